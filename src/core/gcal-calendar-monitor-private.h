@@ -0,0 +1,64 @@
+/* gcal-calendar-monitor-private.h
+ *
+ * Copyright 2024 Georges Basile Stavracas Neto <georges.stavracas@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include "gcal-calendar-monitor.h"
+
+#include <libecal/libecal.h>
+
+G_BEGIN_DECLS
+
+/*
+ * Recurrence rules without COUNT or UNTIL and with a very small interval
+ * (e.g. FREQ=MINUTELY) can generate hundreds of thousands of instances in
+ * a single month. Only the first MAX_INSTANCES_PER_SERIES instances of a
+ * series are turned into events; the remaining ones are only counted, up
+ * to MAX_HIDDEN_INSTANCES_PER_SERIES, and then the expansion stops.
+ */
+#define MAX_INSTANCES_PER_SERIES 1000
+#define MAX_HIDDEN_INSTANCES_PER_SERIES (4 * MAX_INSTANCES_PER_SERIES)
+
+guint                gcal_calendar_monitor_estimate_n_instances  (ICalComponent      *icomponent,
+                                                                  time_t              range_start,
+                                                                  time_t              range_end);
+
+/*
+ * Generates the instances of @icomponent, calling @callback for each of
+ * them, like e_cal_client_generate_instances_for_object_sync() does.
+ */
+typedef void        (*GcalGenerateInstancesFunc)                 (ICalComponent       *icomponent,
+                                                                  time_t               range_start,
+                                                                  time_t               range_end,
+                                                                  GCancellable        *cancellable,
+                                                                  ECalRecurInstanceCb  callback,
+                                                                  gpointer             callback_data,
+                                                                  gpointer             user_data);
+
+GPtrArray*           gcal_calendar_monitor_expand_series         (GcalCalendar              *calendar,
+                                                                  ICalComponent             *icomponent,
+                                                                  time_t                     range_start,
+                                                                  time_t                     range_end,
+                                                                  GcalGenerateInstancesFunc  generate_func,
+                                                                  gpointer                   generate_data,
+                                                                  GCancellable              *cancellable,
+                                                                  guint                     *out_n_hidden_instances);
+
+G_END_DECLS
@@ -21,14 +21,22 @@
 #define G_LOG_DOMAIN "GcalCalendarMonitor"
 
 #include "gcal-calendar-monitor.h"
+#include "gcal-calendar-monitor-private.h"
 #include "gcal-core-macros.h"
 #include "gcal-date-time-utils.h"
 #include "gcal-debug.h"
 #include "gcal-event.h"
+#include "gcal-memory-stats.h"
 
 #include <gio/gio.h>
 #include <libecal/libecal.h>
 
+/*
+ * Once the expanded instances pending to be added reach this size, they
+ * are sent to the main thread instead of waiting for the remaining series.
+ */
+#define EXPANSION_CHUNK_SIZE 250
+
 typedef struct
 {
   GcalCalendarMonitor *monitor;
@@ -83,6 +91,16 @@ struct _GcalCalendarMonitor
     GcalRange        *range;
     gchar            *filter;
   } shared;
+
+  /*
+   * Series that hit MAX_INSTANCES_PER_SERIES, and how many of their
+   * instances are hidden. Written by the monitor thread, and read by
+   * the main thread.
+   */
+  struct {
+    GMutex            lock;
+    GHashTable       *hidden_instances; /* gchar* -> guint */
+  } truncated;
 };
 
 static gboolean      add_events_to_timeline_in_idle_cb           (gpointer           user_data);
@@ -261,49 +279,193 @@ set_complete_in_idle (GcalCalendarMonitor *self,
 
 typedef struct
 {
-  GcalCalendarMonitor *monitor;
+  GcalCalendar        *calendar;
+  ICalComponent       *icomponent;
   GPtrArray           *expanded_events;
+  guint                n_instances;
+  guint                n_hidden_instances;
 } GenerateRecurrencesData;
 
+static gchar*
+get_series_id (GcalCalendarMonitor *self,
+               ICalComponent       *icomponent)
+{
+  return g_strdup_printf ("%s:%s",
+                          gcal_calendar_get_id (self->calendar),
+                          i_cal_component_get_uid (icomponent));
+}
+
+static void
+set_series_hidden_instances (GcalCalendarMonitor *self,
+                             const gchar         *series_id,
+                             guint                n_hidden_instances)
+{
+  g_autoptr (GMutexLocker) locker = NULL;
+
+  locker = g_mutex_locker_new (&self->truncated.lock);
+
+  if (n_hidden_instances > 0)
+    {
+      g_hash_table_insert (self->truncated.hidden_instances,
+                           g_strdup (series_id),
+                           GUINT_TO_POINTER (n_hidden_instances));
+    }
+  else
+    {
+      g_hash_table_remove (self->truncated.hidden_instances, series_id);
+    }
+}
+
+/*
+ * ECalClient builds a component for each instance of a recurring event, with
+ * its DTSTART, DTEND and RECURRENCE-ID patched, and that component can be
+ * adopted by the event. Non-recurring events, and calendars that store each
+ * instance separately, are passed as the original component instead, which
+ * is owned by the caller and must be cloned.
+ */
+static GcalEvent*
+create_instance (GcalCalendar   *calendar,
+                 ICalComponent  *instance,
+                 gboolean        is_private_copy,
+                 GError        **error)
+{
+  g_autoptr (ECalComponent) ecomponent = NULL;
+
+  if (is_private_copy)
+    ecomponent = e_cal_component_new_from_icalcomponent (g_object_ref (instance));
+  else
+    ecomponent = e_cal_component_new_from_icalcomponent (i_cal_component_clone (instance));
+
+  if (!ecomponent)
+    return NULL;
+
+  return gcal_event_new (calendar, ecomponent, error);
+}
+
 static gboolean
-client_instance_generated_cb (ICalComponent  *icomponent,
-                              ICalTime       *instance_start,
-                              ICalTime       *instance_end,
-                              gpointer        user_data,
-                              GCancellable   *cancellable,
-                              GError        **error)
+instance_generated_cb (ICalComponent  *icomponent,
+                       ICalTime       *instance_start,
+                       ICalTime       *instance_end,
+                       gpointer        user_data,
+                       GCancellable   *cancellable,
+                       GError        **error)
 {
   g_autoptr (GcalEvent) event = NULL;
   g_autoptr (GError) local_error = NULL;
   GenerateRecurrencesData *data;
-  GcalCalendarMonitor *self;
-  ECalComponent *ecomponent;
 
   data = user_data;
-  self = data->monitor;
-
-  g_assert (GCAL_IS_THREAD (self->thread));
 
   if (g_cancellable_set_error_if_cancelled (cancellable, error))
     return FALSE;
 
-  ecomponent = e_cal_component_new_from_icalcomponent (i_cal_component_clone (icomponent));
-  if (!ecomponent)
-    return TRUE;
+  /* Past the budget, instances are only counted */
+  if (data->n_instances >= MAX_INSTANCES_PER_SERIES)
+    {
+      data->n_hidden_instances++;
+      return data->n_hidden_instances < MAX_HIDDEN_INSTANCES_PER_SERIES;
+    }
 
-  event = gcal_event_new (self->calendar, ecomponent, &local_error);
-  g_clear_object (&ecomponent);
+  data->n_instances++;
+
+  event = create_instance (data->calendar, icomponent, icomponent != data->icomponent, &local_error);
   if (local_error)
     {
-      g_propagate_error (error, local_error);
+      g_propagate_error (error, g_steal_pointer (&local_error));
       return TRUE;
     }
 
-  g_ptr_array_add (data->expanded_events, g_steal_pointer (&event));
+  if (event)
+    g_ptr_array_add (data->expanded_events, g_steal_pointer (&event));
 
   return TRUE;
 }
 
+/*
+ * Instances are usually generated in order, but that is up to the
+ * calendar backend.
+ */
+static GcalEvent*
+find_last_event (GPtrArray *events)
+{
+  GcalEvent *last_event;
+  guint i;
+
+  last_event = g_ptr_array_index (events, 0);
+
+  for (i = 1; i < events->len; i++)
+    {
+      GcalEvent *event = g_ptr_array_index (events, i);
+
+      if (g_date_time_compare (gcal_event_get_date_start (event), gcal_event_get_date_start (last_event)) > 0)
+        last_event = event;
+    }
+
+  return last_event;
+}
+
+static void
+client_generate_instances (ICalComponent       *icomponent,
+                           time_t               range_start,
+                           time_t               range_end,
+                           GCancellable        *cancellable,
+                           ECalRecurInstanceCb  callback,
+                           gpointer             callback_data,
+                           gpointer             user_data)
+{
+  e_cal_client_generate_instances_for_object_sync (E_CAL_CLIENT (user_data),
+                                                   icomponent,
+                                                   range_start,
+                                                   range_end,
+                                                   cancellable,
+                                                   callback,
+                                                   callback_data);
+}
+
+/*
+ * Returns the instances of @icomponent within the range, in an array
+ * sized after the recurrence rule so that it is filled in a single pass.
+ */
+static GPtrArray*
+expand_recurrences (GcalCalendarMonitor *self,
+                    ECalClient          *client,
+                    ICalComponent       *icomponent,
+                    time_t               range_start_time,
+                    time_t               range_end_time)
+{
+  g_autoptr (GPtrArray) expanded_events = NULL;
+  g_autofree gchar *series_id = NULL;
+  guint n_hidden_instances;
+
+  g_assert (GCAL_IS_THREAD (self->thread));
+
+  expanded_events = gcal_calendar_monitor_expand_series (self->calendar,
+                                                         icomponent,
+                                                         range_start_time,
+                                                         range_end_time,
+                                                         client_generate_instances,
+                                                         client,
+                                                         self->cancellable,
+                                                         &n_hidden_instances);
+
+  if (g_cancellable_is_cancelled (self->cancellable))
+    return g_steal_pointer (&expanded_events);
+
+  series_id = get_series_id (self, icomponent);
+  set_series_hidden_instances (self, series_id, n_hidden_instances);
+
+  if (n_hidden_instances > 0)
+    {
+      g_debug ("Recurring event %s has too many instances, showing %u and hiding %u%s",
+               series_id,
+               expanded_events->len,
+               n_hidden_instances,
+               n_hidden_instances >= MAX_HIDDEN_INSTANCES_PER_SERIES ? " or more" : "");
+    }
+
+  return g_steal_pointer (&expanded_events);
+}
+
 static void
 on_client_view_objects_added_cb (ECalClientView      *view,
                                  const GSList        *objects,
@@ -323,7 +485,7 @@ on_client_view_objects_added_cb (ECalClientView      *view,
 
   maybe_init_event_arrays (self);
   components_to_expand = g_ptr_array_new ();
-  events_to_add = g_ptr_array_new_with_free_func (g_object_unref);
+  events_to_add = g_ptr_array_new_full (g_slist_length ((GSList *) objects), g_object_unref);
 
   for (l = objects; l; l = l->next)
     {
@@ -392,47 +554,39 @@ on_client_view_objects_added_cb (ECalClientView      *view,
       /* Generate the instances */
       for (i = 0; i < components_to_expand->len; i++)
         {
-          GenerateRecurrencesData recurrences_data;
           ICalComponent *icomponent;
-#if GCAL_ENABLE_TRACE
-          gint old_size;
-#endif
 
           if (g_cancellable_is_cancelled (self->cancellable))
             return;
 
           icomponent = g_ptr_array_index (components_to_expand, i);
 
-          recurrences_data.monitor = self;
-
           if (!self->monitor_thread.populated)
-            recurrences_data.expanded_events = self->monitor_thread.events_to_add;
-          else
-            recurrences_data.expanded_events = events_to_add;
-
-#if GCAL_ENABLE_TRACE
-          old_size = recurrences_data.expanded_events->len;
-#endif
+            {
+              g_ptr_array_extend_and_steal (self->monitor_thread.events_to_add,
+                                            expand_recurrences (self,
+                                                                client,
+                                                                icomponent,
+                                                                range_start_time,
+                                                                range_end_time));
+              continue;
+            }
 
-          e_cal_client_generate_instances_for_object_sync (client,
-                                                           icomponent,
-                                                           range_start_time,
-                                                           range_end_time,
-                                                           self->cancellable,
-                                                           client_instance_generated_cb,
-                                                           &recurrences_data);
+          g_ptr_array_extend_and_steal (events_to_add,
+                                        expand_recurrences (self,
+                                                            client,
+                                                            icomponent,
+                                                            range_start_time,
+                                                            range_end_time));
 
-#if GCAL_ENABLE_TRACE
+          /* Don't hold already expanded instances while expanding the next series */
+          if (events_to_add->len >= EXPANSION_CHUNK_SIZE)
             {
-              g_autofree gchar *range_str = gcal_range_to_string (range);
+              add_events_in_idle (self, events_to_add);
 
-              GCAL_TRACE_MSG ("Component %s (%s) added %d instance(s) between %s",
-                              i_cal_component_get_summary (icomponent),
-                              i_cal_component_get_uid (icomponent),
-                              recurrences_data.expanded_events->len - old_size,
-                              range_str);
+              g_clear_pointer (&events_to_add, g_ptr_array_unref);
+              events_to_add = g_ptr_array_new_with_free_func (g_object_unref);
             }
-#endif
         }
     }
 
@@ -511,6 +665,9 @@ on_client_view_objects_modified_cb (ECalClientView      *view,
           GHashTableIter iter;
           const gchar *aux;
 
+          /* Recurring events will set it again when expanded */
+          set_series_hidden_instances (self, event_id, 0);
+
           g_hash_table_iter_init (&iter, self->shared.events);
           while (g_hash_table_iter_next (&iter, (gpointer*) &aux, NULL))
             {
@@ -571,43 +728,19 @@ on_client_view_objects_modified_cb (ECalClientView      *view,
       /* Generate the instances */
       for (guint i = 0; i < components_to_expand->len; i++)
         {
-          GenerateRecurrencesData recurrences_data;
           ICalComponent *icomponent;
-#if GCAL_ENABLE_TRACE
-          gint old_size;
-#endif
 
           if (g_cancellable_is_cancelled (self->cancellable))
             return;
 
           icomponent = g_ptr_array_index (components_to_expand, i);
 
-          recurrences_data.monitor = self;
-          recurrences_data.expanded_events = expanded_events;
-
-#if GCAL_ENABLE_TRACE
-          old_size = expanded_events->len;
-#endif
-
-          e_cal_client_generate_instances_for_object_sync (client,
-                                                           icomponent,
-                                                           range_start_time,
-                                                           range_end_time,
-                                                           self->cancellable,
-                                                           client_instance_generated_cb,
-                                                           &recurrences_data);
-
-#if GCAL_ENABLE_TRACE
-            {
-              g_autofree gchar *range_str = gcal_range_to_string (range);
-
-              GCAL_TRACE_MSG ("Component %s (%s) added %d instance(s) between %s",
-                              i_cal_component_get_summary (icomponent),
-                              i_cal_component_get_uid (icomponent),
-                              expanded_events->len - old_size,
-                              range_str);
-            }
-#endif
+          g_ptr_array_extend_and_steal (expanded_events,
+                                        expand_recurrences (self,
+                                                            client,
+                                                            icomponent,
+                                                            range_start_time,
+                                                            range_end_time));
         }
 
       for (guint i = 0; i < expanded_events->len; i++)
@@ -686,6 +819,8 @@ on_client_view_objects_removed_cb (ECalClientView      *view,
                                       gcal_calendar_get_id (self->calendar),
                                       e_cal_component_id_get_uid (component_id));
 
+          set_series_hidden_instances (self, event_id, 0);
+
           /*
            * If this is the main component, remove the expanded recurrency instances
            * as well.
@@ -753,6 +888,10 @@ create_view (GcalCalendarMonitor *self)
   g_assert (self->cancellable == NULL);
   self->cancellable = g_cancellable_new ();
 
+  g_mutex_lock (&self->truncated.lock);
+  g_hash_table_remove_all (self->truncated.hidden_instances);
+  g_mutex_unlock (&self->truncated.lock);
+
   if (!self->shared.range)
     GCAL_RETURN ();
 
@@ -956,6 +1095,13 @@ calendar_view_thread_func (gpointer data)
  * Auxiliary methods
  */
 
+static inline gsize
+cache_entry_size (const gchar *event_id)
+{
+  /* The key, and the pointers stored by the hash table */
+  return strlen (event_id) + 1 + 2 * sizeof (gpointer) + sizeof (guint);
+}
+
 static void
 notify_view_thread (GcalCalendarMonitor *self,
                     MonitorThreadEvent   event)
@@ -1009,6 +1155,8 @@ remove_events_outside_range (GcalCalendarMonitor *self,
       if (gcal_range_calculate_overlap (range, event_range, NULL) != GCAL_RANGE_NO_OVERLAP)
         continue;
 
+      gcal_memory_stats_remove (GCAL_MEMORY_MONITOR_CACHE, 1, cache_entry_size (gcal_event_get_uid (event)));
+
       g_ptr_array_add (events_to_remove, event);
       g_hash_table_iter_steal (&iter);
     }
@@ -1031,6 +1179,13 @@ remove_all_events (GcalCalendarMonitor *self)
 
   events_to_remove = g_hash_table_steal_all_values (self->shared.events);
 
+  for (guint i = 0; i < events_to_remove->len; i++)
+    {
+      GcalEvent *event = g_ptr_array_index (events_to_remove, i);
+
+      gcal_memory_stats_remove (GCAL_MEMORY_MONITOR_CACHE, 1, cache_entry_size (gcal_event_get_uid (event)));
+    }
+
   if (events_to_remove->len > 0)
     self->listener->remove_events (self, events_to_remove, self->listener_user_data);
 }
@@ -1059,7 +1214,9 @@ static gboolean
 add_events_to_timeline_in_idle_cb (gpointer user_data)
 {
   g_autoptr (GRWLockWriterLocker) writer_locker = NULL;
+  g_autoptr (GPtrArray) events_to_update = NULL;
   g_autoptr (GPtrArray) events_to_add = NULL;
+  g_autoptr (GPtrArray) old_events = NULL;
   GcalCalendarMonitor *self;
   GPtrArray *events;
   IdleData *idle_data;
@@ -1074,26 +1231,42 @@ add_events_to_timeline_in_idle_cb (gpointer user_data)
   g_assert (idle_data->event_ids == NULL);
 
   events_to_add = g_ptr_array_sized_new (events->len);
+  events_to_update = g_ptr_array_new ();
+  old_events = g_ptr_array_new_with_free_func (g_object_unref);
 
   writer_locker = g_rw_lock_writer_locker_new (&self->shared.lock);
   for (guint i = 0; i < events->len; i++)
     {
+      GcalEvent *cached_event;
       GcalEvent *event;
       const gchar *uid;
 
       event = g_ptr_array_index (events, i);
       uid = gcal_event_get_uid (event);
+      cached_event = g_hash_table_lookup (self->shared.events, uid);
 
-      if (!g_hash_table_contains (self->shared.events, uid))
+      if (!cached_event)
         {
           g_hash_table_insert (self->shared.events, g_strdup (uid), g_object_ref (event));
           g_ptr_array_add (events_to_add, event);
+
+          gcal_memory_stats_add (GCAL_MEMORY_MONITOR_CACHE, 1, cache_entry_size (uid));
+        }
+      else if (gcal_event_get_n_hidden_occurrences (cached_event) != gcal_event_get_n_hidden_occurrences (event))
+        {
+          /* A re-expanded series may end at a different instance */
+          g_ptr_array_add (old_events, g_object_ref (cached_event));
+          g_ptr_array_add (events_to_update, event);
+          g_hash_table_insert (self->shared.events, g_strdup (uid), g_object_ref (event));
         }
     }
 
   if (events_to_add->len > 0)
     self->listener->add_events (self, events_to_add, self->listener_user_data);
 
+  if (events_to_update->len > 0)
+    self->listener->update_events (self, old_events, events_to_update, self->listener_user_data);
+
   GCAL_RETURN (G_SOURCE_REMOVE);
 }
 
@@ -1184,6 +1357,8 @@ remove_events_from_timeline_in_idle_cb (gpointer user_data)
           /* Keep the event alive until the listener process it*/
           g_ptr_array_add (events_to_remove, g_object_ref (event));
           g_hash_table_remove (self->shared.events, event_id);
+
+          gcal_memory_stats_remove (GCAL_MEMORY_MONITOR_CACHE, 1, cache_entry_size (event_id));
         }
     }
 
@@ -1267,6 +1442,10 @@ gcal_calendar_monitor_finalize (GObject *object)
   g_clear_pointer (&self->shared.events, g_hash_table_destroy);
   g_clear_pointer (&self->shared.filter, g_free);
   g_clear_pointer (&self->shared.range, gcal_range_unref);
+  g_clear_pointer (&self->truncated.hidden_instances, g_hash_table_destroy);
+
+  g_rw_lock_clear (&self->shared.lock);
+  g_mutex_clear (&self->truncated.lock);
 
   G_OBJECT_CLASS (gcal_calendar_monitor_parent_class)->finalize (object);
 }
@@ -1354,7 +1533,10 @@ gcal_calendar_monitor_init (GcalCalendarMonitor *self)
   self->messages = g_async_queue_new ();
   self->complete = FALSE;
 
+  self->truncated.hidden_instances = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
   g_rw_lock_init (&self->shared.lock);
+  g_mutex_init (&self->truncated.lock);
 }
 
 GcalCalendarMonitor*
@@ -1476,3 +1658,194 @@ gcal_calendar_monitor_is_complete (GcalCalendarMonitor *self)
 
   return self->complete;
 }
+
+/**
+ * gcal_calendar_monitor_get_n_truncated:
+ * @self: a #GcalCalendarMonitor
+ *
+ * Retrieves the number of recurring events in the current range
+ * that have more instances than @self is willing to expand. Only
+ * the first instances of these series are added to the timeline.
+ *
+ * Returns: the number of truncated recurring events
+ */
+guint
+gcal_calendar_monitor_get_n_truncated (GcalCalendarMonitor *self)
+{
+  g_autoptr (GMutexLocker) locker = NULL;
+
+  g_return_val_if_fail (GCAL_IS_CALENDAR_MONITOR (self), 0);
+
+  locker = g_mutex_locker_new (&self->truncated.lock);
+
+  return g_hash_table_size (self->truncated.hidden_instances);
+}
+
+/**
+ * gcal_calendar_monitor_get_n_hidden:
+ * @self: a #GcalCalendarMonitor
+ * @series_id: the id of a recurring #GcalEvent, without the recurrence id
+ *
+ * Retrieves the number of instances of the recurring event @series_id
+ * that were not expanded because the series exceeded its budget. The
+ * same count is set on the last expanded instance of the series, see
+ * gcal_event_get_n_hidden_occurrences(). The count itself is capped, so
+ * the actual number of hidden instances may be larger.
+ *
+ * Returns: the number of hidden instances, or 0 if @series_id wasn't
+ * truncated
+ */
+guint
+gcal_calendar_monitor_get_n_hidden (GcalCalendarMonitor *self,
+                                    const gchar         *series_id)
+{
+  g_autoptr (GMutexLocker) locker = NULL;
+
+  g_return_val_if_fail (GCAL_IS_CALENDAR_MONITOR (self), 0);
+  g_return_val_if_fail (series_id != NULL, 0);
+
+  locker = g_mutex_locker_new (&self->truncated.lock);
+
+  return GPOINTER_TO_UINT (g_hash_table_lookup (self->truncated.hidden_instances, series_id));
+}
+
+/*
+ * Private API
+ */
+
+/*
+ * gcal_calendar_monitor_estimate_n_instances:
+ *
+ * Estimates the number of instances that the recurrence rule of
+ * @icomponent generates between @range_start and @range_end. This
+ * is only used to size arrays, so it ignores BY* rules and EXDATEs.
+ */
+guint
+gcal_calendar_monitor_estimate_n_instances (ICalComponent *icomponent,
+                                            time_t         range_start,
+                                            time_t         range_end)
+{
+  g_autoptr (ICalRecurrence) recurrence = NULL;
+  g_autoptr (ICalProperty) property = NULL;
+  gint64 estimate;
+  gint64 period;
+  gint interval;
+  gint count;
+
+  property = i_cal_component_get_first_property (icomponent, I_CAL_RRULE_PROPERTY);
+  if (!property)
+    return 1;
+
+  recurrence = i_cal_property_get_rrule (property);
+  if (!recurrence)
+    return 1;
+
+  switch (i_cal_recurrence_get_freq (recurrence))
+    {
+    case I_CAL_SECONDLY_RECURRENCE:
+      period = 1;
+      break;
+
+    case I_CAL_MINUTELY_RECURRENCE:
+      period = 60;
+      break;
+
+    case I_CAL_HOURLY_RECURRENCE:
+      period = 60 * 60;
+      break;
+
+    case I_CAL_DAILY_RECURRENCE:
+      period = 24 * 60 * 60;
+      break;
+
+    case I_CAL_WEEKLY_RECURRENCE:
+      period = 7 * 24 * 60 * 60;
+      break;
+
+    case I_CAL_MONTHLY_RECURRENCE:
+      period = 28 * 24 * 60 * 60;
+      break;
+
+    case I_CAL_YEARLY_RECURRENCE:
+      period = 365 * 24 * 60 * 60;
+      break;
+
+    case I_CAL_NO_RECURRENCE:
+    default:
+      return 1;
+    }
+
+  interval = MAX (1, i_cal_recurrence_get_interval (recurrence));
+  estimate = MAX (0, (gint64) range_end - (gint64) range_start) / (period * interval) + 1;
+
+  count = i_cal_recurrence_get_count (recurrence);
+  if (count > 0)
+    estimate = MIN (estimate, count);
+
+  return CLAMP (estimate, 1, MAX_INSTANCES_PER_SERIES);
+}
+
+/*
+ * gcal_calendar_monitor_expand_series:
+ *
+ * Expands @icomponent into the events of its instances between @range_start
+ * and @range_end, using @generate_func to generate the instances. At most
+ * MAX_INSTANCES_PER_SERIES events are created, and the instances past that
+ * are counted in @out_n_hidden_instances. The count is also set on the
+ * last created event, so that views can tell about the hidden instances
+ * right after it.
+ *
+ * The monitor generates instances with ECalClient. Tests and benchmarks pass
+ * a function that mimics it, since ECalClient needs a running E-D-S.
+ *
+ * Returns: (transfer full): a #GPtrArray with the #GcalEvent of the instances
+ */
+GPtrArray*
+gcal_calendar_monitor_expand_series (GcalCalendar              *calendar,
+                                     ICalComponent             *icomponent,
+                                     time_t                     range_start,
+                                     time_t                     range_end,
+                                     GcalGenerateInstancesFunc  generate_func,
+                                     gpointer                   generate_data,
+                                     GCancellable              *cancellable,
+                                     guint                     *out_n_hidden_instances)
+{
+  GenerateRecurrencesData recurrences_data;
+  guint estimated_instances;
+
+  estimated_instances = gcal_calendar_monitor_estimate_n_instances (icomponent, range_start, range_end);
+
+  recurrences_data.calendar = calendar;
+  recurrences_data.icomponent = icomponent;
+  recurrences_data.expanded_events = g_ptr_array_new_full (estimated_instances, g_object_unref);
+  recurrences_data.n_instances = 0;
+  recurrences_data.n_hidden_instances = 0;
+
+  generate_func (icomponent,
+                 range_start,
+                 range_end,
+                 cancellable,
+                 instance_generated_cb,
+                 &recurrences_data,
+                 generate_data);
+
+  GCAL_TRACE_MSG ("Component %s (%s) added %u instance(s) (estimated %u), %u hidden",
+                  i_cal_component_get_summary (icomponent),
+                  i_cal_component_get_uid (icomponent),
+                  recurrences_data.n_instances,
+                  estimated_instances,
+                  recurrences_data.n_hidden_instances);
+
+  if (recurrences_data.n_hidden_instances > 0 && recurrences_data.expanded_events->len > 0)
+    {
+      GcalEvent *last_event;
+
+      last_event = find_last_event (recurrences_data.expanded_events);
+      gcal_event_set_n_hidden_occurrences (last_event, recurrences_data.n_hidden_instances);
+    }
+
+  if (out_n_hidden_instances)
+    *out_n_hidden_instances = recurrences_data.n_hidden_instances;
+
+  return recurrences_data.expanded_events;
+}
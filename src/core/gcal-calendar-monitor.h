@@ -60,4 +60,9 @@ void                 gcal_calendar_monitor_set_filter            (GcalCalendarMo
 
 gboolean             gcal_calendar_monitor_is_complete           (GcalCalendarMonitor *self);
 
+guint                gcal_calendar_monitor_get_n_truncated       (GcalCalendarMonitor *self);
+
+guint                gcal_calendar_monitor_get_n_hidden          (GcalCalendarMonitor *self,
+                                                                  const gchar         *series_id);
+
 G_END_DECLS
@@ -24,20 +24,43 @@
 
 #include <gio/gio.h>
 
+#ifdef __linux__
+#include <glib-unix.h>
+#include <sys/timerfd.h>
+#include <errno.h>
+#include <unistd.h>
+#endif
+
 struct _GcalClock
 {
   GObject             parent;
 
   guint               timeout_id;
 
+  /*
+   * Minute ticks are only needed while someone is displaying the time,
+   * so the timeout is only scheduled while the clock is held.
+   */
+  guint               hold_count;
+
   GDateTime          *current;
 
+  /* Watches for wall clock changes, e.g. from NTP or the user */
+  gint                time_changed_fd;
+  guint               time_changed_id;
+
   GDBusProxy         *proxy;
   GCancellable       *cancellable;
 };
 
 static gboolean      timeout_cb                                  (gpointer user_data);
 
+#ifdef __linux__
+static gboolean      time_changed_cb                             (gint         fd,
+                                                                  GIOCondition condition,
+                                                                  gpointer     user_data);
+#endif
+
 G_DEFINE_TYPE (GcalClock, gcal_clock, G_TYPE_OBJECT)
 
 enum
@@ -50,6 +73,15 @@ enum
 
 static guint signals[NUM_SIGNALS] = { 0, };
 
+enum
+{
+  PROP_0,
+  PROP_ACTIVE,
+  N_PROPS
+};
+
+static GParamSpec *properties [N_PROPS];
+
 /*
  * Auxiliary methods
  */
@@ -95,25 +127,104 @@ schedule_update_timeout (GcalClock *self)
   guint seconds_between;
 
   /* Remove the previous timeout if we came from resume */
-  if (self->timeout_id > 0)
-    {
-      g_source_remove (self->timeout_id);
-      self->timeout_id = 0;
-    }
+  g_clear_handle_id (&self->timeout_id, g_source_remove);
+
+  if (self->hold_count == 0)
+    return;
 
   now = g_date_time_new_now_local ();
 
   seconds_between = 60 - g_date_time_get_second (now);
 
+  /*
+   * Second-granularity timeouts are coalesced with other wakeups of the
+   * session, which is precise enough for a minute clock.
+   */
   self->timeout_id = g_timeout_add_seconds (seconds_between, timeout_cb, self);
 
   g_debug ("Scheduling update for %d seconds", seconds_between);
 }
 
+static void
+catch_up (GcalClock *self)
+{
+  /* Emits each signal at most once, no matter how much time was skipped */
+  update_current_date (self);
+  schedule_update_timeout (self);
+}
+
+#ifdef __linux__
+static gboolean
+arm_time_changed_fd (GcalClock *self)
+{
+  struct itimerspec spec = { 0, };
+
+  /*
+   * An absolute timer that never expires, but is cancelled every time
+   * the realtime clock is set, making the file descriptor readable.
+   */
+  spec.it_value.tv_sec = G_MAXINT32;
+
+  return timerfd_settime (self->time_changed_fd,
+                          TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET,
+                          &spec,
+                          NULL) == 0;
+}
+
+static void
+setup_time_changed_watch (GcalClock *self)
+{
+  self->time_changed_fd = timerfd_create (CLOCK_REALTIME, TFD_NONBLOCK | TFD_CLOEXEC);
+
+  if (self->time_changed_fd < 0)
+    return;
+
+  if (!arm_time_changed_fd (self))
+    {
+      close (self->time_changed_fd);
+      self->time_changed_fd = -1;
+      return;
+    }
+
+  self->time_changed_id = g_unix_fd_add (self->time_changed_fd, G_IO_IN, time_changed_cb, self);
+}
+#endif
+
 /*
  * Callbacks
  */
 
+#ifdef __linux__
+static gboolean
+time_changed_cb (gint         fd,
+                 GIOCondition condition,
+                 gpointer     user_data)
+{
+  GcalClock *self = user_data;
+  guint64 expirations;
+
+  /* The read fails with ECANCELED when the clock was set */
+  if (read (fd, &expirations, sizeof (expirations)) < 0 && errno != ECANCELED && errno != EAGAIN)
+    {
+      self->time_changed_id = 0;
+      return G_SOURCE_REMOVE;
+    }
+
+  if (!arm_time_changed_fd (self))
+    {
+      self->time_changed_id = 0;
+      return G_SOURCE_REMOVE;
+    }
+
+  g_debug ("Wall clock changed");
+
+  if (self->hold_count > 0)
+    catch_up (self);
+
+  return G_SOURCE_CONTINUE;
+}
+#endif
+
 static gboolean
 timeout_cb (gpointer user_data)
 {
@@ -143,12 +254,9 @@ logind_signal_received_cb (GDBusProxy  *logind,
   child = g_variant_get_child_value (params, 0);
   resuming = !g_variant_get_boolean (child);
 
-  /* Only emit :update when resuming */
-  if (resuming)
-    {
-      update_current_date (self);
-      schedule_update_timeout (self);
-    }
+  /* Only catch up when resuming, and when someone is listening */
+  if (resuming && self->hold_count > 0)
+    catch_up (self);
 
   g_clear_pointer (&child, g_variant_unref);
 }
@@ -189,11 +297,13 @@ gcal_clock_finalize (GObject *object)
 
   g_cancellable_cancel (self->cancellable);
 
-  if (self->timeout_id > 0)
-    {
-      g_source_remove (self->timeout_id);
-      self->timeout_id = 0;
-    }
+  g_clear_handle_id (&self->timeout_id, g_source_remove);
+  g_clear_handle_id (&self->time_changed_id, g_source_remove);
+
+#ifdef __linux__
+  if (self->time_changed_fd >= 0)
+    close (self->time_changed_fd);
+#endif
 
   gcal_clear_date_time (&self->current);
 
@@ -209,7 +319,17 @@ gcal_clock_get_property (GObject    *object,
                          GValue     *value,
                          GParamSpec *pspec)
 {
-  G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+  GcalClock *self = GCAL_CLOCK (object);
+
+  switch (prop_id)
+    {
+    case PROP_ACTIVE:
+      g_value_set_boolean (value, gcal_clock_is_active (self));
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
 }
 
 static void
@@ -230,6 +350,19 @@ gcal_clock_class_init (GcalClockClass *klass)
   object_class->get_property = gcal_clock_get_property;
   object_class->set_property = gcal_clock_set_property;
 
+  /**
+   * GcalClock:active:
+   *
+   * Whether the clock is held, and emits minute ticks.
+   */
+  properties[PROP_ACTIVE] = g_param_spec_boolean ("active",
+                                                  "Active",
+                                                  "Whether the clock is held",
+                                                  FALSE,
+                                                  G_PARAM_READABLE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
+
+  g_object_class_install_properties (object_class, N_PROPS, properties);
+
   signals[DAY_CHANGED] = g_signal_new ("day-changed",
                                        GCAL_TYPE_CLOCK,
                                        G_SIGNAL_RUN_LAST,
@@ -257,6 +390,7 @@ gcal_clock_init (GcalClock *self)
 {
   self->current = g_date_time_new_now_local ();
   self->cancellable = g_cancellable_new ();
+  self->time_changed_fd = -1;
 
   g_dbus_proxy_new_for_bus (G_BUS_TYPE_SYSTEM,
                             G_DBUS_PROXY_FLAGS_NONE,
@@ -268,7 +402,9 @@ gcal_clock_init (GcalClock *self)
                             login_proxy_acquired_cb,
                             self);
 
-  schedule_update_timeout (self);
+#ifdef __linux__
+  setup_time_changed_watch (self);
+#endif
 }
 
 /**
@@ -283,3 +419,66 @@ gcal_clock_new (void)
 {
   return g_object_new (GCAL_TYPE_CLOCK, NULL);
 }
+
+/**
+ * gcal_clock_hold:
+ * @self: a #GcalClock
+ *
+ * Marks the clock as in use, e.g. because a window displaying
+ * the current time is mapped. While the clock is not held, no
+ * ticks are emitted; holding it again emits a single catch-up
+ * of ::day-changed, ::hour-changed and ::minute-changed, as
+ * needed.
+ */
+void
+gcal_clock_hold (GcalClock *self)
+{
+  g_return_if_fail (GCAL_IS_CLOCK (self));
+
+  if (self->hold_count++ > 0)
+    return;
+
+  g_debug ("Resuming clock ticks");
+
+  catch_up (self);
+
+  g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_ACTIVE]);
+}
+
+/**
+ * gcal_clock_release:
+ * @self: a #GcalClock
+ *
+ * Releases a previous hold on the clock with gcal_clock_hold().
+ */
+void
+gcal_clock_release (GcalClock *self)
+{
+  g_return_if_fail (GCAL_IS_CLOCK (self));
+  g_return_if_fail (self->hold_count > 0);
+
+  if (--self->hold_count > 0)
+    return;
+
+  g_debug ("Suspending clock ticks");
+
+  g_clear_handle_id (&self->timeout_id, g_source_remove);
+
+  g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_ACTIVE]);
+}
+
+/**
+ * gcal_clock_is_active:
+ * @self: a #GcalClock
+ *
+ * Retrieves whether @self is held, and thus emits ticks.
+ *
+ * Returns: %TRUE if the clock is held, %FALSE otherwise
+ */
+gboolean
+gcal_clock_is_active (GcalClock *self)
+{
+  g_return_val_if_fail (GCAL_IS_CLOCK (self), FALSE);
+
+  return self->hold_count > 0;
+}
@@ -29,6 +29,12 @@ G_DECLARE_FINAL_TYPE (GcalClock, gcal_clock, GCAL, CLOCK, GObject)
 
 GcalClock*           gcal_clock_new                              (void);
 
+void                 gcal_clock_hold                             (GcalClock          *self);
+
+void                 gcal_clock_release                          (GcalClock          *self);
+
+gboolean             gcal_clock_is_active                        (GcalClock          *self);
+
 G_END_DECLS
 
 #endif /* GCAL_CLOCK_H */
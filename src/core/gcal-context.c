@@ -143,6 +143,15 @@ on_portal_proxy_signal_cb (GDBusProxy  *proxy,
     }
 }
 
+static void
+on_clock_active_changed_cb (GcalClock   *clock,
+                            GParamSpec  *pspec,
+                            GcalContext *self)
+{
+  /* Nobody can see weather reports while the clock isn't held */
+  gcal_weather_service_set_timers_suspended (self->weather_service, !gcal_clock_is_active (clock));
+}
+
 static void
 on_timezone_changed_cb (GcalTimeZoneMonitor *timezone_monitor,
                         GParamSpec          *pspec,
@@ -311,6 +320,13 @@ gcal_context_init (GcalContext *self)
   self->settings = g_settings_new ("org.gnome.calendar");
   self->weather_service = gcal_weather_service_new ();
 
+  gcal_weather_service_set_timers_suspended (self->weather_service, TRUE);
+  g_signal_connect_object (self->clock,
+                           "notify::active",
+                           G_CALLBACK (on_clock_active_changed_cb),
+                           self,
+                           0);
+
   self->timezone_monitor = gcal_time_zone_monitor_new ();
   g_signal_connect_object (self->timezone_monitor,
                            "notify::timezone",
@@ -0,0 +1,963 @@
+/* gcal-event-archive.c
+ *
+ * Copyright 2024 Georges Basile Stavracas Neto <georges.stavracas@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#define G_LOG_DOMAIN "GcalEventArchive"
+
+#include "gcal-event-archive.h"
+
+#include <string.h>
+
+/*
+ * Binary format, all integers little endian:
+ *
+ *   magic             8 bytes, "GCALARC2"
+ *   n_strings         u32
+ *   n_records         u32
+ *   strings_size      u32
+ *   string_offsets    u32 × n_strings
+ *   record_offsets    u32 × n_records
+ *   strings           strings_size bytes of NUL-terminated strings
+ *   records           the remaining bytes
+ *
+ * Every string is stored once in the string table, and records refer to
+ * them by index. String 0 is always the empty string, and means "unset".
+ * Repeated values such as TZIDs, organizers and attendees thus cost one
+ * varint per use.
+ *
+ * Records are sequences of varints:
+ *
+ *   flags, uid, recurrence_id, recurrence_id_tzid, summary, location,
+ *   description, organizer, rrule, start_tzid, start, [end_tzid,
+ *   end - start,] n_attendees, attendee × n_attendees,
+ *   n_recurrence_dates, recurrence_date × n_recurrence_dates,
+ *   n_alarms, alarm × n_alarms
+ *
+ * EXDATE and RDATE properties are stored as recurrence dates, and VALARM
+ * components as alarms, both as iCalendar strings. They're rare compared
+ * to the other fields, and have parameters and subcomponents that would
+ * be lost otherwise.
+ *
+ * Times are the wall clock time in seconds, zigzag encoded; the end is
+ * only present when FLAG_HAS_END is set.
+ */
+
+#define MAGIC "GCALARC2"
+#define MAGIC_SIZE 8
+#define HEADER_SIZE (MAGIC_SIZE + 3 * sizeof (guint32))
+#define UTC_TZID "UTC"
+
+#define FLAG_ALL_DAY (1 << 0)
+#define FLAG_HAS_END (1 << 1)
+
+struct _GcalEventArchiveWriter
+{
+  GHashTable         *string_ids;
+  GString            *strings;
+  GArray             *string_offsets;
+  GByteArray         *records;
+  GArray             *record_offsets;
+};
+
+struct _GcalEventArchive
+{
+  GBytes             *bytes;
+
+  const guint8       *string_offsets;
+  const guint8       *record_offsets;
+  const gchar        *strings;
+  const guint8       *records;
+  gsize               records_size;
+  guint32             n_strings;
+  guint32             n_records;
+  guint32             strings_size;
+};
+
+
+/*
+ * Auxiliary methods
+ */
+
+static inline guint32
+read_uint32 (const guint8 *data)
+{
+  guint32 value;
+
+  memcpy (&value, data, sizeof (guint32));
+
+  return GUINT32_FROM_LE (value);
+}
+
+static inline void
+append_uint32 (GByteArray *array,
+               guint32     value)
+{
+  value = GUINT32_TO_LE (value);
+  g_byte_array_append (array, (const guint8 *) &value, sizeof (guint32));
+}
+
+static inline guint64
+zigzag_encode (gint64 value)
+{
+  return ((guint64) value << 1) ^ (guint64) (value >> 63);
+}
+
+static inline gint64
+zigzag_decode (guint64 value)
+{
+  return (gint64) (value >> 1) ^ -(gint64) (value & 1);
+}
+
+static void
+append_varint (GByteArray *array,
+               guint64     value)
+{
+  guint8 buffer[10];
+  gsize len = 0;
+
+  while (value >= 0x80)
+    {
+      buffer[len++] = (value & 0x7F) | 0x80;
+      value >>= 7;
+    }
+
+  buffer[len++] = value;
+
+  g_byte_array_append (array, buffer, len);
+}
+
+static gboolean
+read_varint (const guint8 *data,
+             gsize         size,
+             gsize        *pos,
+             guint64      *out_value)
+{
+  guint64 value = 0;
+  guint shift;
+
+  for (shift = 0; shift < 64 && *pos < size; shift += 7)
+    {
+      guint8 byte = data[(*pos)++];
+
+      value |= (guint64) (byte & 0x7F) << shift;
+
+      if ((byte & 0x80) == 0)
+        {
+          *out_value = value;
+          return TRUE;
+        }
+    }
+
+  return FALSE;
+}
+
+static guint32
+intern_string (GcalEventArchiveWriter *self,
+               const gchar            *str)
+{
+  gpointer id;
+  guint32 offset;
+
+  if (!str || *str == '\0')
+    return 0;
+
+  if (g_hash_table_lookup_extended (self->string_ids, str, NULL, &id))
+    return GPOINTER_TO_UINT (id);
+
+  offset = self->strings->len;
+  g_string_append_len (self->strings, str, strlen (str) + 1);
+  g_array_append_val (self->string_offsets, offset);
+
+  g_hash_table_insert (self->string_ids, g_strdup (str), GUINT_TO_POINTER (self->string_offsets->len - 1));
+
+  return self->string_offsets->len - 1;
+}
+
+static void
+append_string_list (GcalEventArchiveWriter *self,
+                    GArray                 *ids)
+{
+  guint i;
+
+  append_varint (self->records, ids->len);
+
+  for (i = 0; i < ids->len; i++)
+    append_varint (self->records, g_array_index (ids, guint32, i));
+}
+
+static const gchar*
+get_time_tzid (ICalComponent     *component,
+               ICalPropertyKind   kind,
+               ICalTime          *time)
+{
+  g_autoptr (ICalParameter) parameter = NULL;
+  g_autoptr (ICalProperty) property = NULL;
+
+  if (i_cal_time_is_utc (time))
+    return UTC_TZID;
+
+  property = i_cal_component_get_first_property (component, kind);
+  if (!property)
+    return NULL;
+
+  parameter = i_cal_property_get_first_parameter (property, I_CAL_TZID_PARAMETER);
+  if (!parameter)
+    return NULL;
+
+  return i_cal_parameter_get_tzid (parameter);
+}
+
+static const gchar*
+lookup_string (GcalEventArchive *self,
+               guint64           id)
+{
+  if (id == 0)
+    return NULL;
+
+  return self->strings + read_uint32 (self->string_offsets + id * sizeof (guint32));
+}
+
+static gboolean
+read_string (GcalEventArchive  *self,
+             const guint8      *data,
+             gsize              size,
+             gsize             *pos,
+             const gchar      **out_string)
+{
+  guint64 id;
+
+  if (!read_varint (data, size, pos, &id) || id >= self->n_strings)
+    return FALSE;
+
+  *out_string = lookup_string (self, id);
+
+  return TRUE;
+}
+
+static gboolean
+read_string_list (GcalEventArchive *self,
+                  const guint8     *data,
+                  gsize             size,
+                  gsize             offset,
+                  gsize            *pos,
+                  guint            *out_n_strings,
+                  gsize            *out_list_offset)
+{
+  guint64 n_strings;
+  guint64 id;
+  guint64 i;
+
+  if (!read_varint (data, size, pos, &n_strings) || n_strings > size - *pos)
+    return FALSE;
+
+  *out_n_strings = n_strings;
+  *out_list_offset = offset + *pos;
+
+  /* Lists are only validated here; they're decoded lazily */
+  for (i = 0; i < n_strings; i++)
+    {
+      if (!read_varint (data, size, pos, &id) || id >= self->n_strings)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static const gchar*
+lookup_string_list_item (GcalEventArchive *self,
+                         gsize             list_offset,
+                         guint             index)
+{
+  guint64 id = 0;
+  gsize pos;
+  guint i;
+
+  pos = list_offset;
+
+  for (i = 0; i <= index; i++)
+    read_varint (self->records, self->records_size, &pos, &id);
+
+  return lookup_string (self, id);
+}
+
+static gboolean
+decode_record (GcalEventArchive       *self,
+               guint                   index,
+               GcalEventArchiveRecord *record)
+{
+  const guint8 *data;
+  guint64 flags;
+  guint64 value;
+  gsize offset;
+  gsize size;
+  gsize pos;
+
+  offset = read_uint32 (self->record_offsets + index * sizeof (guint32));
+  if (offset >= self->records_size)
+    return FALSE;
+
+  data = self->records + offset;
+  size = self->records_size - offset;
+  pos = 0;
+
+  if (!read_varint (data, size, &pos, &flags))
+    return FALSE;
+
+  record->all_day = (flags & FLAG_ALL_DAY) != 0;
+  record->has_end = (flags & FLAG_HAS_END) != 0;
+
+  if (!read_string (self, data, size, &pos, &record->uid) ||
+      !read_string (self, data, size, &pos, &record->recurrence_id) ||
+      !read_string (self, data, size, &pos, &record->recurrence_id_tzid) ||
+      !read_string (self, data, size, &pos, &record->summary) ||
+      !read_string (self, data, size, &pos, &record->location) ||
+      !read_string (self, data, size, &pos, &record->description) ||
+      !read_string (self, data, size, &pos, &record->organizer) ||
+      !read_string (self, data, size, &pos, &record->rrule) ||
+      !read_string (self, data, size, &pos, &record->start_tzid) ||
+      !read_varint (data, size, &pos, &value))
+    {
+      return FALSE;
+    }
+
+  record->start = zigzag_decode (value);
+  record->end = record->start;
+  record->end_tzid = NULL;
+
+  if (record->has_end)
+    {
+      if (!read_string (self, data, size, &pos, &record->end_tzid) ||
+          !read_varint (data, size, &pos, &value))
+        {
+          return FALSE;
+        }
+
+      record->end = record->start + zigzag_decode (value);
+    }
+
+  return read_string_list (self, data, size, offset, &pos, &record->n_attendees, &record->attendees_offset) &&
+         read_string_list (self, data, size, offset, &pos, &record->n_recurrence_dates, &record->recurrence_dates_offset) &&
+         read_string_list (self, data, size, offset, &pos, &record->n_alarms, &record->alarms_offset);
+}
+
+static gboolean
+validate_archive (GcalEventArchive  *self,
+                  GError           **error)
+{
+  const guint8 *data;
+  guint64 tables_size;
+  gsize size;
+  guint i;
+
+  data = g_bytes_get_data (self->bytes, &size);
+
+  if (size < HEADER_SIZE || memcmp (data, MAGIC, MAGIC_SIZE) != 0)
+    goto invalid;
+
+  self->n_strings = read_uint32 (data + MAGIC_SIZE);
+  self->n_records = read_uint32 (data + MAGIC_SIZE + sizeof (guint32));
+  self->strings_size = read_uint32 (data + MAGIC_SIZE + 2 * sizeof (guint32));
+
+  tables_size = ((guint64) self->n_strings + self->n_records) * sizeof (guint32);
+
+  if (self->n_strings == 0 || tables_size + self->strings_size > size - HEADER_SIZE)
+    goto invalid;
+
+  self->string_offsets = data + HEADER_SIZE;
+  self->record_offsets = self->string_offsets + self->n_strings * sizeof (guint32);
+  self->strings = (const gchar *) self->record_offsets + self->n_records * sizeof (guint32);
+  self->records = (const guint8 *) self->strings + self->strings_size;
+  self->records_size = size - HEADER_SIZE - tables_size - self->strings_size;
+
+  /* A trailing NUL guarantees every string is terminated within the table */
+  if (self->strings_size == 0 || self->strings[self->strings_size - 1] != '\0')
+    goto invalid;
+
+  for (i = 0; i < self->n_strings; i++)
+    {
+      if (read_uint32 (self->string_offsets + i * sizeof (guint32)) >= self->strings_size)
+        goto invalid;
+    }
+
+  for (i = 0; i < self->n_records; i++)
+    {
+      GcalEventArchiveRecord record;
+
+      if (!decode_record (self, i, &record) || !record.uid)
+        goto invalid;
+    }
+
+  return TRUE;
+
+invalid:
+  g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA, "Invalid event archive");
+  return FALSE;
+}
+
+static ICalProperty*
+build_time_property (ICalPropertyKind  kind,
+                     gint64            wall_clock,
+                     gboolean          all_day,
+                     const gchar      *tzid)
+{
+  g_autoptr (ICalTime) time = NULL;
+  ICalProperty *property;
+
+  time = i_cal_time_new_from_timet_with_zone (wall_clock, all_day, NULL);
+
+  if (g_strcmp0 (tzid, UTC_TZID) == 0)
+    i_cal_time_set_timezone (time, i_cal_timezone_get_utc_timezone ());
+
+  property = i_cal_property_new (kind);
+  if (kind == I_CAL_DTSTART_PROPERTY)
+    i_cal_property_set_dtstart (property, time);
+  else
+    i_cal_property_set_dtend (property, time);
+
+  if (tzid && g_strcmp0 (tzid, UTC_TZID) != 0)
+    i_cal_property_take_parameter (property, i_cal_parameter_new_tzid (tzid));
+
+  return property;
+}
+
+
+/*
+ * Public API
+ */
+
+/**
+ * gcal_event_archive_writer_new:
+ *
+ * Creates a new #GcalEventArchiveWriter.
+ *
+ * Returns: (transfer full): a #GcalEventArchiveWriter
+ */
+GcalEventArchiveWriter*
+gcal_event_archive_writer_new (void)
+{
+  GcalEventArchiveWriter *self;
+  guint32 empty_offset = 0;
+
+  self = g_new0 (GcalEventArchiveWriter, 1);
+  self->string_ids = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  self->strings = g_string_new (NULL);
+  self->string_offsets = g_array_new (FALSE, FALSE, sizeof (guint32));
+  self->records = g_byte_array_new ();
+  self->record_offsets = g_array_new (FALSE, FALSE, sizeof (guint32));
+
+  /* String 0 is the empty string */
+  g_string_append_c (self->strings, '\0');
+  g_array_append_val (self->string_offsets, empty_offset);
+
+  return self;
+}
+
+/**
+ * gcal_event_archive_writer_free:
+ * @self: a #GcalEventArchiveWriter
+ *
+ * Frees @self.
+ */
+void
+gcal_event_archive_writer_free (GcalEventArchiveWriter *self)
+{
+  g_return_if_fail (self);
+
+  g_clear_pointer (&self->string_ids, g_hash_table_destroy);
+  g_string_free (self->strings, TRUE);
+  g_clear_pointer (&self->string_offsets, g_array_unref);
+  g_clear_pointer (&self->records, g_byte_array_unref);
+  g_clear_pointer (&self->record_offsets, g_array_unref);
+  g_free (self);
+}
+
+/**
+ * gcal_event_archive_writer_add_component:
+ * @self: a #GcalEventArchiveWriter
+ * @component: an #ICalComponent
+ * @error: (nullable): return location for a #GError
+ *
+ * Appends the fields of @component that GNOME Calendar uses to the
+ * archive. Properties and parameters outside of that subset, such as
+ * attendee parameters, are not stored.
+ *
+ * Components without a UID cannot be archived, and are refused with
+ * %G_IO_ERROR_INVALID_DATA.
+ *
+ * Returns: %TRUE if @component was added, %FALSE otherwise
+ */
+gboolean
+gcal_event_archive_writer_add_component (GcalEventArchiveWriter  *self,
+                                         ICalComponent           *component,
+                                         GError                 **error)
+{
+  g_autoptr (ICalProperty) organizer = NULL;
+  g_autoptr (ICalProperty) rrule = NULL;
+  g_autoptr (ICalTime) recurrence_id = NULL;
+  g_autoptr (ICalTime) dtstart = NULL;
+  g_autoptr (ICalTime) dtend = NULL;
+  g_autoptr (GArray) recurrence_dates = NULL;
+  g_autoptr (GArray) attendees = NULL;
+  g_autoptr (GArray) alarms = NULL;
+  g_autofree gchar *rrule_str = NULL;
+  g_autofree gchar *rid_str = NULL;
+  const gchar *rid_tzid = NULL;
+  const gchar *start_tzid;
+  const gchar *uid;
+  ICalComponent *alarm;
+  ICalProperty *property;
+  guint32 offset;
+  guint64 flags;
+  gboolean has_dtend;
+  gboolean has_end;
+  gint64 start;
+
+  g_return_val_if_fail (self, FALSE);
+  g_return_val_if_fail (I_CAL_IS_COMPONENT (component), FALSE);
+
+  /* Records without a UID would make the whole archive invalid */
+  uid = i_cal_component_get_uid (component);
+  if (!uid || *uid == '\0')
+    {
+      g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA, "Components without a UID cannot be archived");
+      return FALSE;
+    }
+
+  dtstart = i_cal_component_get_dtstart (component);
+  dtend = i_cal_component_get_dtend (component);
+  has_dtend = i_cal_component_count_properties (component, I_CAL_DTEND_PROPERTY) > 0;
+  has_end = has_dtend || i_cal_component_count_properties (component, I_CAL_DURATION_PROPERTY) > 0;
+  start_tzid = get_time_tzid (component, I_CAL_DTSTART_PROPERTY, dtstart);
+
+  recurrence_id = i_cal_component_get_recurrenceid (component);
+  if (recurrence_id && !i_cal_time_is_null_time (recurrence_id))
+    {
+      /* The string only has the wall clock time, without the TZID */
+      rid_str = i_cal_time_as_ical_string (recurrence_id);
+      rid_tzid = get_time_tzid (component, I_CAL_RECURRENCEID_PROPERTY, recurrence_id);
+    }
+
+  rrule = i_cal_component_get_first_property (component, I_CAL_RRULE_PROPERTY);
+  if (rrule)
+    rrule_str = i_cal_property_get_value_as_string (rrule);
+
+  organizer = i_cal_component_get_first_property (component, I_CAL_ORGANIZER_PROPERTY);
+
+  /* Intern the lists first, so the record can be written in one go */
+  attendees = g_array_new (FALSE, FALSE, sizeof (guint32));
+
+  for (property = i_cal_component_get_first_property (component, I_CAL_ATTENDEE_PROPERTY);
+       property;
+       property = i_cal_component_get_next_property (component, I_CAL_ATTENDEE_PROPERTY))
+    {
+      guint32 id = intern_string (self, i_cal_property_get_attendee (property));
+
+      g_array_append_val (attendees, id);
+      g_object_unref (property);
+    }
+
+  recurrence_dates = g_array_new (FALSE, FALSE, sizeof (guint32));
+
+  for (property = i_cal_component_get_first_property (component, I_CAL_ANY_PROPERTY);
+       property;
+       property = i_cal_component_get_next_property (component, I_CAL_ANY_PROPERTY))
+    {
+      ICalPropertyKind kind = i_cal_property_isa (property);
+
+      if (kind == I_CAL_EXDATE_PROPERTY || kind == I_CAL_RDATE_PROPERTY)
+        {
+          g_autofree gchar *property_str = i_cal_property_as_ical_string (property);
+          guint32 id = intern_string (self, property_str);
+
+          g_array_append_val (recurrence_dates, id);
+        }
+
+      g_object_unref (property);
+    }
+
+  alarms = g_array_new (FALSE, FALSE, sizeof (guint32));
+
+  for (alarm = i_cal_component_get_first_component (component, I_CAL_VALARM_COMPONENT);
+       alarm;
+       alarm = i_cal_component_get_next_component (component, I_CAL_VALARM_COMPONENT))
+    {
+      g_autofree gchar *alarm_str = i_cal_component_as_ical_string (alarm);
+      guint32 id = intern_string (self, alarm_str);
+
+      g_array_append_val (alarms, id);
+      g_object_unref (alarm);
+    }
+
+  flags = 0;
+  if (i_cal_time_is_date (dtstart))
+    flags |= FLAG_ALL_DAY;
+  if (has_end)
+    flags |= FLAG_HAS_END;
+
+  offset = self->records->len;
+  g_array_append_val (self->record_offsets, offset);
+
+  append_varint (self->records, flags);
+  append_varint (self->records, intern_string (self, uid));
+  append_varint (self->records, intern_string (self, rid_str));
+  append_varint (self->records, intern_string (self, rid_tzid));
+  append_varint (self->records, intern_string (self, i_cal_component_get_summary (component)));
+  append_varint (self->records, intern_string (self, i_cal_component_get_location (component)));
+  append_varint (self->records, intern_string (self, i_cal_component_get_description (component)));
+  append_varint (self->records, intern_string (self, organizer ? i_cal_property_get_organizer (organizer) : NULL));
+  append_varint (self->records, intern_string (self, rrule_str));
+  append_varint (self->records, intern_string (self, start_tzid));
+
+  /* i_cal_time_as_timet() ignores the timezone, which gives the wall clock */
+  start = i_cal_time_as_timet (dtstart);
+  append_varint (self->records, zigzag_encode (start));
+
+  if (has_end)
+    {
+      const gchar *end_tzid;
+
+      /* With DURATION, the end is in the timezone of the start */
+      end_tzid = has_dtend ? get_time_tzid (component, I_CAL_DTEND_PROPERTY, dtend) : start_tzid;
+
+      append_varint (self->records, intern_string (self, end_tzid));
+      append_varint (self->records, zigzag_encode (i_cal_time_as_timet (dtend) - start));
+    }
+
+  append_string_list (self, attendees);
+  append_string_list (self, recurrence_dates);
+  append_string_list (self, alarms);
+
+  return TRUE;
+}
+
+/**
+ * gcal_event_archive_writer_to_bytes:
+ * @self: a #GcalEventArchiveWriter
+ *
+ * Serializes all components added to @self so far.
+ *
+ * Returns: (transfer full): a #GBytes with the archive
+ */
+GBytes*
+gcal_event_archive_writer_to_bytes (GcalEventArchiveWriter *self)
+{
+  GByteArray *array;
+  gsize size;
+  guint i;
+
+  g_return_val_if_fail (self, NULL);
+
+  size = HEADER_SIZE +
+         (self->string_offsets->len + self->record_offsets->len) * sizeof (guint32) +
+         self->strings->len +
+         self->records->len;
+
+  array = g_byte_array_sized_new (size);
+
+  g_byte_array_append (array, (const guint8 *) MAGIC, MAGIC_SIZE);
+  append_uint32 (array, self->string_offsets->len);
+  append_uint32 (array, self->record_offsets->len);
+  append_uint32 (array, self->strings->len);
+
+  for (i = 0; i < self->string_offsets->len; i++)
+    append_uint32 (array, g_array_index (self->string_offsets, guint32, i));
+
+  for (i = 0; i < self->record_offsets->len; i++)
+    append_uint32 (array, g_array_index (self->record_offsets, guint32, i));
+
+  g_byte_array_append (array, (const guint8 *) self->strings->str, self->strings->len);
+  g_byte_array_append (array, self->records->data, self->records->len);
+
+  return g_byte_array_free_to_bytes (array);
+}
+
+/**
+ * gcal_event_archive_new_from_bytes:
+ * @bytes: a #GBytes
+ * @error: (nullable): return location for a #GError
+ *
+ * Opens the archive in @bytes. The archive is validated once, and
+ * records are read directly from @bytes afterwards, without copying.
+ *
+ * Returns: (transfer full)(nullable): a #GcalEventArchive, or %NULL
+ */
+GcalEventArchive*
+gcal_event_archive_new_from_bytes (GBytes  *bytes,
+                                   GError **error)
+{
+  g_autoptr (GcalEventArchive) self = NULL;
+
+  g_return_val_if_fail (bytes, NULL);
+
+  self = g_new0 (GcalEventArchive, 1);
+  self->bytes = g_bytes_ref (bytes);
+
+  if (!validate_archive (self, error))
+    return NULL;
+
+  return g_steal_pointer (&self);
+}
+
+/**
+ * gcal_event_archive_new_from_file:
+ * @path: path to an archive file
+ * @error: (nullable): return location for a #GError
+ *
+ * Maps the archive at @path into memory and opens it.
+ *
+ * Returns: (transfer full)(nullable): a #GcalEventArchive, or %NULL
+ */
+GcalEventArchive*
+gcal_event_archive_new_from_file (const gchar  *path,
+                                  GError      **error)
+{
+  g_autoptr (GMappedFile) mapped_file = NULL;
+  g_autoptr (GBytes) bytes = NULL;
+
+  g_return_val_if_fail (path, NULL);
+
+  mapped_file = g_mapped_file_new (path, FALSE, error);
+  if (!mapped_file)
+    return NULL;
+
+  bytes = g_mapped_file_get_bytes (mapped_file);
+
+  return gcal_event_archive_new_from_bytes (bytes, error);
+}
+
+/**
+ * gcal_event_archive_free:
+ * @self: a #GcalEventArchive
+ *
+ * Frees @self. Records retrieved from @self are invalidated.
+ */
+void
+gcal_event_archive_free (GcalEventArchive *self)
+{
+  g_return_if_fail (self);
+
+  g_clear_pointer (&self->bytes, g_bytes_unref);
+  g_free (self);
+}
+
+/**
+ * gcal_event_archive_get_n_records:
+ * @self: a #GcalEventArchive
+ *
+ * Retrieves the number of records in @self.
+ *
+ * Returns: the number of records
+ */
+guint
+gcal_event_archive_get_n_records (GcalEventArchive *self)
+{
+  g_return_val_if_fail (self, 0);
+
+  return self->n_records;
+}
+
+/**
+ * gcal_event_archive_get_record:
+ * @self: a #GcalEventArchive
+ * @index: the index of the record
+ * @out_record: (out caller-allocates): return location for the record
+ *
+ * Decodes the record at @index. No memory is allocated.
+ */
+void
+gcal_event_archive_get_record (GcalEventArchive       *self,
+                               guint                   index,
+                               GcalEventArchiveRecord *out_record)
+{
+  G_GNUC_UNUSED gboolean valid;
+
+  g_return_if_fail (self);
+  g_return_if_fail (index < self->n_records);
+  g_return_if_fail (out_record);
+
+  /* Records were validated when opening the archive */
+  valid = decode_record (self, index, out_record);
+  g_assert (valid);
+}
+
+/**
+ * gcal_event_archive_get_attendee:
+ * @self: a #GcalEventArchive
+ * @record: a #GcalEventArchiveRecord of @self
+ * @index: the index of the attendee
+ *
+ * Retrieves the attendee at @index of @record.
+ *
+ * Returns: (transfer none): the attendee
+ */
+const gchar*
+gcal_event_archive_get_attendee (GcalEventArchive             *self,
+                                 const GcalEventArchiveRecord *record,
+                                 guint                         index)
+{
+  g_return_val_if_fail (self, NULL);
+  g_return_val_if_fail (record, NULL);
+  g_return_val_if_fail (index < record->n_attendees, NULL);
+
+  return lookup_string_list_item (self, record->attendees_offset, index);
+}
+
+/**
+ * gcal_event_archive_get_recurrence_date:
+ * @self: a #GcalEventArchive
+ * @record: a #GcalEventArchiveRecord of @self
+ * @index: the index of the recurrence date
+ *
+ * Retrieves the EXDATE or RDATE property at @index of @record.
+ *
+ * Returns: (transfer none): the property, as an iCalendar string
+ */
+const gchar*
+gcal_event_archive_get_recurrence_date (GcalEventArchive             *self,
+                                        const GcalEventArchiveRecord *record,
+                                        guint                         index)
+{
+  g_return_val_if_fail (self, NULL);
+  g_return_val_if_fail (record, NULL);
+  g_return_val_if_fail (index < record->n_recurrence_dates, NULL);
+
+  return lookup_string_list_item (self, record->recurrence_dates_offset, index);
+}
+
+/**
+ * gcal_event_archive_get_alarm:
+ * @self: a #GcalEventArchive
+ * @record: a #GcalEventArchiveRecord of @self
+ * @index: the index of the alarm
+ *
+ * Retrieves the VALARM component at @index of @record.
+ *
+ * Returns: (transfer none): the alarm, as an iCalendar string
+ */
+const gchar*
+gcal_event_archive_get_alarm (GcalEventArchive             *self,
+                              const GcalEventArchiveRecord *record,
+                              guint                         index)
+{
+  g_return_val_if_fail (self, NULL);
+  g_return_val_if_fail (record, NULL);
+  g_return_val_if_fail (index < record->n_alarms, NULL);
+
+  return lookup_string_list_item (self, record->alarms_offset, index);
+}
+
+/**
+ * gcal_event_archive_build_component:
+ * @self: a #GcalEventArchive
+ * @index: the index of the record
+ *
+ * Builds a VEVENT component from the record at @index.
+ *
+ * Returns: (transfer full): an #ICalComponent
+ */
+ICalComponent*
+gcal_event_archive_build_component (GcalEventArchive *self,
+                                    guint             index)
+{
+  GcalEventArchiveRecord record;
+  ICalComponent *component;
+  guint i;
+
+  g_return_val_if_fail (self, NULL);
+  g_return_val_if_fail (index < self->n_records, NULL);
+
+  gcal_event_archive_get_record (self, index, &record);
+
+  component = i_cal_component_new_vevent ();
+  i_cal_component_set_uid (component, record.uid);
+
+  if (record.summary)
+    i_cal_component_set_summary (component, record.summary);
+
+  if (record.location)
+    i_cal_component_set_location (component, record.location);
+
+  if (record.description)
+    i_cal_component_set_description (component, record.description);
+
+  i_cal_component_take_property (component,
+                                 build_time_property (I_CAL_DTSTART_PROPERTY,
+                                                      record.start,
+                                                      record.all_day,
+                                                      record.start_tzid));
+
+  if (record.has_end)
+    {
+      i_cal_component_take_property (component,
+                                     build_time_property (I_CAL_DTEND_PROPERTY,
+                                                          record.end,
+                                                          record.all_day,
+                                                          record.end_tzid));
+    }
+
+  if (record.recurrence_id)
+    {
+      g_autoptr (ICalTime) recurrence_id = i_cal_time_new_from_string (record.recurrence_id);
+      ICalProperty *property;
+
+      property = i_cal_property_new_recurrenceid (recurrence_id);
+
+      if (record.recurrence_id_tzid && g_strcmp0 (record.recurrence_id_tzid, UTC_TZID) != 0)
+        i_cal_property_take_parameter (property, i_cal_parameter_new_tzid (record.recurrence_id_tzid));
+
+      i_cal_component_take_property (component, property);
+    }
+
+  if (record.rrule)
+    {
+      g_autoptr (ICalRecurrence) recurrence = i_cal_recurrence_new_from_string (record.rrule);
+
+      i_cal_component_take_property (component, i_cal_property_new_rrule (recurrence));
+    }
+
+  if (record.organizer)
+    i_cal_component_take_property (component, i_cal_property_new_organizer (record.organizer));
+
+  for (i = 0; i < record.n_attendees; i++)
+    {
+      const gchar *attendee = gcal_event_archive_get_attendee (self, &record, i);
+
+      i_cal_component_take_property (component, i_cal_property_new_attendee (attendee));
+    }
+
+  for (i = 0; i < record.n_recurrence_dates; i++)
+    {
+      const gchar *recurrence_date = gcal_event_archive_get_recurrence_date (self, &record, i);
+      ICalProperty *property = i_cal_property_new_from_string (recurrence_date);
+
+      if (property)
+        i_cal_component_take_property (component, property);
+    }
+
+  for (i = 0; i < record.n_alarms; i++)
+    {
+      const gchar *alarm = gcal_event_archive_get_alarm (self, &record, i);
+      ICalComponent *alarm_component = i_cal_component_new_from_string (alarm);
+
+      if (alarm_component)
+        i_cal_component_take_component (component, alarm_component);
+    }
+
+  return component;
+}
@@ -0,0 +1,123 @@
+/* gcal-event-archive.h
+ *
+ * Copyright 2024 Georges Basile Stavracas Neto <georges.stavracas@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+#include <libecal/libecal.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GcalEventArchive GcalEventArchive;
+typedef struct _GcalEventArchiveWriter GcalEventArchiveWriter;
+
+/**
+ * GcalEventArchiveRecord:
+ * @uid: the UID of the component
+ * @recurrence_id: (nullable): the RECURRENCE-ID, as an iCalendar string
+ * @recurrence_id_tzid: (nullable): the TZID of RECURRENCE-ID, "UTC" or %NULL
+ *   if floating
+ * @summary: (nullable): the SUMMARY
+ * @location: (nullable): the LOCATION
+ * @description: (nullable): the DESCRIPTION
+ * @organizer: (nullable): the ORGANIZER
+ * @rrule: (nullable): the RRULE, as an iCalendar string
+ * @start_tzid: (nullable): the TZID of DTSTART, "UTC" or %NULL if floating
+ * @end_tzid: (nullable): the TZID of DTEND, "UTC" or %NULL if floating
+ * @start: the wall clock time of DTSTART, in seconds since the epoch
+ * @end: the wall clock time of DTEND, in seconds since the epoch
+ * @all_day: whether DTSTART and DTEND are dates
+ * @has_end: whether the component has an end
+ * @n_attendees: the number of attendees
+ * @n_recurrence_dates: the number of EXDATE and RDATE properties
+ * @n_alarms: the number of VALARM components
+ *
+ * A record of a #GcalEventArchive. All strings point into the archive
+ * memory, and are valid for as long as the archive is.
+ */
+typedef struct
+{
+  const gchar        *uid;
+  const gchar        *recurrence_id;
+  const gchar        *recurrence_id_tzid;
+  const gchar        *summary;
+  const gchar        *location;
+  const gchar        *description;
+  const gchar        *organizer;
+  const gchar        *rrule;
+  const gchar        *start_tzid;
+  const gchar        *end_tzid;
+  gint64              start;
+  gint64              end;
+  gboolean            all_day;
+  gboolean            has_end;
+  guint               n_attendees;
+  guint               n_recurrence_dates;
+  guint               n_alarms;
+
+  /*< private >*/
+  gsize               attendees_offset;
+  gsize               recurrence_dates_offset;
+  gsize               alarms_offset;
+} GcalEventArchiveRecord;
+
+GcalEventArchiveWriter* gcal_event_archive_writer_new            (void);
+
+void                 gcal_event_archive_writer_free              (GcalEventArchiveWriter *self);
+
+gboolean             gcal_event_archive_writer_add_component     (GcalEventArchiveWriter  *self,
+                                                                  ICalComponent           *component,
+                                                                  GError                 **error);
+
+GBytes*              gcal_event_archive_writer_to_bytes          (GcalEventArchiveWriter *self);
+
+GcalEventArchive*    gcal_event_archive_new_from_bytes           (GBytes             *bytes,
+                                                                  GError            **error);
+
+GcalEventArchive*    gcal_event_archive_new_from_file            (const gchar        *path,
+                                                                  GError            **error);
+
+void                 gcal_event_archive_free                     (GcalEventArchive   *self);
+
+guint                gcal_event_archive_get_n_records            (GcalEventArchive   *self);
+
+void                 gcal_event_archive_get_record               (GcalEventArchive       *self,
+                                                                  guint                   index,
+                                                                  GcalEventArchiveRecord *out_record);
+
+const gchar*         gcal_event_archive_get_attendee             (GcalEventArchive             *self,
+                                                                  const GcalEventArchiveRecord *record,
+                                                                  guint                         index);
+
+const gchar*         gcal_event_archive_get_recurrence_date      (GcalEventArchive             *self,
+                                                                  const GcalEventArchiveRecord *record,
+                                                                  guint                         index);
+
+const gchar*         gcal_event_archive_get_alarm                (GcalEventArchive             *self,
+                                                                  const GcalEventArchiveRecord *record,
+                                                                  guint                         index);
+
+ICalComponent*       gcal_event_archive_build_component          (GcalEventArchive   *self,
+                                                                  guint               index);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (GcalEventArchiveWriter, gcal_event_archive_writer_free)
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (GcalEventArchive, gcal_event_archive_free)
+
+G_END_DECLS
@@ -23,6 +23,7 @@
 #include "gcal-context.h"
 #include "gcal-debug.h"
 #include "gcal-event.h"
+#include "gcal-memory-stats.h"
 #include "gcal-utils.h"
 #include "gcal-recurrence.h"
 
@@ -76,16 +77,20 @@ struct _GcalEvent
   gchar              *uid;
   gboolean            has_recurrence;
 
-  /* These are cached, because ECalComponent returns newly allocated data for them */
-  gchar              *summary;
-  gchar              *location;
+  /*
+   * These are cached, because ECalComponent returns newly allocated data for
+   * them. They are interned, so instances of a recurring series, and events
+   * with the same texts, share them; and comparing them is comparing pointers.
+   */
+  GRefString         *summary;
+  GRefString         *location;
 
   /*
    * The description is cached in the class because it
    * may come as a GSList of descriptions, in which
    * case we merge them and cache it here.
    */
-  gchar              *description;
+  GRefString         *description;
 
   GDateTime          *dt_start;
   GDateTime          *dt_end;
@@ -103,6 +108,26 @@ struct _GcalEvent
   GcalCalendar       *calendar;
 
   GcalRecurrence     *recurrence;
+
+  /* Instances of the series not expanded after this one */
+  guint               n_hidden_occurrences;
+
+  /*
+   * Views sort events very often, so everything the comparison functions
+   * need is computed once per revision of the dates and summary. See
+   * ensure_sort_key().
+   */
+  struct {
+    gboolean          valid;
+    gboolean          multiday;
+    gint64            start;
+    gint              start_usec;
+    GTimeSpan         duration;
+    gchar            *collation_key;
+  } sort_key;
+
+  /* Estimated size reported to GcalMemoryStats */
+  gsize               memory_size;
 };
 
 static void          gcal_event_initable_iface_init              (GInitableIface *iface);
@@ -128,6 +153,7 @@ enum {
   PROP_UID,
   PROP_HAS_RECURRENCE,
   PROP_RECURRENCE,
+  PROP_N_HIDDEN_OCCURRENCES,
   N_PROPS
 };
 
@@ -141,9 +167,78 @@ static void
 clear_range (GcalEvent *self)
 {
   g_clear_pointer (&self->range, gcal_range_unref);
+  self->sort_key.valid = FALSE;
+
   g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_RANGE]);
 }
 
+static gboolean
+calculate_is_multiday (GcalEvent *self)
+{
+  g_autoptr (GDateTime) start_date = NULL;
+  g_autoptr (GDateTime) end_date = NULL;
+  GDate start_dt;
+  GDate end_dt;
+  gint n_days;
+
+  if (self->all_day)
+    {
+      start_date = g_date_time_ref (self->dt_start);
+      end_date = g_date_time_ref (gcal_event_get_date_end (self));
+      n_days = 1;
+    }
+  else
+    {
+      g_autoptr (GDateTime) inclusive_end_date = NULL;
+
+      inclusive_end_date = g_date_time_add_seconds (gcal_event_get_date_end (self), -1);
+      start_date = g_date_time_to_local (self->dt_start);
+      end_date = g_date_time_to_local (inclusive_end_date);
+      n_days = 0;
+    }
+
+  g_date_clear (&start_dt, 1);
+  g_date_set_dmy (&start_dt,
+                  g_date_time_get_day_of_month (start_date),
+                  g_date_time_get_month (start_date),
+                  g_date_time_get_year (start_date));
+
+  g_date_clear (&end_dt, 1);
+  g_date_set_dmy (&end_dt,
+                  g_date_time_get_day_of_month (end_date),
+                  g_date_time_get_month (end_date),
+                  g_date_time_get_year (end_date));
+
+  return g_date_days_between (&start_dt, &end_dt) > n_days;
+}
+
+/*
+ * The sort key is invalidated by clear_range(), which is called whenever
+ * the dates or the all-day flag change. The multiday flag depends on the
+ * local timezone, which is fixed for the lifetime of the process.
+ */
+static inline void
+ensure_sort_key (GcalEvent *self)
+{
+  if (G_LIKELY (self->sort_key.valid))
+    return;
+
+  self->sort_key.start = g_date_time_to_unix (self->dt_start);
+  self->sort_key.start_usec = g_date_time_get_microsecond (self->dt_start);
+  self->sort_key.duration = g_date_time_difference (gcal_event_get_date_end (self), self->dt_start);
+  self->sort_key.multiday = calculate_is_multiday (self);
+  self->sort_key.valid = TRUE;
+}
+
+static const gchar*
+get_collation_key (GcalEvent *self)
+{
+  if (!self->sort_key.collation_key)
+    self->sort_key.collation_key = g_utf8_collate_key (self->summary ? self->summary : "", -1);
+
+  return self->sort_key.collation_key;
+}
+
 static GTimeZone*
 get_timezone_from_ical (GcalEvent             *self,
                         ECalComponentDateTime *comp)
@@ -438,6 +533,55 @@ gcal_event_set_component_internal (GcalEvent     *self,
   g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_COMPONENT]);
 }
 
+static inline gsize
+string_size (const gchar *str)
+{
+  return str ? strlen (str) + 1 : 0;
+}
+
+/*
+ * Replaces @field with the interned copy of @value. Returns whether the
+ * value changed, which only takes a pointer comparison.
+ */
+static gboolean
+set_ref_string (GRefString  **field,
+                const gchar  *value)
+{
+  GRefString *interned;
+
+  interned = value ? g_ref_string_new_intern (value) : NULL;
+
+  if (*field == interned)
+    {
+      g_clear_pointer (&interned, g_ref_string_release);
+      return FALSE;
+    }
+
+  g_clear_pointer (field, g_ref_string_release);
+  *field = interned;
+
+  return TRUE;
+}
+
+/*
+ * The texts of the event are stored in the cloned ECalComponent. The
+ * cached summary, location and description are interned and shared with
+ * other events, so they are not accounted here. Other properties of the
+ * component are usually small compared to them.
+ */
+static gsize
+estimate_memory_size (GcalEvent *self)
+{
+  gsize text_size;
+
+  text_size = string_size (self->uid) +
+              string_size (self->summary) +
+              string_size (self->location) +
+              string_size (self->description);
+
+  return sizeof (GcalEvent) + string_size (self->uid) + text_size;
+}
+
 /*
  * GInitable iface implementation
  */
@@ -449,7 +593,13 @@ gcal_event_initable_init (GInitable     *initable,
 {
   GcalEvent *self = GCAL_EVENT (initable);
 
-  return setup_component (self, error);
+  if (!setup_component (self, error))
+    return FALSE;
+
+  self->memory_size = estimate_memory_size (self);
+  gcal_memory_stats_add (GCAL_MEMORY_EVENTS, 1, self->memory_size);
+
+  return TRUE;
 }
 
 static void
@@ -463,12 +613,16 @@ gcal_event_finalize (GObject *object)
 {
   GcalEvent *self = (GcalEvent *)object;
 
+  if (self->memory_size > 0)
+    gcal_memory_stats_remove (GCAL_MEMORY_EVENTS, 1, self->memory_size);
+
   g_clear_pointer (&self->dt_start, g_date_time_unref);
   g_clear_pointer (&self->dt_end, g_date_time_unref);
   g_clear_pointer (&self->range, gcal_range_unref);
-  g_clear_pointer (&self->summary, g_free);
-  g_clear_pointer (&self->location, g_free);
-  g_clear_pointer (&self->description, g_free);
+  g_clear_pointer (&self->summary, g_ref_string_release);
+  g_clear_pointer (&self->location, g_ref_string_release);
+  g_clear_pointer (&self->description, g_ref_string_release);
+  g_clear_pointer (&self->sort_key.collation_key, g_free);
   g_clear_pointer (&self->alarms, g_hash_table_unref);
   g_clear_pointer (&self->uid, g_free);
   g_clear_pointer (&self->color, gdk_rgba_free);
@@ -541,6 +695,10 @@ gcal_event_get_property (GObject    *object,
       g_value_set_boxed (value, self->recurrence);
       break;
 
+    case PROP_N_HIDDEN_OCCURRENCES:
+      g_value_set_uint (value, self->n_hidden_occurrences);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
     }
@@ -596,6 +754,10 @@ gcal_event_set_property (GObject      *object,
       gcal_event_set_recurrence (self, g_value_get_boxed (value));
       break;
 
+    case PROP_N_HIDDEN_OCCURRENCES:
+      gcal_event_set_n_hidden_occurrences (self, g_value_get_uint (value));
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
     }
@@ -721,6 +883,20 @@ gcal_event_class_init (GcalEventClass *klass)
                                                     GCAL_TYPE_RECURRENCE,
                                                     G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
 
+  /**
+   * GcalEvent::n-hidden-occurrences:
+   *
+   * The number of occurrences of the recurring event after this one that
+   * were not expanded, because the series has too many occurrences.
+   */
+  properties[PROP_N_HIDDEN_OCCURRENCES] = g_param_spec_uint ("n-hidden-occurrences",
+                                                             "Number of hidden occurrences",
+                                                             "Number of occurrences of the series hidden after the event",
+                                                             0,
+                                                             G_MAXUINT,
+                                                             0,
+                                                             G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
+
   /**
    * GcalEvent::calendar:
    *
@@ -1073,11 +1249,8 @@ gcal_event_set_description (GcalEvent   *self,
   if (description && !*description)
     description = NULL;
 
-  if (g_strcmp0 (self->description, description) != 0)
+  if (set_ref_string (&self->description, description))
     {
-      g_clear_pointer (&self->description, g_free);
-      self->description = g_strdup (description);
-
       if (description)
         {
           ECalComponentText* text_component;
@@ -1318,20 +1491,13 @@ void
 gcal_event_set_location (GcalEvent   *self,
                          const gchar *location)
 {
-  const gchar *current_location;
-
   g_return_if_fail (GCAL_IS_EVENT (self));
 
-  current_location = gcal_event_get_location (self);
-
-  if (g_strcmp0 (current_location, location) != 0)
+  if (set_ref_string (&self->location, location ? location : ""))
     {
       e_cal_component_set_location (self->component, (location && *location) ? location : NULL);
       e_cal_component_commit_sequence (self->component);
 
-      g_clear_pointer (&self->location, g_free);
-      self->location = g_strdup (location ? location : "");
-
       g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_LOCATION]);
     }
 }
@@ -1417,13 +1583,9 @@ void
 gcal_event_set_summary (GcalEvent   *self,
                         const gchar *summary)
 {
-  const gchar *current_summary;
-
   g_return_if_fail (GCAL_IS_EVENT (self));
 
-  current_summary = gcal_event_get_summary (self);
-
-  if (g_strcmp0 (current_summary, summary) != 0)
+  if (set_ref_string (&self->summary, summary ? summary : ""))
     {
       ECalComponentText *text_component;
 
@@ -1434,8 +1596,7 @@ gcal_event_set_summary (GcalEvent   *self,
 
       e_cal_component_text_free (text_component);
 
-      g_clear_pointer (&self->summary, g_free);
-      self->summary = g_strdup (summary ? summary : "");
+      g_clear_pointer (&self->sort_key.collation_key, g_free);
 
       g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_SUMMARY]);
     }
@@ -1483,43 +1644,30 @@ gcal_event_get_uid (GcalEvent *self)
 gboolean
 gcal_event_is_multiday (GcalEvent *self)
 {
-  g_autoptr (GDateTime) start_date = NULL;
-  g_autoptr (GDateTime) end_date = NULL;
-  GDate start_dt;
-  GDate end_dt;
-  gint n_days;
-
   g_return_val_if_fail (GCAL_IS_EVENT (self), FALSE);
 
-  if (self->all_day)
-    {
-      start_date = g_date_time_ref (self->dt_start);
-      end_date = g_date_time_ref (gcal_event_get_date_end (self));
-      n_days = 1;
-    }
-  else
-    {
-      g_autoptr (GDateTime) inclusive_end_date = NULL;
-
-      inclusive_end_date = g_date_time_add_seconds (gcal_event_get_date_end (self), -1);
-      start_date = g_date_time_to_local (self->dt_start);
-      end_date = g_date_time_to_local (inclusive_end_date);
-      n_days = 0;
-    }
+  ensure_sort_key (self);
 
-  g_date_clear (&start_dt, 1);
-  g_date_set_dmy (&start_dt,
-                  g_date_time_get_day_of_month (start_date),
-                  g_date_time_get_month (start_date),
-                  g_date_time_get_year (start_date));
+  return self->sort_key.multiday;
+}
 
-  g_date_clear (&end_dt, 1);
-  g_date_set_dmy (&end_dt,
-                  g_date_time_get_day_of_month (end_date),
-                  g_date_time_get_month (end_date),
-                  g_date_time_get_year (end_date));
+/**
+ * gcal_event_ensure_caches:
+ * @self: a #GcalEvent
+ *
+ * Computes the values that @self otherwise computes on first use, like
+ * its range and sort key. Afterwards, and until @self is modified, its
+ * getters and comparison functions don't write to it, so it can be read
+ * from multiple threads at once.
+ */
+void
+gcal_event_ensure_caches (GcalEvent *self)
+{
+  g_return_if_fail (GCAL_IS_EVENT (self));
 
-  return g_date_days_between (&start_dt, &end_dt) > n_days;
+  gcal_event_get_range (self);
+  ensure_sort_key (self);
+  get_collation_key (self);
 }
 
 /**
@@ -1531,7 +1679,11 @@ gcal_event_is_multiday (GcalEvent *self)
  * the events and, when they have the same date (time is ignored),
  * the @GcalEvent::all-day is the tiebreaker criteria.
  *
- * Events with equal start dates are sorted by the length.
+ * Events with equal start dates are sorted by the length, and then
+ * by the collation order of their summaries.
+ *
+ * The values compared are computed once and cached until the event
+ * changes, so sorting many events is cheap.
  *
  * Returns: 1, 0 or -1 if @event1 is, respectively, lower, equal or
  * greater than @event2.
@@ -1554,29 +1706,21 @@ gcal_event_compare (GcalEvent *event1,
    *  3. The event duration
    */
   if (event1->all_day != event2->all_day)
-    {
-      return event2->all_day - event1->all_day;
-    }
-  else
-    {
-      gint start_date_diff;
+    return event2->all_day - event1->all_day;
 
-      start_date_diff = g_date_time_compare (event1->dt_start, event2->dt_start);
+  ensure_sort_key (event1);
+  ensure_sort_key (event2);
 
-      if (start_date_diff != 0)
-        {
-          return start_date_diff;
-        }
-      else
-        {
-          GTimeSpan span1, span2;
+  if (event1->sort_key.start != event2->sort_key.start)
+    return event1->sort_key.start < event2->sort_key.start ? -1 : 1;
 
-          span1 = g_date_time_difference (event1->dt_start, gcal_event_get_date_end (event1));
-          span2 = g_date_time_difference (event2->dt_start, gcal_event_get_date_end (event2));
+  if (event1->sort_key.start_usec != event2->sort_key.start_usec)
+    return event1->sort_key.start_usec < event2->sort_key.start_usec ? -1 : 1;
 
-          return span2 - span1;
-        }
-    }
+  if (event1->sort_key.duration != event2->sort_key.duration)
+    return event1->sort_key.duration < event2->sort_key.duration ? -1 : 1;
+
+  return strcmp (get_collation_key (event1), get_collation_key (event2));
 }
 
 /**
@@ -1606,8 +1750,11 @@ gcal_event_compare_with_current (GcalEvent *event1,
   else if (!event2)
     return -1;
 
-  time1 = g_date_time_to_unix (event1->dt_start);
-  time2 = g_date_time_to_unix (event2->dt_start);
+  ensure_sort_key (event1);
+  ensure_sort_key (event2);
+
+  time1 = event1->sort_key.start;
+  time2 = event2->sort_key.start;
   diff1 = time1 - current_time;
   diff2 = time2 - current_time;
 
@@ -1692,6 +1839,47 @@ gcal_event_get_recurrence (GcalEvent *self)
   return self->recurrence;
 }
 
+/**
+ * gcal_event_get_n_hidden_occurrences:
+ * @self: a #GcalEvent
+ *
+ * Retrieves the number of occurrences of the recurring event that come
+ * after @self, but were not expanded because the series has too many
+ * occurrences. Only the last expanded occurrence of such series has a
+ * non-zero value. The count itself is capped, so the actual number of
+ * hidden occurrences may be larger.
+ *
+ * Returns: the number of hidden occurrences after @self
+ */
+guint
+gcal_event_get_n_hidden_occurrences (GcalEvent *self)
+{
+  g_return_val_if_fail (GCAL_IS_EVENT (self), 0);
+
+  return self->n_hidden_occurrences;
+}
+
+/**
+ * gcal_event_set_n_hidden_occurrences:
+ * @self: a #GcalEvent
+ * @n_hidden_occurrences: the number of hidden occurrences
+ *
+ * Sets the number of occurrences of the recurring event hidden after
+ * @self. This is not saved to the calendar.
+ */
+void
+gcal_event_set_n_hidden_occurrences (GcalEvent *self,
+                                     guint      n_hidden_occurrences)
+{
+  g_return_if_fail (GCAL_IS_EVENT (self));
+
+  if (self->n_hidden_occurrences == n_hidden_occurrences)
+    return;
+
+  self->n_hidden_occurrences = n_hidden_occurrences;
+  g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_N_HIDDEN_OCCURRENCES]);
+}
+
 /**
  * gcal_event_get_original_timezones:
  * @self: a #GcalEvent
@@ -123,11 +123,18 @@ gint                 gcal_event_compare_with_current             (GcalEvent
                                                                   GcalEvent          *event2,
                                                                   time_t              current_time);
 
+void                 gcal_event_ensure_caches                    (GcalEvent          *self);
+
 void                 gcal_event_set_recurrence                   (GcalEvent          *event,
                                                                   GcalRecurrence     *recur);
 
 GcalRecurrence*      gcal_event_get_recurrence                   (GcalEvent          *self);
 
+guint                gcal_event_get_n_hidden_occurrences         (GcalEvent          *self);
+
+void                 gcal_event_set_n_hidden_occurrences         (GcalEvent          *self,
+                                                                  guint               n_hidden_occurrences);
+
 void                 gcal_event_save_original_timezones          (GcalEvent          *self);
 
 void                 gcal_event_get_original_timezones           (GcalEvent          *self,
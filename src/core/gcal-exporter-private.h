@@ -0,0 +1,58 @@
+/* gcal-exporter-private.h
+ *
+ * Copyright 2024 Georges Basile Stavracas Neto <georges.stavracas@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include "gcal-exporter.h"
+
+#include <libecal/libecal.h>
+
+G_BEGIN_DECLS
+
+/*
+ * Called with each batch of components returned by a query. Returning
+ * %FALSE stops the query.
+ */
+typedef gboolean    (*GcalExportComponentsFunc)                  (const GSList        *components,
+                                                                  gpointer             user_data,
+                                                                  GError             **error);
+
+/*
+ * Where the exporter reads components and timezones from. This is
+ * ECalClient by default, and tests replace it since ECalClient needs
+ * a running E-D-S. Both functions run in worker threads.
+ */
+typedef struct
+{
+  gboolean           (*query_components)                         (GcalCalendar              *calendar,
+                                                                  const gchar               *sexp,
+                                                                  GcalExportComponentsFunc   func,
+                                                                  gpointer                   user_data,
+                                                                  GCancellable              *cancellable,
+                                                                  GError                   **error);
+
+  ICalTimezone*      (*get_timezone)                             (GcalCalendar              *calendar,
+                                                                  const gchar               *tzid,
+                                                                  GCancellable              *cancellable);
+} GcalExportBackend;
+
+void                 gcal_exporter_set_backend_for_testing       (const GcalExportBackend   *backend);
+
+G_END_DECLS
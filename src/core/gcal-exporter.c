@@ -0,0 +1,882 @@
+/* gcal-exporter.c
+ *
+ * Copyright 2024 Georges Basile Stavracas Neto <georges.stavracas@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#define G_LOG_DOMAIN "GcalExporter"
+
+#include "config.h"
+
+#include "gcal-debug.h"
+#include "gcal-exporter.h"
+#include "gcal-exporter-private.h"
+
+#include <libecal/libecal.h>
+
+/*
+ * Components are read through an ECalClientView, which delivers them in
+ * small batches, and each batch is written to the output stream and then
+ * released. Neither the VCALENDAR nor the list of components is ever built
+ * in memory, and a view returns each stored component once, so nothing
+ * needs to be deduplicated.
+ */
+
+/* Report progress every PROGRESS_INTERVAL components */
+#define PROGRESS_INTERVAL 50
+
+/* Write to the output stream in chunks of at least WRITE_BUFFER_SIZE bytes */
+#define WRITE_BUFFER_SIZE (16 * 1024)
+
+typedef struct
+{
+  GMainContext       *context;
+  GcalExportProgressFunc func;
+  gpointer            data;
+  gint                n_exported;
+  gint                report_pending;
+} ExportProgress;
+
+typedef struct
+{
+  GPtrArray          *calendars;
+  GcalRange          *range;
+  GOutputStream      *stream;
+  GFile              *file;
+  ExportProgress     *progress;
+} ExportData;
+
+typedef struct
+{
+  GcalCalendar       *calendar;
+  GOutputStream      *out;
+  GByteArray         *buffer;
+  GHashTable         *written_tzids;
+  ExportProgress     *progress;
+  GCancellable       *cancellable;
+} ExportContext;
+
+typedef struct
+{
+  GcalExportComponentsFunc func;
+  gpointer            user_data;
+  GError             *error;
+  gboolean            done;
+} ViewData;
+
+typedef struct
+{
+  ExportProgress     *progress;
+  GError             *error;
+  guint               n_pending;
+} DirectoryData;
+
+
+/*
+ * Auxiliary methods
+ */
+
+static ExportProgress*
+export_progress_new (GcalExportProgressFunc progress_func,
+                     gpointer               progress_data)
+{
+  ExportProgress *progress;
+
+  progress = g_atomic_rc_box_new0 (ExportProgress);
+  progress->context = g_main_context_ref_thread_default ();
+  progress->func = progress_func;
+  progress->data = progress_data;
+
+  return progress;
+}
+
+static void
+export_progress_clear (ExportProgress *progress)
+{
+  g_clear_pointer (&progress->context, g_main_context_unref);
+}
+
+static ExportProgress*
+export_progress_ref (ExportProgress *progress)
+{
+  return g_atomic_rc_box_acquire (progress);
+}
+
+static void
+export_progress_unref (gpointer data)
+{
+  g_atomic_rc_box_release_full (data, (GDestroyNotify) export_progress_clear);
+}
+
+static void
+export_data_free (gpointer data)
+{
+  ExportData *export_data = data;
+
+  g_clear_pointer (&export_data->calendars, g_ptr_array_unref);
+  g_clear_pointer (&export_data->range, gcal_range_unref);
+  g_clear_object (&export_data->stream);
+  g_clear_object (&export_data->file);
+  g_clear_pointer (&export_data->progress, export_progress_unref);
+  g_free (export_data);
+}
+
+static void
+directory_data_free (gpointer data)
+{
+  DirectoryData *directory_data = data;
+
+  g_clear_pointer (&directory_data->progress, export_progress_unref);
+  g_clear_error (&directory_data->error);
+  g_free (directory_data);
+}
+
+static gchar*
+build_range_filter (GcalRange *range)
+{
+  g_autoptr (GDateTime) inclusive_range_end = NULL;
+  g_autoptr (GDateTime) utc_range_start = NULL;
+  g_autoptr (GDateTime) utc_range_end = NULL;
+  g_autoptr (GDateTime) range_start = NULL;
+  g_autoptr (GDateTime) range_end = NULL;
+  g_autofree gchar *start_str = NULL;
+  g_autofree gchar *end_str = NULL;
+
+  range_start = gcal_range_get_start (range);
+  range_end = gcal_range_get_end (range);
+
+  /* Same format as GcalCalendarMonitor, see build_subscriber_filter() */
+  utc_range_start = g_date_time_to_utc (range_start);
+  start_str = g_date_time_format (utc_range_start, "%Y%m%dT%H%M%SZ");
+
+  inclusive_range_end = g_date_time_add_seconds (range_end, -1);
+  utc_range_end = g_date_time_to_utc (inclusive_range_end);
+  end_str = g_date_time_format (utc_range_end, "%Y%m%dT%H%M%SZ");
+
+  return g_strdup_printf ("(occur-in-time-range? (make-time \"%s\") (make-time \"%s\"))",
+                          start_str,
+                          end_str);
+}
+
+static const gchar*
+build_file_basename (GcalCalendar *calendar,
+                     GHashTable   *used_basenames)
+{
+  g_autofree gchar *name = NULL;
+  gchar *basename;
+  guint i;
+
+  name = g_strdup (gcal_calendar_get_name (calendar));
+
+  if (name)
+    g_strstrip (name);
+
+  if (!name || *name == '\0')
+    {
+      g_free (name);
+      name = g_strdup (gcal_calendar_get_id (calendar));
+    }
+
+  g_strdelimit (name, "/\\:", '_');
+
+  basename = g_strdup_printf ("%s.ics", name);
+
+  for (i = 2; g_hash_table_contains (used_basenames, basename); i++)
+    {
+      g_free (basename);
+      basename = g_strdup_printf ("%s (%u).ics", name, i);
+    }
+
+  g_hash_table_add (used_basenames, basename);
+
+  return basename;
+}
+
+static gboolean
+report_progress_cb (gpointer user_data)
+{
+  ExportProgress *progress = user_data;
+
+  g_atomic_int_set (&progress->report_pending, 0);
+  progress->func (g_atomic_int_get (&progress->n_exported), progress->data);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+report_progress (ExportProgress *progress)
+{
+  gint n_exported;
+
+  n_exported = g_atomic_int_add (&progress->n_exported, 1) + 1;
+
+  if (!progress->func || n_exported % PROGRESS_INTERVAL != 0)
+    return;
+
+  /* Don't flood the main context if it's busy */
+  if (!g_atomic_int_compare_and_exchange (&progress->report_pending, 0, 1))
+    return;
+
+  g_main_context_invoke_full (progress->context,
+                              G_PRIORITY_DEFAULT_IDLE,
+                              report_progress_cb,
+                              export_progress_ref (progress),
+                              export_progress_unref);
+}
+
+static gboolean
+flush_buffer (ExportContext  *context,
+              GCancellable   *cancellable,
+              GError        **error)
+{
+  gboolean success;
+
+  success = g_output_stream_write_all (context->out,
+                                       context->buffer->data,
+                                       context->buffer->len,
+                                       NULL,
+                                       cancellable,
+                                       error);
+
+  g_byte_array_set_size (context->buffer, 0);
+
+  return success;
+}
+
+/*
+ * Unlike GBufferedOutputStream, which flushes when disposed, buffered
+ * data is only ever written by flush_buffer(), so nothing reaches the
+ * output stream after an export failed.
+ */
+static gboolean
+write_string (ExportContext  *context,
+              const gchar    *str,
+              GCancellable   *cancellable,
+              GError        **error)
+{
+  g_byte_array_append (context->buffer, (const guint8 *) str, strlen (str));
+
+  if (context->buffer->len < WRITE_BUFFER_SIZE)
+    return TRUE;
+
+  return flush_buffer (context, cancellable, error);
+}
+
+
+/*
+ * Threads
+ *
+ * These methods must *never* be executed in the main thread.
+ */
+
+static void
+on_view_objects_added_cb (ECalClientView *view,
+                          const GSList   *objects,
+                          ViewData       *data)
+{
+  if (data->done)
+    return;
+
+  if (!data->func (objects, data->user_data, &data->error))
+    data->done = TRUE;
+}
+
+static void
+on_view_complete_cb (ECalClientView *view,
+                     const GError   *error,
+                     ViewData       *data)
+{
+  if (error && !data->error)
+    data->error = g_error_copy (error);
+
+  data->done = TRUE;
+}
+
+static gboolean
+on_cancellable_cancelled_cb (GCancellable *cancellable,
+                             ViewData     *data)
+{
+  data->done = TRUE;
+
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean
+client_query_components (GcalCalendar              *calendar,
+                         const gchar               *sexp,
+                         GcalExportComponentsFunc   func,
+                         gpointer                   user_data,
+                         GCancellable              *cancellable,
+                         GError                   **error)
+{
+  g_autoptr (GSource) cancellable_source = NULL;
+  g_autoptr (GMainContext) context = NULL;
+  ECalClientView *view = NULL;
+  ViewData data;
+
+  data = (ViewData) {
+    .func = func,
+    .user_data = user_data,
+    .error = NULL,
+    .done = FALSE,
+  };
+
+  /* Views emit their signals in the thread default context they were created in */
+  context = g_main_context_new ();
+  g_main_context_push_thread_default (context);
+
+  if (!e_cal_client_get_view_sync (gcal_calendar_get_client (calendar), sexp, &view, cancellable, &data.error))
+    goto out;
+
+  g_signal_connect (view, "objects-added", G_CALLBACK (on_view_objects_added_cb), &data);
+  g_signal_connect (view, "complete", G_CALLBACK (on_view_complete_cb), &data);
+
+  if (cancellable)
+    {
+      cancellable_source = g_cancellable_source_new (cancellable);
+      g_source_set_callback (cancellable_source, G_SOURCE_FUNC (on_cancellable_cancelled_cb), &data, NULL);
+      g_source_attach (cancellable_source, context);
+    }
+
+  e_cal_client_view_start (view, &data.error);
+
+  while (!data.done && !data.error)
+    g_main_context_iteration (context, TRUE);
+
+  e_cal_client_view_stop (view, NULL);
+  g_signal_handlers_disconnect_by_data (view, &data);
+
+  if (cancellable_source)
+    g_source_destroy (cancellable_source);
+
+out:
+  g_clear_object (&view);
+  g_main_context_pop_thread_default (context);
+
+  if (!data.error)
+    g_cancellable_set_error_if_cancelled (cancellable, &data.error);
+
+  if (data.error)
+    {
+      g_propagate_error (error, data.error);
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+static ICalTimezone*
+client_get_timezone (GcalCalendar *calendar,
+                     const gchar  *tzid,
+                     GCancellable *cancellable)
+{
+  ICalTimezone *zone = NULL;
+
+  if (!e_cal_client_get_timezone_sync (gcal_calendar_get_client (calendar), tzid, &zone, cancellable, NULL))
+    return NULL;
+
+  return zone;
+}
+
+static const GcalExportBackend client_backend = {
+  .query_components = client_query_components,
+  .get_timezone = client_get_timezone,
+};
+
+static const GcalExportBackend *backend = &client_backend;
+
+static void
+collect_tzid_cb (ICalParameter *parameter,
+                 gpointer       user_data)
+{
+  GPtrArray *tzids = user_data;
+  const gchar *tzid;
+
+  tzid = i_cal_parameter_get_tzid (parameter);
+
+  if (tzid && *tzid != '\0')
+    g_ptr_array_add (tzids, g_strdup (tzid));
+}
+
+static gboolean
+write_timezones (ExportContext  *context,
+                 ICalComponent  *component,
+                 GCancellable   *cancellable,
+                 GError        **error)
+{
+  g_autoptr (GPtrArray) tzids = NULL;
+  guint i;
+
+  tzids = g_ptr_array_new_with_free_func (g_free);
+  i_cal_component_foreach_tzid (component, collect_tzid_cb, tzids);
+
+  for (i = 0; i < tzids->len; i++)
+    {
+      g_autoptr (ICalComponent) vtimezone = NULL;
+      g_autofree gchar *vtimezone_str = NULL;
+      ICalTimezone *zone;
+      const gchar *tzid;
+
+      tzid = g_ptr_array_index (tzids, i);
+
+      /* Each VTIMEZONE is written only once per stream */
+      if (g_hash_table_contains (context->written_tzids, tzid))
+        continue;
+
+      g_hash_table_add (context->written_tzids, g_strdup (tzid));
+
+      zone = backend->get_timezone (context->calendar, tzid, cancellable);
+
+      if (!zone)
+        {
+          GCAL_TRACE_MSG ("Timezone %s not found, skipping", tzid);
+          continue;
+        }
+
+      vtimezone = i_cal_timezone_get_component (zone);
+      if (!vtimezone)
+        continue;
+
+      vtimezone_str = i_cal_component_as_ical_string (vtimezone);
+
+      if (!write_string (context, vtimezone_str, cancellable, error))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static gboolean
+write_component (ExportContext  *context,
+                 ICalComponent  *component,
+                 GCancellable   *cancellable,
+                 GError        **error)
+{
+  g_autofree gchar *component_str = NULL;
+
+  if (!write_timezones (context, component, cancellable, error))
+    return FALSE;
+
+  component_str = i_cal_component_as_ical_string (component);
+
+  if (!write_string (context, component_str, cancellable, error))
+    return FALSE;
+
+  report_progress (context->progress);
+
+  return TRUE;
+}
+
+static gboolean
+write_components_cb (const GSList  *components,
+                     gpointer       user_data,
+                     GError       **error)
+{
+  ExportContext *context = user_data;
+  const GSList *l;
+
+  for (l = components; l; l = l->next)
+    {
+      if (!write_component (context, l->data, context->cancellable, error))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static gboolean
+export_calendar (ExportContext  *context,
+                 GcalCalendar   *calendar,
+                 GcalRange      *range,
+                 GCancellable   *cancellable,
+                 GError        **error)
+{
+  g_autofree gchar *sexp = NULL;
+
+  GCAL_ENTRY;
+
+  context->calendar = calendar;
+
+  sexp = range ? build_range_filter (range) : g_strdup ("#t");
+
+  GCAL_RETURN (backend->query_components (calendar, sexp, write_components_cb, context, cancellable, error));
+}
+
+static GFile*
+create_temporary_file (GFile          *file,
+                       GOutputStream **out_stream,
+                       GCancellable   *cancellable,
+                       GError        **error)
+{
+  g_autoptr (GFileOutputStream) stream = NULL;
+  g_autoptr (GFile) temporary_file = NULL;
+  g_autoptr (GFile) parent = NULL;
+  g_autofree gchar *basename = NULL;
+  g_autofree gchar *temporary_basename = NULL;
+
+  parent = g_file_get_parent (file);
+  basename = g_file_get_basename (file);
+  temporary_basename = g_strdup_printf (".%s.%08x", basename, g_random_int ());
+  temporary_file = g_file_get_child (parent, temporary_basename);
+
+  stream = g_file_create (temporary_file, G_FILE_CREATE_PRIVATE, cancellable, error);
+  if (!stream)
+    return NULL;
+
+  *out_stream = G_OUTPUT_STREAM (g_steal_pointer (&stream));
+
+  return g_steal_pointer (&temporary_file);
+}
+
+static void
+export_in_thread_cb (GTask        *task,
+                     gpointer      source_object,
+                     gpointer      task_data,
+                     GCancellable *cancellable)
+{
+  g_autoptr (GHashTable) written_tzids = NULL;
+  g_autoptr (GOutputStream) base_stream = NULL;
+  g_autoptr (GByteArray) buffer = NULL;
+  g_autoptr (GFile) temporary_file = NULL;
+  g_autoptr (GError) error = NULL;
+  ExportContext context;
+  ExportData *data;
+  guint i;
+
+  GCAL_ENTRY;
+
+  data = task_data;
+
+  /*
+   * Files are written to a temporary file that only replaces the destination
+   * once the export succeeded, so that failed exports don't leave a truncated
+   * file in place of an existing one.
+   */
+  if (data->file)
+    {
+      temporary_file = create_temporary_file (data->file, &base_stream, cancellable, &error);
+      if (error)
+        goto out;
+    }
+  else
+    {
+      base_stream = g_object_ref (data->stream);
+    }
+
+  buffer = g_byte_array_sized_new (2 * WRITE_BUFFER_SIZE);
+  written_tzids = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  /* The stream belongs to the caller, or is closed below */
+  context = (ExportContext) {
+    .calendar = NULL,
+    .out = base_stream,
+    .buffer = buffer,
+    .written_tzids = written_tzids,
+    .progress = data->progress,
+    .cancellable = cancellable,
+  };
+
+  if (!write_string (&context,
+                     "BEGIN:VCALENDAR\r\n"
+                     "VERSION:2.0\r\n"
+                     "PRODID:-//GNOME//GNOME Calendar " PACKAGE_VERSION "//EN\r\n",
+                     cancellable,
+                     &error))
+    {
+      goto out;
+    }
+
+  for (i = 0; i < data->calendars->len; i++)
+    {
+      GcalCalendar *calendar = g_ptr_array_index (data->calendars, i);
+
+      if (!export_calendar (&context, calendar, data->range, cancellable, &error))
+        goto out;
+    }
+
+  if (!write_string (&context, "END:VCALENDAR\r\n", cancellable, &error))
+    goto out;
+
+  if (!flush_buffer (&context, cancellable, &error))
+    goto out;
+
+  if (!g_output_stream_flush (base_stream, cancellable, &error))
+    goto out;
+
+  if (data->file)
+    {
+      if (!g_output_stream_close (base_stream, cancellable, &error))
+        goto out;
+
+      g_file_move (temporary_file,
+                   data->file,
+                   G_FILE_COPY_OVERWRITE | G_FILE_COPY_NO_FALLBACK_FOR_MOVE,
+                   cancellable,
+                   NULL,
+                   NULL,
+                   &error);
+    }
+
+out:
+  if (error && temporary_file)
+    {
+      g_output_stream_close (base_stream, NULL, NULL);
+      g_file_delete (temporary_file, NULL, NULL);
+    }
+
+  if (error)
+    g_task_return_error (task, g_steal_pointer (&error));
+  else
+    g_task_return_int (task, g_atomic_int_get (&data->progress->n_exported));
+
+  GCAL_EXIT;
+}
+
+
+/*
+ * Callbacks
+ */
+
+static void
+calendar_exported_cb (GObject      *source_object,
+                      GAsyncResult *result,
+                      gpointer      user_data)
+{
+  g_autoptr (GTask) task = user_data;
+  g_autoptr (GError) error = NULL;
+  DirectoryData *directory_data;
+
+  directory_data = g_task_get_task_data (task);
+
+  g_task_propagate_int (G_TASK (result), &error);
+
+  if (error && !directory_data->error)
+    directory_data->error = g_steal_pointer (&error);
+
+  if (--directory_data->n_pending > 0)
+    return;
+
+  if (directory_data->error)
+    g_task_return_error (task, g_steal_pointer (&directory_data->error));
+  else
+    g_task_return_int (task, g_atomic_int_get (&directory_data->progress->n_exported));
+}
+
+
+/*
+ * Public API
+ */
+
+/**
+ * gcal_exporter_export_to_stream:
+ * @calendars: (element-type GcalCalendar): calendars to export
+ * @range: (nullable): a #GcalRange
+ * @stream: a #GOutputStream
+ * @progress_func: (nullable): a #GcalExportProgressFunc
+ * @progress_data: (closure progress_func): user data for @progress_func
+ * @cancellable: (nullable): a #GCancellable
+ * @callback: (scope async): a #GAsyncReadyCallback
+ * @user_data: (closure callback): user data for @callback
+ *
+ * Writes the events of @calendars to @stream as a single VCALENDAR in
+ * a worker thread. If @range is not %NULL, only events occurring within
+ * it are exported. @stream is flushed, but not closed. If the export
+ * fails, nothing more is written to @stream, but what was written up
+ * to that point is left in place.
+ *
+ * Components are written in the small batches E-D-S delivers them in,
+ * so memory usage doesn't grow with the number of exported events, only
+ * with the number of distinct timezones they use. @progress_data must
+ * stay alive until @callback is called.
+ */
+void
+gcal_exporter_export_to_stream (GPtrArray              *calendars,
+                                GcalRange              *range,
+                                GOutputStream          *stream,
+                                GcalExportProgressFunc  progress_func,
+                                gpointer                progress_data,
+                                GCancellable           *cancellable,
+                                GAsyncReadyCallback     callback,
+                                gpointer                user_data)
+{
+  g_autoptr (GTask) task = NULL;
+  ExportData *data;
+  guint i;
+
+  g_return_if_fail (calendars != NULL);
+  g_return_if_fail (G_IS_OUTPUT_STREAM (stream));
+
+  data = g_new0 (ExportData, 1);
+  data->calendars = g_ptr_array_new_full (calendars->len, g_object_unref);
+  data->range = range ? gcal_range_ref (range) : NULL;
+  data->stream = g_object_ref (stream);
+  data->progress = export_progress_new (progress_func, progress_data);
+
+  for (i = 0; i < calendars->len; i++)
+    g_ptr_array_add (data->calendars, g_object_ref (g_ptr_array_index (calendars, i)));
+
+  task = g_task_new (NULL, cancellable, callback, user_data);
+  g_task_set_task_data (task, data, export_data_free);
+  g_task_set_source_tag (task, gcal_exporter_export_to_stream);
+  g_task_run_in_thread (task, export_in_thread_cb);
+}
+
+/**
+ * gcal_exporter_export_to_stream_finish:
+ * @result: a #GAsyncResult
+ * @out_n_exported: (out)(optional): return location for the number of exported components
+ * @error: (nullable): return location for a #GError
+ *
+ * Finishes an operation started by gcal_exporter_export_to_stream().
+ *
+ * Returns: %TRUE if all events were exported, %FALSE otherwise
+ */
+gboolean
+gcal_exporter_export_to_stream_finish (GAsyncResult  *result,
+                                       guint         *out_n_exported,
+                                       GError       **error)
+{
+  gssize n_exported;
+
+  g_return_val_if_fail (g_task_is_valid (result, NULL), FALSE);
+  g_return_val_if_fail (g_task_get_source_tag (G_TASK (result)) == gcal_exporter_export_to_stream, FALSE);
+
+  n_exported = g_task_propagate_int (G_TASK (result), error);
+
+  if (out_n_exported)
+    *out_n_exported = MAX (n_exported, 0);
+
+  return n_exported >= 0;
+}
+
+/**
+ * gcal_exporter_export_to_directory:
+ * @calendars: (element-type GcalCalendar): calendars to export
+ * @range: (nullable): a #GcalRange
+ * @directory: an existing directory
+ * @progress_func: (nullable): a #GcalExportProgressFunc
+ * @progress_data: (closure progress_func): user data for @progress_func
+ * @cancellable: (nullable): a #GCancellable
+ * @callback: (scope async): a #GAsyncReadyCallback
+ * @user_data: (closure callback): user data for @callback
+ *
+ * Writes each calendar of @calendars to its own .ics file inside
+ * @directory, named after the calendar. Existing files are only replaced
+ * when their calendar is exported successfully. Calendars are exported
+ * in parallel, and @progress_func receives the total number of components
+ * exported across all files.
+ */
+void
+gcal_exporter_export_to_directory (GPtrArray              *calendars,
+                                   GcalRange              *range,
+                                   GFile                  *directory,
+                                   GcalExportProgressFunc  progress_func,
+                                   gpointer                progress_data,
+                                   GCancellable           *cancellable,
+                                   GAsyncReadyCallback     callback,
+                                   gpointer                user_data)
+{
+  g_autoptr (GHashTable) used_basenames = NULL;
+  g_autoptr (GTask) task = NULL;
+  DirectoryData *directory_data;
+  guint i;
+
+  g_return_if_fail (calendars != NULL);
+  g_return_if_fail (G_IS_FILE (directory));
+
+  directory_data = g_new0 (DirectoryData, 1);
+  directory_data->progress = export_progress_new (progress_func, progress_data);
+  directory_data->n_pending = calendars->len;
+
+  task = g_task_new (NULL, cancellable, callback, user_data);
+  g_task_set_task_data (task, directory_data, directory_data_free);
+  g_task_set_source_tag (task, gcal_exporter_export_to_directory);
+
+  if (calendars->len == 0)
+    {
+      g_task_return_int (task, 0);
+      return;
+    }
+
+  used_basenames = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  for (i = 0; i < calendars->len; i++)
+    {
+      g_autoptr (GTask) calendar_task = NULL;
+      const gchar *basename;
+      GcalCalendar *calendar;
+      ExportData *data;
+
+      calendar = g_ptr_array_index (calendars, i);
+      basename = build_file_basename (calendar, used_basenames);
+
+      data = g_new0 (ExportData, 1);
+      data->calendars = g_ptr_array_new_full (1, g_object_unref);
+      data->range = range ? gcal_range_ref (range) : NULL;
+      data->file = g_file_get_child (directory, basename);
+      data->progress = export_progress_ref (directory_data->progress);
+
+      g_ptr_array_add (data->calendars, g_object_ref (calendar));
+
+      calendar_task = g_task_new (NULL, cancellable, calendar_exported_cb, g_object_ref (task));
+      g_task_set_task_data (calendar_task, data, export_data_free);
+      g_task_set_source_tag (calendar_task, gcal_exporter_export_to_directory);
+      g_task_run_in_thread (calendar_task, export_in_thread_cb);
+    }
+}
+
+/**
+ * gcal_exporter_export_to_directory_finish:
+ * @result: a #GAsyncResult
+ * @out_n_exported: (out)(optional): return location for the number of exported components
+ * @error: (nullable): return location for a #GError
+ *
+ * Finishes an operation started by gcal_exporter_export_to_directory().
+ * If more than one calendar failed, the first error is returned.
+ *
+ * Returns: %TRUE if all calendars were exported, %FALSE otherwise
+ */
+gboolean
+gcal_exporter_export_to_directory_finish (GAsyncResult  *result,
+                                          guint         *out_n_exported,
+                                          GError       **error)
+{
+  gssize n_exported;
+
+  g_return_val_if_fail (g_task_is_valid (result, NULL), FALSE);
+  g_return_val_if_fail (g_task_get_source_tag (G_TASK (result)) == gcal_exporter_export_to_directory, FALSE);
+
+  n_exported = g_task_propagate_int (G_TASK (result), error);
+
+  if (out_n_exported)
+    *out_n_exported = MAX (n_exported, 0);
+
+  return n_exported >= 0;
+}
+
+/*
+ * gcal_exporter_set_backend_for_testing:
+ *
+ * Replaces where components and timezones are read from, or restores
+ * ECalClient if @new_backend is %NULL. Not thread-safe; only call it
+ * while no export is running.
+ */
+void
+gcal_exporter_set_backend_for_testing (const GcalExportBackend *new_backend)
+{
+  backend = new_backend ? new_backend : &client_backend;
+}
@@ -0,0 +1,67 @@
+/* gcal-exporter.h
+ *
+ * Copyright 2024 Georges Basile Stavracas Neto <georges.stavracas@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+#include "gcal-calendar.h"
+#include "gcal-range.h"
+
+G_BEGIN_DECLS
+
+/**
+ * GcalExportProgressFunc:
+ * @n_exported: the number of components exported so far
+ * @user_data: (closure): user data passed to the function
+ *
+ * Function called on the main context of the caller, every now
+ * and then, while exporting calendars.
+ */
+typedef void        (*GcalExportProgressFunc)                    (guint               n_exported,
+                                                                  gpointer            user_data);
+
+void                 gcal_exporter_export_to_stream              (GPtrArray              *calendars,
+                                                                  GcalRange              *range,
+                                                                  GOutputStream          *stream,
+                                                                  GcalExportProgressFunc  progress_func,
+                                                                  gpointer                progress_data,
+                                                                  GCancellable           *cancellable,
+                                                                  GAsyncReadyCallback     callback,
+                                                                  gpointer                user_data);
+
+gboolean             gcal_exporter_export_to_stream_finish       (GAsyncResult        *result,
+                                                                  guint               *out_n_exported,
+                                                                  GError             **error);
+
+void                 gcal_exporter_export_to_directory           (GPtrArray              *calendars,
+                                                                  GcalRange              *range,
+                                                                  GFile                  *directory,
+                                                                  GcalExportProgressFunc  progress_func,
+                                                                  gpointer                progress_data,
+                                                                  GCancellable           *cancellable,
+                                                                  GAsyncReadyCallback     callback,
+                                                                  gpointer                user_data);
+
+gboolean             gcal_exporter_export_to_directory_finish    (GAsyncResult        *result,
+                                                                  guint               *out_n_exported,
+                                                                  GError             **error);
+
+G_END_DECLS
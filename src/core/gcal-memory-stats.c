@@ -0,0 +1,227 @@
+/* gcal-memory-stats.c
+ *
+ * Copyright 2024 Georges Basile Stavracas Neto <georges.stavracas@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#define G_LOG_DOMAIN "GcalMemoryStats"
+
+#include "gcal-memory-stats.h"
+
+/**
+ * SECTION:gcal-memory-stats
+ * @short_description: Memory accounting of the largest consumers
+ * @title:GcalMemoryStats
+ * @stability:unstable
+ *
+ * GcalMemoryStats keeps track of the number of objects, and an estimate
+ * of the number of bytes, used by the subsystems that usually dominate
+ * the memory usage of Calendar. Each subsystem reports its allocations
+ * with gcal_memory_stats_add() and gcal_memory_stats_remove(), and the
+ * current and peak values can be retrieved at any time.
+ *
+ * Byte counts are estimates: they include the instance structures and
+ * the strings owned by them, but not the allocator overhead.
+ *
+ * Accounting can happen on any thread, and never takes a lock. Each
+ * counter is updated atomically on its own, so the values of different
+ * counters may be from slightly different moments, and peaks are best
+ * effort.
+ */
+
+static const gchar * const subsystem_names[] = {
+  [GCAL_MEMORY_EVENTS] = "Events",
+  [GCAL_MEMORY_RANGE_TREE_NODES] = "Range tree nodes",
+  [GCAL_MEMORY_TIMELINE_QUEUE] = "Timeline queue",
+  [GCAL_MEMORY_MONITOR_CACHE] = "Monitor caches",
+  [GCAL_MEMORY_EVENT_WIDGETS] = "Event widgets",
+  [GCAL_MEMORY_WEATHER] = "Weather",
+};
+
+G_STATIC_ASSERT (G_N_ELEMENTS (subsystem_names) == GCAL_N_MEMORY_SUBSYSTEMS);
+
+static GcalMemoryUsage usage[GCAL_N_MEMORY_SUBSYSTEMS] = { { 0, }, };
+
+
+/*
+ * Auxiliary methods
+ */
+
+static inline gsize
+counter_get (gsize *counter)
+{
+  return GPOINTER_TO_SIZE (g_atomic_pointer_get (counter));
+}
+
+static inline gsize
+counter_add (gsize *counter,
+             gsize  value)
+{
+  return (gsize) g_atomic_pointer_add (counter, (gssize) value) + value;
+}
+
+static inline void
+counter_subtract (gsize *counter,
+                  gsize  value)
+{
+  gsize current;
+
+  do
+    current = counter_get (counter);
+  while (!g_atomic_pointer_compare_and_exchange (counter, current, current - MIN (value, current)));
+
+  g_warn_if_fail (current >= value);
+}
+
+static inline void
+update_peak (gsize *peak,
+             gsize  value)
+{
+  gsize current_peak;
+
+  /* Another thread may raise the peak in between, so retry until it's above the value */
+  do
+    current_peak = counter_get (peak);
+  while (value > current_peak && !g_atomic_pointer_compare_and_exchange (peak, current_peak, value));
+}
+
+
+/*
+ * Public API
+ */
+
+/**
+ * gcal_memory_stats_add:
+ * @subsystem: a #GcalMemorySubsystem
+ * @n_objects: the number of allocated objects
+ * @n_bytes: the estimated size of the objects, in bytes
+ *
+ * Accounts @n_objects and @n_bytes to @subsystem, and updates
+ * its peak values.
+ */
+void
+gcal_memory_stats_add (GcalMemorySubsystem subsystem,
+                       gsize               n_objects,
+                       gsize               n_bytes)
+{
+  GcalMemoryUsage *subsystem_usage;
+
+  g_return_if_fail (subsystem < GCAL_N_MEMORY_SUBSYSTEMS);
+
+  subsystem_usage = &usage[subsystem];
+
+  update_peak (&subsystem_usage->peak_objects, counter_add (&subsystem_usage->n_objects, n_objects));
+  update_peak (&subsystem_usage->peak_bytes, counter_add (&subsystem_usage->n_bytes, n_bytes));
+}
+
+/**
+ * gcal_memory_stats_remove:
+ * @subsystem: a #GcalMemorySubsystem
+ * @n_objects: the number of released objects
+ * @n_bytes: the estimated size of the objects, in bytes
+ *
+ * Removes @n_objects and @n_bytes, previously accounted with
+ * gcal_memory_stats_add(), from @subsystem.
+ */
+void
+gcal_memory_stats_remove (GcalMemorySubsystem subsystem,
+                          gsize               n_objects,
+                          gsize               n_bytes)
+{
+  GcalMemoryUsage *subsystem_usage;
+
+  g_return_if_fail (subsystem < GCAL_N_MEMORY_SUBSYSTEMS);
+
+  subsystem_usage = &usage[subsystem];
+
+  counter_subtract (&subsystem_usage->n_objects, n_objects);
+  counter_subtract (&subsystem_usage->n_bytes, n_bytes);
+}
+
+/**
+ * gcal_memory_stats_get_usage:
+ * @subsystem: a #GcalMemorySubsystem
+ * @out_usage: (out): return location for the usage of @subsystem
+ *
+ * Retrieves the current and peak usage of @subsystem.
+ */
+void
+gcal_memory_stats_get_usage (GcalMemorySubsystem  subsystem,
+                             GcalMemoryUsage     *out_usage)
+{
+  g_return_if_fail (subsystem < GCAL_N_MEMORY_SUBSYSTEMS);
+  g_return_if_fail (out_usage != NULL);
+
+  out_usage->n_objects = counter_get (&usage[subsystem].n_objects);
+  out_usage->n_bytes = counter_get (&usage[subsystem].n_bytes);
+  out_usage->peak_objects = counter_get (&usage[subsystem].peak_objects);
+  out_usage->peak_bytes = counter_get (&usage[subsystem].peak_bytes);
+}
+
+/**
+ * gcal_memory_stats_reset_peaks:
+ *
+ * Resets the peak values of all subsystems to their current values.
+ */
+void
+gcal_memory_stats_reset_peaks (void)
+{
+  for (guint i = 0; i < GCAL_N_MEMORY_SUBSYSTEMS; i++)
+    {
+      g_atomic_pointer_set (&usage[i].peak_objects, counter_get (&usage[i].n_objects));
+      g_atomic_pointer_set (&usage[i].peak_bytes, counter_get (&usage[i].n_bytes));
+    }
+}
+
+/**
+ * gcal_memory_stats_to_string:
+ *
+ * Formats the current and peak usage of all subsystems as a
+ * human-readable table.
+ *
+ * Returns: (transfer full): a string
+ */
+gchar*
+gcal_memory_stats_to_string (void)
+{
+  GcalMemoryUsage snapshot[GCAL_N_MEMORY_SUBSYSTEMS];
+  GString *string;
+
+  for (guint i = 0; i < GCAL_N_MEMORY_SUBSYSTEMS; i++)
+    gcal_memory_stats_get_usage (i, &snapshot[i]);
+
+  string = g_string_new ("");
+  g_string_append_printf (string,
+                          "%-20s %12s %12s %12s %12s\n",
+                          "Subsystem", "Objects", "Peak", "Bytes", "Peak");
+
+  for (guint i = 0; i < GCAL_N_MEMORY_SUBSYSTEMS; i++)
+    {
+      g_autofree gchar *bytes = g_format_size (snapshot[i].n_bytes);
+      g_autofree gchar *peak_bytes = g_format_size (snapshot[i].peak_bytes);
+
+      g_string_append_printf (string,
+                              "%-20s %12" G_GSIZE_FORMAT " %12" G_GSIZE_FORMAT " %12s %12s\n",
+                              subsystem_names[i],
+                              snapshot[i].n_objects,
+                              snapshot[i].peak_objects,
+                              bytes,
+                              peak_bytes);
+    }
+
+  return g_string_free (string, FALSE);
+}
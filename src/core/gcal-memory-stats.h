@@ -0,0 +1,61 @@
+/* gcal-memory-stats.h
+ *
+ * Copyright 2024 Georges Basile Stavracas Neto <georges.stavracas@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef enum
+{
+  GCAL_MEMORY_EVENTS,
+  GCAL_MEMORY_RANGE_TREE_NODES,
+  GCAL_MEMORY_TIMELINE_QUEUE,
+  GCAL_MEMORY_MONITOR_CACHE,
+  GCAL_MEMORY_EVENT_WIDGETS,
+  GCAL_MEMORY_WEATHER,
+  GCAL_N_MEMORY_SUBSYSTEMS,
+} GcalMemorySubsystem;
+
+typedef struct
+{
+  gsize               n_objects;
+  gsize               n_bytes;
+  gsize               peak_objects;
+  gsize               peak_bytes;
+} GcalMemoryUsage;
+
+void                 gcal_memory_stats_add                       (GcalMemorySubsystem  subsystem,
+                                                                  gsize                n_objects,
+                                                                  gsize                n_bytes);
+
+void                 gcal_memory_stats_remove                    (GcalMemorySubsystem  subsystem,
+                                                                  gsize                n_objects,
+                                                                  gsize                n_bytes);
+
+void                 gcal_memory_stats_get_usage                 (GcalMemorySubsystem  subsystem,
+                                                                  GcalMemoryUsage     *out_usage);
+
+void                 gcal_memory_stats_reset_peaks               (void);
+
+gchar*               gcal_memory_stats_to_string                 (void);
+
+G_END_DECLS
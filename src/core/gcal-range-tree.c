@@ -18,9 +18,13 @@
 
 #define G_LOG_DOMAIN "GcalRangeTree"
 
+#include "gcal-memory-stats.h"
 #include "gcal-range-tree.h"
+#include "gcal-range-tree-private.h"
 #include "utils/gcal-date-time-utils.h"
 
+#include <stdlib.h>
+
 /**
  * SECTION:gcal-range-tree
  * @short_description: Augmented AVL tree to handle ranges
@@ -40,7 +44,57 @@
  * Conforming to the overall standard of iCal and Calendar,
  * the start of a range is inclusive but the end of the range
  * is always exclusive.
+ *
+ * # Queries
+ *
+ * Each node stores the maximum end of its subtree, which allows
+ * range queries to skip entire subtrees that end before the queried
+ * range. Querying a range costs O(log n + k), where k is the number
+ * of entries overlapping the range.
+ *
+ * # Data index
+ *
+ * Trees created with %GCAL_RANGE_TREE_INDEX_DATA additionally keep a
+ * table of the node each data pointer is stored at, which makes
+ * gcal_range_tree_remove_data() and gcal_range_tree_contains_data()
+ * O(log n) instead of a traversal of the whole tree. Rotations never
+ * move data between nodes, so the table stays valid as the tree is
+ * rebalanced.
+ *
+ * # Bulk loading
+ *
+ * gcal_range_tree_new_from_array() and gcal_range_tree_add_ranges() sort
+ * their input once and build a perfectly balanced tree bottom-up, which is
+ * O(n) after sorting, instead of doing one AVL insertion per entry.
+ *
+ * # Iterators
+ *
+ * #GcalRangeTreeIter walks the entries overlapping a range without
+ * allocating anything, which makes it preferable to
+ * gcal_range_tree_get_data_at_range() when the results are used only
+ * once. Iterators are invalidated by any modification of the tree;
+ * using an invalid iterator is caught by an assertion.
+ */
+
+/*
+ * Date-only ranges are compared by their wall clock dates, which may
+ * differ from the absolute time by the UTC offset of the timezone. Keep
+ * this much of slack when pruning subtrees so that those are never
+ * skipped wrongly.
+ */
+#define PRUNE_SLACK (2 * G_TIME_SPAN_DAY)
+
+/*
+ * Adding fewer entries than 1/BULK_REBUILD_RATIO of the nodes is cheaper
+ * with regular insertions than by rebuilding the whole tree.
+ */
+#define BULK_REBUILD_RATIO 8
+
+/*
+ * An AVL tree of height 48 would hold billions of nodes, so this is more
+ * than enough to keep the path to the current node of an iterator.
  */
+#define MAX_ITER_DEPTH 48
 
 typedef struct _Node
 {
@@ -53,12 +107,54 @@ typedef struct _Node
   GPtrArray          *data_array;
 } Node;
 
+typedef struct
+{
+  Node               *node;
+  guint               n_instances;
+} IndexEntry;
+
+typedef struct
+{
+  GcalRange          *range;
+  gpointer            data;
+  guint               position;
+} BulkEntry;
+
+typedef struct
+{
+  GcalRangeTree      *tree;
+  GcalRange          *range;
+  gint64              min_end;
+  Node               *current;
+  guint               data_index;
+  guint               n_stack;
+  guint64             stamp;
+  Node               *stack[MAX_ITER_DEPTH];
+} RealIter;
+
+G_STATIC_ASSERT (sizeof (RealIter) <= sizeof (GcalRangeTreeIter));
+
 struct _GcalRangeTree
 {
   guint               ref_count;
 
   GDestroyNotify      destroy_func;
   Node               *root;
+  guint               n_nodes;
+
+  /* Incremented on every modification, to catch invalid iterators */
+  guint64             stamp;
+
+  /* data → IndexEntry, only with GCAL_RANGE_TREE_INDEX_DATA */
+  GHashTable         *data_index;
+
+  /*
+   * Nodes touched by range queries, for tests to catch queries that stop
+   * pruning. Only counted when enabled, so that trees shared with other
+   * threads are never written to by readers.
+   */
+  gboolean            count_visits;
+  guint64             n_visits;
 };
 
 G_DEFINE_BOXED_TYPE (GcalRangeTree, gcal_range_tree, gcal_range_tree_ref, gcal_range_tree_unref)
@@ -78,6 +174,8 @@ destroy_tree (Node *n)
 
   g_ptr_array_unref (n->data_array);
   g_free (n);
+
+  gcal_memory_stats_remove (GCAL_MEMORY_RANGE_TREE_NODES, 1, sizeof (Node));
 }
 
 static inline gint32
@@ -92,6 +190,29 @@ update_height (Node *n)
   n->height = MAX (height (n->left), height (n->right)) + 1;
 }
 
+static inline void
+update_max (Node *n)
+{
+  g_autoptr (GDateTime) max = NULL;
+
+  max = gcal_range_get_end (n->range);
+
+  if (n->left && g_date_time_compare (n->left->max, max) > 0)
+    gcal_set_date_time (&max, n->left->max);
+
+  if (n->right && g_date_time_compare (n->right->max, max) > 0)
+    gcal_set_date_time (&max, n->right->max);
+
+  gcal_set_date_time (&n->max, max);
+}
+
+static inline void
+update_node (Node *n)
+{
+  update_height (n);
+  update_max (n);
+}
+
 static inline guint32
 balance (Node *n)
 {
@@ -114,6 +235,8 @@ node_new (GcalRange      *range,
   n->data_array = g_ptr_array_new_with_free_func (destroy_func);
   g_ptr_array_add (n->data_array, data);
 
+  gcal_memory_stats_add (GCAL_MEMORY_RANGE_TREE_NODES, 1, sizeof (Node));
+
   return n;
 }
 
@@ -127,9 +250,9 @@ rotate_left (Node *n)
   n->right = tmp->left;
   tmp->left = n;
 
-  /* Update heights */
-  update_height (n);
-  update_height (tmp);
+  /* Update heights and subtree maximums */
+  update_node (n);
+  update_node (tmp);
 
   return tmp;
 }
@@ -143,13 +266,67 @@ rotate_right (Node *n)
   n->left = tmp->right;
   tmp->right = n;
 
-  /* Update heights */
-  update_height (n);
-  update_height (tmp);
+  /* Update heights and subtree maximums */
+  update_node (n);
+  update_node (tmp);
 
   return tmp;
 }
 
+static inline void
+index_data (GcalRangeTree *self,
+            gpointer       data,
+            Node          *n)
+{
+  IndexEntry *entry;
+
+  if (!self->data_index)
+    return;
+
+  entry = g_hash_table_lookup (self->data_index, data);
+
+  if (!entry)
+    {
+      entry = g_new0 (IndexEntry, 1);
+      g_hash_table_insert (self->data_index, data, entry);
+    }
+
+  entry->n_instances++;
+
+  if (!entry->node)
+    entry->node = n;
+}
+
+static inline void
+unindex_data (GcalRangeTree *self,
+              gpointer       data,
+              Node          *n)
+{
+  IndexEntry *entry;
+
+  if (!self->data_index)
+    return;
+
+  entry = g_hash_table_lookup (self->data_index, data);
+
+  if (!entry)
+    return;
+
+  if (--entry->n_instances == 0)
+    {
+      g_hash_table_remove (self->data_index, data);
+      return;
+    }
+
+  /*
+   * The same data was added more than once. If the indexed node doesn't
+   * hold it anymore, the location of the remaining instances is unknown,
+   * and gcal_range_tree_remove_data() falls back to traversing the tree.
+   */
+  if (entry->node == n && !g_ptr_array_find (n->data_array, data, NULL))
+    entry->node = NULL;
+}
+
 static inline Node*
 hit_node (Node     *n,
           gpointer  data)
@@ -164,7 +341,7 @@ rebalance (Node *n)
 {
   gint32 node_balance;
 
-  update_height (n);
+  update_node (n);
 
   /* Rotate the tree */
   node_balance = balance (n);
@@ -188,33 +365,158 @@ rebalance (Node *n)
 }
 
 static Node*
-insert (Node           *n,
-        GcalRange      *range,
-        gpointer        data,
-        GDestroyNotify  destroy_func)
+insert (GcalRangeTree *self,
+        Node          *n,
+        GcalRange     *range,
+        gpointer       data)
 {
-  g_autoptr (GDateTime) range_end = NULL;
   gint result;
 
   if (!n)
-    return node_new (range, data, destroy_func);
+    {
+      n = node_new (range, data, self->destroy_func);
+      index_data (self, data, n);
+      self->n_nodes++;
+      return n;
+    }
 
   result = gcal_range_compare (range, n->range);
 
   if (result < 0)
-    n->left = insert (n->left, range, data, destroy_func);
+    {
+      n->left = insert (self, n->left, range, data);
+    }
   else if (result > 0)
-    n->right = insert (n->right, range, data, destroy_func);
+    {
+      n->right = insert (self, n->right, range, data);
+    }
   else
-    return hit_node (n, data);
+    {
+      index_data (self, data, n);
+      return hit_node (n, data);
+    }
 
-  range_end = gcal_range_get_end (range);
+  return rebalance (n);
+}
 
-  /* Update the current node's maximum subrange value */
-  if (!n->max || g_date_time_compare (range_end, n->max) > 0)
-    gcal_set_date_time (&n->max, range_end);
+/* Bulk loading */
+static gint
+compare_bulk_entries (gconstpointer a,
+                      gconstpointer b)
+{
+  const BulkEntry *entry_a = a;
+  const BulkEntry *entry_b = b;
+  gint result;
 
-  return rebalance (n);
+  result = gcal_range_compare (entry_a->range, entry_b->range);
+
+  /* Keep entries with the same range in the order they were passed */
+  if (result == 0)
+    result = (entry_a->position > entry_b->position) - (entry_a->position < entry_b->position);
+
+  return result;
+}
+
+static void
+flatten_tree (Node      *n,
+              GPtrArray *nodes)
+{
+  if (!n)
+    return;
+
+  flatten_tree (n->left, nodes);
+  g_ptr_array_add (nodes, n);
+  flatten_tree (n->right, nodes);
+}
+
+static Node*
+build_balanced_tree (GPtrArray *nodes,
+                     gint       first,
+                     gint       last)
+{
+  Node *n;
+  gint middle;
+
+  if (first > last)
+    return NULL;
+
+  middle = first + (last - first) / 2;
+
+  n = g_ptr_array_index (nodes, middle);
+  n->left = build_balanced_tree (nodes, first, middle - 1);
+  n->right = build_balanced_tree (nodes, middle + 1, last);
+
+  /* Children are complete at this point, so the subtree maximum is too */
+  update_node (n);
+
+  return n;
+}
+
+static void
+bulk_insert (GcalRangeTree *self,
+             GcalRange    **ranges,
+             gpointer      *data,
+             guint          n_entries)
+{
+  g_autoptr (GPtrArray) old_nodes = NULL;
+  g_autoptr (GPtrArray) nodes = NULL;
+  g_autofree BulkEntry *entries = NULL;
+  Node *last_node;
+  guint i, j;
+
+  entries = g_new (BulkEntry, n_entries);
+
+  for (i = 0; i < n_entries; i++)
+    {
+      entries[i].range = ranges[i];
+      entries[i].data = data[i];
+      entries[i].position = i;
+    }
+
+  qsort (entries, n_entries, sizeof (BulkEntry), compare_bulk_entries);
+
+  /* Existing nodes are sorted already, so the new entries can be merged in */
+  old_nodes = g_ptr_array_sized_new (self->n_nodes);
+  flatten_tree (self->root, old_nodes);
+
+  nodes = g_ptr_array_sized_new (self->n_nodes + n_entries);
+  last_node = NULL;
+  i = 0;
+  j = 0;
+
+  while (i < old_nodes->len || j < n_entries)
+    {
+      BulkEntry *entry;
+      Node *old_node;
+
+      old_node = i < old_nodes->len ? g_ptr_array_index (old_nodes, i) : NULL;
+
+      /* Existing nodes go first, so that new entries with the same range hit them */
+      if (old_node && (j == n_entries || gcal_range_compare (old_node->range, entries[j].range) <= 0))
+        {
+          g_ptr_array_add (nodes, old_node);
+          last_node = old_node;
+          i++;
+          continue;
+        }
+
+      entry = &entries[j++];
+
+      if (last_node && gcal_range_compare (last_node->range, entry->range) == 0)
+        {
+          index_data (self, entry->data, last_node);
+          hit_node (last_node, entry->data);
+          continue;
+        }
+
+      last_node = node_new (entry->range, entry->data, self->destroy_func);
+      index_data (self, entry->data, last_node);
+      g_ptr_array_add (nodes, last_node);
+    }
+
+  self->n_nodes = nodes->len;
+  self->root = build_balanced_tree (nodes, 0, (gint) nodes->len - 1);
+  self->stamp++;
 }
 
 /* Remove */
@@ -239,13 +541,16 @@ delete_minimum (Node *n)
 }
 
 static inline Node*
-delete_node (Node     *n,
-             gpointer  data)
+delete_node (GcalRangeTree *self,
+             Node          *n,
+             gpointer       data)
 {
   Node *left, *right, *min;
 
   n->hits--;
-  g_ptr_array_remove (n->data_array, data);
+
+  if (g_ptr_array_remove (n->data_array, data))
+    unindex_data (self, data, n);
 
   /* Only remove the node when the hit count reaches zero */
   if (n->hits > 0)
@@ -254,9 +559,15 @@ delete_node (Node     *n,
   left = n->left;
   right = n->right;
 
+  g_clear_pointer (&n->range, gcal_range_unref);
+  gcal_clear_date_time (&n->max);
   g_ptr_array_unref (n->data_array);
   g_free (n);
 
+  gcal_memory_stats_remove (GCAL_MEMORY_RANGE_TREE_NODES, 1, sizeof (Node));
+
+  self->n_nodes--;
+
   if (!right)
     return left;
 
@@ -268,9 +579,10 @@ delete_node (Node     *n,
 }
 
 static Node*
-remove_node (Node      *n,
-             GcalRange *range,
-             gpointer   data)
+remove_node (GcalRangeTree *self,
+             Node          *n,
+             GcalRange     *range,
+             gpointer       data)
 {
   GcalRangePosition position;
 
@@ -282,14 +594,14 @@ remove_node (Node      *n,
   switch (position)
     {
     case GCAL_RANGE_BEFORE:
-      n->left = remove_node (n->left, range, data);
+      n->left = remove_node (self, n->left, range, data);
       break;
 
     case GCAL_RANGE_MATCH:
-      return delete_node (n, data);
+      return delete_node (self, n, data);
 
     case GCAL_RANGE_AFTER:
-      n->right = remove_node (n->right, range, data);
+      n->right = remove_node (self, n->right, range, data);
       break;
 
     default:
@@ -352,6 +664,49 @@ traverse (Node                  *n,
   return GCAL_TRAVERSE_CONTINUE;
 }
 
+/*
+ * Walks, in order, the nodes that overlap @range. Subtrees whose maximum
+ * end is before @min_end cannot overlap @range, and are skipped entirely.
+ */
+static gboolean
+traverse_at_range (GcalRangeTree         *self,
+                   Node                  *n,
+                   GcalRange             *range,
+                   GDateTime             *min_end,
+                   GcalRangeTraverseFunc  func,
+                   gpointer               user_data)
+{
+  GcalRangePosition position;
+  GcalRangeOverlap overlap;
+
+  if (!n)
+    return GCAL_TRAVERSE_CONTINUE;
+
+  if (G_UNLIKELY (self->count_visits))
+    self->n_visits++;
+
+  if (g_date_time_compare (n->max, min_end) < 0)
+    return GCAL_TRAVERSE_CONTINUE;
+
+  if (traverse_at_range (self, n->left, range, min_end, func, user_data))
+    return GCAL_TRAVERSE_STOP;
+
+  overlap = gcal_range_calculate_overlap (n->range, range, &position);
+
+  if (overlap == GCAL_RANGE_NO_OVERLAP)
+    {
+      /* Every node after this one starts after @range */
+      if (position == GCAL_RANGE_AFTER)
+        return GCAL_TRAVERSE_STOP;
+    }
+  else if (run_traverse_func (n, func, user_data))
+    {
+      return GCAL_TRAVERSE_STOP;
+    }
+
+  return traverse_at_range (self, n->right, range, min_end, func, user_data);
+}
+
 /* Internal traverse functions */
 static inline gboolean
 gather_all_data (GcalRange *range,
@@ -366,60 +721,28 @@ gather_all_data (GcalRange *range,
 }
 
 static inline gboolean
-gather_data_at_range (GcalRange *range,
-                      gpointer   data,
-                      gpointer   user_data)
+gather_data_lazily (GcalRange *range,
+                    gpointer   data,
+                    gpointer   user_data)
 {
-  GcalRangePosition position;
-  GcalRangeOverlap overlap;
+  GPtrArray **array = user_data;
 
-  struct {
-    GcalRange *range;
-    GPtrArray **array;
-  } *gather_data = user_data;
+  if (!*array)
+    *array = g_ptr_array_new ();
 
-  overlap = gcal_range_calculate_overlap (range, gather_data->range, &position);
-
-  if (overlap == GCAL_RANGE_NO_OVERLAP)
-    {
-      if (position == GCAL_RANGE_BEFORE)
-        return GCAL_TRAVERSE_CONTINUE;
-      if (position == GCAL_RANGE_AFTER)
-        return GCAL_TRAVERSE_STOP;
-    }
-
-  if (!*gather_data->array)
-    *gather_data->array = g_ptr_array_new ();
-
-  g_ptr_array_add (*gather_data->array, data);
+  g_ptr_array_add (*array, data);
 
   return GCAL_TRAVERSE_CONTINUE;
 }
 
 static inline gboolean
-count_entries_at_range (GcalRange *range,
-                        gpointer   data,
-                        gpointer   user_data)
+count_entries (GcalRange *range,
+               gpointer   data,
+               gpointer   user_data)
 {
-  GcalRangePosition position;
-  GcalRangeOverlap overlap;
-
-  struct {
-    GcalRange *range;
-    guint64 counter;
-  } *gather_data = user_data;
-
-  overlap = gcal_range_calculate_overlap (range, gather_data->range, &position);
-
-  if (overlap == GCAL_RANGE_NO_OVERLAP)
-    {
-      if (position == GCAL_RANGE_BEFORE)
-        return GCAL_TRAVERSE_CONTINUE;
-      if (position == GCAL_RANGE_AFTER)
-        return GCAL_TRAVERSE_STOP;
-    }
+  guint64 *counter = user_data;
 
-  gather_data->counter++;
+  (*counter)++;
 
   return GCAL_TRAVERSE_CONTINUE;
 }
@@ -443,6 +766,60 @@ remove_data_func (GcalRange *range,
   return GCAL_TRAVERSE_CONTINUE;
 }
 
+static inline gboolean
+contains_data_func (GcalRange *range,
+                    gpointer   data,
+                    gpointer   user_data)
+{
+  struct {
+    gpointer  data;
+    gboolean  found;
+  } *contains_data = user_data;
+
+  contains_data->found = contains_data->data == data;
+
+  return contains_data->found;
+}
+
+static void
+traverse_tree_at_range (GcalRangeTree         *self,
+                        GcalRange             *range,
+                        GcalRangeTraverseFunc  func,
+                        gpointer               user_data)
+{
+  g_autoptr (GDateTime) range_start = NULL;
+  g_autoptr (GDateTime) min_end = NULL;
+
+  if (!self->root)
+    return;
+
+  range_start = gcal_range_get_start (range);
+  min_end = g_date_time_add (range_start, -PRUNE_SLACK);
+
+  traverse_at_range (self, self->root, range, min_end, func, user_data);
+}
+
+/* Iterators */
+static void
+iter_push_left (RealIter *iter,
+                Node     *n)
+{
+  while (n)
+    {
+      if (G_UNLIKELY (iter->tree->count_visits))
+        iter->tree->n_visits++;
+
+      /* Nothing in this subtree ends after the start of the range */
+      if (g_date_time_to_unix (n->max) < iter->min_end)
+        return;
+
+      g_assert (iter->n_stack < MAX_ITER_DEPTH);
+
+      iter->stack[iter->n_stack++] = n;
+      n = n->left;
+    }
+}
+
 static void
 recursively_print_node_to_string (Node    *n,
                                   GString *string,
@@ -474,6 +851,7 @@ gcal_range_tree_free (GcalRangeTree *self)
   g_assert_cmpint (self->ref_count, ==, 0);
 
   destroy_tree (self->root);
+  g_clear_pointer (&self->data_index, g_hash_table_destroy);
 
   g_slice_free (GcalRangeTree, self);
 }
@@ -509,6 +887,24 @@ gcal_range_tree_new (void)
  */
 GcalRangeTree*
 gcal_range_tree_new_with_free_func (GDestroyNotify destroy_func)
+{
+  return gcal_range_tree_new_full (destroy_func, GCAL_RANGE_TREE_DEFAULT);
+}
+
+/**
+ * gcal_range_tree_new_full:
+ * @destroy_func: (nullable): a function to free elements with
+ * @flags: a #GcalRangeTreeFlags
+ *
+ * Creates a new range tree with @destroy_func as the function to
+ * destroy elements when removing them, and the behavior set by @flags.
+ *
+ * Returns: (transfer full): a newly created #GcalRangeTree.
+ * Free with gcal_range_tree_unref() when done.
+ */
+GcalRangeTree*
+gcal_range_tree_new_full (GDestroyNotify     destroy_func,
+                          GcalRangeTreeFlags flags)
 {
   GcalRangeTree *self;
 
@@ -516,6 +912,44 @@ gcal_range_tree_new_with_free_func (GDestroyNotify destroy_func)
   self->ref_count = 1;
   self->destroy_func = destroy_func;
 
+  if (flags & GCAL_RANGE_TREE_INDEX_DATA)
+    self->data_index = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
+
+  return self;
+}
+
+/**
+ * gcal_range_tree_new_from_array:
+ * @destroy_func: (nullable): a function to free elements with
+ * @flags: a #GcalRangeTreeFlags
+ * @ranges: (array length=n_entries): the ranges of the entries
+ * @data: (array length=n_entries): the data of the entries
+ * @n_entries: the number of entries in @ranges and @data
+ *
+ * Creates a new range tree like gcal_range_tree_new_full(), and
+ * fills it with the given entries at once. This is considerably
+ * faster than adding them one by one.
+ *
+ * Returns: (transfer full): a newly created #GcalRangeTree.
+ * Free with gcal_range_tree_unref() when done.
+ */
+GcalRangeTree*
+gcal_range_tree_new_from_array (GDestroyNotify      destroy_func,
+                                GcalRangeTreeFlags  flags,
+                                GcalRange         **ranges,
+                                gpointer           *data,
+                                guint               n_entries)
+{
+  GcalRangeTree *self;
+
+  g_return_val_if_fail (ranges || n_entries == 0, NULL);
+  g_return_val_if_fail (data || n_entries == 0, NULL);
+
+  self = gcal_range_tree_new_full (destroy_func, flags);
+
+  if (n_entries > 0)
+    bulk_insert (self, ranges, data, n_entries);
+
   return self;
 }
 
@@ -596,7 +1030,47 @@ gcal_range_tree_add_range (GcalRangeTree *self,
   g_return_if_fail (self);
   g_return_if_fail (range);
 
-  self->root = insert (self->root, range, data, self->destroy_func);
+  self->root = insert (self, self->root, range, data);
+  self->stamp++;
+}
+
+/**
+ * gcal_range_tree_add_ranges:
+ * @self: a #GcalRangeTree
+ * @ranges: (array length=n_entries): the ranges of the entries
+ * @data: (array length=n_entries): the data of the entries
+ * @n_entries: the number of entries in @ranges and @data
+ *
+ * Adds multiple entries to @self, with the same semantics as calling
+ * gcal_range_tree_add_range() on each of them in order. When the number
+ * of entries is large compared to the size of @self, the tree is rebuilt
+ * in a single pass instead.
+ */
+void
+gcal_range_tree_add_ranges (GcalRangeTree  *self,
+                            GcalRange     **ranges,
+                            gpointer       *data,
+                            guint           n_entries)
+{
+  guint i;
+
+  g_return_if_fail (self);
+  g_return_if_fail (ranges || n_entries == 0);
+  g_return_if_fail (data || n_entries == 0);
+
+  if (n_entries == 0)
+    return;
+
+  if (n_entries >= self->n_nodes / BULK_REBUILD_RATIO)
+    {
+      bulk_insert (self, ranges, data, n_entries);
+      return;
+    }
+
+  for (i = 0; i < n_entries; i++)
+    self->root = insert (self, self->root, ranges[i], data[i]);
+
+  self->stamp++;
 }
 
 /**
@@ -615,7 +1089,8 @@ gcal_range_tree_remove_range (GcalRangeTree *self,
   g_return_if_fail (self);
   g_return_if_fail (range);
 
-  self->root = remove_node (self->root, range, data);
+  self->root = remove_node (self, self->root, range, data);
+  self->stamp++;
 }
 
 /**
@@ -636,9 +1111,54 @@ gcal_range_tree_remove_data (GcalRangeTree *self,
 
   g_return_if_fail (self);
 
+  if (self->data_index)
+    {
+      IndexEntry *entry = g_hash_table_lookup (self->data_index, data);
+
+      if (!entry)
+        return;
+
+      if (entry->node)
+        {
+          self->root = remove_node (self, self->root, entry->node->range, data);
+          self->stamp++;
+          return;
+        }
+    }
+
   gcal_range_tree_traverse (self, G_IN_ORDER, remove_data_func, &remove_data);
 }
 
+/**
+ * gcal_range_tree_contains_data:
+ * @self: a #GcalRangeTree
+ * @data: user data
+ *
+ * Checks whether @data is stored in @self. This is O(1) for trees
+ * created with %GCAL_RANGE_TREE_INDEX_DATA, and traverses the whole
+ * tree otherwise.
+ *
+ * Returns: %TRUE if @data is in @self, %FALSE otherwise
+ */
+gboolean
+gcal_range_tree_contains_data (GcalRangeTree *self,
+                               gpointer       data)
+{
+  struct {
+    gpointer  data;
+    gboolean  found;
+  } contains_data = { data, FALSE };
+
+  g_return_val_if_fail (self, FALSE);
+
+  if (self->data_index)
+    return g_hash_table_contains (self->data_index, data);
+
+  gcal_range_tree_traverse (self, G_IN_ORDER, contains_data_func, &contains_data);
+
+  return contains_data.found;
+}
+
 /**
  * gcal_range_tree_traverse:
  * @self: a #GcalRangeTree
@@ -697,17 +1217,12 @@ gcal_range_tree_get_data_at_range (GcalRangeTree *self,
 {
   GPtrArray *data;
 
-  struct {
-    GcalRange *range;
-    GPtrArray **array;
-  } gather_data = { range, &data };
-
   g_return_val_if_fail (self, NULL);
   g_return_val_if_fail (range, NULL);
 
   data = NULL;
 
-  gcal_range_tree_traverse (self, G_IN_ORDER, gather_data_at_range, &gather_data);
+  traverse_tree_at_range (self, range, gather_data_lazily, &data);
 
   return data;
 }
@@ -726,17 +1241,124 @@ guint64
 gcal_range_tree_count_entries_at_range (GcalRangeTree *self,
                                         GcalRange     *range)
 {
-  struct {
-    GcalRange *range;
-    guint64 counter;
-  } gather_data = { range, 0 };
+  guint64 counter = 0;
 
   g_return_val_if_fail (self, 0);
   g_return_val_if_fail (range, 0);
 
-  gcal_range_tree_traverse (self, G_IN_ORDER, count_entries_at_range, &gather_data);
+  traverse_tree_at_range (self, range, count_entries, &counter);
+
+  return counter;
+}
+
+/**
+ * gcal_range_tree_iter_init_at_range:
+ * @iter: an uninitialized #GcalRangeTreeIter
+ * @tree: a #GcalRangeTree
+ * @range: a #GcalRange
+ *
+ * Initializes @iter to walk the entries of @tree that overlap @range,
+ * in the order of their start dates. @tree and @range must be kept
+ * alive while @iter is used, and @iter is only valid until @tree is
+ * modified.
+ */
+void
+gcal_range_tree_iter_init_at_range (GcalRangeTreeIter *iter,
+                                    GcalRangeTree     *tree,
+                                    GcalRange         *range)
+{
+  g_autoptr (GDateTime) range_start = NULL;
+  RealIter *real_iter;
+
+  g_return_if_fail (iter);
+  g_return_if_fail (tree);
+  g_return_if_fail (range);
+
+  range_start = gcal_range_get_start (range);
 
-  return gather_data.counter;
+  real_iter = (RealIter *) iter;
+  real_iter->tree = tree;
+  real_iter->range = range;
+  real_iter->min_end = g_date_time_to_unix (range_start) - PRUNE_SLACK / G_TIME_SPAN_SECOND;
+  real_iter->current = NULL;
+  real_iter->data_index = 0;
+  real_iter->n_stack = 0;
+  real_iter->stamp = tree->stamp;
+
+  iter_push_left (real_iter, tree->root);
+}
+
+/**
+ * gcal_range_tree_iter_next:
+ * @iter: a #GcalRangeTreeIter
+ * @out_range: (out)(optional)(transfer none): return location for the range of the entry
+ * @out_data: (out)(optional)(transfer none): return location for the data of the entry
+ *
+ * Advances @iter to the next entry overlapping the range it was
+ * initialized with.
+ *
+ * Returns: %TRUE if there was a next entry, %FALSE otherwise
+ */
+gboolean
+gcal_range_tree_iter_next (GcalRangeTreeIter  *iter,
+                           GcalRange         **out_range,
+                           gpointer           *out_data)
+{
+  RealIter *real_iter;
+
+  g_return_val_if_fail (iter, FALSE);
+
+  real_iter = (RealIter *) iter;
+
+  g_assert (real_iter->stamp == real_iter->tree->stamp);
+
+  while (TRUE)
+    {
+      GcalRangePosition position;
+      Node *n;
+
+      if (real_iter->current)
+        {
+          n = real_iter->current;
+
+          if (real_iter->data_index < n->hits)
+            {
+              if (out_range)
+                *out_range = n->range;
+              if (out_data)
+                *out_data = g_ptr_array_index (n->data_array, real_iter->data_index);
+
+              real_iter->data_index++;
+              return TRUE;
+            }
+
+          real_iter->current = NULL;
+          iter_push_left (real_iter, n->right);
+        }
+
+      if (real_iter->n_stack == 0)
+        return FALSE;
+
+      n = real_iter->stack[--real_iter->n_stack];
+
+      if (gcal_range_calculate_overlap (n->range, real_iter->range, &position) == GCAL_RANGE_NO_OVERLAP)
+        {
+          /* Every node after this one starts after the range */
+          if (position == GCAL_RANGE_AFTER)
+            {
+              real_iter->n_stack = 0;
+              return FALSE;
+            }
+
+          iter_push_left (real_iter, n->right);
+          continue;
+        }
+
+      real_iter->current = n;
+      real_iter->data_index = 0;
+    }
+
+  return FALSE;
 }
 
 /**
@@ -758,3 +1380,25 @@ gcal_range_tree_print (GcalRangeTree *self)
 
   g_print ("%s", string->str);
 }
+
+
+/*
+ * Private API
+ */
+
+void
+gcal_range_tree_count_visits_for_testing (GcalRangeTree *self)
+{
+  g_return_if_fail (self);
+
+  self->count_visits = TRUE;
+  self->n_visits = 0;
+}
+
+guint64
+gcal_range_tree_get_n_visits_for_testing (GcalRangeTree *self)
+{
+  g_return_val_if_fail (self, 0);
+
+  return self->n_visits;
+}
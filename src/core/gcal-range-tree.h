@@ -46,12 +46,56 @@ typedef gboolean    (*GcalRangeTraverseFunc)                     (GcalRange
 #define GCAL_TRAVERSE_CONTINUE FALSE;
 #define GCAL_TRAVERSE_STOP     TRUE;
 
+/**
+ * GcalRangeTreeFlags:
+ * @GCAL_RANGE_TREE_DEFAULT: no special behavior
+ * @GCAL_RANGE_TREE_INDEX_DATA: keep an index of the stored data, which
+ *   makes gcal_range_tree_remove_data() and gcal_range_tree_contains_data()
+ *   fast at the cost of a hash table entry per element
+ *
+ * Flags to create a #GcalRangeTree with.
+ */
+typedef enum
+{
+  GCAL_RANGE_TREE_DEFAULT    = 0,
+  GCAL_RANGE_TREE_INDEX_DATA = 1 << 0,
+} GcalRangeTreeFlags;
+
+/**
+ * GcalRangeTreeIter:
+ *
+ * An iterator over the entries of a #GcalRangeTree that overlap a
+ * range. It is meant to be allocated on the stack, and is invalidated
+ * by any modification of the tree.
+ */
+typedef struct
+{
+  /*< private >*/
+  gpointer            dummy1;
+  gpointer            dummy2;
+  gint64              dummy3;
+  gpointer            dummy4;
+  guint               dummy5;
+  guint               dummy6;
+  guint64             dummy7;
+  gpointer            dummy8[48];
+} GcalRangeTreeIter;
+
 GType                gcal_range_tree_get_type                    (void) G_GNUC_CONST;
 
 GcalRangeTree*       gcal_range_tree_new                         (void);
 
 GcalRangeTree*       gcal_range_tree_new_with_free_func          (GDestroyNotify      destroy_func);
 
+GcalRangeTree*       gcal_range_tree_new_full                    (GDestroyNotify      destroy_func,
+                                                                  GcalRangeTreeFlags  flags);
+
+GcalRangeTree*       gcal_range_tree_new_from_array              (GDestroyNotify      destroy_func,
+                                                                  GcalRangeTreeFlags  flags,
+                                                                  GcalRange         **ranges,
+                                                                  gpointer           *data,
+                                                                  guint               n_entries);
+
 GcalRangeTree*       gcal_range_tree_copy                        (GcalRangeTree      *self);
 
 GcalRangeTree*       gcal_range_tree_ref                         (GcalRangeTree      *self);
@@ -62,6 +106,11 @@ void                 gcal_range_tree_add_range                   (GcalRangeTree
                                                                   GcalRange          *range,
                                                                   gpointer            data);
 
+void                 gcal_range_tree_add_ranges                  (GcalRangeTree      *self,
+                                                                  GcalRange         **ranges,
+                                                                  gpointer           *data,
+                                                                  guint               n_entries);
+
 void                 gcal_range_tree_remove_range                (GcalRangeTree      *self,
                                                                   GcalRange          *range,
                                                                   gpointer            data);
@@ -69,6 +118,9 @@ void                 gcal_range_tree_remove_range                (GcalRangeTree
 void                 gcal_range_tree_remove_data                 (GcalRangeTree      *self,
                                                                   gpointer            data);
 
+gboolean             gcal_range_tree_contains_data               (GcalRangeTree      *self,
+                                                                  gpointer            data);
+
 void                 gcal_range_tree_traverse                    (GcalRangeTree      *self,
                                                                   GTraverseType       type,
                                                                   GcalRangeTraverseFunc func,
@@ -82,6 +134,14 @@ GPtrArray*           gcal_range_tree_get_data_at_range           (GcalRangeTree
 guint64              gcal_range_tree_count_entries_at_range      (GcalRangeTree      *self,
                                                                   GcalRange          *range);
 
+void                 gcal_range_tree_iter_init_at_range          (GcalRangeTreeIter  *iter,
+                                                                  GcalRangeTree      *tree,
+                                                                  GcalRange          *range);
+
+gboolean             gcal_range_tree_iter_next                   (GcalRangeTreeIter  *iter,
+                                                                  GcalRange         **out_range,
+                                                                  gpointer           *out_data);
+
 void                 gcal_range_tree_print                       (GcalRangeTree      *self);
 
 G_DEFINE_AUTOPTR_CLEANUP_FUNC (GcalRangeTree, gcal_range_tree_unref)
@@ -0,0 +1,63 @@
+/* gcal-timeline-private.h
+ *
+ * Copyright 2024 Georges Basile Stavracas Neto <georges.stavracas@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include "gcal-timeline.h"
+
+G_BEGIN_DECLS
+
+/*
+ * Range tree additions are coalesced into bulk insertions, but no more
+ * than this many per dispatch of the timeline source, so that a large
+ * batch of events is spread over several main loop iterations.
+ */
+#define GCAL_TIMELINE_MAX_COALESCED_ADDS 500
+
+/*
+ * Operation counters, used by tests to catch algorithmic regressions
+ * without depending on wall clock time.
+ */
+typedef struct
+{
+  guint64             range_tree_visits;
+  guint64             queued_items;
+  guint64             dispatched_items;
+  guint64             subscriber_adds;
+  guint64             subscriber_updates;
+  guint64             subscriber_removes;
+} GcalTimelineStats;
+
+void                 gcal_timeline_get_stats                     (GcalTimeline       *self,
+                                                                  GcalTimelineStats  *out_stats);
+
+void                 gcal_timeline_reset_stats                   (GcalTimeline       *self);
+
+void                 gcal_timeline_add_events_for_testing        (GcalTimeline       *self,
+                                                                  GPtrArray          *events);
+
+void                 gcal_timeline_update_events_for_testing     (GcalTimeline       *self,
+                                                                  GPtrArray          *old_events,
+                                                                  GPtrArray          *events);
+
+void                 gcal_timeline_remove_events_for_testing     (GcalTimeline       *self,
+                                                                  GPtrArray          *events);
+
+G_END_DECLS
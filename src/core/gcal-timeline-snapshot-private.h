@@ -0,0 +1,45 @@
+/* gcal-timeline-snapshot-private.h
+ *
+ * Copyright 2024 Georges Basile Stavracas Neto <georges.stavracas@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include "gcal-event.h"
+#include "gcal-timeline-snapshot.h"
+
+G_BEGIN_DECLS
+
+/*
+ * Snapshots are created and derived by GcalTimeline only. Deriving a
+ * snapshot never modifies @self, which stays valid for its readers.
+ */
+GcalTimelineSnapshot* gcal_timeline_snapshot_new                 (void);
+
+GcalTimelineSnapshot* gcal_timeline_snapshot_add_event           (GcalTimelineSnapshot *self,
+                                                                  GcalEvent            *event);
+
+GcalTimelineSnapshot* gcal_timeline_snapshot_remove_event        (GcalTimelineSnapshot *self,
+                                                                  GcalEvent            *event);
+
+guint                gcal_timeline_snapshot_count_shared_nodes_for_testing (GcalTimelineSnapshot *a,
+                                                                            GcalTimelineSnapshot *b);
+
+gint                 gcal_timeline_snapshot_get_height_for_testing (GcalTimelineSnapshot *self);
+
+G_END_DECLS
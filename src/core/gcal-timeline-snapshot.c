@@ -0,0 +1,590 @@
+/* gcal-timeline-snapshot.c
+ *
+ * Copyright 2024 Georges Basile Stavracas Neto <georges.stavracas@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#define G_LOG_DOMAIN "GcalTimelineSnapshot"
+
+#include "gcal-timeline-snapshot.h"
+#include "gcal-timeline-snapshot-private.h"
+
+/**
+ * SECTION:gcal-timeline-snapshot
+ * @short_description: Immutable version of the events of a timeline
+ * @title:GcalTimelineSnapshot
+ * @stability:unstable
+ *
+ * #GcalTimelineSnapshot is a persistent AVL tree of events, ordered by
+ * their start and end, and augmented with the maximum end of each subtree
+ * for range queries. Snapshots are never modified once created, so they
+ * can be read from any thread without locking.
+ *
+ * # Path copying
+ *
+ * Adding or removing an event creates a new snapshot that copies only
+ * the nodes on the path to the changed node, O(log n) of them, and
+ * shares every other subtree with the previous snapshot. Nodes are
+ * reference counted, and are freed with the last snapshot using them.
+ *
+ * # Times
+ *
+ * Events are compared by the absolute time of the start and end of their
+ * range, with the start inclusive and the end exclusive.
+ */
+
+typedef struct _Node
+{
+  gint                ref_count;
+  struct _Node       *left;
+  struct _Node       *right;
+  GcalEvent          *event;
+  gint64              start;
+  gint64              end;
+  gint64              max_end;
+  gint                height;
+} Node;
+
+struct _GcalTimelineSnapshot
+{
+  gatomicrefcount     ref_count;
+
+  Node               *root;
+  guint               n_events;
+  guint64             version;
+};
+
+G_DEFINE_BOXED_TYPE (GcalTimelineSnapshot, gcal_timeline_snapshot, gcal_timeline_snapshot_ref, gcal_timeline_snapshot_unref)
+
+
+/*
+ * Auxiliary methods
+ */
+
+static inline gint
+height (Node *n)
+{
+  return n ? n->height : 0;
+}
+
+static Node*
+node_ref (Node *n)
+{
+  if (n)
+    g_atomic_int_inc (&n->ref_count);
+
+  return n;
+}
+
+static void
+node_unref (Node *n)
+{
+  if (!n || !g_atomic_int_dec_and_test (&n->ref_count))
+    return;
+
+  node_unref (n->left);
+  node_unref (n->right);
+  g_clear_object (&n->event);
+  g_free (n);
+}
+
+/*
+ * Creates a node for @event, taking the references of @left and @right.
+ */
+static Node*
+node_new (GcalEvent *event,
+          gint64     start,
+          gint64     end,
+          Node      *left,
+          Node      *right)
+{
+  Node *n;
+
+  n = g_new0 (Node, 1);
+  n->ref_count = 1;
+  n->event = g_object_ref (event);
+  n->start = start;
+  n->end = end;
+  n->left = left;
+  n->right = right;
+  n->height = MAX (height (left), height (right)) + 1;
+  n->max_end = end;
+
+  if (left && left->max_end > n->max_end)
+    n->max_end = left->max_end;
+
+  if (right && right->max_end > n->max_end)
+    n->max_end = right->max_end;
+
+  return n;
+}
+
+static inline Node*
+node_copy_with (Node *source,
+                Node *left,
+                Node *right)
+{
+  return node_new (source->event, source->start, source->end, left, right);
+}
+
+/*
+ * Builds a balanced subtree out of the node @key and the subtrees @left and
+ * @right, whose heights differ by at most 2. Takes the references of @left
+ * and @right; nodes they share with other snapshots are copied, never
+ * rotated in place.
+ */
+static Node*
+join_balanced (Node *key,
+               Node *left,
+               Node *right)
+{
+  Node *result;
+
+  if (height (left) > height (right) + 1)
+    {
+      if (height (left->left) >= height (left->right))
+        {
+          result = node_copy_with (left,
+                                   node_ref (left->left),
+                                   node_copy_with (key, node_ref (left->right), right));
+        }
+      else
+        {
+          Node *pivot = left->right;
+
+          result = node_copy_with (pivot,
+                                   node_copy_with (left, node_ref (left->left), node_ref (pivot->left)),
+                                   node_copy_with (key, node_ref (pivot->right), right));
+        }
+
+      node_unref (left);
+      return result;
+    }
+
+  if (height (right) > height (left) + 1)
+    {
+      if (height (right->right) >= height (right->left))
+        {
+          result = node_copy_with (right,
+                                   node_copy_with (key, left, node_ref (right->left)),
+                                   node_ref (right->right));
+        }
+      else
+        {
+          Node *pivot = right->left;
+
+          result = node_copy_with (pivot,
+                                   node_copy_with (key, left, node_ref (pivot->left)),
+                                   node_copy_with (right, node_ref (pivot->right), node_ref (right->right)));
+        }
+
+      node_unref (right);
+      return result;
+    }
+
+  return node_copy_with (key, left, right);
+}
+
+static gint
+compare_key (gint64     start,
+             gint64     end,
+             GcalEvent *event,
+             Node      *n)
+{
+  if (start != n->start)
+    return start < n->start ? -1 : 1;
+
+  if (end != n->end)
+    return end < n->end ? -1 : 1;
+
+  if (event != n->event)
+    return event < n->event ? -1 : 1;
+
+  return 0;
+}
+
+static Node*
+insert_node (Node      *n,
+             GcalEvent *event,
+             gint64     start,
+             gint64     end,
+             gboolean  *out_inserted)
+{
+  gint result;
+
+  if (!n)
+    {
+      *out_inserted = TRUE;
+      return node_new (event, start, end, NULL, NULL);
+    }
+
+  result = compare_key (start, end, event, n);
+
+  if (result == 0)
+    {
+      *out_inserted = FALSE;
+      return node_ref (n);
+    }
+
+  if (result < 0)
+    return join_balanced (n, insert_node (n->left, event, start, end, out_inserted), node_ref (n->right));
+  else
+    return join_balanced (n, node_ref (n->left), insert_node (n->right, event, start, end, out_inserted));
+}
+
+static Node*
+find_minimum (Node *n)
+{
+  while (n->left)
+    n = n->left;
+
+  return n;
+}
+
+static Node*
+remove_minimum (Node *n)
+{
+  if (!n->left)
+    return node_ref (n->right);
+
+  return join_balanced (n, remove_minimum (n->left), node_ref (n->right));
+}
+
+static Node*
+remove_node (Node      *n,
+             GcalEvent *event,
+             gint64     start,
+             gint64     end,
+             gboolean  *out_removed)
+{
+  gint result;
+
+  if (!n)
+    {
+      *out_removed = FALSE;
+      return NULL;
+    }
+
+  result = compare_key (start, end, event, n);
+
+  if (result < 0)
+    return join_balanced (n, remove_node (n->left, event, start, end, out_removed), node_ref (n->right));
+
+  if (result > 0)
+    return join_balanced (n, node_ref (n->left), remove_node (n->right, event, start, end, out_removed));
+
+  *out_removed = TRUE;
+
+  if (!n->left)
+    return node_ref (n->right);
+
+  if (!n->right)
+    return node_ref (n->left);
+
+  return join_balanced (find_minimum (n->right), node_ref (n->left), remove_minimum (n->right));
+}
+
+static void
+gather_events_at_range (Node      *n,
+                        gint64     range_start,
+                        gint64     range_end,
+                        GPtrArray *events)
+{
+  while (n)
+    {
+      /* Nothing in this subtree ends after the range starts */
+      if (n->max_end < range_start)
+        return;
+
+      gather_events_at_range (n->left, range_start, range_end, events);
+
+      /* Neither this node nor the ones after it start before the range ends */
+      if (n->start >= range_end)
+        return;
+
+      if (n->end > range_start || (n->start == n->end && n->start >= range_start))
+        g_ptr_array_add (events, g_object_ref (n->event));
+
+      n = n->right;
+    }
+}
+
+static void
+get_event_times (GcalEvent *event,
+                 gint64    *out_start,
+                 gint64    *out_end)
+{
+  g_autoptr (GDateTime) start = NULL;
+  g_autoptr (GDateTime) end = NULL;
+  GcalRange *range;
+
+  range = gcal_event_get_range (event);
+  start = gcal_range_get_start (range);
+  end = gcal_range_get_end (range);
+
+  *out_start = g_date_time_to_unix (start);
+  *out_end = g_date_time_to_unix (end);
+}
+
+static GcalTimelineSnapshot*
+snapshot_new_with_root (GcalTimelineSnapshot *previous,
+                        Node                 *root,
+                        guint                 n_events)
+{
+  GcalTimelineSnapshot *self;
+
+  self = g_new0 (GcalTimelineSnapshot, 1);
+  g_atomic_ref_count_init (&self->ref_count);
+  self->root = root;
+  self->n_events = n_events;
+  self->version = previous ? previous->version + 1 : 0;
+
+  return self;
+}
+
+static guint
+count_shared_nodes (Node       *n,
+                    GHashTable *nodes)
+{
+  if (!n)
+    return 0;
+
+  return (g_hash_table_contains (nodes, n) ? 1 : 0) +
+         count_shared_nodes (n->left, nodes) +
+         count_shared_nodes (n->right, nodes);
+}
+
+static void
+collect_nodes (Node       *n,
+               GHashTable *nodes)
+{
+  if (!n)
+    return;
+
+  g_hash_table_add (nodes, n);
+  collect_nodes (n->left, nodes);
+  collect_nodes (n->right, nodes);
+}
+
+
+/*
+ * Public API
+ */
+
+/**
+ * gcal_timeline_snapshot_ref:
+ * @self: a #GcalTimelineSnapshot
+ *
+ * Increases the reference count of @self. This is thread-safe.
+ *
+ * Returns: (transfer full): @self
+ */
+GcalTimelineSnapshot*
+gcal_timeline_snapshot_ref (GcalTimelineSnapshot *self)
+{
+  g_return_val_if_fail (self, NULL);
+
+  g_atomic_ref_count_inc (&self->ref_count);
+
+  return self;
+}
+
+/**
+ * gcal_timeline_snapshot_unref:
+ * @self: a #GcalTimelineSnapshot
+ *
+ * Decreases the reference count of @self, and frees it, and the nodes
+ * no other snapshot shares, when it reaches zero. This is thread-safe.
+ */
+void
+gcal_timeline_snapshot_unref (GcalTimelineSnapshot *self)
+{
+  g_return_if_fail (self);
+
+  if (!g_atomic_ref_count_dec (&self->ref_count))
+    return;
+
+  node_unref (self->root);
+  g_free (self);
+}
+
+/**
+ * gcal_timeline_snapshot_get_version:
+ * @self: a #GcalTimelineSnapshot
+ *
+ * Retrieves the version of @self. Versions increase every time the
+ * events of the timeline change, so a snapshot with a greater version
+ * is more recent.
+ *
+ * Returns: the version of @self
+ */
+guint64
+gcal_timeline_snapshot_get_version (GcalTimelineSnapshot *self)
+{
+  g_return_val_if_fail (self, 0);
+
+  return self->version;
+}
+
+/**
+ * gcal_timeline_snapshot_get_n_events:
+ * @self: a #GcalTimelineSnapshot
+ *
+ * Retrieves the number of events in @self.
+ *
+ * Returns: the number of events
+ */
+guint
+gcal_timeline_snapshot_get_n_events (GcalTimelineSnapshot *self)
+{
+  g_return_val_if_fail (self, 0);
+
+  return self->n_events;
+}
+
+/**
+ * gcal_timeline_snapshot_get_events_at_range:
+ * @self: a #GcalTimelineSnapshot
+ * @range: (nullable): a #GcalRange
+ *
+ * Retrieves the events of @self that overlap @range, or all events if
+ * @range is %NULL, ordered by their start. This costs O(log n + k),
+ * where k is the number of returned events. The events must not be
+ * modified.
+ *
+ * Returns: (transfer full)(element-type GcalEvent): a #GPtrArray
+ */
+GPtrArray*
+gcal_timeline_snapshot_get_events_at_range (GcalTimelineSnapshot *self,
+                                            GcalRange            *range)
+{
+  g_autoptr (GPtrArray) events = NULL;
+  gint64 range_start;
+  gint64 range_end;
+
+  g_return_val_if_fail (self, NULL);
+
+  events = g_ptr_array_new_with_free_func (g_object_unref);
+
+  if (range)
+    {
+      g_autoptr (GDateTime) start = gcal_range_get_start (range);
+      g_autoptr (GDateTime) end = gcal_range_get_end (range);
+
+      range_start = g_date_time_to_unix (start);
+      range_end = g_date_time_to_unix (end);
+    }
+  else
+    {
+      range_start = G_MININT64;
+      range_end = G_MAXINT64;
+    }
+
+  gather_events_at_range (self->root, range_start, range_end, events);
+
+  return g_steal_pointer (&events);
+}
+
+
+/*
+ * Private API
+ */
+
+/*
+ * gcal_timeline_snapshot_new:
+ *
+ * Creates an empty snapshot, with version 0.
+ */
+GcalTimelineSnapshot*
+gcal_timeline_snapshot_new (void)
+{
+  return snapshot_new_with_root (NULL, NULL, 0);
+}
+
+/*
+ * gcal_timeline_snapshot_add_event:
+ *
+ * Creates a snapshot with the events of @self and @event. @event must
+ * not be modified afterwards, see gcal_event_ensure_caches().
+ *
+ * Returns: (transfer full): a new #GcalTimelineSnapshot
+ */
+GcalTimelineSnapshot*
+gcal_timeline_snapshot_add_event (GcalTimelineSnapshot *self,
+                                  GcalEvent            *event)
+{
+  gboolean inserted = FALSE;
+  gint64 start;
+  gint64 end;
+  Node *root;
+
+  g_return_val_if_fail (self, NULL);
+  g_return_val_if_fail (GCAL_IS_EVENT (event), NULL);
+
+  get_event_times (event, &start, &end);
+  root = insert_node (self->root, event, start, end, &inserted);
+
+  return snapshot_new_with_root (self, root, self->n_events + (inserted ? 1 : 0));
+}
+
+/*
+ * gcal_timeline_snapshot_remove_event:
+ *
+ * Creates a snapshot with the events of @self except @event.
+ *
+ * Returns: (transfer full): a new #GcalTimelineSnapshot
+ */
+GcalTimelineSnapshot*
+gcal_timeline_snapshot_remove_event (GcalTimelineSnapshot *self,
+                                     GcalEvent            *event)
+{
+  gboolean removed = FALSE;
+  gint64 start;
+  gint64 end;
+  Node *root;
+
+  g_return_val_if_fail (self, NULL);
+  g_return_val_if_fail (GCAL_IS_EVENT (event), NULL);
+
+  get_event_times (event, &start, &end);
+  root = remove_node (self->root, event, start, end, &removed);
+
+  return snapshot_new_with_root (self, root, self->n_events - (removed ? 1 : 0));
+}
+
+/*
+ * gcal_timeline_snapshot_count_shared_nodes_for_testing:
+ *
+ * Counts the nodes of @b that are also used by @a.
+ */
+guint
+gcal_timeline_snapshot_count_shared_nodes_for_testing (GcalTimelineSnapshot *a,
+                                                       GcalTimelineSnapshot *b)
+{
+  g_autoptr (GHashTable) nodes = NULL;
+
+  nodes = g_hash_table_new (NULL, NULL);
+  collect_nodes (a->root, nodes);
+
+  return count_shared_nodes (b->root, nodes);
+}
+
+gint
+gcal_timeline_snapshot_get_height_for_testing (GcalTimelineSnapshot *self)
+{
+  return height (self->root);
+}
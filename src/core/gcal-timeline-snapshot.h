@@ -0,0 +1,48 @@
+/* gcal-timeline-snapshot.h
+ *
+ * Copyright 2024 Georges Basile Stavracas Neto <georges.stavracas@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <glib-object.h>
+
+#include "gcal-range.h"
+
+G_BEGIN_DECLS
+
+#define GCAL_TYPE_TIMELINE_SNAPSHOT (gcal_timeline_snapshot_get_type())
+
+typedef struct _GcalTimelineSnapshot GcalTimelineSnapshot;
+
+GType                gcal_timeline_snapshot_get_type             (void) G_GNUC_CONST;
+
+GcalTimelineSnapshot* gcal_timeline_snapshot_ref                 (GcalTimelineSnapshot *self);
+
+void                 gcal_timeline_snapshot_unref                (GcalTimelineSnapshot *self);
+
+guint64              gcal_timeline_snapshot_get_version          (GcalTimelineSnapshot *self);
+
+guint                gcal_timeline_snapshot_get_n_events         (GcalTimelineSnapshot *self);
+
+GPtrArray*           gcal_timeline_snapshot_get_events_at_range  (GcalTimelineSnapshot *self,
+                                                                  GcalRange            *range);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (GcalTimelineSnapshot, gcal_timeline_snapshot_unref)
+
+G_END_DECLS
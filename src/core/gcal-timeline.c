@@ -26,8 +26,13 @@
 #include "gcal-date-time-utils.h"
 #include "gcal-debug.h"
 #include "gcal-event.h"
+#include "gcal-memory-stats.h"
 #include "gcal-range-tree.h"
+#include "gcal-range-tree-private.h"
 #include "gcal-timeline.h"
+#include "gcal-timeline-private.h"
+#include "gcal-timeline-snapshot.h"
+#include "gcal-timeline-snapshot-private.h"
 #include "gcal-timeline-subscriber.h"
 
 #include <libedataserver/libedataserver.h>
@@ -67,6 +72,7 @@ struct _GcalTimeline
   GcalRange          *range;
 
   GcalRangeTree      *events;
+  GHashTable         *calendar_events; /* GcalCalendar* -> GcalRangeTree* */
   gchar              *filter;
 
   GHashTable         *calendars; /* GcalCalendar* -> GcalCalendarMonitor* */
@@ -81,6 +87,21 @@ struct _GcalTimeline
   GQueue             *event_queue;
   GSource            *timeline_source;
 
+  /*
+   * Immutable versions of the events, see gcal_timeline_ref_snapshot().
+   * The current version is only used by the main thread, and is published
+   * to other threads at the end of each dispatch. Replaced versions are
+   * retired until no reader can be about to take a reference to them.
+   */
+  struct {
+    GcalTimelineSnapshot *current;
+    GcalTimelineSnapshot *published;
+    gint              n_readers;
+    GPtrArray        *retired;
+  } snapshot;
+
+  GcalTimelineStats   stats;
+
   GcalContext        *context;
 };
 
@@ -116,6 +137,8 @@ queue_data_free (QueueData *queue_data)
   g_clear_object (&queue_data->old_event);
   g_clear_object (&queue_data->event);
   g_free (queue_data);
+
+  gcal_memory_stats_remove (GCAL_MEMORY_TIMELINE_QUEUE, 1, sizeof (QueueData));
 }
 
 static void
@@ -129,6 +152,8 @@ queue_event_data (GcalTimeline           *self,
   g_autofree gchar *subscriber_event_id = NULL;
   QueueData *queue_data;
 
+  self->stats.queued_items++;
+
   queue_data = g_new0 (QueueData, 1);
   queue_data->timeline = self;
   queue_data->queue_event = queue_event;
@@ -137,6 +162,8 @@ queue_event_data (GcalTimeline           *self,
   queue_data->old_event = old_event ? g_object_ref (old_event) : NULL;
   queue_data->update_range_tree = update_range_tree;
 
+  gcal_memory_stats_add (GCAL_MEMORY_TIMELINE_QUEUE, 1, sizeof (QueueData));
+
   if (subscriber)
     {
       subscriber_event_id = format_subscriber_event_id (subscriber, event);
@@ -188,6 +215,208 @@ queue_event_data (GcalTimeline           *self,
     }
 }
 
+static void
+add_event_to_snapshot (GcalTimeline *self,
+                       GcalEvent    *event)
+{
+  GcalTimelineSnapshot *snapshot;
+
+  /* Other threads must not write to the lazily computed fields of the event */
+  gcal_event_ensure_caches (event);
+
+  snapshot = gcal_timeline_snapshot_add_event (self->snapshot.current, event);
+  gcal_timeline_snapshot_unref (self->snapshot.current);
+  self->snapshot.current = snapshot;
+}
+
+static void
+remove_event_from_snapshot (GcalTimeline *self,
+                            GcalEvent    *event)
+{
+  GcalTimelineSnapshot *snapshot;
+
+  snapshot = gcal_timeline_snapshot_remove_event (self->snapshot.current, event);
+  gcal_timeline_snapshot_unref (self->snapshot.current);
+  self->snapshot.current = snapshot;
+}
+
+static void
+publish_snapshot (GcalTimeline *self)
+{
+  GcalTimelineSnapshot *published;
+
+  published = g_atomic_pointer_get (&self->snapshot.published);
+
+  if (published != self->snapshot.current)
+    {
+      g_atomic_pointer_set (&self->snapshot.published, gcal_timeline_snapshot_ref (self->snapshot.current));
+      g_ptr_array_add (self->snapshot.retired, published);
+
+      GCAL_TRACE_MSG ("Published timeline snapshot %" G_GUINT64_FORMAT " with %u events",
+                      gcal_timeline_snapshot_get_version (self->snapshot.current),
+                      gcal_timeline_snapshot_get_n_events (self->snapshot.current));
+    }
+
+  /*
+   * A reader may have loaded the pointer to a retired version without
+   * having referenced it yet. Such readers are counted, so retired versions
+   * are only released when there are none; otherwise, try again on the next
+   * dispatch.
+   */
+  if (self->snapshot.retired->len > 0 && g_atomic_int_get (&self->snapshot.n_readers) == 0)
+    g_ptr_array_set_size (self->snapshot.retired, 0);
+}
+
+static void
+add_event_to_range_trees (GcalTimeline *self,
+                          GcalEvent    *event)
+{
+  GcalRangeTree *calendar_events;
+  GcalCalendar *calendar;
+  GcalRange *event_range;
+
+  event_range = gcal_event_get_range (event);
+  gcal_range_tree_add_range (self->events, event_range, g_object_ref (event));
+  add_event_to_snapshot (self, event);
+
+  calendar = gcal_event_get_calendar (event);
+
+  if (!calendar)
+    return;
+
+  calendar_events = g_hash_table_lookup (self->calendar_events, calendar);
+
+  if (!calendar_events)
+    {
+      calendar_events = gcal_range_tree_new_with_free_func (g_object_unref);
+      g_hash_table_insert (self->calendar_events, g_object_ref (calendar), calendar_events);
+    }
+
+  gcal_range_tree_add_range (calendar_events, event_range, g_object_ref (event));
+}
+
+static void
+gather_events_at_range (GcalRangeTree  *range_tree,
+                        GcalRange      *range,
+                        GPtrArray     **events)
+{
+  GcalRangeTreeIter iter;
+  GcalEvent *event;
+
+  gcal_range_tree_iter_init_at_range (&iter, range_tree, range);
+  while (gcal_range_tree_iter_next (&iter, NULL, (gpointer *) &event))
+    {
+      if (!*events)
+        *events = g_ptr_array_new ();
+
+      g_ptr_array_add (*events, event);
+    }
+}
+
+static void
+add_ranges_to_tree (GcalRangeTree *range_tree,
+                    GPtrArray     *events)
+{
+  g_autoptr (GPtrArray) ranges = NULL;
+  g_autoptr (GPtrArray) data = NULL;
+  guint i;
+
+  ranges = g_ptr_array_sized_new (events->len);
+  data = g_ptr_array_sized_new (events->len);
+
+  for (i = 0; i < events->len; i++)
+    {
+      GcalEvent *event = g_ptr_array_index (events, i);
+
+      g_ptr_array_add (ranges, gcal_event_get_range (event));
+      g_ptr_array_add (data, g_object_ref (event));
+    }
+
+  gcal_range_tree_add_ranges (range_tree,
+                              (GcalRange **) ranges->pdata,
+                              data->pdata,
+                              events->len);
+}
+
+static void
+add_events_to_range_trees (GcalTimeline *self,
+                           GPtrArray    *events)
+{
+  g_autoptr (GHashTable) events_per_calendar = NULL;
+  GHashTableIter iter;
+  GcalCalendar *calendar;
+  GPtrArray *calendar_events;
+  guint i;
+
+  if (events->len == 1)
+    {
+      add_event_to_range_trees (self, g_ptr_array_index (events, 0));
+      return;
+    }
+
+  add_ranges_to_tree (self->events, events);
+
+  for (i = 0; i < events->len; i++)
+    add_event_to_snapshot (self, g_ptr_array_index (events, i));
+
+  events_per_calendar = g_hash_table_new_full (NULL, NULL, NULL, (GDestroyNotify) g_ptr_array_unref);
+
+  for (i = 0; i < events->len; i++)
+    {
+      GcalEvent *event = g_ptr_array_index (events, i);
+
+      calendar = gcal_event_get_calendar (event);
+
+      if (!calendar)
+        continue;
+
+      calendar_events = g_hash_table_lookup (events_per_calendar, calendar);
+
+      if (!calendar_events)
+        {
+          calendar_events = g_ptr_array_new ();
+          g_hash_table_insert (events_per_calendar, calendar, calendar_events);
+        }
+
+      g_ptr_array_add (calendar_events, event);
+    }
+
+  g_hash_table_iter_init (&iter, events_per_calendar);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &calendar, (gpointer *) &calendar_events))
+    {
+      GcalRangeTree *range_tree;
+
+      range_tree = g_hash_table_lookup (self->calendar_events, calendar);
+
+      if (!range_tree)
+        {
+          range_tree = gcal_range_tree_new_with_free_func (g_object_unref);
+          g_hash_table_insert (self->calendar_events, g_object_ref (calendar), range_tree);
+        }
+
+      add_ranges_to_tree (range_tree, calendar_events);
+    }
+}
+
+static void
+remove_event_from_range_trees (GcalTimeline *self,
+                               GcalEvent    *event)
+{
+  GcalRangeTree *calendar_events;
+  GcalCalendar *calendar;
+  GcalRange *event_range;
+
+  event_range = gcal_event_get_range (event);
+  calendar = gcal_event_get_calendar (event);
+  calendar_events = calendar ? g_hash_table_lookup (self->calendar_events, calendar) : NULL;
+
+  if (calendar_events)
+    gcal_range_tree_remove_range (calendar_events, event_range, event);
+
+  gcal_range_tree_remove_range (self->events, event_range, event);
+  remove_event_from_snapshot (self, event);
+}
+
 static void
 update_completed_calendars (GcalTimeline *self)
 {
@@ -320,97 +549,17 @@ update_range (GcalTimeline *self)
 }
 
 static void
-calculate_changed_events (GcalTimeline            *self,
-                          GcalTimelineSubscriber  *subscriber,
-                          GcalRange               *old_range,
-                          GcalRange               *new_range)
+queue_removals_at_range (GcalTimeline           *self,
+                         GcalTimelineSubscriber *subscriber,
+                         GcalRange              *range,
+                         GcalRange              *new_range)
 {
-  g_autoptr (GPtrArray) events_to_remove = NULL;
-  g_autoptr (GPtrArray) events_to_add = NULL;
-  GcalRangeOverlap overlap;
-  gint range_diff;
-  gint i;
-
-  overlap = gcal_range_calculate_overlap (new_range, old_range, NULL);
-
-  if (overlap == GCAL_RANGE_NO_OVERLAP)
-    {
-      GCAL_TRACE_MSG ("Ranges don't overlap, doing a full cleanup");
+  GcalRangeTreeIter iter;
+  GcalEvent *event;
 
-      events_to_remove = gcal_range_tree_get_data_at_range (self->events, old_range);
-      events_to_add = gcal_range_tree_get_data_at_range (self->events, new_range);
-    }
-  else
+  gcal_range_tree_iter_init_at_range (&iter, self->events, range);
+  while (gcal_range_tree_iter_next (&iter, NULL, (gpointer *) &event))
     {
-      g_autoptr (GDateTime) old_range_start = NULL;
-      g_autoptr (GDateTime) old_range_end = NULL;
-      g_autoptr (GDateTime) new_range_start = NULL;
-      g_autoptr (GDateTime) new_range_end = NULL;
-
-      GCAL_TRACE_MSG ("Ranges overlap, doing a diff");
-
-      events_to_add = g_ptr_array_new ();
-      events_to_remove = g_ptr_array_new ();
-
-      old_range_start = gcal_range_get_start (old_range);
-      old_range_end = gcal_range_get_end (old_range);
-      new_range_start = gcal_range_get_start (new_range);
-      new_range_end = gcal_range_get_end (new_range);
-
-      /* Start ranges diff */
-      range_diff = g_date_time_compare (old_range_start, new_range_start);
-      if (range_diff != 0)
-        {
-          g_autoptr (GPtrArray) events = NULL;
-
-          if (range_diff < 0)
-            {
-              g_autoptr (GcalRange) range = gcal_range_new (old_range_start, new_range_start, GCAL_RANGE_DEFAULT);
-
-              /* Removed */
-              events = gcal_range_tree_get_data_at_range (self->events, range);
-              if (events)
-                g_ptr_array_extend (events_to_remove, events, NULL, NULL);
-            }
-          else if (range_diff > 0)
-            {
-              g_autoptr (GcalRange) range = gcal_range_new (new_range_start, old_range_start, GCAL_RANGE_DEFAULT);
-
-              /* Added */
-              events = gcal_range_tree_get_data_at_range (self->events, range);
-              if (events)
-                g_ptr_array_extend (events_to_add, events, NULL, NULL);
-            }
-        }
-
-      /* End ranges diff */
-      range_diff = g_date_time_compare (old_range_end, new_range_end);
-      if (range_diff != 0)
-        {
-          g_autoptr (GPtrArray) events = NULL;
-
-          if (range_diff < 0)
-            {
-              g_autoptr (GcalRange) range = gcal_range_new (old_range_end, new_range_end, GCAL_RANGE_DEFAULT);
-
-              events = gcal_range_tree_get_data_at_range (self->events, range);
-              if (events)
-                g_ptr_array_extend (events_to_add, events, NULL, NULL);
-            }
-          else if (range_diff > 0)
-            {
-              g_autoptr (GcalRange) range = gcal_range_new (new_range_end, old_range_end, GCAL_RANGE_DEFAULT);
-
-              events = gcal_range_tree_get_data_at_range (self->events, range);
-              if (events)
-                g_ptr_array_extend (events_to_remove, events, NULL, NULL);
-            }
-        }
-    }
-
-  for (i = 0; events_to_remove && i < events_to_remove->len; i++)
-    {
-      GcalEvent *event = g_ptr_array_index (events_to_remove, i);
       /* Do not re-remove multiday events that are part of new range */
       if (gcal_event_is_multiday (event) && gcal_event_overlaps (event, new_range))
         continue;
@@ -422,12 +571,22 @@ calculate_changed_events (GcalTimeline            *self,
 
       queue_event_data (self, REMOVE_EVENT, subscriber, event, NULL, FALSE);
     }
+}
 
-  for (i = 0; events_to_add && i < events_to_add->len; i++)
+static void
+queue_additions_at_range (GcalTimeline           *self,
+                          GcalTimelineSubscriber *subscriber,
+                          GcalRange              *range,
+                          GcalRange              *old_range)
+{
+  GcalRangeTreeIter iter;
+  GcalEvent *event;
+
+  gcal_range_tree_iter_init_at_range (&iter, self->events, range);
+  while (gcal_range_tree_iter_next (&iter, NULL, (gpointer *) &event))
     {
-      GcalEvent *event = g_ptr_array_index (events_to_add, i);
       /* Do not re-add multiday events that were part of old range */
-      if (gcal_event_is_multiday (event) && gcal_event_overlaps (event, old_range))
+      if (old_range && gcal_event_is_multiday (event) && gcal_event_overlaps (event, old_range))
         continue;
 
       GCAL_TRACE_MSG ("Queueing event addition for subscriber %s (event: '%s' (%s))",
@@ -439,31 +598,78 @@ calculate_changed_events (GcalTimeline            *self,
     }
 }
 
+static void
+calculate_changed_events (GcalTimeline            *self,
+                          GcalTimelineSubscriber  *subscriber,
+                          GcalRange               *old_range,
+                          GcalRange               *new_range)
+{
+  g_autoptr (GDateTime) old_range_start = NULL;
+  g_autoptr (GDateTime) old_range_end = NULL;
+  g_autoptr (GDateTime) new_range_start = NULL;
+  g_autoptr (GDateTime) new_range_end = NULL;
+  g_autoptr (GcalRange) added_start_range = NULL;
+  g_autoptr (GcalRange) removed_start_range = NULL;
+  g_autoptr (GcalRange) added_end_range = NULL;
+  g_autoptr (GcalRange) removed_end_range = NULL;
+  GcalRangeOverlap overlap;
+  gint range_diff;
+
+  overlap = gcal_range_calculate_overlap (new_range, old_range, NULL);
+
+  if (overlap == GCAL_RANGE_NO_OVERLAP)
+    {
+      GCAL_TRACE_MSG ("Ranges don't overlap, doing a full cleanup");
+
+      queue_removals_at_range (self, subscriber, old_range, new_range);
+      queue_additions_at_range (self, subscriber, new_range, old_range);
+      return;
+    }
+
+  GCAL_TRACE_MSG ("Ranges overlap, doing a diff");
+
+  old_range_start = gcal_range_get_start (old_range);
+  old_range_end = gcal_range_get_end (old_range);
+  new_range_start = gcal_range_get_start (new_range);
+  new_range_end = gcal_range_get_end (new_range);
+
+  /* Start ranges diff */
+  range_diff = g_date_time_compare (old_range_start, new_range_start);
+  if (range_diff < 0)
+    removed_start_range = gcal_range_new (old_range_start, new_range_start, GCAL_RANGE_DEFAULT);
+  else if (range_diff > 0)
+    added_start_range = gcal_range_new (new_range_start, old_range_start, GCAL_RANGE_DEFAULT);
+
+  /* End ranges diff */
+  range_diff = g_date_time_compare (old_range_end, new_range_end);
+  if (range_diff < 0)
+    added_end_range = gcal_range_new (old_range_end, new_range_end, GCAL_RANGE_DEFAULT);
+  else if (range_diff > 0)
+    removed_end_range = gcal_range_new (new_range_end, old_range_end, GCAL_RANGE_DEFAULT);
+
+  /* Queue all removals before additions */
+  if (removed_start_range)
+    queue_removals_at_range (self, subscriber, removed_start_range, new_range);
+  if (removed_end_range)
+    queue_removals_at_range (self, subscriber, removed_end_range, new_range);
+
+  if (added_start_range)
+    queue_additions_at_range (self, subscriber, added_start_range, old_range);
+  if (added_end_range)
+    queue_additions_at_range (self, subscriber, added_end_range, old_range);
+}
+
 static void
 add_cached_events_to_subscriber (GcalTimeline           *self,
                                  GcalTimelineSubscriber *subscriber)
 {
   g_autoptr (GcalRange) subscriber_range = NULL;
-  g_autoptr (GPtrArray) events_to_add = NULL;
-  gint i;
 
   GCAL_ENTRY;
 
   subscriber_range = gcal_timeline_subscriber_get_range (subscriber);
 
-  events_to_add = gcal_range_tree_get_data_at_range (self->events, subscriber_range);
-
-  for (i = 0; events_to_add && i < events_to_add->len; i++)
-    {
-      GcalEvent *event = g_ptr_array_index (events_to_add, i);
-
-      GCAL_TRACE_MSG ("Queueing event addition for subscriber %s (event: '%s' (%s))",
-                      G_OBJECT_TYPE_NAME (subscriber),
-                      gcal_event_get_summary (event),
-                      gcal_event_get_uid (event));
-
-      queue_event_data (self, ADD_EVENT, subscriber, event, NULL, FALSE);
-    }
+  queue_additions_at_range (self, subscriber, subscriber_range, NULL);
 
   GCAL_EXIT;
 }
@@ -521,9 +727,17 @@ calendar_monitor_add_events_cb (GcalCalendarMonitor *monitor,
 
   self = GCAL_TIMELINE (user_data);
 
+  /*
+   * Queue all range tree additions first, so that the timeline source can
+   * add them to the range trees in bulk before notifying subscribers.
+   */
+  for (guint i = 0; i < events->len; i++)
+    queue_event_data (self, ADD_EVENT, NULL, g_ptr_array_index (events, i), NULL, TRUE);
+
   for (guint i = 0; i < events->len; i++)
     {
-      g_autoptr (GPtrArray) subscribers_at_range = NULL;
+      GcalTimelineSubscriber *subscriber;
+      GcalRangeTreeIter iter;
       GcalRange *event_range;
       GcalEvent *event;
 
@@ -531,16 +745,9 @@ calendar_monitor_add_events_cb (GcalCalendarMonitor *monitor,
       event_range = gcal_event_get_range (event);
 
       /* Add to all subscribers within the event range */
-      subscribers_at_range = gcal_range_tree_get_data_at_range (self->subscriber_ranges, event_range);
-
-      queue_event_data (self, ADD_EVENT, NULL, event, NULL, TRUE);
-
-      for (guint j = 0; subscribers_at_range && j < subscribers_at_range->len; j++)
-        {
-          GcalTimelineSubscriber *subscriber = g_ptr_array_index (subscribers_at_range, j);
-
-          queue_event_data (self, ADD_EVENT, subscriber, event, NULL, FALSE);
-        }
+      gcal_range_tree_iter_init_at_range (&iter, self->subscriber_ranges, event_range);
+      while (gcal_range_tree_iter_next (&iter, NULL, (gpointer *) &subscriber))
+        queue_event_data (self, ADD_EVENT, subscriber, event, NULL, FALSE);
     }
 
   GCAL_EXIT;
@@ -616,22 +823,18 @@ calendar_monitor_remove_events_cb (GcalCalendarMonitor *monitor,
 
   for (guint i = 0; i < events->len; i++)
     {
-      g_autoptr (GPtrArray) subscribers_at_range = NULL;
+      GcalTimelineSubscriber *subscriber;
+      GcalRangeTreeIter iter;
       GcalRange *event_range;
       GcalEvent *event;
 
       event = g_ptr_array_index (events, i);
       event_range = gcal_event_get_range (event);
 
-      /* Add to all subscribers within the event range */
-      subscribers_at_range = gcal_range_tree_get_data_at_range (self->subscriber_ranges, event_range);
-
-      for (guint j = 0; subscribers_at_range && j < subscribers_at_range->len; j++)
-        {
-          GcalTimelineSubscriber *subscriber = g_ptr_array_index (subscribers_at_range, j);
-
-          queue_event_data (self, REMOVE_EVENT, subscriber, event, NULL, FALSE);
-        }
+      /* Remove from all subscribers within the event range */
+      gcal_range_tree_iter_init_at_range (&iter, self->subscriber_ranges, event_range);
+      while (gcal_range_tree_iter_next (&iter, NULL, (gpointer *) &subscriber))
+        queue_event_data (self, REMOVE_EVENT, subscriber, event, NULL, FALSE);
 
       queue_event_data (self, REMOVE_EVENT, NULL, event, NULL, TRUE);
     }
@@ -710,27 +913,30 @@ timeline_source_dispatch (GSource     *source,
 {
   TimelineSource *timeline_source;
   GcalTimeline *self;
+  guint range_tree_adds;
   gint processed_events;
 
   GCAL_ENTRY;
 
   processed_events = 0;
+  range_tree_adds = 0;
   timeline_source = (TimelineSource*) source;
   self = timeline_source->timeline;
 
-  while (processed_events < BATCH_SIZE && !g_queue_is_empty (self->event_queue))
+  while (processed_events < BATCH_SIZE &&
+         range_tree_adds < GCAL_TIMELINE_MAX_COALESCED_ADDS &&
+         !g_queue_is_empty (self->event_queue))
     {
       GcalTimelineSubscriber *subscriber;
       g_autofree gchar *subscriber_event_id = NULL;
-      GcalRange *event_range;
       QueueData *queue_data;
       GcalEvent *event;
 
       queue_data = g_queue_pop_head (self->event_queue);
+      self->stats.dispatched_items++;
 
       event = queue_data->event;
       subscriber = queue_data->subscriber;
-      event_range = gcal_event_get_range (event);
 
       if (subscriber)
         subscriber_event_id = format_subscriber_event_id (subscriber, event);
@@ -753,10 +959,32 @@ timeline_source_dispatch (GSource     *source,
                           queue_data->update_range_tree);
 
           if (queue_data->update_range_tree)
-            gcal_range_tree_add_range (self->events, event_range, g_object_ref (event));
+            {
+              g_autoptr (GPtrArray) events = NULL;
+              QueueData *next;
+
+              /* Coalesce consecutive range tree additions into a bulk insertion */
+              events = g_ptr_array_new_with_free_func (g_object_unref);
+              g_ptr_array_add (events, g_object_ref (event));
+
+              while (range_tree_adds + events->len < GCAL_TIMELINE_MAX_COALESCED_ADDS &&
+                     (next = g_queue_peek_head (self->event_queue)) != NULL &&
+                     next->queue_event == ADD_EVENT &&
+                     next->update_range_tree &&
+                     !next->subscriber)
+                {
+                  g_ptr_array_add (events, g_object_ref (next->event));
+                  queue_data_free (g_queue_pop_head (self->event_queue));
+                  self->stats.dispatched_items++;
+                }
+
+              add_events_to_range_trees (self, events);
+              range_tree_adds += events->len;
+            }
 
           if (subscriber)
             {
+              self->stats.subscriber_adds++;
               add_event_to_subscriber (subscriber, event);
               g_hash_table_remove (self->queued_adds, subscriber_event_id);
             }
@@ -771,17 +999,15 @@ timeline_source_dispatch (GSource     *source,
 
             if (queue_data->update_range_tree)
               {
-                GcalRange *old_event_range;
-
-                /* Remove the old event */
-                old_event_range = gcal_event_get_range (queue_data->old_event);
-
-                gcal_range_tree_remove_range (self->events, old_event_range, queue_data->old_event);
-                gcal_range_tree_add_range (self->events, event_range, g_object_ref (event));
+                remove_event_from_range_trees (self, queue_data->old_event);
+                add_event_to_range_trees (self, event);
               }
 
             if (subscriber)
-              update_subscriber_event (subscriber, queue_data->old_event, event);
+              {
+                self->stats.subscriber_updates++;
+                update_subscriber_event (subscriber, queue_data->old_event, event);
+              }
           }
           break;
 
@@ -792,10 +1018,13 @@ timeline_source_dispatch (GSource     *source,
                           queue_data->update_range_tree);
 
           if (subscriber)
-            remove_event_from_subscriber (subscriber, event);
+            {
+              self->stats.subscriber_removes++;
+              remove_event_from_subscriber (subscriber, event);
+            }
 
           if (queue_data->update_range_tree)
-            gcal_range_tree_remove_range (self->events, event_range, event);
+            remove_event_from_range_trees (self, event);
           break;
         }
 
@@ -804,6 +1033,8 @@ timeline_source_dispatch (GSource     *source,
       processed_events++;
     }
 
+  publish_snapshot (self);
+
   GCAL_RETURN (G_SOURCE_CONTINUE);
 }
 
@@ -830,10 +1061,14 @@ gcal_timeline_finalize (GObject *object)
   g_clear_handle_id (&self->update_range_idle_id, g_source_remove);
 
   g_clear_pointer (&self->events, gcal_range_tree_unref);
+  g_clear_pointer (&self->calendar_events, g_hash_table_destroy);
   g_clear_pointer (&self->calendars, g_hash_table_destroy);
   g_clear_pointer (&self->subscribers, g_hash_table_destroy);
   g_clear_pointer (&self->queued_adds, g_hash_table_destroy);
   g_clear_pointer (&self->subscriber_ranges, gcal_range_tree_unref);
+  g_clear_pointer (&self->snapshot.current, gcal_timeline_snapshot_unref);
+  g_clear_pointer (&self->snapshot.published, gcal_timeline_snapshot_unref);
+  g_clear_pointer (&self->snapshot.retired, g_ptr_array_unref);
 
   g_source_destroy (self->timeline_source);
   g_clear_pointer (&self->timeline_source, g_source_unref);
@@ -950,12 +1185,17 @@ gcal_timeline_init (GcalTimeline *self)
 
   self->cancellable = g_cancellable_new ();
   self->events = gcal_range_tree_new_with_free_func (g_object_unref);
+  self->calendar_events = g_hash_table_new_full (NULL, NULL, g_object_unref, (GDestroyNotify) gcal_range_tree_unref);
   self->calendars = g_hash_table_new_full (NULL, NULL, NULL, g_object_unref);
   self->subscribers = g_hash_table_new_full (NULL, NULL, g_object_unref, (GDestroyNotify) gcal_range_unref);
-  self->subscriber_ranges = gcal_range_tree_new ();
+  self->subscriber_ranges = gcal_range_tree_new_full (NULL, GCAL_RANGE_TREE_INDEX_DATA);
   self->event_queue = g_queue_new ();
   self->queued_adds = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 
+  self->snapshot.current = gcal_timeline_snapshot_new ();
+  self->snapshot.published = gcal_timeline_snapshot_ref (self->snapshot.current);
+  self->snapshot.retired = g_ptr_array_new_with_free_func ((GDestroyNotify) gcal_timeline_snapshot_unref);
+
   /* Timeline source */
   timeline_source = (TimelineSource*) g_source_new (&timeline_source_funcs, sizeof (TimelineSource));
   timeline_source->timeline = self;
@@ -1113,6 +1353,53 @@ gcal_timeline_get_events_at_range (GcalTimeline *self,
   return g_steal_pointer (&events_at_range);
 }
 
+/**
+ * gcal_timeline_get_overlapping_events:
+ * @self: a #GcalTimeline
+ * @range: a #GcalRange
+ * @calendars: (nullable)(element-type GcalCalendar): the calendars to look into
+ *
+ * Retrieves the events of @calendars that overlap @range. If @calendars
+ * is %NULL, events of all calendars are considered. This is meant to be
+ * used to detect conflicts while creating or moving events, and is cheap
+ * enough to be called on every motion event.
+ *
+ * Only events within the range of the subscribers of @self are known.
+ *
+ * Returns: (transfer container)(nullable): a #GPtrArray with the overlapping
+ * #GcalEvent, or %NULL if there are none
+ */
+GPtrArray*
+gcal_timeline_get_overlapping_events (GcalTimeline *self,
+                                      GcalRange    *range,
+                                      GList        *calendars)
+{
+  g_autoptr (GPtrArray) overlapping_events = NULL;
+  GcalRangeTree *calendar_events;
+  GHashTableIter iter;
+  GList *l;
+
+  g_return_val_if_fail (GCAL_IS_TIMELINE (self), NULL);
+  g_return_val_if_fail (range != NULL, NULL);
+
+  if (!calendars)
+    {
+      g_hash_table_iter_init (&iter, self->calendar_events);
+      while (g_hash_table_iter_next (&iter, NULL, (gpointer*) &calendar_events))
+        gather_events_at_range (calendar_events, range, &overlapping_events);
+    }
+
+  for (l = calendars; l; l = l->next)
+    {
+      calendar_events = g_hash_table_lookup (self->calendar_events, l->data);
+
+      if (calendar_events)
+        gather_events_at_range (calendar_events, range, &overlapping_events);
+    }
+
+  return g_steal_pointer (&overlapping_events);
+}
+
 const gchar*
 gcal_timeline_get_filter (GcalTimeline *self)
 {
@@ -1149,3 +1436,121 @@ gcal_timeline_is_complete (GcalTimeline *self)
 
   return self->complete;
 }
+
+/**
+ * gcal_timeline_get_n_truncated_series:
+ * @self: a #GcalTimeline
+ *
+ * Retrieves the number of recurring events, across all calendars, that
+ * generate too many instances in the current range and were only
+ * partially expanded.
+ *
+ * Returns: the number of truncated recurring events
+ */
+guint
+gcal_timeline_get_n_truncated_series (GcalTimeline *self)
+{
+  GcalCalendarMonitor *monitor;
+  GHashTableIter iter;
+  guint n_truncated;
+
+  g_return_val_if_fail (GCAL_IS_TIMELINE (self), 0);
+
+  n_truncated = 0;
+
+  g_hash_table_iter_init (&iter, self->calendars);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer*) &monitor))
+    n_truncated += gcal_calendar_monitor_get_n_truncated (monitor);
+
+  return n_truncated;
+}
+
+/**
+ * gcal_timeline_ref_snapshot:
+ * @self: a #GcalTimeline
+ *
+ * Retrieves the latest immutable snapshot of the events of @self. This
+ * can be called from any thread, and the returned snapshot and the events
+ * in it can be read without further locking while the timeline keeps
+ * changing. The events must not be modified.
+ *
+ * Snapshots are versioned, and a new version is published after each
+ * batch of changes to the events of @self. Versions share the parts of
+ * the tree that didn't change, so they are cheap to keep around.
+ *
+ * Returns: (transfer full): a #GcalTimelineSnapshot
+ */
+GcalTimelineSnapshot*
+gcal_timeline_ref_snapshot (GcalTimeline *self)
+{
+  GcalTimelineSnapshot *snapshot;
+
+  g_return_val_if_fail (GCAL_IS_TIMELINE (self), NULL);
+
+  /* Keeps the main thread from releasing the published version under us */
+  g_atomic_int_inc (&self->snapshot.n_readers);
+  snapshot = gcal_timeline_snapshot_ref (g_atomic_pointer_get (&self->snapshot.published));
+  g_atomic_int_add (&self->snapshot.n_readers, -1);
+
+  return snapshot;
+}
+
+/*
+ * Private API
+ */
+
+void
+gcal_timeline_get_stats (GcalTimeline      *self,
+                         GcalTimelineStats *out_stats)
+{
+  g_return_if_fail (GCAL_IS_TIMELINE (self));
+  g_return_if_fail (out_stats != NULL);
+
+  *out_stats = self->stats;
+  out_stats->range_tree_visits = gcal_range_tree_get_n_visits_for_testing (self->events) +
+                                 gcal_range_tree_get_n_visits_for_testing (self->subscriber_ranges);
+}
+
+void
+gcal_timeline_reset_stats (GcalTimeline *self)
+{
+  g_return_if_fail (GCAL_IS_TIMELINE (self));
+
+  self->stats = (GcalTimelineStats) { 0, };
+
+  gcal_range_tree_count_visits_for_testing (self->events);
+  gcal_range_tree_count_visits_for_testing (self->subscriber_ranges);
+}
+
+/*
+ * The functions below feed events to @self as if they came from a
+ * calendar monitor, so that tests don't need a running E-D-S.
+ */
+
+void
+gcal_timeline_add_events_for_testing (GcalTimeline *self,
+                                      GPtrArray    *events)
+{
+  g_return_if_fail (GCAL_IS_TIMELINE (self));
+
+  calendar_monitor_add_events_cb (NULL, events, self);
+}
+
+void
+gcal_timeline_update_events_for_testing (GcalTimeline *self,
+                                         GPtrArray    *old_events,
+                                         GPtrArray    *events)
+{
+  g_return_if_fail (GCAL_IS_TIMELINE (self));
+
+  calendar_monitor_update_events_cb (NULL, old_events, events, self);
+}
+
+void
+gcal_timeline_remove_events_for_testing (GcalTimeline *self,
+                                         GPtrArray    *events)
+{
+  g_return_if_fail (GCAL_IS_TIMELINE (self));
+
+  calendar_monitor_remove_events_cb (NULL, events, self);
+}
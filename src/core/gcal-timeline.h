@@ -20,6 +20,8 @@
 
 #pragma once
 
+#include "gcal-range.h"
+#include "gcal-timeline-snapshot.h"
 #include "gcal-types.h"
 
 #include <glib-object.h>
@@ -47,6 +49,10 @@ GPtrArray*           gcal_timeline_get_events_at_range           (GcalTimeline
                                                                   GDateTime          *range_start,
                                                                   GDateTime          *range_end);
 
+GPtrArray*           gcal_timeline_get_overlapping_events        (GcalTimeline       *self,
+                                                                  GcalRange          *range,
+                                                                  GList              *calendars);
+
 const gchar*         gcal_timeline_get_filter                    (GcalTimeline       *self);
 
 void                 gcal_timeline_set_filter                    (GcalTimeline       *self,
@@ -54,4 +60,8 @@ void                 gcal_timeline_set_filter                    (GcalTimeline
 
 gboolean             gcal_timeline_is_complete                   (GcalTimeline       *self);
 
+guint                gcal_timeline_get_n_truncated_series        (GcalTimeline       *self);
+
+GcalTimelineSnapshot* gcal_timeline_ref_snapshot                 (GcalTimeline       *self);
+
 G_END_DECLS
@@ -33,6 +33,14 @@ typedef struct _GcalTimer
   GSource            parent;
   gint64             last_event;
   gint64             default_duration;
+  gboolean           running;
+
+  /*
+   * Waits for the next event. Seconds timeouts are coalesced by GLib with
+   * every other one of the session, so the timer doesn't wake the system
+   * up on its own.
+   */
+  GSource           *timeout_source;
 } GcalTimer;
 
 
@@ -62,6 +70,8 @@ static gboolean      timer_source_dispatch                       (GcalTimer
                                                                   GSourceFunc         callback,
                                                                   CbWrapperData      *user_data);
 
+static void          clear_timeout                               (GcalTimer          *self);
+
 static void          schedule_next                               (GcalTimer          *self);
 
 static void          timer_source_finalize                       (GcalTimer          *self);
@@ -100,15 +110,40 @@ timer_source_dispatch (GcalTimer       *self,
 
   g_return_val_if_fail (self != NULL, G_SOURCE_REMOVE);
 
+  g_source_set_ready_time ((GSource*) self, -1);
+
   if (user_callback != NULL)
     result = user_callback (user_data);
 
   self->last_event = g_source_get_time ((GSource*) self);
-  schedule_next (self);
+
+  if (self->running)
+    schedule_next (self);
 
   return result;
 }
 
+static gboolean
+timeout_cb (gpointer user_data)
+{
+  GcalTimer *self = user_data;
+
+  g_clear_pointer (&self->timeout_source, g_source_unref);
+  g_source_set_ready_time ((GSource*) self, 0);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+clear_timeout (GcalTimer *self)
+{
+  if (!self->timeout_source)
+    return;
+
+  g_source_destroy (self->timeout_source);
+  g_clear_pointer (&self->timeout_source, g_source_unref);
+}
+
 static void
 schedule_next (GcalTimer *self)
 {
@@ -118,18 +153,29 @@ schedule_next (GcalTimer *self)
   g_return_if_fail (self != NULL);
   g_return_if_fail (self->last_event >= 0);
 
+  clear_timeout (self);
+
   now = g_source_get_time ((GSource*) self);
   next = self->last_event + self->default_duration*G_GUINT64_CONSTANT(1000000);
 
-  if (next > now)
-    g_source_set_ready_time ((GSource*) self, next);
-  else
-    g_source_set_ready_time ((GSource*) self, 0);
+  if (next <= now)
+    {
+      g_source_set_ready_time ((GSource*) self, 0);
+      return;
+    }
+
+  g_source_set_ready_time ((GSource*) self, -1);
+
+  self->timeout_source = g_timeout_source_new_seconds ((next - now + G_USEC_PER_SEC - 1) / G_USEC_PER_SEC);
+  g_source_set_name (self->timeout_source, "Timer Timeout Source");
+  g_source_set_callback (self->timeout_source, timeout_cb, self, NULL);
+  g_source_attach (self->timeout_source, g_source_get_context ((GSource*) self));
 }
 
 static void
 timer_source_finalize (GcalTimer *self)
 {
+  clear_timeout (self);
 }
 
 
@@ -184,6 +230,7 @@ gcal_timer_start (GcalTimer *self)
   g_return_if_fail (self != NULL);
   g_return_if_fail (!gcal_timer_is_running (self));
 
+  self->running = TRUE;
   self->last_event = g_source_get_time ((GSource*) self);
   schedule_next (self);
 }
@@ -216,6 +263,8 @@ gcal_timer_stop (GcalTimer *self)
   g_return_if_fail (self != NULL);
   g_return_if_fail (gcal_timer_is_running (self));
 
+  self->running = FALSE;
+  clear_timeout (self);
   g_source_set_ready_time ((GSource*) self, -1);
 }
 
@@ -230,7 +279,7 @@ gcal_timer_is_running (GcalTimer *self)
 {
   g_return_val_if_fail (self != NULL, FALSE);
 
-  return g_source_get_ready_time ((GSource*) self) >= 0;
+  return self->running;
 }
 
 /**
@@ -255,7 +304,10 @@ gcal_timer_set_default_duration (GcalTimer *self,
   if (!gcal_timer_is_running (self))
     /* nothing to do (not running) */;
   else if (self->last_event + duration < now)
-    g_source_set_ready_time ((GSource*) self, 0);
+    {
+      clear_timeout (self);
+      g_source_set_ready_time ((GSource*) self, 0);
+    }
   else
     schedule_next (self);
 }
@@ -317,6 +369,7 @@ void
 gcal_timer_free (GcalTimer *self)
 {
   g_return_if_fail (self != NULL);
+  clear_timeout (self);
   g_source_destroy ((GSource *) self);
   g_source_unref ((GSource *) self);
 }
@@ -448,14 +448,18 @@ update_event_indicators (GcalDateChooser *self)
       {
           GDateTime *date;
           g_autoptr (GcalRange) range = NULL;
+          GcalRangeTreeIter iter;
 
           date = gcal_date_chooser_day_get_date (GCAL_DATE_CHOOSER_DAY (self->days[row][col]));
           range = gcal_range_new_take (g_date_time_ref (date),
                                        g_date_time_add_days (date, 1),
                                        GCAL_RANGE_DEFAULT);
 
+          /* Only the presence of events matters, no need to count them all */
+          gcal_range_tree_iter_init_at_range (&iter, self->events, range);
+
           gcal_date_chooser_day_set_dot_visible (GCAL_DATE_CHOOSER_DAY (self->days[row][col]),
-                                                 gcal_range_tree_count_entries_at_range (self->events, range) > 0);
+                                                 gcal_range_tree_iter_next (&iter, NULL, NULL));
       }
     }
 }
@@ -25,18 +25,30 @@
 #include "gcal-debug.h"
 #include "gcal-event.h"
 #include "gcal-event-editor-section.h"
+#include "gcal-manager.h"
 #include "gcal-recurrence.h"
 #include "gcal-schedule-section.h"
 #include "gcal-time-selector.h"
+#include "gcal-timeline.h"
 #include "gcal-utils.h"
 
 #include <glib/gi18n.h>
 
+#define MAX_CONFLICT_SUMMARIES 3
+
+typedef struct
+{
+  GcalTimeline       *timeline;
+  GcalRange          *range;
+  gchar              *series_uid;
+} FindConflictsData;
+
 struct _GcalScheduleSection
 {
   GtkBox              parent;
 
   GtkSwitch          *all_day_switch;
+  AdwActionRow       *conflicts_row;
   GtkWidget          *end_date_selector;
   GtkWidget          *end_time_selector;
   GtkLabel           *event_end_label;
@@ -51,6 +63,8 @@ struct _GcalScheduleSection
   GcalContext        *context;
   GcalEvent          *event;
 
+  GCancellable       *conflicts_cancellable;
+
   GcalEventEditorFlags flags;
 };
 
@@ -67,10 +81,112 @@ enum
 };
 
 
+static void          on_conflicts_found_cb                       (GObject            *source_object,
+                                                                  GAsyncResult       *result,
+                                                                  gpointer            user_data);
+
+
 /*
  * Auxiliary methods
  */
 
+static void
+find_conflicts_data_free (FindConflictsData *data)
+{
+  g_clear_object (&data->timeline);
+  g_clear_pointer (&data->range, gcal_range_unref);
+  g_clear_pointer (&data->series_uid, g_free);
+  g_free (data);
+}
+
+static gboolean
+is_same_series (GcalEvent   *event,
+                const gchar *series_uid)
+{
+  const gchar *uid = gcal_event_get_uid (event);
+  gsize length = strlen (series_uid);
+
+  /* Instances of a recurring event append their recurrence id to the uid */
+  return g_str_has_prefix (uid, series_uid) && (uid[length] == '\0' || uid[length] == ':');
+}
+
+static void
+find_conflicts_in_thread (GTask        *task,
+                          gpointer      source_object,
+                          gpointer      task_data,
+                          GCancellable *cancellable)
+{
+  g_autoptr (GcalTimelineSnapshot) snapshot = NULL;
+  g_autoptr (GPtrArray) conflicts = NULL;
+  g_autoptr (GPtrArray) events = NULL;
+  FindConflictsData *data;
+  guint i;
+
+  data = task_data;
+
+  /* The snapshot is immutable, so it can be queried here while the timeline changes */
+  snapshot = gcal_timeline_ref_snapshot (data->timeline);
+  events = gcal_timeline_snapshot_get_events_at_range (snapshot, data->range);
+  conflicts = g_ptr_array_new_with_free_func (g_object_unref);
+
+  for (i = 0; i < events->len; i++)
+    {
+      GcalEvent *event = g_ptr_array_index (events, i);
+
+      if (g_task_return_error_if_cancelled (task))
+        return;
+
+      if (gcal_event_get_all_day (event) || is_same_series (event, data->series_uid))
+        continue;
+
+      g_ptr_array_add (conflicts, g_object_ref (event));
+    }
+
+  g_task_return_pointer (task, g_steal_pointer (&conflicts), (GDestroyNotify) g_ptr_array_unref);
+}
+
+static void
+update_conflicts (GcalScheduleSection *self,
+                  GDateTime           *start,
+                  GDateTime           *end)
+{
+  g_autoptr (GTask) task = NULL;
+  FindConflictsData *data;
+  ECalComponentId *id;
+  GcalCalendar *calendar;
+  GcalManager *manager;
+
+  g_cancellable_cancel (self->conflicts_cancellable);
+  g_clear_object (&self->conflicts_cancellable);
+
+  /* All day events rarely mean being busy, so only timed events are checked */
+  if (!self->event || gtk_switch_get_active (self->all_day_switch) || g_date_time_compare (start, end) >= 0)
+    {
+      gtk_widget_set_visible (GTK_WIDGET (self->conflicts_row), FALSE);
+      return;
+    }
+
+  manager = gcal_context_get_manager (self->context);
+  calendar = gcal_event_get_calendar (self->event);
+  id = e_cal_component_get_id (gcal_event_get_component (self->event));
+
+  data = g_new0 (FindConflictsData, 1);
+  data->timeline = g_object_ref (gcal_manager_get_timeline (manager));
+  data->range = gcal_range_new (start, end, GCAL_RANGE_DEFAULT);
+  data->series_uid = g_strdup_printf ("%s:%s",
+                                      calendar ? gcal_calendar_get_id (calendar) : "",
+                                      e_cal_component_id_get_uid (id));
+
+  e_cal_component_id_free (id);
+
+  self->conflicts_cancellable = g_cancellable_new ();
+
+  task = g_task_new (self, self->conflicts_cancellable, on_conflicts_found_cb, NULL);
+  g_task_set_task_data (task, data, (GDestroyNotify) find_conflicts_data_free);
+  g_task_set_source_tag (task, update_conflicts);
+  g_task_run_in_thread (task, find_conflicts_in_thread);
+}
+
 static void
 find_best_timezones_for_event (GcalScheduleSection  *self,
                                GTimeZone             **out_tz_start,
@@ -312,6 +428,8 @@ update_date_labels (GcalScheduleSection *self)
 
   gtk_label_set_label (self->event_start_label, start_label);
   gtk_label_set_label (self->event_end_label, end_label);
+
+  update_conflicts (self, start, end);
 }
 
 static void
@@ -383,6 +501,55 @@ out:
  * Callbacks
  */
 
+static void
+on_conflicts_found_cb (GObject      *source_object,
+                       GAsyncResult *result,
+                       gpointer      user_data)
+{
+  g_autoptr (GPtrArray) conflicts = NULL;
+  g_autoptr (GString) summaries = NULL;
+  g_autofree gchar *title = NULL;
+  g_autoptr (GError) error = NULL;
+  GcalScheduleSection *self;
+  guint i;
+
+  conflicts = g_task_propagate_pointer (G_TASK (result), &error);
+
+  if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    return;
+
+  self = GCAL_SCHEDULE_SECTION (source_object);
+
+  if (!conflicts || conflicts->len == 0)
+    {
+      gtk_widget_set_visible (GTK_WIDGET (self->conflicts_row), FALSE);
+      return;
+    }
+
+  summaries = g_string_new ("");
+
+  for (i = 0; i < MIN (conflicts->len, MAX_CONFLICT_SUMMARIES); i++)
+    {
+      if (i > 0)
+        g_string_append (summaries, ", ");
+
+      g_string_append (summaries, gcal_event_get_summary (g_ptr_array_index (conflicts, i)));
+    }
+
+  if (conflicts->len > MAX_CONFLICT_SUMMARIES)
+    g_string_append (summaries, ", …");
+
+  title = g_strdup_printf (g_dngettext (GETTEXT_PACKAGE,
+                                        "Overlaps with %u event",
+                                        "Overlaps with %u events",
+                                        conflicts->len),
+                           conflicts->len);
+
+  adw_preferences_row_set_title (ADW_PREFERENCES_ROW (self->conflicts_row), title);
+  adw_action_row_set_subtitle (self->conflicts_row, summaries->str);
+  gtk_widget_set_visible (GTK_WIDGET (self->conflicts_row), TRUE);
+}
+
 static void
 on_repeat_duration_changed_cb (GtkWidget           *widget,
                                GParamSpec          *pspec,
@@ -717,6 +884,8 @@ gcal_schedule_section_finalize (GObject *object)
 {
   GcalScheduleSection *self = (GcalScheduleSection *)object;
 
+  g_cancellable_cancel (self->conflicts_cancellable);
+  g_clear_object (&self->conflicts_cancellable);
   g_clear_object (&self->context);
   g_clear_object (&self->event);
 
@@ -786,6 +955,7 @@ gcal_schedule_section_class_init (GcalScheduleSectionClass *klass)
   gtk_widget_class_set_template_from_resource (widget_class, "/org/gnome/calendar/ui/event-editor/gcal-schedule-section.ui");
 
   gtk_widget_class_bind_template_child (widget_class, GcalScheduleSection, all_day_switch);
+  gtk_widget_class_bind_template_child (widget_class, GcalScheduleSection, conflicts_row);
   gtk_widget_class_bind_template_child (widget_class, GcalScheduleSection, start_time_selector);
   gtk_widget_class_bind_template_child (widget_class, GcalScheduleSection, start_date_selector);
   gtk_widget_class_bind_template_child (widget_class, GcalScheduleSection, end_time_selector);
@@ -0,0 +1,640 @@
+/* gcal-export-dialog.c
+ *
+ * Copyright 2024 Georges Basile Stavracas Neto <georges.stavracas@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#define G_LOG_DOMAIN "GcalExportDialog"
+
+#include "gcal-export-dialog.h"
+
+#include "config.h"
+#include "gcal-debug.h"
+#include "gcal-exporter.h"
+
+#include <adwaita.h>
+#include <glib/gi18n.h>
+
+/* Positions of the items in the combo rows, see gcal-export-dialog.ui */
+typedef enum
+{
+  EXPORT_RANGE_ALL,
+  EXPORT_RANGE_MONTH,
+  EXPORT_RANGE_YEAR,
+} ExportRange;
+
+typedef enum
+{
+  EXPORT_FORMAT_FILE,
+  EXPORT_FORMAT_DIRECTORY,
+} ExportFormat;
+
+struct _GcalExportDialog
+{
+  AdwDialog           parent;
+
+  AdwPreferencesGroup *calendars_group;
+  GtkButton          *close_button;
+  GtkWidget          *export_button;
+  AdwComboRow        *format_row;
+  AdwStatusPage      *progress_page;
+  AdwComboRow        *range_row;
+  GtkStack           *stack;
+  AdwToastOverlay    *toast_overlay;
+
+  /* Index-aligned with the switch rows in calendars_group */
+  GPtrArray          *calendars;
+  GPtrArray          *calendar_rows;
+
+  GCancellable       *cancellable;
+  GOutputStream      *stream;
+  guint               n_exported;
+  GcalContext        *context;
+  GDateTime          *date;
+};
+
+G_DEFINE_TYPE (GcalExportDialog, gcal_export_dialog, ADW_TYPE_DIALOG)
+
+enum
+{
+  PROP_0,
+  PROP_CONTEXT,
+  PROP_DATE,
+  N_PROPS
+};
+
+static GParamSpec *properties [N_PROPS];
+
+
+/*
+ * Auxiliary methods
+ */
+
+static void
+update_export_button (GcalExportDialog *self)
+{
+  gboolean has_selection = FALSE;
+  guint i;
+
+  for (i = 0; i < self->calendar_rows->len; i++)
+    {
+      if (adw_switch_row_get_active (g_ptr_array_index (self->calendar_rows, i)))
+        {
+          has_selection = TRUE;
+          break;
+        }
+    }
+
+  gtk_widget_set_sensitive (self->export_button, has_selection);
+}
+
+static void
+setup_calendars (GcalExportDialog *self)
+{
+  GListModel *calendars;
+  GcalManager *manager;
+  guint i;
+
+  g_assert (self->context != NULL);
+
+  manager = gcal_context_get_manager (self->context);
+  calendars = gcal_manager_get_calendars_model (manager);
+
+  for (i = 0; i < g_list_model_get_n_items (calendars); i++)
+    {
+      g_autoptr (GcalCalendar) calendar = g_list_model_get_item (calendars, i);
+      GtkWidget *row;
+
+      row = adw_switch_row_new ();
+      adw_preferences_row_set_title (ADW_PREFERENCES_ROW (row), gcal_calendar_get_name (calendar));
+      adw_preferences_row_set_use_markup (ADW_PREFERENCES_ROW (row), FALSE);
+      adw_switch_row_set_active (ADW_SWITCH_ROW (row), gcal_calendar_get_visible (calendar));
+      g_signal_connect_object (row, "notify::active", G_CALLBACK (update_export_button), self, G_CONNECT_SWAPPED);
+
+      adw_preferences_group_add (self->calendars_group, row);
+
+      g_ptr_array_add (self->calendars, g_steal_pointer (&calendar));
+      g_ptr_array_add (self->calendar_rows, row);
+    }
+
+  update_export_button (self);
+}
+
+static GPtrArray*
+get_selected_calendars (GcalExportDialog *self)
+{
+  g_autoptr (GPtrArray) calendars = NULL;
+  guint i;
+
+  calendars = g_ptr_array_new_with_free_func (g_object_unref);
+
+  for (i = 0; i < self->calendar_rows->len; i++)
+    {
+      if (adw_switch_row_get_active (g_ptr_array_index (self->calendar_rows, i)))
+        g_ptr_array_add (calendars, g_object_ref (g_ptr_array_index (self->calendars, i)));
+    }
+
+  return g_steal_pointer (&calendars);
+}
+
+static GcalRange*
+get_selected_range (GcalExportDialog *self)
+{
+  g_autoptr (GDateTime) range_start = NULL;
+  g_autoptr (GDateTime) range_end = NULL;
+
+  switch ((ExportRange) adw_combo_row_get_selected (self->range_row))
+    {
+    case EXPORT_RANGE_MONTH:
+      range_start = g_date_time_new (g_date_time_get_timezone (self->date),
+                                     g_date_time_get_year (self->date),
+                                     g_date_time_get_month (self->date),
+                                     1, 0, 0, 0);
+      range_end = g_date_time_add_months (range_start, 1);
+      break;
+
+    case EXPORT_RANGE_YEAR:
+      range_start = g_date_time_new (g_date_time_get_timezone (self->date),
+                                     g_date_time_get_year (self->date),
+                                     1, 1, 0, 0, 0);
+      range_end = g_date_time_add_years (range_start, 1);
+      break;
+
+    case EXPORT_RANGE_ALL:
+    default:
+      return NULL;
+    }
+
+  return gcal_range_new (range_start, range_end, GCAL_RANGE_DEFAULT);
+}
+
+static void
+set_exporting (GcalExportDialog *self,
+               gboolean          exporting)
+{
+  gtk_stack_set_visible_child_name (self->stack, exporting ? "progress" : "options");
+  gtk_widget_set_sensitive (self->export_button, !exporting);
+  adw_status_page_set_description (self->progress_page, NULL);
+
+  if (!exporting)
+    update_export_button (self);
+}
+
+static void
+finish_export (GcalExportDialog *self,
+               guint             n_exported,
+               const GError     *error)
+{
+  g_autofree gchar *description = NULL;
+
+  GCAL_ENTRY;
+
+  g_clear_object (&self->cancellable);
+  g_clear_object (&self->stream);
+
+  if (error)
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        {
+          g_warning ("Error exporting calendars: %s", error->message);
+          adw_toast_overlay_add_toast (self->toast_overlay, adw_toast_new (_("Could not export calendars")));
+          set_exporting (self, FALSE);
+        }
+
+      GCAL_RETURN ();
+    }
+
+  description = g_strdup_printf (g_dngettext (GETTEXT_PACKAGE,
+                                              "%u event exported",
+                                              "%u events exported",
+                                              n_exported),
+                                 n_exported);
+
+  adw_status_page_set_paintable (self->progress_page, NULL);
+  adw_status_page_set_icon_name (self->progress_page, "object-select-symbolic");
+  adw_status_page_set_title (self->progress_page, _("Export Complete"));
+  adw_status_page_set_description (self->progress_page, description);
+
+  gtk_widget_set_visible (self->export_button, FALSE);
+  gtk_button_set_label (self->close_button, _("_Close"));
+
+  GCAL_EXIT;
+}
+
+
+/*
+ * Callbacks
+ */
+
+static void
+on_export_progress_cb (guint    n_exported,
+                       gpointer user_data)
+{
+  GcalExportDialog *self = GCAL_EXPORT_DIALOG (user_data);
+  g_autofree gchar *description = NULL;
+
+  description = g_strdup_printf (g_dngettext (GETTEXT_PACKAGE,
+                                              "%u event exported",
+                                              "%u events exported",
+                                              n_exported),
+                                 n_exported);
+
+  adw_status_page_set_description (self->progress_page, description);
+}
+
+static void
+on_stream_closed_cb (GObject      *source_object,
+                     GAsyncResult *result,
+                     gpointer      user_data)
+{
+  g_autoptr (GcalExportDialog) self = GCAL_EXPORT_DIALOG (user_data);
+  g_autoptr (GError) error = NULL;
+
+  g_output_stream_close_finish (G_OUTPUT_STREAM (source_object), result, &error);
+
+  finish_export (self, self->n_exported, error);
+}
+
+static void
+on_exported_to_stream_cb (GObject      *source_object,
+                          GAsyncResult *result,
+                          gpointer      user_data)
+{
+  g_autoptr (GcalExportDialog) self = GCAL_EXPORT_DIALOG (user_data);
+  g_autoptr (GError) error = NULL;
+
+  GCAL_ENTRY;
+
+  if (!gcal_exporter_export_to_stream_finish (result, &self->n_exported, &error))
+    {
+      g_autoptr (GCancellable) cancellable = g_cancellable_new ();
+
+      /* Closing a replaced file with a cancelled cancellable keeps the original file */
+      g_cancellable_cancel (cancellable);
+      g_output_stream_close (self->stream, cancellable, NULL);
+
+      finish_export (self, 0, error);
+      GCAL_RETURN ();
+    }
+
+  /* The file only replaces the destination once closed */
+  g_output_stream_close_async (self->stream,
+                               G_PRIORITY_DEFAULT,
+                               self->cancellable,
+                               on_stream_closed_cb,
+                               g_object_ref (self));
+
+  GCAL_EXIT;
+}
+
+static void
+on_file_replaced_cb (GObject      *source_object,
+                     GAsyncResult *result,
+                     gpointer      user_data)
+{
+  g_autoptr (GcalExportDialog) self = GCAL_EXPORT_DIALOG (user_data);
+  g_autoptr (GFileOutputStream) stream = NULL;
+  g_autoptr (GPtrArray) calendars = NULL;
+  g_autoptr (GcalRange) range = NULL;
+  g_autoptr (GError) error = NULL;
+
+  GCAL_ENTRY;
+
+  stream = g_file_replace_finish (G_FILE (source_object), result, &error);
+
+  if (!stream)
+    {
+      finish_export (self, 0, error);
+      GCAL_RETURN ();
+    }
+
+  self->stream = G_OUTPUT_STREAM (g_steal_pointer (&stream));
+
+  calendars = get_selected_calendars (self);
+  range = get_selected_range (self);
+
+  gcal_exporter_export_to_stream (calendars,
+                                  range,
+                                  self->stream,
+                                  on_export_progress_cb,
+                                  self,
+                                  self->cancellable,
+                                  on_exported_to_stream_cb,
+                                  g_object_ref (self));
+
+  GCAL_EXIT;
+}
+
+static void
+on_exported_to_directory_cb (GObject      *source_object,
+                             GAsyncResult *result,
+                             gpointer      user_data)
+{
+  g_autoptr (GcalExportDialog) self = GCAL_EXPORT_DIALOG (user_data);
+  g_autoptr (GError) error = NULL;
+  guint n_exported;
+
+  gcal_exporter_export_to_directory_finish (result, &n_exported, &error);
+
+  finish_export (self, n_exported, error);
+}
+
+static void
+on_file_dialog_finished_cb (GObject      *source_object,
+                            GAsyncResult *result,
+                            gpointer      user_data)
+{
+  g_autoptr (GcalExportDialog) self = GCAL_EXPORT_DIALOG (user_data);
+  g_autoptr (GPtrArray) calendars = NULL;
+  g_autoptr (GcalRange) range = NULL;
+  g_autoptr (GError) error = NULL;
+  g_autoptr (GFile) file = NULL;
+  ExportFormat format;
+
+  GCAL_ENTRY;
+
+  format = adw_combo_row_get_selected (self->format_row);
+
+  if (format == EXPORT_FORMAT_DIRECTORY)
+    file = gtk_file_dialog_select_folder_finish (GTK_FILE_DIALOG (source_object), result, &error);
+  else
+    file = gtk_file_dialog_save_finish (GTK_FILE_DIALOG (source_object), result, &error);
+
+  if (!file)
+    {
+      if (!g_error_matches (error, GTK_DIALOG_ERROR, GTK_DIALOG_ERROR_DISMISSED))
+        g_warning ("Error selecting export destination: %s", error->message);
+      GCAL_RETURN ();
+    }
+
+  g_assert (self->cancellable == NULL);
+  self->cancellable = g_cancellable_new ();
+
+  set_exporting (self, TRUE);
+
+  if (format == EXPORT_FORMAT_DIRECTORY)
+    {
+      calendars = get_selected_calendars (self);
+      range = get_selected_range (self);
+
+      gcal_exporter_export_to_directory (calendars,
+                                         range,
+                                         file,
+                                         on_export_progress_cb,
+                                         self,
+                                         self->cancellable,
+                                         on_exported_to_directory_cb,
+                                         g_object_ref (self));
+    }
+  else
+    {
+      g_file_replace_async (file,
+                            NULL,
+                            FALSE,
+                            G_FILE_CREATE_REPLACE_DESTINATION,
+                            G_PRIORITY_DEFAULT,
+                            self->cancellable,
+                            on_file_replaced_cb,
+                            g_object_ref (self));
+    }
+
+  GCAL_EXIT;
+}
+
+static void
+on_export_button_clicked_cb (GtkButton        *button,
+                             GcalExportDialog *self)
+{
+  g_autoptr (GtkFileDialog) file_dialog = NULL;
+  GtkRoot *root;
+
+  GCAL_ENTRY;
+
+  root = gtk_widget_get_root (GTK_WIDGET (self));
+  file_dialog = gtk_file_dialog_new ();
+
+  if (adw_combo_row_get_selected (self->format_row) == EXPORT_FORMAT_DIRECTORY)
+    {
+      gtk_file_dialog_set_title (file_dialog, _("Select a Folder"));
+      gtk_file_dialog_select_folder (file_dialog,
+                                     GTK_IS_WINDOW (root) ? GTK_WINDOW (root) : NULL,
+                                     NULL,
+                                     on_file_dialog_finished_cb,
+                                     g_object_ref (self));
+    }
+  else
+    {
+      g_autoptr (GtkFileFilter) filter = NULL;
+      g_autoptr (GListStore) filters = NULL;
+
+      filter = gtk_file_filter_new ();
+      gtk_file_filter_set_name (filter, _("Calendar Files"));
+      gtk_file_filter_add_mime_type (filter, "text/calendar");
+
+      filters = g_list_store_new (GTK_TYPE_FILE_FILTER);
+      g_list_store_append (filters, filter);
+
+      gtk_file_dialog_set_title (file_dialog, _("Export Calendars"));
+      /* Translators: this is the default name of exported calendar files */
+      gtk_file_dialog_set_initial_name (file_dialog, _("Calendars.ics"));
+      gtk_file_dialog_set_filters (file_dialog, G_LIST_MODEL (filters));
+      gtk_file_dialog_save (file_dialog,
+                            GTK_IS_WINDOW (root) ? GTK_WINDOW (root) : NULL,
+                            NULL,
+                            on_file_dialog_finished_cb,
+                            g_object_ref (self));
+    }
+
+  GCAL_EXIT;
+}
+
+
+/*
+ * AdwDialog overrides
+ */
+
+static void
+gcal_export_dialog_closed (AdwDialog *dialog)
+{
+  GcalExportDialog *self = (GcalExportDialog *)dialog;
+
+  /* Running exports hold a reference to the dialog until they finish */
+  g_cancellable_cancel (self->cancellable);
+}
+
+
+/*
+ * GObject overrides
+ */
+
+static void
+gcal_export_dialog_constructed (GObject *object)
+{
+  GcalExportDialog *self = (GcalExportDialog *)object;
+
+  G_OBJECT_CLASS (gcal_export_dialog_parent_class)->constructed (object);
+
+  if (!self->date)
+    self->date = g_date_time_new_now_local ();
+
+  setup_calendars (self);
+}
+
+static void
+gcal_export_dialog_finalize (GObject *object)
+{
+  GcalExportDialog *self = (GcalExportDialog *)object;
+
+  g_cancellable_cancel (self->cancellable);
+  g_clear_object (&self->cancellable);
+  g_clear_object (&self->stream);
+  g_clear_object (&self->context);
+  g_clear_pointer (&self->date, g_date_time_unref);
+  g_clear_pointer (&self->calendars, g_ptr_array_unref);
+  g_clear_pointer (&self->calendar_rows, g_ptr_array_unref);
+
+  G_OBJECT_CLASS (gcal_export_dialog_parent_class)->finalize (object);
+}
+
+static void
+gcal_export_dialog_get_property (GObject    *object,
+                                 guint       prop_id,
+                                 GValue     *value,
+                                 GParamSpec *pspec)
+{
+  GcalExportDialog *self = GCAL_EXPORT_DIALOG (object);
+
+  switch (prop_id)
+    {
+    case PROP_CONTEXT:
+      g_value_set_object (value, self->context);
+      break;
+
+    case PROP_DATE:
+      g_value_set_boxed (value, self->date);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+gcal_export_dialog_set_property (GObject      *object,
+                                 guint         prop_id,
+                                 const GValue *value,
+                                 GParamSpec   *pspec)
+{
+  GcalExportDialog *self = GCAL_EXPORT_DIALOG (object);
+
+  switch (prop_id)
+    {
+    case PROP_CONTEXT:
+      g_assert (self->context == NULL);
+      self->context = g_value_dup_object (value);
+      break;
+
+    case PROP_DATE:
+      g_assert (self->date == NULL);
+      self->date = g_value_dup_boxed (value);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+gcal_export_dialog_class_init (GcalExportDialogClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+  GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (klass);
+  AdwDialogClass *dialog_class = ADW_DIALOG_CLASS (klass);
+
+  object_class->constructed = gcal_export_dialog_constructed;
+  object_class->finalize = gcal_export_dialog_finalize;
+  object_class->get_property = gcal_export_dialog_get_property;
+  object_class->set_property = gcal_export_dialog_set_property;
+
+  dialog_class->closed = gcal_export_dialog_closed;
+
+  /**
+   * GcalExportDialog::context:
+   *
+   * The context of the export dialog.
+   */
+  properties[PROP_CONTEXT] = g_param_spec_object ("context",
+                                                  "Context",
+                                                  "Context",
+                                                  GCAL_TYPE_CONTEXT,
+                                                  G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
+
+  /**
+   * GcalExportDialog::date:
+   *
+   * The date the displayed month and year ranges are relative to.
+   */
+  properties[PROP_DATE] = g_param_spec_boxed ("date",
+                                              "Date",
+                                              "Date",
+                                              G_TYPE_DATE_TIME,
+                                              G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
+
+  g_object_class_install_properties (object_class, N_PROPS, properties);
+
+  gtk_widget_class_set_template_from_resource (widget_class, "/org/gnome/calendar/ui/gui/exporter/gcal-export-dialog.ui");
+
+  gtk_widget_class_bind_template_child (widget_class, GcalExportDialog, calendars_group);
+  gtk_widget_class_bind_template_child (widget_class, GcalExportDialog, close_button);
+  gtk_widget_class_bind_template_child (widget_class, GcalExportDialog, export_button);
+  gtk_widget_class_bind_template_child (widget_class, GcalExportDialog, format_row);
+  gtk_widget_class_bind_template_child (widget_class, GcalExportDialog, progress_page);
+  gtk_widget_class_bind_template_child (widget_class, GcalExportDialog, range_row);
+  gtk_widget_class_bind_template_child (widget_class, GcalExportDialog, stack);
+  gtk_widget_class_bind_template_child (widget_class, GcalExportDialog, toast_overlay);
+
+  gtk_widget_class_bind_template_callback (widget_class, on_export_button_clicked_cb);
+}
+
+static void
+gcal_export_dialog_init (GcalExportDialog *self)
+{
+  self->calendars = g_ptr_array_new_with_free_func (g_object_unref);
+  self->calendar_rows = g_ptr_array_new ();
+
+  gtk_widget_init_template (GTK_WIDGET (self));
+}
+
+/**
+ * gcal_export_dialog_new:
+ * @context: a #GcalContext
+ * @date: (nullable): the date the displayed month and year are relative to
+ *
+ * Creates a dialog that lets the user pick calendars and a range of
+ * events, and export them to a single file or to one file per calendar.
+ *
+ * Returns: (transfer floating): a #GcalExportDialog
+ */
+GtkWidget*
+gcal_export_dialog_new (GcalContext *context,
+                        GDateTime   *date)
+{
+  return g_object_new (GCAL_TYPE_EXPORT_DIALOG,
+                       "context", context,
+                       "date", date,
+                       NULL);
+}
@@ -0,0 +1,35 @@
+/* gcal-export-dialog.h
+ *
+ * Copyright 2024 Georges Basile Stavracas Neto <georges.stavracas@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <adwaita.h>
+
+#include "gcal-context.h"
+
+G_BEGIN_DECLS
+
+#define GCAL_TYPE_EXPORT_DIALOG (gcal_export_dialog_get_type())
+G_DECLARE_FINAL_TYPE (GcalExportDialog, gcal_export_dialog, GCAL, EXPORT_DIALOG, AdwDialog)
+
+GtkWidget*           gcal_export_dialog_new                      (GcalContext        *context,
+                                                                  GDateTime          *date);
+
+G_END_DECLS
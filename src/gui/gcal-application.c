@@ -25,6 +25,7 @@
 #include "gcal-context.h"
 #include "gcal-debug.h"
 #include "gcal-log.h"
+#include "gcal-memory-stats.h"
 #include "gcal-shell-search-provider.h"
 #include "gcal-window.h"
 
@@ -39,6 +40,12 @@ struct _GcalApplication
 
   GtkWidget          *window;
 
+  /*
+   * When retention is enabled, closing the window only hides it, so that
+   * the views and the loaded events survive until the timeout expires.
+   */
+  guint               window_retention_timeout_id;
+
   gchar              *uuid;
   GDateTime          *initial_date;
 
@@ -77,6 +84,11 @@ static GOptionEntry gcal_application_goptions[] = {
     G_OPTION_ARG_STRING, NULL,
     N_("Open calendar showing the passed event"), NULL
   },
+  {
+    "memory-stats", 0, 0,
+    G_OPTION_ARG_NONE, NULL,
+    N_("Print the memory usage of the running instance"), NULL
+  },
   { NULL }
 };
 
@@ -90,10 +102,84 @@ enum
 
 static GParamSpec* properties[N_PROPS] = { NULL, };
 
+/*
+ * Auxiliary methods
+ */
+
+static gboolean
+is_within_retention_budget (GcalApplication *self)
+{
+  GcalMemorySubsystem subsystems[] = {
+    GCAL_MEMORY_EVENTS,
+    GCAL_MEMORY_RANGE_TREE_NODES,
+    GCAL_MEMORY_TIMELINE_QUEUE,
+    GCAL_MEMORY_EVENT_WIDGETS,
+  };
+  GSettings *settings;
+  guint64 budget;
+  gsize n_bytes;
+  gsize i;
+
+  settings = gcal_context_get_settings (self->context);
+  budget = (guint64) g_settings_get_uint (settings, "window-retention-memory-budget") * 1024 * 1024;
+
+  n_bytes = 0;
+  for (i = 0; i < G_N_ELEMENTS (subsystems); i++)
+    {
+      GcalMemoryUsage usage;
+
+      gcal_memory_stats_get_usage (subsystems[i], &usage);
+      n_bytes += usage.n_bytes;
+    }
+
+  g_debug ("Retained window would use %" G_GSIZE_FORMAT " of %" G_GUINT64_FORMAT " bytes", n_bytes, budget);
+
+  return n_bytes <= budget;
+}
+
+
 /*
  * Callbacks
  */
 
+static gboolean
+on_window_retention_timeout_cb (gpointer user_data)
+{
+  GcalApplication *self = GCAL_APPLICATION (user_data);
+
+  self->window_retention_timeout_id = 0;
+
+  g_debug ("Window retention expired, destroying window");
+
+  if (self->window && !gtk_widget_get_visible (self->window))
+    gtk_window_destroy (GTK_WINDOW (self->window));
+
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean
+on_window_close_request_cb (GtkWindow       *window,
+                            GcalApplication *self)
+{
+  GSettings *settings;
+  guint timeout;
+
+  settings = gcal_context_get_settings (self->context);
+  timeout = g_settings_get_uint (settings, "window-retention-timeout");
+
+  if (timeout == 0 || !is_within_retention_budget (self))
+    return FALSE;
+
+  g_debug ("Retaining window for %u seconds", timeout);
+
+  gtk_widget_set_visible (GTK_WIDGET (window), FALSE);
+
+  gcal_clear_timeout (&self->window_retention_timeout_id);
+  self->window_retention_timeout_id = g_timeout_add_seconds (timeout, on_window_retention_timeout_cb, self);
+
+  return TRUE;
+}
+
 static void
 gcal_application_open_event (GSimpleAction *sync,
                              GVariant      *parameter,
@@ -108,6 +194,7 @@ gcal_application_open_event (GSimpleAction *sync,
 
   g_debug ("Opening event %s", event_uuid);
 
+  gcal_clear_timeout (&self->window_retention_timeout_id);
   gcal_window_open_event_by_uuid (GCAL_WINDOW (self->window), event_uuid);
   gtk_window_present (GTK_WINDOW (self->window));
 }
@@ -255,6 +342,7 @@ gcal_application_quit (GSimpleAction *simple,
 {
   GcalApplication *self = GCAL_APPLICATION (user_data);
 
+  gcal_clear_timeout (&self->window_retention_timeout_id);
   gtk_window_destroy (GTK_WINDOW (self->window));
 }
 
@@ -270,6 +358,7 @@ gcal_application_finalize (GObject *object)
 
   GCAL_ENTRY;
 
+  gcal_clear_timeout (&self->window_retention_timeout_id);
   gcal_clear_date_time (&self->initial_date);
   g_clear_pointer (&self->uuid, g_free);
   g_clear_object (&self->context);
@@ -328,9 +417,13 @@ gcal_application_activate (GApplication *application)
                                     NULL);
 
       g_object_add_weak_pointer (G_OBJECT (self->window), (gpointer*) &self->window);
+      g_signal_connect (self->window, "close-request", G_CALLBACK (on_window_close_request_cb), self);
       gtk_widget_set_visible (self->window, TRUE);
     }
 
+  /* A retained window is reused as is */
+  gcal_clear_timeout (&self->window_retention_timeout_id);
+
   gtk_window_present (GTK_WINDOW (self->window));
 
   if (self->initial_date)
@@ -412,6 +505,14 @@ gcal_application_command_line (GApplication            *app,
       GCAL_RETURN (0);
     }
 
+  if (g_variant_dict_contains (options, "memory-stats"))
+    {
+      g_autofree gchar *memory_stats = gcal_memory_stats_to_string ();
+
+      g_application_command_line_print (command_line, "%s", memory_stats);
+      GCAL_RETURN (0);
+    }
+
   if (g_variant_dict_contains (options, "uuid"))
     {
       option = g_variant_dict_lookup_value (options, "uuid", G_VARIANT_TYPE_STRING);
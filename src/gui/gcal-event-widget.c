@@ -28,6 +28,7 @@
 #include "gcal-debug.h"
 #include "gcal-event-popover.h"
 #include "gcal-event-widget.h"
+#include "gcal-memory-stats.h"
 #include "gcal-overflow-bin.h"
 #include "gcal-utils.h"
 
@@ -52,6 +53,7 @@ struct _GcalEventWidget
   GDateTime          *dt_end;
 
   /* widgets */
+  GtkWidget          *hidden_occurrences_label;
   GtkWidget          *horizontal_box;
   GtkWidget          *main_widget;
   GtkWidget          *timestamp_label;
@@ -417,6 +419,19 @@ gcal_event_widget_set_event_tooltip (GcalEventWidget *self,
       g_string_free (tooltip_desc, TRUE);
     }
 
+  if (gcal_event_get_n_hidden_occurrences (event) > 0)
+    {
+      guint n_hidden_occurrences = gcal_event_get_n_hidden_occurrences (event);
+
+      g_string_append (tooltip_mesg, "\n\n");
+      g_string_append_printf (tooltip_mesg,
+                              g_dngettext (GETTEXT_PACKAGE,
+                                           "This event repeats too often, %u more occurrence is not shown",
+                                           "This event repeats too often, %u more occurrences are not shown",
+                                           n_hidden_occurrences),
+                              n_hidden_occurrences);
+    }
+
   gtk_widget_set_tooltip_markup (GTK_WIDGET (self), tooltip_mesg->str);
 
   g_string_free (tooltip_mesg, TRUE);
@@ -449,6 +464,27 @@ gcal_event_widget_update_timestamp (GcalEventWidget *self)
   gtk_label_set_label (GTK_LABEL (self->timestamp_label), timestamp_str);
 }
 
+static void
+update_hidden_occurrences (GcalEventWidget *self)
+{
+  g_autofree gchar *label = NULL;
+  guint n_hidden_occurrences;
+
+  n_hidden_occurrences = gcal_event_get_n_hidden_occurrences (self->event);
+
+  if (n_hidden_occurrences > 0)
+    {
+      label = g_strdup_printf (g_dngettext (GETTEXT_PACKAGE,
+                                            "%u more occurrence",
+                                            "%u more occurrences",
+                                            n_hidden_occurrences),
+                               n_hidden_occurrences);
+    }
+
+  gtk_widget_set_visible (self->hidden_occurrences_label, label != NULL);
+  gtk_label_set_label (GTK_LABEL (self->hidden_occurrences_label), label);
+}
+
 static void
 gcal_event_widget_set_event_internal (GcalEventWidget *self,
                                       GcalEvent       *event)
@@ -497,6 +533,9 @@ gcal_event_widget_set_event_internal (GcalEventWidget *self,
                           "text",
                           G_BINDING_DEFAULT | G_BINDING_SYNC_CREATE);
 
+  /* Series with too many occurrences end with a "N more occurrences" note */
+  update_hidden_occurrences (self);
+
   gcal_event_widget_update_style (self);
   gcal_event_widget_update_timestamp (self);
 }
@@ -548,9 +587,16 @@ on_drag_source_begin_cb (GtkDragSource   *source,
                          GdkDrag         *drag,
                          GcalEventWidget *self)
 {
+  g_autoptr (GdkPaintable) widget_paintable = NULL;
   g_autoptr (GdkPaintable) paintable = NULL;
 
-  paintable = gtk_widget_paintable_new (GTK_WIDGET (self));
+  /*
+   * Use a static image of the widget as the drag icon, so that the
+   * icon is only moved around while dragging instead of following
+   * every redraw of the event widget.
+   */
+  widget_paintable = gtk_widget_paintable_new (GTK_WIDGET (self));
+  paintable = gdk_paintable_get_current_image (widget_paintable);
   gtk_drag_source_set_icon (source, paintable, 0, 0);
 }
 
@@ -698,6 +744,8 @@ gcal_event_widget_finalize (GObject *object)
   g_clear_object (&self->event);
   g_clear_object (&self->context);
 
+  gcal_memory_stats_remove (GCAL_MEMORY_EVENT_WIDGETS, 1, sizeof (GcalEventWidget));
+
   G_OBJECT_CLASS (gcal_event_widget_parent_class)->finalize (object);
 }
 
@@ -805,6 +853,7 @@ gcal_event_widget_class_init (GcalEventWidgetClass *klass)
   gtk_widget_class_set_template_from_resource (widget_class, "/org/gnome/calendar/ui/gui/gcal-event-widget.ui");
 
   gtk_widget_class_bind_template_child (widget_class, GcalEventWidget, drag_source);
+  gtk_widget_class_bind_template_child (widget_class, GcalEventWidget, hidden_occurrences_label);
   gtk_widget_class_bind_template_child (widget_class, GcalEventWidget, horizontal_box);
   gtk_widget_class_bind_template_child (widget_class, GcalEventWidget, main_widget);
   gtk_widget_class_bind_template_child (widget_class, GcalEventWidget, timestamp_label);
@@ -835,6 +884,8 @@ gcal_event_widget_init (GcalEventWidget *self)
   /* Starts with horizontal */
   self->orientation = GTK_ORIENTATION_HORIZONTAL;
   gtk_widget_add_css_class (GTK_WIDGET (self), "horizontal");
+
+  gcal_memory_stats_add (GCAL_MEMORY_EVENT_WIDGETS, 1, sizeof (GcalEventWidget));
 }
 
 GtkWidget*
@@ -24,6 +24,8 @@
 #include "gcal-debug.h"
 #include "gcal-search-button.h"
 #include "gcal-search-hit.h"
+#include "gcal-search-hit-event.h"
+#include "gcal-search-model.h"
 
 #include <math.h>
 
@@ -98,6 +100,17 @@ scroll_to_result (GcalSearchButton *self,
                               position);
 }
 
+static void
+show_more_results (GcalSearchButton *self)
+{
+  GListModel *model;
+
+  model = gtk_single_selection_get_model (self->results_selection_model);
+
+  if (GCAL_IS_SEARCH_MODEL (model) && gcal_search_model_get_n_hidden_hits (GCAL_SEARCH_MODEL (model)) > 0)
+    gcal_search_model_show_more (GCAL_SEARCH_MODEL (model));
+}
+
 static void
 set_model (GcalSearchButton *self,
            GListModel       *model)
@@ -131,6 +144,39 @@ escape_markup_cb (GcalSearchHit *hit,
   return g_steal_pointer (&escaped_string);
 }
 
+static gboolean
+has_collapsed_instances_cb (GcalSearchHit *hit,
+                            guint          n_instances)
+{
+  return n_instances > 1;
+}
+
+static GVariant *
+hit_id_to_variant_cb (GcalSearchHit *hit,
+                      const gchar   *id)
+{
+  return g_variant_new_string (id ? id : "");
+}
+
+static void
+on_expand_series_action_activated_cb (GSimpleAction *action,
+                                      GVariant      *parameter,
+                                      gpointer       user_data)
+{
+  GcalSearchButton *self;
+  GListModel *model;
+
+  GCAL_ENTRY;
+
+  self = GCAL_SEARCH_BUTTON (user_data);
+  model = gtk_single_selection_get_model (self->results_selection_model);
+
+  if (GCAL_IS_SEARCH_MODEL (model))
+    gcal_search_model_expand_series (GCAL_SEARCH_MODEL (model), g_variant_get_string (parameter, NULL));
+
+  GCAL_EXIT;
+}
+
 static void
 on_button_clicked_cb (GtkButton        *button,
                       GcalSearchButton *self)
@@ -170,6 +216,10 @@ on_search_finished_cb (GObject      *source_object,
   self = GCAL_SEARCH_BUTTON (user_data);
   model = gcal_search_engine_search_finish (GCAL_SEARCH_ENGINE (source_object), result, &error);
 
+  /* Superseded by a newer search */
+  if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    GCAL_RETURN ();
+
   set_model (self, model);
 
   GCAL_EXIT;
@@ -206,6 +256,12 @@ on_entry_next_match_cb (GtkSearchEntry   *entry,
 
   selected = gtk_single_selection_get_selected (self->results_selection_model);
 
+  if (selected != GTK_INVALID_LIST_POSITION &&
+      selected + 1 == g_list_model_get_n_items (G_LIST_MODEL (self->results_selection_model)))
+    {
+      show_more_results (self);
+    }
+
   if (selected != GTK_INVALID_LIST_POSITION &&
       selected + 1 < g_list_model_get_n_items (G_LIST_MODEL (self->results_selection_model)))
     {
@@ -241,7 +297,6 @@ static void
 on_entry_search_changed_cb (GtkSearchEntry   *entry,
                             GcalSearchButton *self)
 {
-  g_autofree gchar *sexp_query = NULL;
   GcalSearchEngine *search_engine;
   const gchar *text;
 
@@ -249,7 +304,9 @@ on_entry_search_changed_cb (GtkSearchEntry   *entry,
 
   text = gtk_editable_get_text (self->entry);
 
+  /* Stops the previous search from widening its range any further */
   g_cancellable_cancel (self->cancellable);
+  g_clear_object (&self->cancellable);
 
   if (!text || *text == '\0')
     {
@@ -260,10 +317,11 @@ on_entry_search_changed_cb (GtkSearchEntry   *entry,
 
   g_debug ("Search query changed to \"%s\"", text);
 
-  sexp_query = g_strdup_printf ("(contains? \"summary\" \"%s\")", text);
+  self->cancellable = g_cancellable_new ();
+
   search_engine = gcal_context_get_search_engine (self->context);
   gcal_search_engine_search (search_engine,
-                             sexp_query,
+                             text,
                              self->cancellable,
                              on_search_finished_cb,
                              g_object_ref (self));
@@ -303,6 +361,15 @@ on_results_revealer_child_reveal_state_changed_cb (GtkRevealer      *revealer,
     gtk_popover_popdown (GTK_POPOVER (self->popover));
 }
 
+static void
+on_results_scrolled_window_edge_reached_cb (GtkScrolledWindow *scrolled_window,
+                                            GtkPositionType    position,
+                                            GcalSearchButton  *self)
+{
+  if (position == GTK_POS_BOTTOM)
+    show_more_results (self);
+}
+
 static gboolean
 string_is_not_empty_cb (GcalSearchHit *hit,
                         const gchar   *string)
@@ -410,6 +477,8 @@ gcal_search_button_class_init (GcalSearchButtonClass *klass)
   gtk_widget_class_bind_template_child (widget_class, GcalSearchButton, stack);
 
   gtk_widget_class_bind_template_callback (widget_class, escape_markup_cb);
+  gtk_widget_class_bind_template_callback (widget_class, has_collapsed_instances_cb);
+  gtk_widget_class_bind_template_callback (widget_class, hit_id_to_variant_cb);
   gtk_widget_class_bind_template_callback (widget_class, on_button_clicked_cb);
   gtk_widget_class_bind_template_callback (widget_class, on_focus_controller_leave_cb);
   gtk_widget_class_bind_template_callback (widget_class, on_entry_activate_cb);
@@ -419,16 +488,29 @@ gcal_search_button_class_init (GcalSearchButtonClass *klass)
   gtk_widget_class_bind_template_callback (widget_class, on_entry_stop_search_cb);
   gtk_widget_class_bind_template_callback (widget_class, on_results_listview_activated_cb);
   gtk_widget_class_bind_template_callback (widget_class, on_results_revealer_child_reveal_state_changed_cb);
+  gtk_widget_class_bind_template_callback (widget_class, on_results_scrolled_window_edge_reached_cb);
   gtk_widget_class_bind_template_callback (widget_class, string_is_not_empty_cb);
 
   gtk_widget_class_set_css_name (widget_class, "searchbutton");
+
+  g_type_ensure (GCAL_TYPE_SEARCH_HIT_EVENT);
 }
 
 static void
 gcal_search_button_init (GcalSearchButton *self)
 {
+  g_autoptr (GSimpleActionGroup) group = NULL;
+
+  static const GActionEntry actions[] = {
+    { "expand-series", on_expand_series_action_activated_cb, "s" },
+  };
+
   gtk_widget_init_template (GTK_WIDGET (self));
 
+  group = g_simple_action_group_new ();
+  g_action_map_add_action_entries (G_ACTION_MAP (group), actions, G_N_ELEMENTS (actions), self);
+  gtk_widget_insert_action_group (GTK_WIDGET (self), "search", G_ACTION_GROUP (group));
+
   gtk_widget_set_parent (GTK_WIDGET (self->popover), GTK_WIDGET (self));
 }
 
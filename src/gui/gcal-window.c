@@ -28,6 +28,7 @@
 #include "gcal-drop-overlay.h"
 #include "gcal-event-editor-dialog.h"
 #include "gcal-event-widget.h"
+#include "gcal-export-dialog.h"
 #include "gcal-context.h"
 #include "gcal-manager.h"
 #include "gcal-month-view.h"
@@ -146,6 +147,9 @@ struct _GcalWindow
 
   AdwToast           *delete_event_toast;
 
+  /* recurring events with too many instances to show */
+  guint               n_truncated_series;
+
   /* calendar management */
   GtkWidget          *calendar_management_dialog;
 
@@ -225,6 +229,38 @@ update_today_action_enabled (GcalWindow *window)
   GCAL_EXIT;
 }
 
+static void
+maybe_show_truncated_series_toast (GcalWindow *self)
+{
+  g_autoptr (AdwToast) toast = NULL;
+  g_autofree gchar *title = NULL;
+  GcalTimeline *timeline;
+  guint n_truncated_series;
+
+  timeline = gcal_manager_get_timeline (gcal_context_get_manager (self->context));
+
+  if (!gcal_timeline_is_complete (timeline))
+    return;
+
+  n_truncated_series = gcal_timeline_get_n_truncated_series (timeline);
+
+  /* Only tell about series that weren't truncated the last time */
+  if (n_truncated_series > self->n_truncated_series)
+    {
+      title = g_strdup_printf (g_dngettext (GETTEXT_PACKAGE,
+                                            "%u recurring event repeats too often, only its first occurrences are shown",
+                                            "%u recurring events repeat too often, only their first occurrences are shown",
+                                            n_truncated_series),
+                               n_truncated_series);
+
+      toast = adw_toast_new (title);
+      adw_toast_set_timeout (toast, 5);
+      adw_toast_overlay_add_toast (self->overlay, g_steal_pointer (&toast));
+    }
+
+  self->n_truncated_series = n_truncated_series;
+}
+
 static void
 maybe_add_subscribers_to_timeline (GcalWindow *self)
 {
@@ -488,6 +524,18 @@ on_window_next_date_activated_cb (GSimpleAction *action,
   update_active_date (self, next_date);
 }
 
+static void
+on_window_export_cb (GSimpleAction *action,
+                     GVariant      *param,
+                     gpointer       user_data)
+{
+  GcalWindow *self = GCAL_WINDOW (user_data);
+  GtkWidget *dialog;
+
+  dialog = gcal_export_dialog_new (self->context, self->active_date);
+  adw_dialog_present (ADW_DIALOG (dialog), GTK_WIDGET (self));
+}
+
 static void
 on_window_new_event_cb (GSimpleAction *action,
                         GVariant      *param,
@@ -1083,6 +1131,12 @@ gcal_window_constructed (GObject *object)
                     NULL);
   recalculate_calendar_colors_css (self);
 
+  g_signal_connect_object (gcal_manager_get_timeline (gcal_context_get_manager (self->context)),
+                           "notify::complete",
+                           G_CALLBACK (maybe_show_truncated_series_toast),
+                           self,
+                           G_CONNECT_SWAPPED);
+
   GCAL_EXIT;
 }
 
@@ -1167,6 +1221,16 @@ gcal_window_get_property (GObject    *object,
  * GtkWidget overrides
  */
 
+static void
+gcal_window_map (GtkWidget *widget)
+{
+  GcalWindow *self = GCAL_WINDOW (widget);
+
+  GTK_WIDGET_CLASS (gcal_window_parent_class)->map (widget);
+
+  gcal_clock_hold (gcal_context_get_clock (self->context));
+}
+
 static void
 gcal_window_unmap (GtkWidget *widget)
 {
@@ -1185,6 +1249,8 @@ gcal_window_unmap (GtkWidget *widget)
   g_settings_set_boolean (settings, "window-maximized", gtk_window_is_maximized (GTK_WINDOW (self)));
   g_settings_set (settings, "window-size", "(ii)", width, height);
 
+  gcal_clock_release (gcal_context_get_clock (self->context));
+
   GTK_WIDGET_CLASS (gcal_window_parent_class)->unmap (widget);
 
   GCAL_EXIT;
@@ -1218,6 +1284,7 @@ gcal_window_class_init (GcalWindowClass *klass)
   object_class->get_property = gcal_window_get_property;
 
   widget_class = GTK_WIDGET_CLASS (klass);
+  widget_class->map = gcal_window_map;
   widget_class->unmap = gcal_window_unmap;
 
 
@@ -1298,6 +1365,7 @@ gcal_window_init (GcalWindow *self)
 {
   static const GActionEntry actions[] = {
     {"change-view", on_view_action_activated, "i" },
+    {"export", on_window_export_cb },
     {"next-date", on_window_next_date_activated_cb },
     {"new-event", on_window_new_event_cb },
     {"open-date-time-settings", on_window_open_date_time_settings_cb },
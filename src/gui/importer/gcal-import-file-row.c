@@ -27,6 +27,36 @@
 
 #include <glib/gi18n.h>
 
+/*
+ * Files can have tens of thousands of events. Only the first events are
+ * previewed, and their rows are added in small batches so that the dialog
+ * can show the first rows right away.
+ */
+#define MAX_PREVIEW_ROWS 200
+#define PREVIEW_ROWS_PER_BATCH 20
+
+typedef struct
+{
+  gchar              *summary;
+  gchar              *location;
+  gchar              *start;
+  gchar              *end;
+  gchar              *description;
+} EventPreview;
+
+typedef struct
+{
+  ICalComponent      *component;
+  GcalTimeFormat      time_format;
+} BuildPreviewsData;
+
+typedef struct
+{
+  GPtrArray          *event_components;
+  GPtrArray          *timezones;
+  GPtrArray          *previews;
+} LoadedFile;
+
 struct _GcalImportFileRow
 {
   AdwBin              parent;
@@ -39,6 +69,10 @@ struct _GcalImportFileRow
   GPtrArray          *ical_components;
   GPtrArray          *ical_timezones;
 
+  GPtrArray          *previews;
+  guint               n_preview_rows;
+  guint               add_rows_idle_id;
+
   GcalContext        *context;
 };
 
@@ -46,6 +80,10 @@ static void          read_calendar_finished_cb                   (GObject
                                                                   GAsyncResult       *res,
                                                                   gpointer            user_data);
 
+static void          previews_built_cb                           (GObject            *source_object,
+                                                                  GAsyncResult       *res,
+                                                                  gpointer            user_data);
+
 G_DEFINE_TYPE (GcalImportFileRow, gcal_import_file_row, ADW_TYPE_BIN)
 
 enum
@@ -108,114 +146,159 @@ add_grid_row (GcalImportFileRow *self,
 }
 
 static void
-fill_grid_with_event_data (GcalImportFileRow *self,
-                           GtkGrid           *grid,
-                           ICalComponent     *ical_component)
+event_preview_free (EventPreview *preview)
 {
-  g_autofree gchar *start_string = NULL;
-  g_autofree gchar *description = NULL;
-  g_autofree gchar *end_string = NULL;
-  g_autoptr (GDateTime) start = NULL;
-  g_autoptr (GDateTime) start_local = NULL;
-  g_autoptr (GDateTime) end = NULL;
-  g_autoptr (GDateTime) end_local = NULL;
-  ICalTime *ical_start;
-  ICalTime *ical_end;
-  gint row = 0;
+  g_clear_pointer (&preview->summary, g_free);
+  g_clear_pointer (&preview->location, g_free);
+  g_clear_pointer (&preview->start, g_free);
+  g_clear_pointer (&preview->end, g_free);
+  g_clear_pointer (&preview->description, g_free);
+  g_free (preview);
+}
 
-  ical_start = i_cal_component_get_dtstart (ical_component);
-  start = gcal_date_time_from_icaltime (ical_start);
-  if (i_cal_time_is_date (ical_start))
-    start_string = g_date_time_format (start, "%x");
-  else
-    {
-      start_local = g_date_time_to_local (start);
+static void
+build_previews_data_free (BuildPreviewsData *data)
+{
+  g_clear_object (&data->component);
+  g_free (data);
+}
 
-      switch (gcal_context_get_time_format (self->context))
-        {
-        case GCAL_TIME_FORMAT_24H:
-          start_string = g_date_time_format (start_local, "%x %R");
-          break;
+static void
+loaded_file_free (LoadedFile *loaded_file)
+{
+  g_clear_pointer (&loaded_file->event_components, g_ptr_array_unref);
+  g_clear_pointer (&loaded_file->timezones, g_ptr_array_unref);
+  g_clear_pointer (&loaded_file->previews, g_ptr_array_unref);
+  g_free (loaded_file);
+}
 
-        case GCAL_TIME_FORMAT_12H:
-          start_string = g_date_time_format (start_local, "%x %I:%M %P");
-          break;
+static gchar*
+format_ical_time (ICalTime       *ical_time,
+                  GcalTimeFormat  time_format)
+{
+  g_autoptr (GDateTime) date_time = NULL;
+  g_autoptr (GDateTime) local_date_time = NULL;
 
-        default:
-          g_assert_not_reached ();
-        }
-    }
+  date_time = gcal_date_time_from_icaltime (ical_time);
 
-  ical_end = i_cal_component_get_dtend (ical_component);
-  end = gcal_date_time_from_icaltime (ical_end);
-  if (i_cal_time_is_date (ical_end))
-    end_string = g_date_time_format (end, "%x");
-  else
-    {
-      end_local = g_date_time_to_local (end);
+  if (i_cal_time_is_date (ical_time))
+    return g_date_time_format (date_time, "%x");
 
-      switch (gcal_context_get_time_format (self->context))
-        {
-        case GCAL_TIME_FORMAT_24H:
-          end_string = g_date_time_format (end_local, "%x %R");
-          break;
+  local_date_time = g_date_time_to_local (date_time);
 
-        case GCAL_TIME_FORMAT_12H:
-          end_string = g_date_time_format (end_local, "%x %I:%M %P");
-          break;
+  switch (time_format)
+    {
+    case GCAL_TIME_FORMAT_24H:
+      return g_date_time_format (local_date_time, "%x %R");
 
-        default:
-          g_assert_not_reached ();
-        }
+    case GCAL_TIME_FORMAT_12H:
+      return g_date_time_format (local_date_time, "%x %I:%M %P");
+
+    default:
+      g_assert_not_reached ();
     }
+}
+
+static EventPreview*
+event_preview_new (ICalComponent  *ical_component,
+                   GcalTimeFormat  time_format)
+{
+  EventPreview *preview;
+  ICalTime *ical_start;
+  ICalTime *ical_end;
+
+  preview = g_new0 (EventPreview, 1);
+  preview->summary = g_strdup (i_cal_component_get_summary (ical_component));
+  preview->location = g_strdup (i_cal_component_get_location (ical_component));
+
+  ical_start = i_cal_component_get_dtstart (ical_component);
+  preview->start = format_ical_time (ical_start, time_format);
+
+  ical_end = i_cal_component_get_dtend (ical_component);
+  preview->end = format_ical_time (ical_end, time_format);
 
   gcal_utils_extract_google_section (i_cal_component_get_description (ical_component),
-                                     &description,
+                                     &preview->description,
                                      NULL);
 
-  add_grid_row (self, grid, row++, _("Title"), i_cal_component_get_summary (ical_component));
-  add_grid_row (self, grid, row++, _("Location"), i_cal_component_get_location (ical_component));
-  add_grid_row (self, grid, row++, _("Starts"), start_string);
-  add_grid_row (self, grid, row++, _("Ends"), end_string);
-  add_grid_row (self, grid, row++, _("Description"), description);
-
   g_clear_object (&ical_start);
   g_clear_object (&ical_end);
+
+  return preview;
 }
 
 static void
-add_events_to_listbox (GcalImportFileRow *self,
-                       GPtrArray         *events)
+fill_grid_with_event_data (GcalImportFileRow  *self,
+                           GtkGrid            *grid,
+                           const EventPreview *preview)
 {
-  guint i;
+  gint row = 0;
 
-  for (i = 0; i < events->len; i++)
-    {
-      ICalComponent *ical_component;
-      GtkWidget *grid;
-      GtkWidget *row;
-
-      ical_component = g_ptr_array_index (events, i);
-
-      row = g_object_new (GTK_TYPE_LIST_BOX_ROW,
-                          "visible", TRUE,
-                          "activatable", FALSE,
-                          NULL);
-
-      grid = g_object_new (GTK_TYPE_GRID,
-                           "visible", TRUE,
-                           "row-spacing", 6,
-                           "column-spacing", 12,
-                           "margin-top", 18,
-                           "margin-bottom", 18,
-                           "margin-start", 24,
-                           "margin-end", 24,
-                           NULL);
-      fill_grid_with_event_data (self, GTK_GRID (grid), ical_component);
-      gtk_list_box_row_set_child (GTK_LIST_BOX_ROW (row), grid);
-
-      gtk_list_box_insert (self->events_listbox, row, -1);
-    }
+  add_grid_row (self, grid, row++, _("Title"), preview->summary);
+  add_grid_row (self, grid, row++, _("Location"), preview->location);
+  add_grid_row (self, grid, row++, _("Starts"), preview->start);
+  add_grid_row (self, grid, row++, _("Ends"), preview->end);
+  add_grid_row (self, grid, row++, _("Description"), preview->description);
+}
+
+static void
+add_preview_row (GcalImportFileRow  *self,
+                 const EventPreview *preview)
+{
+  GtkWidget *grid;
+  GtkWidget *row;
+
+  row = g_object_new (GTK_TYPE_LIST_BOX_ROW,
+                      "visible", TRUE,
+                      "activatable", FALSE,
+                      NULL);
+
+  grid = g_object_new (GTK_TYPE_GRID,
+                       "visible", TRUE,
+                       "row-spacing", 6,
+                       "column-spacing", 12,
+                       "margin-top", 18,
+                       "margin-bottom", 18,
+                       "margin-start", 24,
+                       "margin-end", 24,
+                       NULL);
+  fill_grid_with_event_data (self, GTK_GRID (grid), preview);
+  gtk_list_box_row_set_child (GTK_LIST_BOX_ROW (row), grid);
+
+  gtk_list_box_insert (self->events_listbox, row, -1);
+}
+
+static void
+add_hidden_events_row (GcalImportFileRow *self,
+                       guint              n_hidden_events)
+{
+  g_autofree gchar *text = NULL;
+  GtkWidget *label;
+  GtkWidget *row;
+
+  text = g_strdup_printf (g_dngettext (GETTEXT_PACKAGE,
+                                       "And %u more event",
+                                       "And %u more events",
+                                       n_hidden_events),
+                          n_hidden_events);
+
+  row = g_object_new (GTK_TYPE_LIST_BOX_ROW,
+                      "visible", TRUE,
+                      "activatable", FALSE,
+                      NULL);
+
+  label = g_object_new (GTK_TYPE_LABEL,
+                        "visible", TRUE,
+                        "label", text,
+                        "margin-top", 12,
+                        "margin-bottom", 12,
+                        "margin-start", 24,
+                        "margin-end", 24,
+                        NULL);
+  gtk_widget_add_css_class (label, "dim-label");
+  gtk_list_box_row_set_child (GTK_LIST_BOX_ROW (row), label);
+
+  gtk_list_box_insert (self->events_listbox, row, -1);
 }
 
 static GPtrArray*
@@ -269,6 +352,41 @@ filter_timezones (ICalComponent *component)
   return g_steal_pointer (&timezones);
 }
 
+static void
+build_previews_in_thread (GTask        *task,
+                          gpointer      source_object,
+                          gpointer      task_data,
+                          GCancellable *cancellable)
+{
+  BuildPreviewsData *data;
+  LoadedFile *loaded_file;
+  guint n_previews;
+
+  data = task_data;
+
+  loaded_file = g_new0 (LoadedFile, 1);
+  loaded_file->event_components = filter_event_components (data->component);
+  loaded_file->timezones = filter_timezones (data->component);
+
+  n_previews = MIN (loaded_file->event_components->len, MAX_PREVIEW_ROWS);
+  loaded_file->previews = g_ptr_array_new_full (n_previews, (GDestroyNotify) event_preview_free);
+
+  for (guint i = 0; i < n_previews; i++)
+    {
+      ICalComponent *ical_component = g_ptr_array_index (loaded_file->event_components, i);
+
+      if (g_task_return_error_if_cancelled (task))
+        {
+          loaded_file_free (loaded_file);
+          return;
+        }
+
+      g_ptr_array_add (loaded_file->previews, event_preview_new (ical_component, data->time_format));
+    }
+
+  g_task_return_pointer (task, loaded_file, (GDestroyNotify) loaded_file_free);
+}
+
 static void
 setup_file (GcalImportFileRow *self)
 {
@@ -283,33 +401,92 @@ setup_file (GcalImportFileRow *self)
  * Callbacks
  */
 
+static gboolean
+add_preview_rows_in_idle_cb (gpointer user_data)
+{
+  GcalImportFileRow *self;
+  guint n_rows;
+
+  self = GCAL_IMPORT_FILE_ROW (user_data);
+  n_rows = MIN (self->previews->len - self->n_preview_rows, PREVIEW_ROWS_PER_BATCH);
+
+  for (guint i = 0; i < n_rows; i++)
+    add_preview_row (self, g_ptr_array_index (self->previews, self->n_preview_rows++));
+
+  if (self->n_preview_rows < self->previews->len)
+    return G_SOURCE_CONTINUE;
+
+  if (self->ical_components->len > self->previews->len)
+    add_hidden_events_row (self, self->ical_components->len - self->previews->len);
+
+  self->add_rows_idle_id = 0;
+  return G_SOURCE_REMOVE;
+}
+
 static void
 read_calendar_finished_cb (GObject      *source_object,
                            GAsyncResult *res,
                            gpointer      user_data)
 {
-  g_autoptr (GPtrArray) event_components = NULL;
-  g_autoptr (GPtrArray) timezones = NULL;
   g_autoptr (GError) error = NULL;
+  g_autoptr (GTask) task = NULL;
+  BuildPreviewsData *data;
   ICalComponent *component;
   GcalImportFileRow *self;
 
   self = GCAL_IMPORT_FILE_ROW (user_data);
   component = gcal_importer_import_file_finish (res, &error);
-  event_components = filter_event_components (component);
-  timezones = filter_timezones (component);
 
-  gtk_widget_set_sensitive (GTK_WIDGET (self), !error && event_components && event_components->len > 0);
+  if (error)
+    {
+      gtk_widget_set_sensitive (GTK_WIDGET (self), FALSE);
+      return;
+    }
+
+  /* Extracting the events and formatting the previews happens in a worker thread */
+  data = g_new0 (BuildPreviewsData, 1);
+  data->component = component;
+  data->time_format = gcal_context_get_time_format (self->context);
+
+  task = g_task_new (self, self->cancellable, previews_built_cb, NULL);
+  g_task_set_task_data (task, data, (GDestroyNotify) build_previews_data_free);
+  g_task_set_source_tag (task, read_calendar_finished_cb);
+  g_task_run_in_thread (task, build_previews_in_thread);
+}
 
-  if (error || !event_components || event_components->len == 0)
+static void
+previews_built_cb (GObject      *source_object,
+                   GAsyncResult *res,
+                   gpointer      user_data)
+{
+  g_autoptr (GError) error = NULL;
+  GcalImportFileRow *self;
+  LoadedFile *loaded_file;
+
+  self = GCAL_IMPORT_FILE_ROW (source_object);
+  loaded_file = g_task_propagate_pointer (G_TASK (res), &error);
+
+  if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
     return;
 
-  add_events_to_listbox (self, event_components);
+  gtk_widget_set_sensitive (GTK_WIDGET (self), loaded_file && loaded_file->event_components->len > 0);
 
-  self->ical_components = g_ptr_array_ref (event_components);
-  self->ical_timezones = g_steal_pointer (&timezones);
+  if (!loaded_file || loaded_file->event_components->len == 0)
+    {
+      g_clear_pointer (&loaded_file, loaded_file_free);
+      return;
+    }
 
-  g_signal_emit (self, signals[FILE_LOADED], 0, event_components);
+  self->ical_components = g_steal_pointer (&loaded_file->event_components);
+  self->ical_timezones = g_steal_pointer (&loaded_file->timezones);
+  self->previews = g_steal_pointer (&loaded_file->previews);
+  g_clear_pointer (&loaded_file, loaded_file_free);
+
+  /* Show the first batch right away */
+  if (add_preview_rows_in_idle_cb (self) == G_SOURCE_CONTINUE)
+    self->add_rows_idle_id = g_idle_add (add_preview_rows_in_idle_cb, self);
+
+  g_signal_emit (self, signals[FILE_LOADED], 0, self->ical_components);
 }
 
 
@@ -317,6 +494,16 @@ read_calendar_finished_cb (GObject      *source_object,
  * GObject overrides
  */
 
+static void
+gcal_import_file_row_dispose (GObject *object)
+{
+  GcalImportFileRow *self = (GcalImportFileRow *)object;
+
+  g_clear_handle_id (&self->add_rows_idle_id, g_source_remove);
+
+  G_OBJECT_CLASS (gcal_import_file_row_parent_class)->dispose (object);
+}
+
 static void
 gcal_import_file_row_finalize (GObject *object)
 {
@@ -328,6 +515,7 @@ gcal_import_file_row_finalize (GObject *object)
   g_clear_object (&self->file);
   g_clear_pointer (&self->ical_components, g_ptr_array_unref);
   g_clear_pointer (&self->ical_timezones, g_ptr_array_unref);
+  g_clear_pointer (&self->previews, g_ptr_array_unref);
 
   G_OBJECT_CLASS (gcal_import_file_row_parent_class)->finalize (object);
 }
@@ -387,6 +575,7 @@ gcal_import_file_row_class_init (GcalImportFileRowClass *klass)
   GObjectClass *object_class = G_OBJECT_CLASS (klass);
   GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (klass);
 
+  object_class->dispose = gcal_import_file_row_dispose;
   object_class->finalize = gcal_import_file_row_finalize;
   object_class->get_property = gcal_import_file_row_get_property;
   object_class->set_property = gcal_import_file_row_set_property;
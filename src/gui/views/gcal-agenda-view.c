@@ -21,6 +21,7 @@
 #include "gcal-agenda-view.h"
 #include "gcal-debug.h"
 #include "gcal-enums.h"
+#include "gcal-event-index.h"
 #include "gcal-event-widget.h"
 #include "gcal-range-tree.h"
 #include "gcal-timeline-subscriber.h"
@@ -52,6 +53,7 @@ struct _GcalAgendaView
   GcalContext        *context;
 
   GcalRangeTree      *events;
+  GcalEventIndex     *children_index;
   guint               scroll_grid_timeout_id;
   gulong              stack_page_changed_id;
 
@@ -526,6 +528,7 @@ gcal_agenda_view_add_event (GcalTimelineSubscriber *subscriber,
   GcalAgendaView *self = GCAL_AGENDA_VIEW (subscriber);
   GtkWidget *widget, *row;
   GcalTimestampPolicy timestamp_policy;
+  ChildData *data;
 
   GCAL_ENTRY;
 
@@ -557,9 +560,10 @@ gcal_agenda_view_add_event (GcalTimelineSubscriber *subscriber,
                       "child", widget,
                       NULL);
 
-  gcal_range_tree_add_range (self->events,
-                             gcal_event_get_range (event),
-                             child_data_new (row, event, self));
+  data = child_data_new (row, event, self);
+
+  gcal_range_tree_add_range (self->events, gcal_event_get_range (event), data);
+  gcal_event_index_add (self->children_index, event, data);
 
   g_signal_connect (widget, "activate", G_CALLBACK (on_event_widget_activated_cb), self);
 
@@ -575,13 +579,12 @@ gcal_agenda_view_remove_event (GcalTimelineSubscriber *subscriber,
                                GcalEvent              *event)
 {
   GcalAgendaView *self = GCAL_AGENDA_VIEW (subscriber);
-  const gchar *uid = gcal_event_get_uid (event);
-  GPtrArray *widgets;
+  g_autoptr (GPtrArray) children = NULL;
   guint i;
 
   GCAL_ENTRY;
 
-  widgets = gcal_range_tree_get_all_data (self->events);
+  children = gcal_event_index_lookup (self->children_index, gcal_event_get_uid (event));
 
   if (gcal_date_time_compare_date (self->date, gcal_event_get_date_start (event)) == 0)
     {
@@ -589,25 +592,15 @@ gcal_agenda_view_remove_event (GcalTimelineSubscriber *subscriber,
       update_no_events_row (self);
     }
 
-  for (i = 0; widgets && i < widgets->len; i++)
+  for (i = 0; children && i < children->len; i++)
     {
-      ChildData *data;
-      GtkWidget *widget;
-      GcalEvent *event;
-
-      data = g_ptr_array_index (widgets, i);
-      widget = gtk_list_box_row_get_child (GTK_LIST_BOX_ROW (data->widget));
-      event = gcal_event_widget_get_event (GCAL_EVENT_WIDGET (widget));
+      ChildData *data = g_ptr_array_index (children, i);
 
-      if (g_strcmp0 (gcal_event_get_uid (event), uid) != 0)
-        continue;
-
-      gcal_range_tree_remove_range (self->events, gcal_event_get_range (event), data);
+      gcal_event_index_remove (self->children_index, data->event, data);
+      gcal_range_tree_remove_range (self->events, gcal_event_get_range (data->event), data);
       gtk_widget_queue_allocate (GTK_WIDGET (self));
     }
 
-  g_clear_pointer (&widgets, g_ptr_array_unref);
-
   gtk_list_box_invalidate_headers (GTK_LIST_BOX (self->list_box));
 
   GCAL_EXIT;
@@ -647,6 +640,7 @@ gcal_agenda_view_dispose (GObject *object)
 
   self = GCAL_AGENDA_VIEW (object);
 
+  g_clear_pointer (&self->children_index, gcal_event_index_free);
   g_clear_pointer (&self->events, gcal_range_tree_unref);
 
   /* Chain up to parent's dispose() method. */
@@ -749,6 +743,7 @@ gcal_agenda_view_init (GcalAgendaView *self)
   gtk_widget_init_template (GTK_WIDGET (self));
 
   self->events = gcal_range_tree_new_with_free_func (child_data_free);
+  self->children_index = gcal_event_index_new ();
 
   gtk_list_box_set_sort_func (GTK_LIST_BOX (self->list_box), sort_func, self, NULL);
   gtk_list_box_set_header_func (GTK_LIST_BOX (self->list_box), update_header, self, NULL);
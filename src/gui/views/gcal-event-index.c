@@ -0,0 +1,337 @@
+/* gcal-event-index.c
+ *
+ * Copyright 2024 Georges Basile Stavracas Neto <georges.stavracas@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#define G_LOG_DOMAIN "GcalEventIndex"
+
+#include "gcal-event-index.h"
+
+/*
+ * GcalEventIndex maps event uids, and the series they belong to, to whatever
+ * per-event data a view keeps around (usually the event widget). Views keep it
+ * in sync with their range trees and children, so that removing an event, or
+ * finding every widget of a recurring series, doesn't have to walk all children.
+ */
+
+typedef struct
+{
+  GcalEvent          *event;
+  gpointer            data;
+  gchar              *series_id;
+} IndexEntry;
+
+struct _GcalEventIndex
+{
+  /* uid → GPtrArray<IndexEntry>, owns the entries */
+  GHashTable         *by_uid;
+
+  /* series id → GPtrArray<IndexEntry> */
+  GHashTable         *by_series;
+};
+
+
+/*
+ * Auxiliary methods
+ */
+
+static gchar*
+get_series_id (GcalEvent *event)
+{
+  ECalComponent *component;
+  GcalCalendar *calendar;
+
+  component = gcal_event_get_component (event);
+  calendar = gcal_event_get_calendar (event);
+
+  if (!component || !calendar)
+    return g_strdup (gcal_event_get_uid (event));
+
+  return g_strdup_printf ("%s:%s",
+                          gcal_calendar_get_id (calendar),
+                          e_cal_component_get_uid (component));
+}
+
+static IndexEntry*
+index_entry_new (GcalEvent *event,
+                 gpointer   data)
+{
+  IndexEntry *entry;
+
+  entry = g_new (IndexEntry, 1);
+  entry->event = g_object_ref (event);
+  entry->data = data;
+  entry->series_id = get_series_id (event);
+
+  return entry;
+}
+
+static void
+index_entry_free (gpointer data)
+{
+  IndexEntry *entry = data;
+
+  g_clear_object (&entry->event);
+  g_clear_pointer (&entry->series_id, g_free);
+  g_free (entry);
+}
+
+static gboolean
+remove_from_table (GHashTable  *table,
+                   const gchar *key,
+                   IndexEntry  *entry)
+{
+  GPtrArray *entries;
+
+  entries = g_hash_table_lookup (table, key);
+
+  if (!entries || !g_ptr_array_remove_fast (entries, entry))
+    return FALSE;
+
+  if (entries->len == 0)
+    g_hash_table_remove (table, key);
+
+  return TRUE;
+}
+
+
+/*
+ * Public API
+ */
+
+GcalEventIndex*
+gcal_event_index_new (void)
+{
+  GcalEventIndex *self;
+
+  self = g_new0 (GcalEventIndex, 1);
+  self->by_uid = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_ptr_array_unref);
+  self->by_series = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_ptr_array_unref);
+
+  return self;
+}
+
+void
+gcal_event_index_free (GcalEventIndex *self)
+{
+  g_return_if_fail (self != NULL);
+
+  /* Series arrays don't own the entries, drop them first */
+  g_clear_pointer (&self->by_series, g_hash_table_destroy);
+  g_clear_pointer (&self->by_uid, g_hash_table_destroy);
+  g_free (self);
+}
+
+/**
+ * gcal_event_index_add:
+ * @self: a #GcalEventIndex
+ * @event: a #GcalEvent
+ * @data: the data associated with @event
+ *
+ * Indexes @data under the uid and the series of @event. The same
+ * event can be added multiple times with different data.
+ */
+void
+gcal_event_index_add (GcalEventIndex *self,
+                      GcalEvent      *event,
+                      gpointer        data)
+{
+  GPtrArray *entries;
+  IndexEntry *entry;
+  const gchar *uid;
+
+  g_return_if_fail (self != NULL);
+  g_return_if_fail (GCAL_IS_EVENT (event));
+
+  entry = index_entry_new (event, data);
+  uid = gcal_event_get_uid (event);
+
+  entries = g_hash_table_lookup (self->by_uid, uid);
+  if (!entries)
+    {
+      entries = g_ptr_array_new_with_free_func (index_entry_free);
+      g_hash_table_insert (self->by_uid, g_strdup (uid), entries);
+    }
+  g_ptr_array_add (entries, entry);
+
+  entries = g_hash_table_lookup (self->by_series, entry->series_id);
+  if (!entries)
+    {
+      entries = g_ptr_array_new ();
+      g_hash_table_insert (self->by_series, g_strdup (entry->series_id), entries);
+    }
+  g_ptr_array_add (entries, entry);
+}
+
+/**
+ * gcal_event_index_remove:
+ * @self: a #GcalEventIndex
+ * @event: a #GcalEvent
+ * @data: the data associated with @event
+ *
+ * Removes the (@event, @data) pair from the index.
+ *
+ * Returns: %TRUE if the pair was indexed, %FALSE otherwise
+ */
+gboolean
+gcal_event_index_remove (GcalEventIndex *self,
+                         GcalEvent      *event,
+                         gpointer        data)
+{
+  IndexEntry *entry;
+  GPtrArray *entries;
+  const gchar *uid;
+  guint i;
+
+  g_return_val_if_fail (self != NULL, FALSE);
+  g_return_val_if_fail (GCAL_IS_EVENT (event), FALSE);
+
+  uid = gcal_event_get_uid (event);
+  entries = g_hash_table_lookup (self->by_uid, uid);
+  entry = NULL;
+
+  for (i = 0; entries && i < entries->len; i++)
+    {
+      IndexEntry *aux = g_ptr_array_index (entries, i);
+
+      if (aux->data == data)
+        {
+          entry = aux;
+          break;
+        }
+    }
+
+  if (!entry)
+    return FALSE;
+
+  remove_from_table (self->by_series, entry->series_id, entry);
+  remove_from_table (self->by_uid, uid, entry);
+
+  return TRUE;
+}
+
+void
+gcal_event_index_remove_all (GcalEventIndex *self)
+{
+  g_return_if_fail (self != NULL);
+
+  g_hash_table_remove_all (self->by_series);
+  g_hash_table_remove_all (self->by_uid);
+}
+
+/**
+ * gcal_event_index_lookup:
+ * @self: a #GcalEventIndex
+ * @uid: the uid of the event
+ *
+ * Retrieves the data associated with all events with @uid.
+ *
+ * Returns: (transfer container) (nullable): a #GPtrArray with the
+ * data associated with @uid, or %NULL
+ */
+GPtrArray*
+gcal_event_index_lookup (GcalEventIndex *self,
+                         const gchar    *uid)
+{
+  GPtrArray *entries;
+  GPtrArray *result;
+  guint i;
+
+  g_return_val_if_fail (self != NULL, NULL);
+
+  entries = g_hash_table_lookup (self->by_uid, uid);
+
+  if (!entries)
+    return NULL;
+
+  result = g_ptr_array_sized_new (entries->len);
+
+  for (i = 0; i < entries->len; i++)
+    {
+      IndexEntry *entry = g_ptr_array_index (entries, i);
+      g_ptr_array_add (result, entry->data);
+    }
+
+  return result;
+}
+
+/**
+ * gcal_event_index_get_related:
+ * @self: a #GcalEventIndex
+ * @uid: the uid of the event
+ * @mod: a #GcalRecurrenceModType
+ *
+ * Retrieves the data of the events with @uid and, depending on @mod,
+ * of the other instances of its series: all of them when @mod is
+ * %GCAL_RECURRENCE_MOD_ALL, or only the ones starting after it when
+ * @mod is %GCAL_RECURRENCE_MOD_THIS_AND_FUTURE.
+ *
+ * Returns: (transfer container) (nullable): a #GList with the data
+ */
+GList*
+gcal_event_index_get_related (GcalEventIndex        *self,
+                              const gchar           *uid,
+                              GcalRecurrenceModType  mod)
+{
+  IndexEntry *first_entry;
+  GPtrArray *entries;
+  GList *result;
+  guint i;
+
+  g_return_val_if_fail (self != NULL, NULL);
+
+  entries = g_hash_table_lookup (self->by_uid, uid);
+  result = NULL;
+
+  if (!entries)
+    return NULL;
+
+  for (i = 0; i < entries->len; i++)
+    {
+      IndexEntry *entry = g_ptr_array_index (entries, i);
+      result = g_list_prepend (result, entry->data);
+    }
+
+  if (mod == GCAL_RECURRENCE_MOD_THIS_ONLY)
+    return result;
+
+  first_entry = g_ptr_array_index (entries, 0);
+  entries = g_hash_table_lookup (self->by_series, first_entry->series_id);
+
+  for (i = 0; entries && i < entries->len; i++)
+    {
+      IndexEntry *entry = g_ptr_array_index (entries, i);
+
+      if (g_str_equal (gcal_event_get_uid (entry->event), uid))
+        continue;
+
+      if (mod == GCAL_RECURRENCE_MOD_ALL)
+        {
+          result = g_list_prepend (result, entry->data);
+        }
+      else if (mod == GCAL_RECURRENCE_MOD_THIS_AND_FUTURE)
+        {
+          GDateTime *start = gcal_event_get_date_start (first_entry->event);
+
+          if (g_date_time_compare (start, gcal_event_get_date_start (entry->event)) < 0)
+            result = g_list_prepend (result, entry->data);
+        }
+    }
+
+  return result;
+}
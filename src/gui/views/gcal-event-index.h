@@ -0,0 +1,55 @@
+/* gcal-event-index.h
+ *
+ * Copyright 2024 Georges Basile Stavracas Neto <georges.stavracas@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <glib.h>
+
+#include "gcal-event.h"
+#include "gcal-recurrence.h"
+
+G_BEGIN_DECLS
+
+typedef struct _GcalEventIndex GcalEventIndex;
+
+GcalEventIndex*      gcal_event_index_new                        (void);
+
+void                 gcal_event_index_free                       (GcalEventIndex     *self);
+
+void                 gcal_event_index_add                        (GcalEventIndex     *self,
+                                                                  GcalEvent          *event,
+                                                                  gpointer            data);
+
+gboolean             gcal_event_index_remove                     (GcalEventIndex     *self,
+                                                                  GcalEvent          *event,
+                                                                  gpointer            data);
+
+void                 gcal_event_index_remove_all                 (GcalEventIndex     *self);
+
+GPtrArray*           gcal_event_index_lookup                     (GcalEventIndex     *self,
+                                                                  const gchar        *uid);
+
+GList*               gcal_event_index_get_related                (GcalEventIndex        *self,
+                                                                  const gchar           *uid,
+                                                                  GcalRecurrenceModType  mod);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (GcalEventIndex, gcal_event_index_free)
+
+G_END_DECLS
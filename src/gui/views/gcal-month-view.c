@@ -1453,8 +1453,13 @@ gcal_month_view_size_allocate (GtkWidget *widget,
   grid_height = height - header_height;
   row_height = grid_height / (gdouble) N_ROWS_PER_PAGE;
   row_scroll_offset = self->row_offset * row_height;
-  y_offset = header_height - row_scroll_offset - (grid_height * ((N_PAGES - 1) / 2.0));
+  y_offset = round (header_height - row_scroll_offset - (grid_height * ((N_PAGES - 1) / 2.0)));
 
+  /*
+   * Row sizes only depend on the row index, and scrolling only translates
+   * them. Rows are then not allocated again while scrolling, and GTK reuses
+   * their render nodes, so scrolling is mostly compositing.
+   */
   for (guint i = 0; i < self->week_rows->len; i++)
     {
       GtkAllocation row_allocation;
@@ -1462,12 +1467,12 @@ gcal_month_view_size_allocate (GtkWidget *widget,
 
       row = g_ptr_array_index (self->week_rows, i);
 
-#define ROW_Y(_i) (row_height * (_i) + y_offset)
+#define ROW_Y(_i) round (row_height * (_i))
 
       row_allocation.x = 0;
-      row_allocation.y = round (ROW_Y (i));
+      row_allocation.y = ROW_Y (i) + y_offset;
       row_allocation.width = width;
-      row_allocation.height = round (ROW_Y (i + 1)) - row_allocation.y;
+      row_allocation.height = ROW_Y (i + 1) - ROW_Y (i);
 
 #undef ROW_Y
 
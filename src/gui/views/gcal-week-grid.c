@@ -28,8 +28,10 @@
 #include "gcal-week-view-common.h"
 #include "gcal-utils.h"
 #include "gcal-view-private.h"
+#include "gcal-event-index.h"
 #include "gcal-event-widget.h"
 #include "gcal-range-tree.h"
+#include "gcal-timeline.h"
 
 #include <glib/gi18n.h>
 #include <string.h>
@@ -56,10 +58,20 @@ struct _GcalWeekGrid
   GtkWidget          *now_strip;
   GtkEventController *motion_controller;
 
+  /*
+   * The now strip is allocated at the top of today's column, and moved to
+   * the current time with a transform when snapshotting. That way, ticking
+   * the clock only redraws the grid instead of laying out every event.
+   */
+  gint                now_strip_column;
+
   GDateTime          *active_date;
 
   GcalRangeTree      *events;
 
+  /* uid and series → ChildData, kept in sync with the range tree */
+  GcalEventIndex     *children_index;
+
   /*
    * These fields are "cells" rather than minutes. Each cell
    * correspond to 30 minutes.
@@ -67,6 +79,27 @@ struct _GcalWeekGrid
   gint                selection_start;
   gint                selection_end;
   gint                dnd_cell;
+  gboolean            dnd_conflict;
+
+  /*
+   * The hour lines and the drag and drop highlight are cached as render
+   * nodes, so that dragging an event over the grid only moves the highlight
+   * around instead of rebuilding the whole background.
+   */
+  struct {
+    GskRenderNode    *node;
+    GtkTextDirection  direction;
+    GdkRGBA           color;
+    gint              width;
+    gint              height;
+  } lines_cache;
+
+  struct {
+    GskRenderNode    *node;
+    gdouble           width;
+    gdouble           height;
+    gboolean          conflict;
+  } dnd_cache;
 
   GcalContext        *context;
 };
@@ -119,9 +152,9 @@ uint16_compare (gconstpointer a,
   return GPOINTER_TO_UINT (*(gint*)a) - GPOINTER_TO_UINT (*(gint*)b);
 }
 
-static inline guint
-get_event_index (GcalRangeTree *tree,
-                 GcalRange     *range)
+static guint
+get_event_index_slow (GcalRangeTree *tree,
+                      GcalRange     *range)
 {
   g_autoptr (GPtrArray) array = NULL;
   gint idx, i;
@@ -136,15 +169,50 @@ get_event_index (GcalRangeTree *tree,
 
   for (i = 0; array && i < array->len; i++)
     {
-      if (idx == GPOINTER_TO_INT (g_ptr_array_index (array, i)))
+      gint column = GPOINTER_TO_INT (g_ptr_array_index (array, i));
+
+      /* Columns may repeat, since events in the same column can overlap @range */
+      if (column == idx)
         idx++;
-      else
+      else if (column > idx)
         break;
     }
 
   return idx;
 }
 
+static inline guint
+get_event_index (GcalRangeTree *tree,
+                 GcalRange     *range)
+{
+  GcalRangeTreeIter iter;
+  gpointer data;
+  guint64 used;
+  guint idx;
+
+  used = 0;
+
+  /* Columns are almost always few, so track the used ones in a bitmask */
+  gcal_range_tree_iter_init_at_range (&iter, tree, range);
+  while (gcal_range_tree_iter_next (&iter, NULL, &data))
+    {
+      guint column = GPOINTER_TO_UINT (data);
+
+      if (column >= 64)
+        return get_event_index_slow (tree, range);
+
+      used |= G_GUINT64_CONSTANT (1) << column;
+    }
+
+  for (idx = 0; idx < 64 && (used & (G_GUINT64_CONSTANT (1) << idx)); idx++)
+    ;
+
+  if (idx == 64)
+    return get_event_index_slow (tree, range);
+
+  return idx;
+}
+
 static guint
 count_overlaps_at_range (GcalRangeTree *self,
                          GcalRange     *range)
@@ -181,6 +249,104 @@ count_overlaps_at_range (GcalRangeTree *self,
   return counter;
 }
 
+static void
+snapshot_hour_lines (GcalWeekGrid  *self,
+                     GtkSnapshot   *snapshot,
+                     const GdkRGBA *color,
+                     gint           width,
+                     gint           height)
+{
+  GtkTextDirection direction;
+  GtkWidget *widget;
+
+  widget = GTK_WIDGET (self);
+  direction = gtk_widget_get_direction (widget);
+
+  if (!self->lines_cache.node ||
+      self->lines_cache.direction != direction ||
+      self->lines_cache.width != width ||
+      self->lines_cache.height != height ||
+      !gdk_rgba_equal (&self->lines_cache.color, color))
+    {
+      GtkSnapshot *lines_snapshot;
+
+      lines_snapshot = gtk_snapshot_new ();
+      gcal_week_view_common_snapshot_hour_lines (widget, lines_snapshot, GTK_ORIENTATION_HORIZONTAL, color, width, height);
+      gcal_week_view_common_snapshot_hour_lines (widget, lines_snapshot, GTK_ORIENTATION_VERTICAL, color, width, height);
+
+      g_clear_pointer (&self->lines_cache.node, gsk_render_node_unref);
+      self->lines_cache.node = gtk_snapshot_free_to_node (lines_snapshot);
+      self->lines_cache.direction = direction;
+      self->lines_cache.color = *color;
+      self->lines_cache.width = width;
+      self->lines_cache.height = height;
+    }
+
+  if (self->lines_cache.node)
+    gtk_snapshot_append_node (snapshot, self->lines_cache.node);
+}
+
+static void
+snapshot_dnd_highlight (GcalWeekGrid    *self,
+                        GtkSnapshot     *snapshot,
+                        GtkStyleContext *context,
+                        gdouble          x,
+                        gdouble          y,
+                        gdouble          width,
+                        gdouble          height)
+{
+  if (!self->dnd_cache.node ||
+      self->dnd_cache.width != width ||
+      self->dnd_cache.height != height ||
+      self->dnd_cache.conflict != self->dnd_conflict)
+    {
+      GtkSnapshot *dnd_snapshot;
+
+      gtk_style_context_save (context);
+      gtk_style_context_add_class (context, "dnd");
+
+      if (self->dnd_conflict)
+        gtk_style_context_add_class (context, "conflict");
+
+      dnd_snapshot = gtk_snapshot_new ();
+      gtk_snapshot_render_background (dnd_snapshot, context, 0, 0, width, height);
+
+      gtk_style_context_restore (context);
+
+      g_clear_pointer (&self->dnd_cache.node, gsk_render_node_unref);
+      self->dnd_cache.node = gtk_snapshot_free_to_node (dnd_snapshot);
+      self->dnd_cache.width = width;
+      self->dnd_cache.height = height;
+      self->dnd_cache.conflict = self->dnd_conflict;
+    }
+
+  if (!self->dnd_cache.node)
+    return;
+
+  gtk_snapshot_save (snapshot);
+  gtk_snapshot_translate (snapshot, &GRAPHENE_POINT_INIT (x, y));
+  gtk_snapshot_append_node (snapshot, self->dnd_cache.node);
+  gtk_snapshot_restore (snapshot);
+}
+
+static inline gint
+get_today_column (GcalWeekGrid *self)
+{
+  g_autoptr(GDateTime) week_start = NULL;
+  g_autoptr(GDateTime) today = NULL;
+  gint days_diff;
+
+  today = g_date_time_new_now_local ();
+  week_start = gcal_date_time_get_start_of_week (self->active_date);
+  days_diff = g_date_time_difference (today, week_start) / G_TIME_SPAN_DAY;
+
+  /* Today is out of range */
+  if (g_date_time_compare (today, week_start) < 0 || days_diff > 7)
+    return -1;
+
+  return days_diff;
+}
+
 /*
  * Callbacks
  */
@@ -211,6 +377,20 @@ on_click_gesture_pressed_cb (GtkGestureClick *click_gesture,
   gtk_event_controller_set_propagation_phase (self->motion_controller, GTK_PHASE_BUBBLE);
 }
 
+static void
+on_clock_minute_changed_cb (GcalClock    *clock,
+                            GcalWeekGrid *self)
+{
+  if (!self->active_date)
+    return;
+
+  /* Only relayout when the strip jumps to another column, e.g. at midnight */
+  if (get_today_column (self) != self->now_strip_column)
+    gtk_widget_queue_allocate (GTK_WIDGET (self));
+  else if (self->now_strip_column != -1)
+    gtk_widget_queue_draw (GTK_WIDGET (self));
+}
+
 static void
 on_event_widget_activated_cb (GcalEventWidget *widget,
                               GcalWeekGrid    *self)
@@ -336,18 +516,11 @@ get_dnd_cell (GcalWeekGrid *self,
   return column * 48 + row;
 }
 
-static void
-move_event_to_cell (GcalWeekGrid          *self,
-                    GcalEvent             *event,
-                    guint                  cell,
-                    GcalRecurrenceModType  mod_type)
+static GDateTime*
+get_dnd_date (GcalWeekGrid *self,
+              guint         cell)
 {
-
   g_autoptr (GDateTime) week_start = NULL;
-  g_autoptr (GDateTime) dnd_date = NULL;
-  g_autoptr (GDateTime) new_end = NULL;
-  g_autoptr (GcalEvent) changed_event = NULL;
-  GTimeSpan timespan = 0;
 
   /* RTL languages swap the drop cell column */
   if (gtk_widget_get_direction (GTK_WIDGET (self)) == GTK_TEXT_DIR_RTL)
@@ -360,9 +533,63 @@ move_event_to_cell (GcalWeekGrid          *self,
       cell = (6 - column) * 48 + row;
     }
 
-  changed_event = gcal_event_new_from_event (event);
   week_start = gcal_date_time_get_start_of_week (self->active_date);
-  dnd_date = gcal_date_time_add_floating_minutes (week_start, cell * 30);
+
+  return gcal_date_time_add_floating_minutes (week_start, cell * 30);
+}
+
+static gboolean
+has_conflicts_at_cell (GcalWeekGrid *self,
+                       GcalEvent    *event,
+                       guint         cell)
+{
+  g_autoptr (GPtrArray) overlapping_events = NULL;
+  g_autoptr (GDateTime) dnd_date = NULL;
+  g_autoptr (GDateTime) dnd_end = NULL;
+  g_autoptr (GcalRange) range = NULL;
+  GcalTimeline *timeline;
+  GTimeSpan timespan;
+  guint i;
+
+  dnd_date = get_dnd_date (self, cell);
+  timespan = g_date_time_difference (gcal_event_get_date_end (event), gcal_event_get_date_start (event));
+  dnd_end = g_date_time_add (dnd_date, timespan);
+  range = gcal_range_new (dnd_date, dnd_end, GCAL_RANGE_DEFAULT);
+
+  timeline = gcal_manager_get_timeline (gcal_context_get_manager (self->context));
+  overlapping_events = gcal_timeline_get_overlapping_events (timeline, range, NULL);
+
+  for (i = 0; overlapping_events && i < overlapping_events->len; i++)
+    {
+      GcalEvent *other_event = g_ptr_array_index (overlapping_events, i);
+
+      /* All day events don't block the time slots they span */
+      if (gcal_event_get_all_day (other_event))
+        continue;
+
+      if (g_strcmp0 (gcal_event_get_uid (other_event), gcal_event_get_uid (event)) == 0)
+        continue;
+
+      return TRUE;
+    }
+
+  return FALSE;
+}
+
+static void
+move_event_to_cell (GcalWeekGrid          *self,
+                    GcalEvent             *event,
+                    guint                  cell,
+                    GcalRecurrenceModType  mod_type)
+{
+
+  g_autoptr (GDateTime) dnd_date = NULL;
+  g_autoptr (GDateTime) new_end = NULL;
+  g_autoptr (GcalEvent) changed_event = NULL;
+  GTimeSpan timespan = 0;
+
+  changed_event = gcal_event_new_from_event (event);
+  dnd_date = get_dnd_date (self, cell);
 
   /*
    * Calculate the diff between the dropped cell and the event's start date,
@@ -449,6 +676,8 @@ on_drop_target_leave_cb (GtkDropTarget *drop_target,
   GCAL_ENTRY;
 
   self->dnd_cell = -1;
+  self->dnd_conflict = FALSE;
+  g_clear_pointer (&self->dnd_cache.node, gsk_render_node_unref);
   gtk_widget_queue_draw (GTK_WIDGET (self));
 
   GCAL_EXIT;
@@ -460,9 +689,27 @@ on_drop_target_motion_cb (GtkDropTarget *drop_target,
                          gdouble        y,
                          GcalWeekGrid  *self)
 {
+  const GValue *value;
+  gint cell;
+
   GCAL_ENTRY;
 
-  self->dnd_cell = get_dnd_cell (self, x, y);
+  cell = get_dnd_cell (self, x, y);
+
+  /* Conflicts only need to be checked again when the hovered cell changes */
+  if (cell == self->dnd_cell)
+    GCAL_RETURN (self->dnd_cell != -1 ? GDK_ACTION_COPY : 0);
+
+  value = gtk_drop_target_get_value (drop_target);
+
+  self->dnd_cell = cell;
+  self->dnd_conflict = cell != -1 &&
+                       value &&
+                       G_VALUE_HOLDS (value, GCAL_TYPE_EVENT_WIDGET) &&
+                       has_conflicts_at_cell (self,
+                                              gcal_event_widget_get_event (g_value_get_object (value)),
+                                              cell);
+
   gtk_widget_queue_draw (GTK_WIDGET (self));
 
   GCAL_RETURN (self->dnd_cell != -1 ? GDK_ACTION_COPY : 0);
@@ -473,6 +720,7 @@ gcal_week_grid_dispose (GObject *object)
 {
   GcalWeekGrid *self = GCAL_WEEK_GRID (object);
 
+  g_clear_pointer (&self->children_index, gcal_event_index_free);
   g_clear_pointer (&self->events, gcal_range_tree_unref);
   g_clear_pointer (&self->now_strip, gtk_widget_unparent);
 
@@ -485,6 +733,8 @@ gcal_week_grid_finalize (GObject *object)
   GcalWeekGrid *self = GCAL_WEEK_GRID (object);
 
   gcal_clear_date_time (&self->active_date);
+  g_clear_pointer (&self->lines_cache.node, gsk_render_node_unref);
+  g_clear_pointer (&self->dnd_cache.node, gsk_render_node_unref);
 
   G_OBJECT_CLASS (gcal_week_grid_parent_class)->finalize (object);
 }
@@ -507,22 +757,17 @@ gcal_week_grid_set_property (GObject      *object,
   G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 }
 
-static inline gint
-get_today_column (GcalWeekGrid *self)
+static void
+gcal_week_grid_css_changed (GtkWidget         *widget,
+                            GtkCssStyleChange *change)
 {
-  g_autoptr(GDateTime) week_start = NULL;
-  g_autoptr(GDateTime) today = NULL;
-  gint days_diff;
-
-  today = g_date_time_new_now_local ();
-  week_start = gcal_date_time_get_start_of_week (self->active_date);
-  days_diff = g_date_time_difference (today, week_start) / G_TIME_SPAN_DAY;
+  GcalWeekGrid *self = GCAL_WEEK_GRID (widget);
 
-  /* Today is out of range */
-  if (g_date_time_compare (today, week_start) < 0 || days_diff > 7)
-    return -1;
+  GTK_WIDGET_CLASS (gcal_week_grid_parent_class)->css_changed (widget, change);
 
-  return days_diff;
+  /* The cached nodes depend on style properties that are not part of their keys */
+  g_clear_pointer (&self->lines_cache.node, gsk_render_node_unref);
+  g_clear_pointer (&self->dnd_cache.node, gsk_render_node_unref);
 }
 
 static void
@@ -661,21 +906,16 @@ gcal_week_grid_snapshot (GtkWidget   *widget,
       column = self->dnd_cell / (MINUTES_PER_DAY / 30);
       row = self->dnd_cell - column * 48;
 
-      gtk_style_context_save (context);
-      gtk_style_context_add_class (context, "dnd");
-
-      gtk_snapshot_render_background (snapshot,
-                                      context,
-                                      column * column_width,
-                                      row * cell_height,
-                                      column_width,
-                                      cell_height);
-
-      gtk_style_context_restore (context);
+      snapshot_dnd_highlight (self,
+                              snapshot,
+                              context,
+                              column * column_width,
+                              row * cell_height,
+                              column_width,
+                              cell_height);
     }
 
-  gcal_week_view_common_snapshot_hour_lines (widget, snapshot, GTK_ORIENTATION_HORIZONTAL, &color, width, height);
-  gcal_week_view_common_snapshot_hour_lines (widget, snapshot, GTK_ORIENTATION_VERTICAL, &color, width, height);
+  snapshot_hour_lines (self, snapshot, &color, width, height);
 
   gtk_style_context_restore (context);
 
@@ -687,7 +927,19 @@ gcal_week_grid_snapshot (GtkWidget   *widget,
       gtk_widget_snapshot_child (widget, child_data->widget, snapshot);
     }
 
-  gtk_widget_snapshot_child (widget, self->now_strip, snapshot);
+  if (self->now_strip_column != -1)
+    {
+      g_autoptr (GDateTime) now = NULL;
+      guint minutes_from_midnight;
+
+      now = g_date_time_new_now_local ();
+      minutes_from_midnight = g_date_time_get_hour (now) * 60 + g_date_time_get_minute (now);
+
+      gtk_snapshot_save (snapshot);
+      gtk_snapshot_translate (snapshot, &GRAPHENE_POINT_INIT (0, round (minutes_from_midnight * minutes_height)));
+      gtk_widget_snapshot_child (widget, self->now_strip, snapshot);
+      gtk_snapshot_restore (snapshot);
+    }
 }
 
 static void
@@ -808,18 +1060,14 @@ gcal_week_grid_size_allocate (GtkWidget *widget,
   /* Today column */
   today_column = get_today_column (GCAL_WEEK_GRID (widget));
 
+  self->now_strip_column = today_column;
   gtk_widget_set_child_visible (self->now_strip, today_column != -1);
 
   if (today_column != -1)
     {
-      g_autoptr (GDateTime) now = NULL;
       GtkAllocation allocation;
-      guint minutes_from_midnight;
       gint now_strip_height;
 
-      now = g_date_time_new_now_local ();
-      minutes_from_midnight = g_date_time_get_hour (now) * 60 + g_date_time_get_minute (now);
-
       gtk_widget_measure (self->now_strip,
                           GTK_ORIENTATION_VERTICAL,
                           -1,
@@ -834,7 +1082,7 @@ gcal_week_grid_size_allocate (GtkWidget *widget,
         x = width - (today_column * column_width) - column_width;
 
       allocation.x = x;
-      allocation.y = round (minutes_from_midnight * ((gdouble) height / MINUTES_PER_DAY));
+      allocation.y = 0;
       allocation.width = column_width;
       allocation.height = MAX (1, now_strip_height);
 
@@ -853,6 +1101,7 @@ gcal_week_grid_class_init (GcalWeekGridClass *klass)
   object_class->get_property = gcal_week_grid_get_property;
   object_class->set_property = gcal_week_grid_set_property;
 
+  widget_class->css_changed = gcal_week_grid_css_changed;
   widget_class->measure = gcal_week_grid_measure;
   widget_class->size_allocate = gcal_week_grid_size_allocate;
   widget_class->snapshot = gcal_week_grid_snapshot;
@@ -877,8 +1126,10 @@ gcal_week_grid_init (GcalWeekGrid *self)
   self->selection_start = -1;
   self->selection_end = -1;
   self->dnd_cell = -1;
+  self->now_strip_column = -1;
 
   self->events = gcal_range_tree_new_with_free_func (child_data_free);
+  self->children_index = gcal_event_index_new ();
 
   self->now_strip = adw_bin_new ();
   gtk_widget_add_css_class (self->now_strip, "now-strip");
@@ -897,6 +1148,7 @@ gcal_week_grid_init (GcalWeekGrid *self)
   gtk_widget_add_controller (GTK_WIDGET (self), self->motion_controller);
 
   drop_target = gtk_drop_target_new (GCAL_TYPE_EVENT_WIDGET, GDK_ACTION_COPY);
+  gtk_drop_target_set_preload (drop_target, TRUE);
   g_signal_connect (drop_target, "drop", G_CALLBACK (on_drop_target_drop_cb), self);
   g_signal_connect (drop_target, "leave", G_CALLBACK (on_drop_target_leave_cb), self);
   g_signal_connect (drop_target, "motion", G_CALLBACK (on_drop_target_motion_cb), self);
@@ -914,9 +1166,9 @@ gcal_week_grid_set_context (GcalWeekGrid *self,
 
   g_signal_connect_object (gcal_context_get_clock (context),
                            "minute-changed",
-                           G_CALLBACK (gtk_widget_queue_resize),
-                           self->now_strip,
-                           G_CONNECT_SWAPPED);
+                           G_CALLBACK (on_clock_minute_changed_cb),
+                           self,
+                           0);
 }
 
 void
@@ -924,6 +1176,7 @@ gcal_week_grid_add_event (GcalWeekGrid *self,
                           GcalEvent    *event)
 {
   GtkWidget *widget;
+  ChildData *data;
 
   g_return_if_fail (GCAL_IS_WEEK_GRID (self));
 
@@ -936,9 +1189,10 @@ gcal_week_grid_add_event (GcalWeekGrid *self,
                          "timestamp-policy", GCAL_TIMESTAMP_POLICY_START,
                          NULL);
 
-  gcal_range_tree_add_range (self->events,
-                             gcal_event_get_range (event),
-                             child_data_new (widget, event));
+  data = child_data_new (widget, event);
+
+  gcal_range_tree_add_range (self->events, gcal_event_get_range (event), data);
+  gcal_event_index_add (self->children_index, event, data);
 
   g_signal_connect (widget, "activate", G_CALLBACK (on_event_widget_activated_cb), self);
 
@@ -949,25 +1203,19 @@ void
 gcal_week_grid_remove_event (GcalWeekGrid *self,
                              const gchar  *uid)
 {
-  g_autoptr (GPtrArray) widgets = NULL;
+  g_autoptr (GPtrArray) children = NULL;
   guint i;
 
   g_return_if_fail (GCAL_IS_WEEK_GRID (self));
 
-  widgets = gcal_range_tree_get_all_data (self->events);
+  children = gcal_event_index_lookup (self->children_index, uid);
 
-  for (i = 0; widgets && i < widgets->len; i++)
+  for (i = 0; children && i < children->len; i++)
     {
-      ChildData *data;
-      GcalEvent *event;
-
-      data = g_ptr_array_index (widgets, i);
-      event = gcal_event_widget_get_event (GCAL_EVENT_WIDGET (data->widget));
+      ChildData *data = g_ptr_array_index (children, i);
 
-      if (g_strcmp0 (gcal_event_get_uid (event), uid) != 0)
-        continue;
-
-      gcal_range_tree_remove_range (self->events, gcal_event_get_range (event), data);
+      gcal_event_index_remove (self->children_index, data->event, data);
+      gcal_range_tree_remove_range (self->events, gcal_event_get_range (data->event), data);
       gtk_widget_queue_allocate (GTK_WIDGET (self));
     }
 }
@@ -978,10 +1226,14 @@ gcal_week_grid_get_children_by_uuid (GcalWeekGrid          *self,
                                      const gchar           *uid)
 {
   g_autoptr (GList) result = NULL;
+  GList *l;
 
   GCAL_ENTRY;
 
-  result = filter_children_by_uid_and_modtype (GTK_WIDGET (self), mod, uid);
+  result = gcal_event_index_get_related (self->children_index, uid, mod);
+
+  for (l = result; l; l = l->next)
+    l->data = ((ChildData *) l->data)->widget;
 
   GCAL_RETURN (g_steal_pointer (&result));
 }
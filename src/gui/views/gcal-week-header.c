@@ -25,6 +25,7 @@
 #include "gcal-context.h"
 #include "gcal-clock.h"
 #include "gcal-debug.h"
+#include "gcal-event-index.h"
 #include "gcal-event-widget.h"
 #include "gcal-utils.h"
 #include "gcal-view-private.h"
@@ -91,6 +92,10 @@ struct _GcalWeekHeader
    */
   GList              *events[7];
   GtkWidget          *overflow_label[7];
+
+  /* uid → GcalEvent, and uid/series → event widgets in the grid */
+  GHashTable         *events_by_uid;
+  GcalEventIndex     *widgets_index;
   WeekdayHeader       weekday_header[7];
 
   gint                first_weekday;
@@ -231,6 +236,10 @@ static inline void
 setup_event_widget (GcalWeekHeader *self,
                     GtkWidget      *widget)
 {
+  gcal_event_index_add (self->widgets_index,
+                        gcal_event_widget_get_event (GCAL_EVENT_WIDGET (widget)),
+                        widget);
+
   gtk_widget_set_margin_end (widget, 6);
   g_signal_connect_object (widget, "activate", G_CALLBACK (on_event_widget_activated), self, 0);
 }
@@ -239,6 +248,10 @@ static inline void
 destroy_event_widget (GcalWeekHeader *self,
                       GtkWidget      *widget)
 {
+  gcal_event_index_remove (self->widgets_index,
+                           gcal_event_widget_get_event (GCAL_EVENT_WIDGET (widget)),
+                           widget);
+
   g_signal_handlers_disconnect_by_func (widget, on_event_widget_activated, self);
   gtk_grid_remove (self->grid, widget);
 }
@@ -366,26 +379,6 @@ on_weather_update (GcalWeatherService *weather_service,
   update_weather_infos (self);
 }
 
-static GcalEvent*
-get_event_by_uuid (GcalWeekHeader *self,
-                   const gchar    *uuid)
-{
-  gint weekday;
-
-  for (weekday = 0; weekday < 7; weekday++)
-    {
-      GList *l;
-
-      for (l = self->events[weekday]; l != NULL; l = l->next)
-        {
-          if (g_strcmp0 (gcal_event_get_uid (l->data), uuid) == 0)
-            return l->data;
-        }
-    }
-
-  return NULL;
-}
-
 static inline gint
 get_today_column (GcalWeekHeader *self)
 {
@@ -790,6 +783,8 @@ add_event_to_grid (GcalWeekHeader *self,
   /* Take a reference to the event */
   g_object_ref (event);
 
+  g_hash_table_insert (self->events_by_uid, g_strdup (gcal_event_get_uid (event)), event);
+
   /* Add at least at the first weekday */
   position = add_event_to_weekday (self, event, start);
 
@@ -1307,9 +1302,17 @@ on_drop_target_motion_cb (GtkDropTarget  *drop_target,
                           gdouble         y,
                           GcalWeekHeader *self)
 {
+  gint cell;
+
   GCAL_ENTRY;
 
-  self->dnd_cell = get_dnd_cell (self, x, y);
+  cell = get_dnd_cell (self, x, y);
+
+  /* Only redraw when the highlight actually moves */
+  if (cell == self->dnd_cell)
+    GCAL_RETURN (self->dnd_cell != -1 ? GDK_ACTION_COPY : 0);
+
+  self->dnd_cell = cell;
   gtk_widget_queue_draw (GTK_WIDGET (self));
 
   GCAL_RETURN (self->dnd_cell != -1 ? GDK_ACTION_COPY : 0);
@@ -1453,6 +1456,9 @@ gcal_week_header_finalize (GObject *object)
   for (i = 0; i < 7; i++)
     g_list_free (self->events[i]);
 
+  g_clear_pointer (&self->events_by_uid, g_hash_table_destroy);
+  g_clear_pointer (&self->widgets_index, gcal_event_index_free);
+
   for (i = 0; i < G_N_ELEMENTS (self->weather_infos); i++)
     wid_clear (&self->weather_infos[i]);
 
@@ -1510,6 +1516,8 @@ gcal_week_header_init (GcalWeekHeader *self)
   self->selection_end = -1;
   self->dnd_cell = -1;
   self->first_weekday = get_first_weekday ();
+  self->events_by_uid = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  self->widgets_index = gcal_event_index_new ();
 
   gtk_widget_init_template (GTK_WIDGET (self));
 
@@ -1658,35 +1666,23 @@ gcal_week_header_remove_event (GcalWeekHeader *self,
                                const gchar    *uuid)
 {
   g_autoptr (GcalEvent) removed_event = NULL;
-  GtkWidget *child;
+  g_autoptr (GPtrArray) widgets = NULL;
   gint weekday;
+  guint i;
 
   g_return_if_fail (GCAL_IS_WEEK_HEADER (self));
 
-  removed_event = get_event_by_uuid (self, uuid);
+  removed_event = g_hash_table_lookup (self->events_by_uid, uuid);
 
   if (!removed_event)
     return;
 
-  child = gtk_widget_get_first_child (GTK_WIDGET (self->grid));
-  while (child)
-    {
-      GtkWidget *next = gtk_widget_get_next_sibling (child);
-
-      if (GCAL_IS_EVENT_WIDGET (child))
-        {
-          GcalEventWidget *child_widget;
-          GcalEvent *event;
+  g_hash_table_remove (self->events_by_uid, uuid);
 
-          child_widget = GCAL_EVENT_WIDGET (child);
-          event = gcal_event_widget_get_event (child_widget);
+  widgets = gcal_event_index_lookup (self->widgets_index, uuid);
 
-          if (g_strcmp0 (uuid, gcal_event_get_uid (event)) == 0)
-            destroy_event_widget (self, child);
-        }
-
-      child = next;
-    }
+  for (i = 0; widgets && i < widgets->len; i++)
+    destroy_event_widget (self, g_ptr_array_index (widgets, i));
 
   /* Remove from the weekday's GList */
   for (weekday = 0; weekday < 7; weekday++)
@@ -1720,11 +1716,11 @@ gcal_week_header_get_children_by_uuid (GcalWeekHeader        *self,
                                        GcalRecurrenceModType  mod,
                                        const gchar           *uuid)
 {
-  g_autolist (GcalEventWidget) result = NULL;
+  g_autoptr (GList) result = NULL;
 
   GCAL_ENTRY;
 
-  result = filter_children_by_uid_and_modtype (GTK_WIDGET (self->grid), mod, uuid);
+  result = gcal_event_index_get_related (self->widgets_index, uuid, mod);
 
   GCAL_RETURN (g_steal_pointer (&result));
 }
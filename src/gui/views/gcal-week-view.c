@@ -60,6 +60,24 @@ struct _GcalWeekView
 
   gdouble             initial_zoom_level;
   gdouble             zoom_level;
+
+  /*
+   * While a zoom gesture is running, the content is scaled around
+   * the gesture center when snapshotting, and only relaid out at
+   * the final zoom level once the gesture ends. The content is drawn
+   * through a paintable, which isn't clipped to the viewport, so that
+   * zooming out reveals the rows above and below it.
+   */
+  gboolean            zoom_preview;
+  gdouble             zoom_preview_center_y;
+  GdkPaintable       *zoom_preview_paintable;
+
+  /*
+   * Only touchpads and trackpoints emit scroll-begin and scroll-end. Smooth
+   * scroll events from other devices, like high resolution mouse wheels,
+   * never end a preview, so they are applied right away.
+   */
+  gboolean            scroll_gesture_active;
 };
 
 static void          stack_visible_child_changed_cb              (AdwViewStack       *stack,
@@ -184,16 +202,27 @@ begin_zoom (GcalWeekView *self,
 }
 
 static void
-apply_zoom (GcalWeekView *self,
-            gdouble       view_center_y,
-            gdouble       scale)
+set_zoom_level_from_scale (GcalWeekView *self,
+                           gdouble       scale)
 {
-  GtkAdjustment *vadjustment;
-  gdouble height;
-
   self->zoom_level = CLAMP (self->initial_zoom_level + (scale - 1.0),
                             MIN_ZOOM_LEVEL,
                             MAX_ZOOM_LEVEL);
+}
+
+static void
+relayout_zoom (GcalWeekView *self,
+               gdouble       view_center_y)
+{
+  GtkAdjustment *vadjustment;
+  gdouble height;
+
+  if (self->zoom_preview)
+    {
+      self->zoom_preview = FALSE;
+      g_clear_object (&self->zoom_preview_paintable);
+      gtk_widget_queue_draw (GTK_WIDGET (self));
+    }
 
   vadjustment = gtk_scrolled_window_get_vadjustment (GTK_SCROLLED_WINDOW (self->scrolled_window));
 
@@ -205,6 +234,38 @@ apply_zoom (GcalWeekView *self,
   gtk_adjustment_set_value (vadjustment, (self->gesture_zoom_center * height) - view_center_y);
 }
 
+static void
+apply_zoom (GcalWeekView *self,
+            gdouble       view_center_y,
+            gdouble       scale)
+{
+  set_zoom_level_from_scale (self, scale);
+  relayout_zoom (self, view_center_y);
+}
+
+static void
+preview_zoom (GcalWeekView *self,
+              gdouble       view_center_y,
+              gdouble       scale)
+{
+  set_zoom_level_from_scale (self, scale);
+
+  self->zoom_preview = TRUE;
+  self->zoom_preview_center_y = view_center_y;
+
+  if (!self->zoom_preview_paintable)
+    self->zoom_preview_paintable = gtk_widget_paintable_new (self->content);
+
+  gtk_widget_queue_draw (GTK_WIDGET (self));
+}
+
+static void
+end_zoom (GcalWeekView *self)
+{
+  if (self->zoom_preview)
+    relayout_zoom (self, self->zoom_preview_center_y);
+}
+
 static void
 save_zoom_level (GcalWeekView *self)
 {
@@ -277,6 +338,8 @@ on_scroll_controller_scroll_begin_cb (GtkEventControllerScroll *controller,
   else
     view_center_y = gtk_widget_get_height (self->scrolled_window) / 2.0;
 
+  self->scroll_gesture_active = TRUE;
+
   begin_zoom (self, view_center_y);
 }
 
@@ -300,7 +363,7 @@ on_scroll_controller_scroll_cb (GtkEventControllerScroll *controller,
     {
     case GDK_SCROLL_SMOOTH:
       scale = dy / 100.0 + 1.0;
-      discrete = FALSE;
+      discrete = !self->scroll_gesture_active;
       break;
 
     case GDK_SCROLL_UP:
@@ -321,12 +384,15 @@ on_scroll_controller_scroll_cb (GtkEventControllerScroll *controller,
     view_center_y = gtk_widget_get_height (self->scrolled_window) / 2.0;
 
   if (discrete)
-    begin_zoom (self, view_center_y);
-
-  apply_zoom (self, view_center_y, scale);
-
-  if (discrete)
-    save_zoom_level (self);
+    {
+      begin_zoom (self, view_center_y);
+      apply_zoom (self, view_center_y, scale);
+      save_zoom_level (self);
+    }
+  else
+    {
+      preview_zoom (self, view_center_y, scale);
+    }
 
   return TRUE;
 }
@@ -335,6 +401,9 @@ static void
 on_scroll_controller_scroll_end_cb (GtkEventControllerScroll *controller,
                                     GcalWeekView             *self)
 {
+  self->scroll_gesture_active = FALSE;
+
+  end_zoom (self);
   save_zoom_level (self);
 }
 
@@ -347,7 +416,7 @@ on_zoom_gesture_scale_changed_cb (GtkGestureZoom *gesture,
 
   gtk_gesture_get_bounding_box_center (GTK_GESTURE (gesture), &view_center_x, &view_center_y);
 
-  apply_zoom (self, view_center_y, scale);
+  preview_zoom (self, view_center_y, scale);
 }
 
 static void
@@ -367,6 +436,7 @@ on_zoom_gesture_end_cb (GtkGesture       *gesture,
                         GdkEventSequence *sequence,
                         GcalWeekView     *self)
 {
+  end_zoom (self);
   save_zoom_level (self);
 }
 
@@ -558,6 +628,7 @@ gcal_week_view_finalize (GObject       *object)
 
   g_clear_pointer (&self->date, g_date_time_unref);
 
+  g_clear_object (&self->zoom_preview_paintable);
   g_clear_object (&self->context);
 
   /* Chain up to parent's finalize() method. */
@@ -621,6 +692,69 @@ gcal_week_view_get_property (GObject       *object,
     }
 }
 
+
+/*
+ * GtkWidget overrides
+ */
+
+static void
+gcal_week_view_snapshot (GtkWidget   *widget,
+                         GtkSnapshot *snapshot)
+{
+  GcalWeekView *self = GCAL_WEEK_VIEW (widget);
+  graphene_point_t content_origin;
+  graphene_point_t center;
+  graphene_rect_t bounds;
+  GtkWidget *child;
+  gdouble content_height;
+  gdouble content_width;
+  gdouble scale;
+
+  content_height = gtk_widget_get_height (self->content);
+  content_width = gtk_widget_get_width (self->content);
+
+  if (!self->zoom_preview ||
+      !self->zoom_preview_paintable ||
+      content_height <= 0 ||
+      !gtk_widget_compute_bounds (self->scrolled_window, widget, &bounds) ||
+      !gtk_widget_compute_point (self->content, widget, &GRAPHENE_POINT_INIT (0, 0), &content_origin) ||
+      !gtk_widget_compute_point (self->scrolled_window,
+                                 widget,
+                                 &GRAPHENE_POINT_INIT (0, self->zoom_preview_center_y),
+                                 &center))
+    {
+      GTK_WIDGET_CLASS (gcal_week_view_parent_class)->snapshot (widget, snapshot);
+      return;
+    }
+
+  scale = HEIGHT_DEFAULT * self->zoom_level / content_height;
+
+  for (child = gtk_widget_get_first_child (widget);
+       child;
+       child = gtk_widget_get_next_sibling (child))
+    {
+      if (child != self->scrolled_window)
+        {
+          gtk_widget_snapshot_child (widget, child, snapshot);
+          continue;
+        }
+
+      /*
+       * Scale the already rendered content around the gesture center. The
+       * transform applies to the content itself, inside the clip of the
+       * scrolled window, instead of to the scrolled window and its clip.
+       */
+      gtk_snapshot_push_clip (snapshot, &bounds);
+      gtk_snapshot_save (snapshot);
+      gtk_snapshot_translate (snapshot, &GRAPHENE_POINT_INIT (0, center.y));
+      gtk_snapshot_scale (snapshot, 1.0, scale);
+      gtk_snapshot_translate (snapshot, &GRAPHENE_POINT_INIT (content_origin.x, content_origin.y - center.y));
+      gdk_paintable_snapshot (self->zoom_preview_paintable, snapshot, content_width, content_height);
+      gtk_snapshot_restore (snapshot);
+      gtk_snapshot_pop (snapshot);
+    }
+}
+
 static void
 gcal_week_view_class_init (GcalWeekViewClass *klass)
 {
@@ -635,6 +769,8 @@ gcal_week_view_class_init (GcalWeekViewClass *klass)
   object_class->set_property = gcal_week_view_set_property;
   object_class->get_property = gcal_week_view_get_property;
 
+  widget_class->snapshot = gcal_week_view_snapshot;
+
   g_object_class_override_property (object_class, PROP_DATE, "active-date");
   g_object_class_override_property (object_class, PROP_CONTEXT, "context");
 
@@ -25,15 +25,33 @@
 #include "gcal-debug.h"
 #include "gcal-search-engine.h"
 #include "gcal-search-model.h"
+#include "gcal-search-ranker.h"
 #include "gcal-timeline.h"
 #include "gcal-timeline-subscriber.h"
 
+#define INITIAL_HORIZON_DAYS 14
+#define DAYS_PER_YEAR        365
+
 struct _GcalSearchEngine
 {
   GObject             parent;
 
   GcalTimeline       *timeline;
 
+  /*
+   * The running search. It starts with a range of INITIAL_HORIZON_DAYS
+   * around now, and doubles it every time the timeline completes loading,
+   * up to the limit set in GSettings.
+   */
+  GcalSearchModel    *model;
+  GCancellable       *cancellable;
+  gulong              cancelled_id;
+  GDateTime          *search_now;
+  guint               horizon_days;
+
+  /* The last ranker, to reuse its tokenized texts */
+  GcalSearchRanker   *ranker;
+
   GcalContext        *context;
 };
 
@@ -49,6 +67,68 @@ enum
 static GParamSpec *properties [N_PROPS];
 
 
+/*
+ * Auxiliary methods
+ */
+
+static void
+stop_search (GcalSearchEngine *self)
+{
+  if (!self->model)
+    return;
+
+  g_debug ("Stopping search at a horizon of %u days", self->horizon_days);
+
+  gcal_timeline_remove_subscriber (self->timeline, GCAL_TIMELINE_SUBSCRIBER (self->model));
+
+  if (self->cancellable)
+    g_cancellable_disconnect (self->cancellable, self->cancelled_id);
+  self->cancelled_id = 0;
+
+  g_clear_object (&self->model);
+  g_clear_object (&self->cancellable);
+  gcal_clear_date_time (&self->search_now);
+  self->horizon_days = 0;
+}
+
+static void
+free_weak_ref (GWeakRef *weak_ref)
+{
+  g_weak_ref_clear (weak_ref);
+  g_free (weak_ref);
+}
+
+static void
+widen_search_horizon (GcalSearchEngine *self)
+{
+  g_autoptr (GDateTime) range_start = NULL;
+  g_autoptr (GDateTime) range_end = NULL;
+  GSettings *settings;
+  guint max_horizon_days;
+
+  GCAL_ENTRY;
+
+  settings = gcal_context_get_settings (self->context);
+  max_horizon_days = g_settings_get_uint (settings, "search-horizon-limit") * DAYS_PER_YEAR;
+
+  if (self->horizon_days >= max_horizon_days)
+    {
+      GCAL_TRACE_MSG ("Search reached its maximum horizon of %u days", max_horizon_days);
+      GCAL_RETURN ();
+    }
+
+  self->horizon_days = MIN (self->horizon_days * 2, max_horizon_days);
+
+  g_debug ("Widening search horizon to %u days", self->horizon_days);
+
+  range_start = g_date_time_add_days (self->search_now, -(gint) self->horizon_days);
+  range_end = g_date_time_add_days (self->search_now, self->horizon_days);
+  gcal_search_model_set_range (self->model, range_start, range_end);
+
+  GCAL_EXIT;
+}
+
+
 /*
  * Callbacks
  */
@@ -73,6 +153,53 @@ on_manager_calendar_removed_cb (GcalManager      *manager,
   gcal_timeline_remove_calendar (self->timeline, calendar);
 }
 
+static gboolean
+stop_cancelled_search_cb (gpointer user_data)
+{
+  GcalSearchEngine *self = GCAL_SEARCH_ENGINE (user_data);
+
+  /* Another search may have started in the meantime */
+  if (self->cancellable && g_cancellable_is_cancelled (self->cancellable))
+    stop_search (self);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+on_search_cancelled_cb (GCancellable *cancellable,
+                        GWeakRef     *weak_ref)
+{
+  g_autoptr (GcalSearchEngine) self = NULL;
+
+  self = g_weak_ref_get (weak_ref);
+  if (!self)
+    return;
+
+  /*
+   * Cancellables can be cancelled from any thread, and handlers cannot
+   * disconnect themselves, so the search is stopped from the main loop.
+   */
+  g_idle_add_full (G_PRIORITY_DEFAULT, stop_cancelled_search_cb, g_steal_pointer (&self), g_object_unref);
+}
+
+static void
+on_timeline_complete_changed_cb (GcalTimeline     *timeline,
+                                 GParamSpec       *pspec,
+                                 GcalSearchEngine *self)
+{
+  if (!self->model || !gcal_timeline_is_complete (timeline))
+    return;
+
+  if (self->cancellable && g_cancellable_is_cancelled (self->cancellable))
+    {
+      stop_search (self);
+      return;
+    }
+
+  /* The current stage is loaded, move on to the next one */
+  widen_search_horizon (self);
+}
+
 static void
 search_model_hits_cb (GObject      *source,
                       GAsyncResult *result,
@@ -108,8 +235,11 @@ gcal_search_engine_finalize (GObject *object)
 {
   GcalSearchEngine *self = (GcalSearchEngine *)object;
 
+  stop_search (self);
+
   g_clear_object (&self->context);
   g_clear_object (&self->timeline);
+  g_clear_pointer (&self->ranker, gcal_search_ranker_unref);
 
   G_OBJECT_CLASS (gcal_search_engine_parent_class)->finalize (object);
 }
@@ -124,6 +254,7 @@ gcal_search_engine_constructed (GObject *object)
 
   /* Setup the data model */
   self->timeline = gcal_timeline_new (self->context);
+  g_signal_connect_object (self->timeline, "notify::complete", G_CALLBACK (on_timeline_complete_changed_cb), self, 0);
 
   manager = gcal_context_get_manager (self->context);
   g_signal_connect_object (manager, "calendar-added", G_CALLBACK (on_manager_calendar_added_cb), self, 0);
@@ -208,28 +339,61 @@ gcal_search_engine_new (GcalContext *context)
 
 void
 gcal_search_engine_search (GcalSearchEngine    *self,
-                           const gchar         *search_query,
+                           const gchar         *search_text,
                            GCancellable        *cancellable,
                            GAsyncReadyCallback  callback,
                            gpointer             user_data)
 {
+  g_autoptr (GcalSearchRanker) ranker = NULL;
   g_autoptr (GcalSearchModel) model = NULL;
   g_autoptr (GDateTime) range_start = NULL;
   g_autoptr (GDateTime) range_end = NULL;
+  g_autofree gchar *sexp_query = NULL;
   g_autoptr (GDateTime) now = NULL;
   g_autoptr (GTask) task = NULL;
   GTimeZone *timezone;
 
   g_return_if_fail (GCAL_IS_SEARCH_ENGINE (self));
+  g_return_if_fail (search_text != NULL);
   g_return_if_fail (!cancellable || G_IS_CANCELLABLE (cancellable));
 
+  /* The timeline filter is shared, so only one search runs at a time */
+  stop_search (self);
+
   timezone = gcal_context_get_timezone (self->context);
   now = g_date_time_new_now (timezone);
-  range_start = g_date_time_add_months (now, -6);
-  range_end = g_date_time_add_months (now, 6);
-  model = gcal_search_model_new (cancellable, range_start, range_end);
+  range_start = g_date_time_add_days (now, -INITIAL_HORIZON_DAYS);
+  range_end = g_date_time_add_days (now, INITIAL_HORIZON_DAYS);
+
+  ranker = gcal_search_ranker_new (search_text, now, self->ranker);
+  g_clear_pointer (&self->ranker, gcal_search_ranker_unref);
+  self->ranker = gcal_search_ranker_ref (ranker);
+
+  model = gcal_search_model_new (cancellable, ranker, range_start, range_end);
+
+  sexp_query = g_strdup_printf ("(or (contains? \"summary\" \"%s\") (contains? \"location\" \"%s\") (contains? \"description\" \"%s\"))",
+                                search_text,
+                                search_text,
+                                search_text);
+
+  self->model = g_object_ref (model);
+  self->cancellable = cancellable ? g_object_ref (cancellable) : NULL;
+  self->search_now = g_date_time_ref (now);
+  self->horizon_days = INITIAL_HORIZON_DAYS;
+
+  /* Tear the search down as soon as it's cancelled, not when the timeline completes */
+  if (cancellable)
+    {
+      GWeakRef *weak_ref = g_new0 (GWeakRef, 1);
+
+      g_weak_ref_init (weak_ref, self);
+      self->cancelled_id = g_cancellable_connect (cancellable,
+                                                  G_CALLBACK (on_search_cancelled_cb),
+                                                  weak_ref,
+                                                  (GDestroyNotify) free_weak_ref);
+    }
 
-  gcal_timeline_set_filter (self->timeline, search_query);
+  gcal_timeline_set_filter (self->timeline, sexp_query);
   gcal_timeline_add_subscriber (self->timeline, GCAL_TIMELINE_SUBSCRIBER (model));
 
   task = g_task_new (self, cancellable, callback, user_data);
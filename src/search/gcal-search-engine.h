@@ -32,7 +32,7 @@ G_DECLARE_FINAL_TYPE (GcalSearchEngine, gcal_search_engine, GCAL, SEARCH_ENGINE,
 GcalSearchEngine*    gcal_search_engine_new                      (GcalContext        *context);
 
 void                 gcal_search_engine_search                   (GcalSearchEngine   *self,
-                                                                  const gchar        *search_query,
+                                                                  const gchar        *search_text,
                                                                   GCancellable       *cancellable,
                                                                   GAsyncReadyCallback callback,
                                                                   gpointer            user_data);
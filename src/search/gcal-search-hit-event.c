@@ -20,6 +20,10 @@
 
 #define G_LOG_DOMAIN "GcalSearchHitEvent"
 
+#include "config.h"
+
+#include <glib/gi18n.h>
+
 #include "gcal-search-hit.h"
 #include "gcal-search-hit-event.h"
 #include "gcal-utils.h"
@@ -29,6 +33,7 @@ struct _GcalSearchHitEvent
   GcalSearchHit       parent;
 
   GcalEvent          *event;
+  guint               n_instances;
 };
 
 G_DEFINE_TYPE (GcalSearchHitEvent, gcal_search_hit_event, GCAL_TYPE_SEARCH_HIT)
@@ -37,6 +42,7 @@ enum
 {
   PROP_0,
   PROP_EVENT,
+  PROP_N_INSTANCES,
   N_PROPS,
 };
 
@@ -46,12 +52,33 @@ static GParamSpec *properties [N_PROPS];
  * Auxiliary methods
  */
 
+static void
+update_subtitle (GcalSearchHitEvent *self)
+{
+  g_autofree gchar *date_string = NULL;
+  g_autofree gchar *subtitle = NULL;
+
+  date_string = gcal_event_format_date (self->event);
+
+  if (self->n_instances > 1)
+    {
+      /* Translators: %1$s is the date of the next occurrence of a recurring event, %2$u is the number of occurrences found */
+      subtitle = g_strdup_printf (g_dngettext (GETTEXT_PACKAGE,
+                                               "%1$s (%2$u occurrence)",
+                                               "%1$s (%2$u occurrences)",
+                                               self->n_instances),
+                                  date_string,
+                                  self->n_instances);
+    }
+
+  gcal_search_hit_set_subtitle (GCAL_SEARCH_HIT (self), subtitle ? subtitle : date_string);
+}
+
 static void
 set_event (GcalSearchHitEvent *self,
            GcalEvent          *event)
 {
   g_autoptr (GdkPaintable) paintable = NULL;
-  g_autofree gchar *date_string = NULL;
   GcalSearchHit *search_hit;
   const GdkRGBA *color;
   GcalCalendar *calendar;
@@ -62,8 +89,7 @@ set_event (GcalSearchHitEvent *self,
   gcal_search_hit_set_id (search_hit, gcal_event_get_uid (event));
   gcal_search_hit_set_title (search_hit, gcal_event_get_summary (event));
 
-  date_string = gcal_event_format_date (event);
-  gcal_search_hit_set_subtitle (search_hit, date_string);
+  update_subtitle (self);
 
   calendar = gcal_event_get_calendar (self->event);
   color = gcal_calendar_get_color (calendar);
@@ -158,6 +184,10 @@ gcal_search_hit_event_get_property (GObject    *object,
       g_value_set_object (value, self->event);
       break;
 
+    case PROP_N_INSTANCES:
+      g_value_set_uint (value, self->n_instances);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
     }
@@ -178,6 +208,10 @@ gcal_search_hit_event_set_property (GObject      *object,
       set_event (self, g_value_get_object (value));
       break;
 
+    case PROP_N_INSTANCES:
+      gcal_search_hit_event_set_n_instances (self, g_value_get_uint (value));
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
     }
@@ -202,12 +236,29 @@ gcal_search_hit_event_class_init (GcalSearchHitEventClass *klass)
                                                 "Event",
                                                 GCAL_TYPE_EVENT,
                                                 G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
+
+  /**
+   * GcalSearchHitEvent:n-instances:
+   *
+   * The number of occurrences of a recurring event this search hit
+   * stands for. It is 1 unless the occurrences are collapsed into a
+   * single search hit.
+   */
+  properties[PROP_N_INSTANCES] = g_param_spec_uint ("n-instances",
+                                                    "Number of instances",
+                                                    "Number of instances",
+                                                    1,
+                                                    G_MAXUINT,
+                                                    1,
+                                                    G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
+
   g_object_class_install_properties (object_class, N_PROPS, properties);
 }
 
 static void
 gcal_search_hit_event_init (GcalSearchHitEvent *self)
 {
+  self->n_instances = 1;
 }
 
 GcalSearchHitEvent *
@@ -225,3 +276,29 @@ gcal_search_hit_event_get_event (GcalSearchHitEvent *self)
 
   return self->event;
 }
+
+guint
+gcal_search_hit_event_get_n_instances (GcalSearchHitEvent *self)
+{
+  g_return_val_if_fail (GCAL_IS_SEARCH_HIT_EVENT (self), 0);
+
+  return self->n_instances;
+}
+
+void
+gcal_search_hit_event_set_n_instances (GcalSearchHitEvent *self,
+                                       guint               n_instances)
+{
+  g_return_if_fail (GCAL_IS_SEARCH_HIT_EVENT (self));
+  g_return_if_fail (n_instances > 0);
+
+  if (self->n_instances == n_instances)
+    return;
+
+  self->n_instances = n_instances;
+
+  if (self->event)
+    update_subtitle (self);
+
+  g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_N_INSTANCES]);
+}
@@ -32,4 +32,9 @@ GcalSearchHitEvent*  gcal_search_hit_event_new                   (GcalEvent
 
 GcalEvent*           gcal_search_hit_event_get_event             (GcalSearchHitEvent *self);
 
+guint                gcal_search_hit_event_get_n_instances       (GcalSearchHitEvent *self);
+
+void                 gcal_search_hit_event_set_n_instances       (GcalSearchHitEvent *self,
+                                                                  guint               n_instances);
+
 G_END_DECLS
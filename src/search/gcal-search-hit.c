@@ -27,6 +27,8 @@ typedef struct
   gchar              *subtitle;
 
   GdkPaintable       *primary_icon;
+
+  gdouble             score;
 } GcalSearchHitPrivate;
 
 
@@ -39,6 +41,7 @@ enum
   PROP_SUBTITLE,
   PROP_TITLE,
   PROP_PRIMARY_ICON,
+  PROP_SCORE,
   N_PROPS,
 };
 
@@ -112,6 +115,10 @@ gcal_search_hit_get_property (GObject    *object,
       g_value_set_object (value, gcal_search_hit_get_primary_icon (self));
       break;
 
+    case PROP_SCORE:
+      g_value_set_double (value, gcal_search_hit_get_score (self));
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
     }
@@ -143,6 +150,10 @@ gcal_search_hit_set_property (GObject      *object,
       gcal_search_hit_set_primary_icon (self, g_value_get_object (value));
       break;
 
+    case PROP_SCORE:
+      gcal_search_hit_set_score (self, g_value_get_double (value));
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
     }
@@ -189,6 +200,15 @@ gcal_search_hit_class_init (GcalSearchHitClass *klass)
                          GDK_TYPE_PAINTABLE,
                          G_PARAM_READABLE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
 
+  properties [PROP_SCORE] =
+    g_param_spec_double ("score",
+                         "Score",
+                         "The relevance score of the suggestion",
+                         0.0,
+                         G_MAXDOUBLE,
+                         0.0,
+                         G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
+
   g_object_class_install_properties (object_class, N_PROPS, properties);
 
 }
@@ -312,6 +332,32 @@ gcal_search_hit_set_primary_icon (GcalSearchHit *self,
     g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_PRIMARY_ICON]);
 }
 
+gdouble
+gcal_search_hit_get_score (GcalSearchHit *self)
+{
+  GcalSearchHitPrivate *priv = gcal_search_hit_get_instance_private (self);
+
+  g_return_val_if_fail (GCAL_IS_SEARCH_HIT (self), 0.0);
+
+  return priv->score;
+}
+
+void
+gcal_search_hit_set_score (GcalSearchHit *self,
+                           gdouble        score)
+{
+  GcalSearchHitPrivate *priv = gcal_search_hit_get_instance_private (self);
+
+  g_return_if_fail (GCAL_IS_SEARCH_HIT (self));
+  g_return_if_fail (score >= 0.0);
+
+  if (priv->score != score)
+    {
+      priv->score = score;
+      g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_SCORE]);
+    }
+}
+
 void
 gcal_search_hit_activate (GcalSearchHit *self,
                           GtkWidget     *for_widget)
@@ -62,6 +62,11 @@ GdkPaintable *       gcal_search_hit_get_primary_icon            (GcalSearchHit
 void                 gcal_search_hit_set_primary_icon            (GcalSearchHit      *self,
                                                                   GdkPaintable       *paintable);
 
+gdouble              gcal_search_hit_get_score                   (GcalSearchHit      *self);
+
+void                 gcal_search_hit_set_score                   (GcalSearchHit      *self,
+                                                                  gdouble             score);
+
 void                 gcal_search_hit_activate                    (GcalSearchHit      *self,
                                                                   GtkWidget          *for_widget);
 
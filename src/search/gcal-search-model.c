@@ -27,11 +27,25 @@
 #include "gcal-search-hit.h"
 #include "gcal-search-hit-event.h"
 #include "gcal-search-model.h"
+#include "gcal-search-ranker.h"
 #include "gcal-utils.h"
 
+#define DEFAULT_MAX_RESULTS 50
 #define MIN_RESULTS         5
 #define WAIT_FOR_RESULTS_MS 0.150
 
+typedef struct
+{
+  /* All the occurrences found, including the representative */
+  GPtrArray          *instances;
+
+  /* The best ranked occurrence, which stands for the collapsed series */
+  GcalSearchHitEvent *representative;
+  gboolean            representative_in_model;
+
+  gboolean            expanded;
+} SearchSeries;
+
 struct _GcalSearchModel
 {
   GObject             parent;
@@ -39,8 +53,21 @@ struct _GcalSearchModel
   GCancellable       *cancellable;
   GDateTime          *range_start;
   GDateTime          *range_end;
+  GcalSearchRanker   *ranker;
+
+  /* Sorted by compare_search_hits() */
+  GPtrArray          *hits;
+  GPtrArray          *pending_hits;
+  guint               flush_idle_id;
+
+  /* Hit id → GcalSearchHitEvent, for every hit added */
+  GHashTable         *known_hits;
+
+  /* Series key → SearchSeries */
+  GHashTable         *series;
 
-  GListModel         *model;
+  guint               max_results;
+  guint               limit;
 
   GTimer             *timer;
   guint               idle_id;
@@ -50,12 +77,307 @@ static void          gcal_timeline_subscriber_interface_init     (GcalTimelineSu
 
 static void g_list_model_interface_init                (GListModelInterface              *iface);
 
+static gint          compare_search_hit_ptrs_cb                  (gconstpointer                    a,
+                                                                  gconstpointer                    b,
+                                                                  gpointer                         user_data);
+
 G_DEFINE_TYPE_WITH_CODE (GcalSearchModel, gcal_search_model, G_TYPE_OBJECT,
                          G_IMPLEMENT_INTERFACE (GCAL_TYPE_TIMELINE_SUBSCRIBER,
                                                 gcal_timeline_subscriber_interface_init)
                          G_IMPLEMENT_INTERFACE (G_TYPE_LIST_MODEL,
                                                 g_list_model_interface_init))
 
+enum
+{
+  PROP_0,
+  PROP_MAX_RESULTS,
+  N_PROPS
+};
+
+static GParamSpec *properties [N_PROPS];
+
+
+/*
+ * Auxiliary methods
+ */
+
+static gint
+compare_search_hits (GcalSearchHit *hit_a,
+                     GcalSearchHit *hit_b)
+{
+  gdouble score_a;
+  gdouble score_b;
+  gint result;
+
+  /* Priority */
+  result = gcal_search_hit_get_priority (hit_a) - gcal_search_hit_get_priority (hit_b);
+
+  if (result != 0)
+    return result;
+
+  /* Relevance, higher scores first */
+  score_a = gcal_search_hit_get_score (hit_a);
+  score_b = gcal_search_hit_get_score (hit_b);
+
+  if (score_a != score_b)
+    return score_a > score_b ? -1 : 1;
+
+  /* Compare func */
+  return gcal_search_hit_compare (hit_a, hit_b);
+}
+
+static inline guint
+get_n_visible_hits (GcalSearchModel *self)
+{
+  return MIN (self->hits->len, self->limit);
+}
+
+static guint
+find_sorted_position (GcalSearchModel *self,
+                      GcalSearchHit   *hit)
+{
+  guint low, high;
+
+  low = 0;
+  high = self->hits->len;
+
+  while (low < high)
+    {
+      guint middle = low + (high - low) / 2;
+
+      if (compare_search_hits (g_ptr_array_index (self->hits, middle), hit) < 0)
+        low = middle + 1;
+      else
+        high = middle;
+    }
+
+  return low;
+}
+
+static guint
+find_hit_position (GcalSearchModel *self,
+                   GcalSearchHit   *hit)
+{
+  guint position;
+
+  for (position = find_sorted_position (self, hit); position < self->hits->len; position++)
+    {
+      GcalSearchHit *other = g_ptr_array_index (self->hits, position);
+
+      if (other == hit)
+        return position;
+
+      if (compare_search_hits (other, hit) != 0)
+        break;
+    }
+
+  /* The ordering depends on the current time, and may have drifted */
+  if (!g_ptr_array_find (self->hits, hit, &position))
+    g_assert_not_reached ();
+
+  return position;
+}
+
+static void
+merge_hits (GcalSearchModel *self,
+            GPtrArray       *new_hits,
+            GHashTable      *removed_hits)
+{
+  g_autoptr (GPtrArray) merged = NULL;
+  guint old_n_visible;
+  guint new_n_visible;
+  guint first_changed;
+  guint n_removed;
+  guint i, j;
+
+  n_removed = removed_hits ? g_hash_table_size (removed_hits) : 0;
+
+  if (new_hits->len == 0 && n_removed == 0)
+    return;
+
+  GCAL_TRACE_MSG ("Merging %u search hits into %u hits, removing %u", new_hits->len, self->hits->len, n_removed);
+
+  old_n_visible = get_n_visible_hits (self);
+  first_changed = self->hits->len;
+
+  /*
+   * Everything that sorts before the first new hit, and before the first
+   * removed hit, is untouched. Only the tail of the array needs merging.
+   */
+  if (new_hits->len > 0)
+    {
+      g_ptr_array_sort_with_data (new_hits, compare_search_hit_ptrs_cb, NULL);
+      first_changed = find_sorted_position (self, g_ptr_array_index (new_hits, 0));
+    }
+
+  if (n_removed > 0)
+    {
+      GHashTableIter iter;
+      GcalSearchHit *hit;
+
+      g_hash_table_iter_init (&iter, removed_hits);
+      while (g_hash_table_iter_next (&iter, (gpointer *) &hit, NULL))
+        first_changed = MIN (first_changed, find_hit_position (self, hit));
+    }
+
+  merged = g_ptr_array_new_full (self->hits->len + new_hits->len, g_object_unref);
+
+  for (i = 0; i < first_changed; i++)
+    g_ptr_array_add (merged, g_object_ref (g_ptr_array_index (self->hits, i)));
+
+  j = 0;
+  while (i < self->hits->len || j < new_hits->len)
+    {
+      GcalSearchHit *hit;
+
+      if (i < self->hits->len && n_removed > 0 && g_hash_table_contains (removed_hits, g_ptr_array_index (self->hits, i)))
+        {
+          i++;
+          continue;
+        }
+
+      if (j == new_hits->len ||
+          (i < self->hits->len &&
+           compare_search_hits (g_ptr_array_index (self->hits, i), g_ptr_array_index (new_hits, j)) <= 0))
+        {
+          hit = g_ptr_array_index (self->hits, i++);
+        }
+      else
+        {
+          hit = g_ptr_array_index (new_hits, j++);
+        }
+
+      g_ptr_array_add (merged, g_object_ref (hit));
+    }
+
+  g_clear_pointer (&self->hits, g_ptr_array_unref);
+  self->hits = g_steal_pointer (&merged);
+
+  new_n_visible = get_n_visible_hits (self);
+
+  if (first_changed < MAX (old_n_visible, new_n_visible))
+    {
+      g_list_model_items_changed (G_LIST_MODEL (self),
+                                  first_changed,
+                                  old_n_visible > first_changed ? old_n_visible - first_changed : 0,
+                                  new_n_visible > first_changed ? new_n_visible - first_changed : 0);
+    }
+}
+
+static void
+search_series_free (SearchSeries *series)
+{
+  g_clear_pointer (&series->instances, g_ptr_array_unref);
+  g_slice_free (SearchSeries, series);
+}
+
+static SearchSeries*
+ensure_series (GcalSearchModel    *self,
+               GcalSearchHitEvent *hit)
+{
+  g_autofree gchar *series_key = NULL;
+  ECalComponent *component;
+  SearchSeries *series;
+  GcalCalendar *calendar;
+  GcalEvent *event;
+
+  /* Occurrences of a recurring event share the UID of their component */
+  event = gcal_search_hit_event_get_event (hit);
+  calendar = gcal_event_get_calendar (event);
+  component = gcal_event_get_component (event);
+  series_key = g_strdup_printf ("%s:%s",
+                                calendar ? gcal_calendar_get_id (calendar) : "",
+                                e_cal_component_get_uid (component));
+
+  series = g_hash_table_lookup (self->series, series_key);
+
+  if (!series)
+    {
+      series = g_slice_new0 (SearchSeries);
+      series->instances = g_ptr_array_new_with_free_func (g_object_unref);
+      g_hash_table_insert (self->series, g_steal_pointer (&series_key), series);
+    }
+
+  return series;
+}
+
+static void
+flush_pending_hits (GcalSearchModel *self)
+{
+  g_autoptr (GHashTable) touched_series = NULL;
+  g_autoptr (GHashTable) removed_hits = NULL;
+  g_autoptr (GPtrArray) pending_hits = NULL;
+  g_autoptr (GPtrArray) new_hits = NULL;
+  GHashTableIter iter;
+  SearchSeries *series;
+  guint i;
+
+  if (self->pending_hits->len == 0)
+    return;
+
+  pending_hits = g_steal_pointer (&self->pending_hits);
+  self->pending_hits = g_ptr_array_new_with_free_func (g_object_unref);
+
+  new_hits = g_ptr_array_new_full (pending_hits->len, g_object_unref);
+  removed_hits = g_hash_table_new (NULL, NULL);
+  touched_series = g_hash_table_new (NULL, NULL);
+
+  for (i = 0; i < pending_hits->len; i++)
+    {
+      GcalSearchHitEvent *hit;
+      const gchar *id;
+
+      hit = g_ptr_array_index (pending_hits, i);
+      id = gcal_search_hit_get_id (GCAL_SEARCH_HIT (hit));
+
+      /* Same event, reported twice */
+      if (g_hash_table_contains (self->known_hits, id))
+        continue;
+
+      g_hash_table_insert (self->known_hits, (gpointer) id, g_object_ref (hit));
+
+      series = ensure_series (self, hit);
+      g_ptr_array_add (series->instances, g_object_ref (hit));
+
+      if (series->expanded)
+        {
+          g_ptr_array_add (new_hits, g_object_ref (hit));
+          continue;
+        }
+
+      /* Collapsed series only expose their best ranked occurrence */
+      if (!series->representative ||
+          compare_search_hits (GCAL_SEARCH_HIT (hit), GCAL_SEARCH_HIT (series->representative)) < 0)
+        {
+          if (series->representative_in_model)
+            {
+              g_hash_table_add (removed_hits, series->representative);
+              gcal_search_hit_event_set_n_instances (series->representative, 1);
+            }
+
+          series->representative = hit;
+          series->representative_in_model = FALSE;
+        }
+
+      g_hash_table_add (touched_series, series);
+    }
+
+  g_hash_table_iter_init (&iter, touched_series);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &series, NULL))
+    {
+      gcal_search_hit_event_set_n_instances (series->representative, series->instances->len);
+
+      if (!series->representative_in_model)
+        {
+          g_ptr_array_add (new_hits, g_object_ref (series->representative));
+          series->representative_in_model = TRUE;
+        }
+    }
+
+  merge_hits (self, new_hits, removed_hits);
+}
+
+
 /*
  * Callbacks
  */
@@ -73,7 +395,7 @@ check_for_search_hits_cb (gpointer user_data)
     goto stop_idle;
 
   if (g_timer_elapsed (self->timer, NULL) >= WAIT_FOR_RESULTS_MS ||
-      g_list_model_get_n_items (self->model) >= MIN_RESULTS)
+      get_n_visible_hits (self) >= MIN_RESULTS)
     {
       g_task_return_boolean (task, TRUE);
       goto stop_idle;
@@ -88,44 +410,24 @@ stop_idle:
 }
 
 static gint
-compare_search_hits_cb (gconstpointer a,
-                        gconstpointer b,
-                        gpointer      user_data)
+compare_search_hit_ptrs_cb (gconstpointer a,
+                            gconstpointer b,
+                            gpointer      user_data)
 {
-  GcalSearchHit *hit_a, *hit_b;
-  gint result;
-
-  hit_a = (GcalSearchHit *) a;
-  hit_b = (GcalSearchHit *) b;
-
-  /* Priority */
-  result = gcal_search_hit_get_priority (hit_a) - gcal_search_hit_get_priority (hit_b);
-
-  if (result != 0)
-    return result;
-
-  /* Compare func */
-  return gcal_search_hit_compare (hit_a, hit_b);
+  return compare_search_hits (*((GcalSearchHit **) a), *((GcalSearchHit **) b));
 }
 
 static gboolean
-search_hits_equals_cb (gconstpointer a,
-                       gconstpointer b)
+flush_pending_hits_cb (gpointer user_data)
 {
-  GcalSearchHit *search_hit_a = GCAL_SEARCH_HIT ((gpointer) a);
-  GcalSearchHit *search_hit_b = GCAL_SEARCH_HIT ((gpointer) b);
+  GcalSearchModel *self = GCAL_SEARCH_MODEL (user_data);
 
-  return gcal_search_hit_compare (search_hit_a, search_hit_b) == 0;
-}
+  GCAL_ENTRY;
 
-static void
-on_search_model_items_changed_cb (GListModel      *model,
-                                  guint            position,
-                                  guint            removed,
-                                  guint            added,
-                                  GcalSearchModel *self)
-{
-  g_list_model_items_changed (G_LIST_MODEL (self), position, removed, added);
+  self->flush_idle_id = 0;
+  flush_pending_hits (self);
+
+  GCAL_RETURN (G_SOURCE_REMOVE);
 }
 
 
@@ -145,28 +447,32 @@ static void
 gcal_search_model_add_event (GcalTimelineSubscriber *subscriber,
                              GcalEvent              *event)
 {
-  g_autoptr (GcalSearchHitEvent) search_hit = NULL;
+  GcalSearchHitEvent *search_hit;
   GcalSearchModel *self;
-  gboolean found;
 
   self = GCAL_SEARCH_MODEL (subscriber);
 
   GCAL_TRACE_MSG ("Adding search hit '%s'", gcal_event_get_summary (event));
 
+  /*
+   * The timeline reports events in batches. Accumulate them, and merge the
+   * whole batch at once right after the timeline dispatch, so that only one
+   * ::items-changed is emitted per batch.
+   */
   search_hit = gcal_search_hit_event_new (event);
 
-  found = g_list_store_find_with_equal_func (G_LIST_STORE (self->model),
-                                             search_hit,
-                                             search_hits_equals_cb,
-                                             NULL);
+  if (self->ranker)
+    gcal_search_hit_set_score (GCAL_SEARCH_HIT (search_hit), gcal_search_ranker_score_event (self->ranker, event, NULL));
 
-  if (found)
-    return;
+  g_ptr_array_add (self->pending_hits, search_hit);
 
-  g_list_store_insert_sorted (G_LIST_STORE (self->model),
-                              search_hit,
-                              compare_search_hits_cb,
-                              self);
+  if (self->flush_idle_id == 0)
+    {
+      self->flush_idle_id = g_idle_add_full (G_PRIORITY_HIGH_IDLE,
+                                             flush_pending_hits_cb,
+                                             self,
+                                             NULL);
+    }
 }
 
 static void
@@ -206,7 +512,7 @@ static guint
 gcal_search_model_get_n_items (GListModel *model)
 {
   GcalSearchModel *self = (GcalSearchModel *)model;
-  return g_list_model_get_n_items (self->model);
+  return get_n_visible_hits (self);
 }
 
 static gpointer
@@ -214,7 +520,11 @@ gcal_search_model_get_item (GListModel *model,
                             guint       position)
 {
   GcalSearchModel *self = (GcalSearchModel *)model;
-  return g_list_model_get_item (self->model, position);
+
+  if (position >= get_n_visible_hits (self))
+    return NULL;
+
+  return g_object_ref (g_ptr_array_index (self->hits, position));
 }
 
 static void
@@ -240,38 +550,106 @@ gcal_search_model_finalize (GObject *object)
 
   g_cancellable_cancel (self->cancellable);
 
+  g_clear_handle_id (&self->flush_idle_id, g_source_remove);
+
   gcal_clear_date_time (&self->range_start);
   gcal_clear_date_time (&self->range_end);
+  g_clear_pointer (&self->ranker, gcal_search_ranker_unref);
   g_clear_object (&self->cancellable);
-  g_clear_object (&self->model);
+  g_clear_pointer (&self->hits, g_ptr_array_unref);
+  g_clear_pointer (&self->pending_hits, g_ptr_array_unref);
+  g_clear_pointer (&self->known_hits, g_hash_table_destroy);
+  g_clear_pointer (&self->series, g_hash_table_destroy);
 
   G_OBJECT_CLASS (gcal_search_model_parent_class)->finalize (object);
 }
 
+static void
+gcal_search_model_get_property (GObject    *object,
+                                guint       prop_id,
+                                GValue     *value,
+                                GParamSpec *pspec)
+{
+  GcalSearchModel *self = GCAL_SEARCH_MODEL (object);
+
+  switch (prop_id)
+    {
+    case PROP_MAX_RESULTS:
+      g_value_set_uint (value, self->max_results);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+gcal_search_model_set_property (GObject      *object,
+                                guint         prop_id,
+                                const GValue *value,
+                                GParamSpec   *pspec)
+{
+  GcalSearchModel *self = GCAL_SEARCH_MODEL (object);
+
+  switch (prop_id)
+    {
+    case PROP_MAX_RESULTS:
+      gcal_search_model_set_max_results (self, g_value_get_uint (value));
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
 static void
 gcal_search_model_class_init (GcalSearchModelClass *klass)
 {
   GObjectClass *object_class = G_OBJECT_CLASS (klass);
 
   object_class->finalize = gcal_search_model_finalize;
+  object_class->get_property = gcal_search_model_get_property;
+  object_class->set_property = gcal_search_model_set_property;
+
+  /**
+   * GcalSearchModel:max-results:
+   *
+   * The number of search hits exposed at once. More hits are exposed
+   * with gcal_search_model_show_more().
+   */
+  properties[PROP_MAX_RESULTS] = g_param_spec_uint ("max-results",
+                                                    "Maximum results",
+                                                    "Maximum number of search hits exposed at once",
+                                                    1,
+                                                    G_MAXUINT,
+                                                    DEFAULT_MAX_RESULTS,
+                                                    G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
+
+  g_object_class_install_properties (object_class, N_PROPS, properties);
 }
 
 static void
 gcal_search_model_init (GcalSearchModel *self)
 {
-  self->model = (GListModel*) g_list_store_new (GCAL_TYPE_SEARCH_HIT);
-  g_signal_connect (self->model, "items-changed", G_CALLBACK (on_search_model_items_changed_cb), self);
+  self->hits = g_ptr_array_new_with_free_func (g_object_unref);
+  self->pending_hits = g_ptr_array_new_with_free_func (g_object_unref);
+  self->known_hits = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_object_unref);
+  self->series = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) search_series_free);
+  self->max_results = DEFAULT_MAX_RESULTS;
+  self->limit = DEFAULT_MAX_RESULTS;
 }
 
 GcalSearchModel *
-gcal_search_model_new (GCancellable *cancellable,
-                       GDateTime    *range_start,
-                       GDateTime    *range_end)
+gcal_search_model_new (GCancellable     *cancellable,
+                       GcalSearchRanker *ranker,
+                       GDateTime        *range_start,
+                       GDateTime        *range_end)
 {
   GcalSearchModel *model;
 
   model = g_object_new (GCAL_TYPE_SEARCH_MODEL, NULL);
   model->cancellable = cancellable ? g_object_ref (cancellable) : NULL;
+  model->ranker = ranker ? gcal_search_ranker_ref (ranker) : NULL;
   model->range_start = g_date_time_ref (range_start);
   model->range_end = g_date_time_ref (range_end);
 
@@ -314,3 +692,177 @@ gcal_search_model_wait_for_hits_finish (GcalSearchModel  *self,
 
   return g_task_propagate_boolean (G_TASK (result), error);
 }
+
+/**
+ * gcal_search_model_get_max_results:
+ * @self: a #GcalSearchModel
+ *
+ * Retrieves the number of search hits exposed at once.
+ *
+ * Returns: the maximum number of search hits
+ */
+guint
+gcal_search_model_get_max_results (GcalSearchModel *self)
+{
+  g_return_val_if_fail (GCAL_IS_SEARCH_MODEL (self), 0);
+
+  return self->max_results;
+}
+
+/**
+ * gcal_search_model_set_max_results:
+ * @self: a #GcalSearchModel
+ * @max_results: the maximum number of search hits
+ *
+ * Sets the number of search hits exposed at once. Only the
+ * @max_results best ranked hits are exposed by @self; this
+ * also resets any previous call to gcal_search_model_show_more().
+ */
+void
+gcal_search_model_set_max_results (GcalSearchModel *self,
+                                   guint            max_results)
+{
+  guint old_n_visible;
+  guint new_n_visible;
+
+  g_return_if_fail (GCAL_IS_SEARCH_MODEL (self));
+  g_return_if_fail (max_results > 0);
+
+  if (self->max_results == max_results)
+    return;
+
+  old_n_visible = get_n_visible_hits (self);
+
+  self->max_results = max_results;
+  self->limit = max_results;
+
+  new_n_visible = get_n_visible_hits (self);
+
+  if (old_n_visible > new_n_visible)
+    g_list_model_items_changed (G_LIST_MODEL (self), new_n_visible, old_n_visible - new_n_visible, 0);
+  else if (new_n_visible > old_n_visible)
+    g_list_model_items_changed (G_LIST_MODEL (self), old_n_visible, 0, new_n_visible - old_n_visible);
+
+  g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_MAX_RESULTS]);
+}
+
+/**
+ * gcal_search_model_get_n_hidden_hits:
+ * @self: a #GcalSearchModel
+ *
+ * Retrieves the number of search hits that rank below the
+ * cut, and are not exposed by @self yet.
+ *
+ * Returns: the number of hidden search hits
+ */
+guint
+gcal_search_model_get_n_hidden_hits (GcalSearchModel *self)
+{
+  g_return_val_if_fail (GCAL_IS_SEARCH_MODEL (self), 0);
+
+  return self->hits->len - get_n_visible_hits (self);
+}
+
+/**
+ * gcal_search_model_show_more:
+ * @self: a #GcalSearchModel
+ *
+ * Exposes up to #GcalSearchModel:max-results more search hits.
+ */
+void
+gcal_search_model_show_more (GcalSearchModel *self)
+{
+  guint old_n_visible;
+  guint new_n_visible;
+
+  g_return_if_fail (GCAL_IS_SEARCH_MODEL (self));
+
+  old_n_visible = get_n_visible_hits (self);
+
+  if (self->limit > G_MAXUINT - self->max_results)
+    self->limit = G_MAXUINT;
+  else
+    self->limit += self->max_results;
+
+  new_n_visible = get_n_visible_hits (self);
+
+  GCAL_TRACE_MSG ("Showing %u more search hits", new_n_visible - old_n_visible);
+
+  if (new_n_visible > old_n_visible)
+    g_list_model_items_changed (G_LIST_MODEL (self), old_n_visible, 0, new_n_visible - old_n_visible);
+}
+
+/**
+ * gcal_search_model_expand_series:
+ * @self: a #GcalSearchModel
+ * @hit_id: the id of a #GcalSearchHit
+ *
+ * Occurrences of a recurring event are collapsed into a single search
+ * hit, the best ranked occurrence. This exposes all the occurrences of
+ * the recurring event that @hit_id belongs to as separate search hits.
+ */
+void
+gcal_search_model_expand_series (GcalSearchModel *self,
+                                 const gchar     *hit_id)
+{
+  g_autoptr (GPtrArray) new_hits = NULL;
+  GcalSearchHitEvent *hit;
+  SearchSeries *series;
+  guint i;
+
+  g_return_if_fail (GCAL_IS_SEARCH_MODEL (self));
+  g_return_if_fail (hit_id != NULL);
+
+  GCAL_ENTRY;
+
+  hit = g_hash_table_lookup (self->known_hits, hit_id);
+
+  if (!hit)
+    GCAL_RETURN ();
+
+  series = ensure_series (self, hit);
+
+  if (series->expanded)
+    GCAL_RETURN ();
+
+  series->expanded = TRUE;
+
+  new_hits = g_ptr_array_new_full (series->instances->len, g_object_unref);
+  for (i = 0; i < series->instances->len; i++)
+    {
+      GcalSearchHitEvent *instance = g_ptr_array_index (series->instances, i);
+
+      if (instance != series->representative)
+        g_ptr_array_add (new_hits, g_object_ref (instance));
+    }
+
+  gcal_search_hit_event_set_n_instances (series->representative, 1);
+
+  merge_hits (self, new_hits, NULL);
+
+  GCAL_EXIT;
+}
+
+/**
+ * gcal_search_model_set_range:
+ * @self: a #GcalSearchModel
+ * @range_start: the start of the search range
+ * @range_end: the end of the search range
+ *
+ * Sets the range that @self looks for search hits into. Hits that
+ * were found before are kept, even if they are not in the new range.
+ */
+void
+gcal_search_model_set_range (GcalSearchModel *self,
+                             GDateTime       *range_start,
+                             GDateTime       *range_end)
+{
+  g_return_if_fail (GCAL_IS_SEARCH_MODEL (self));
+  g_return_if_fail (range_start != NULL);
+  g_return_if_fail (range_end != NULL);
+
+  gcal_set_date_time (&self->range_start, range_start);
+  gcal_set_date_time (&self->range_end, range_end);
+
+  gcal_timeline_subscriber_range_changed (GCAL_TIMELINE_SUBSCRIBER (self));
+}
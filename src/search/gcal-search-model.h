@@ -22,12 +22,19 @@
 
 #include <gio/gio.h>
 
+#include "gcal-search-ranker.h"
+
 G_BEGIN_DECLS
 
 #define GCAL_TYPE_SEARCH_MODEL (gcal_search_model_get_type())
 G_DECLARE_FINAL_TYPE (GcalSearchModel, gcal_search_model, GCAL, SEARCH_MODEL, GObject)
 
 GcalSearchModel*     gcal_search_model_new                       (GCancellable       *cancellable,
+                                                                  GcalSearchRanker   *ranker,
+                                                                  GDateTime          *range_start,
+                                                                  GDateTime          *range_end);
+
+void                 gcal_search_model_set_range                 (GcalSearchModel    *self,
                                                                   GDateTime          *range_start,
                                                                   GDateTime          *range_end);
 
@@ -40,4 +47,16 @@ gboolean             gcal_search_model_wait_for_hits_finish      (GcalSearchMode
                                                                   GAsyncResult       *result,
                                                                   GError            **error);
 
+guint                gcal_search_model_get_max_results           (GcalSearchModel    *self);
+
+void                 gcal_search_model_set_max_results           (GcalSearchModel    *self,
+                                                                  guint               max_results);
+
+guint                gcal_search_model_get_n_hidden_hits         (GcalSearchModel    *self);
+
+void                 gcal_search_model_show_more                 (GcalSearchModel    *self);
+
+void                 gcal_search_model_expand_series             (GcalSearchModel    *self,
+                                                                  const gchar        *hit_id);
+
 G_END_DECLS
@@ -0,0 +1,443 @@
+/* gcal-search-ranker.c
+ *
+ * Copyright 2024 Georges Basile Stavracas Neto <georges.stavracas@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#define G_LOG_DOMAIN "GcalSearchRanker"
+
+#include "gcal-calendar.h"
+#include "gcal-search-ranker.h"
+#include "gcal-search-ranker-private.h"
+
+#include <string.h>
+
+#define SECONDS_PER_DAY 86400.0
+
+/**
+ * SECTION:gcal-search-ranker
+ * @short_description: Relevance ranking of search hits
+ * @title:GcalSearchRanker
+ *
+ * #GcalSearchRanker scores events against a search query. The score
+ * combines which field of the event matched, where in that field it
+ * matched, how close the event is to the current time, and whether
+ * its calendar is visible.
+ *
+ * Texts are tokenized once, and the tokenized texts are shared with
+ * the rankers created after it with gcal_search_ranker_new(). Since
+ * every keystroke creates a new search, this avoids tokenizing the
+ * same events over and over while the user types. The cache is keyed
+ * by the texts themselves, so instances of a recurring event share
+ * their tokens, and an edited event is simply tokenized again.
+ */
+
+typedef struct
+{
+  gchar              *folded;
+  guint              *word_starts;
+  guint               n_words;
+} SearchText;
+
+struct _GcalSearchRanker
+{
+  guint               ref_count;
+
+  GStrv               terms;
+  gint64              now;
+
+  /* Original text → SearchText, shared with previous rankers */
+  GHashTable         *texts;
+};
+
+G_DEFINE_BOXED_TYPE (GcalSearchRanker, gcal_search_ranker, gcal_search_ranker_ref, gcal_search_ranker_unref)
+
+static const gdouble field_weights[] = {
+  [GCAL_SEARCH_FIELD_NONE] = 0.0,
+  [GCAL_SEARCH_FIELD_SUMMARY] = 1.0,
+  [GCAL_SEARCH_FIELD_LOCATION] = 0.6,
+  [GCAL_SEARCH_FIELD_DESCRIPTION] = 0.3,
+};
+
+
+/*
+ * Auxiliary methods
+ */
+
+static gchar*
+fold_text (const gchar *text)
+{
+  g_autofree gchar *normalized = NULL;
+
+  normalized = g_utf8_normalize (text, -1, G_NORMALIZE_ALL);
+
+  if (!normalized)
+    return g_strdup ("");
+
+  return g_utf8_casefold (normalized, -1);
+}
+
+static SearchText*
+search_text_new (const gchar *text)
+{
+  g_autoptr (GArray) word_starts = NULL;
+  SearchText *search_text;
+  const gchar *p;
+  gboolean in_word;
+
+  search_text = g_slice_new0 (SearchText);
+  search_text->folded = fold_text (text);
+
+  word_starts = g_array_new (FALSE, FALSE, sizeof (guint));
+  in_word = FALSE;
+
+  for (p = search_text->folded; *p; p = g_utf8_next_char (p))
+    {
+      gboolean is_word_char = g_unichar_isalnum (g_utf8_get_char (p));
+
+      if (is_word_char && !in_word)
+        {
+          guint offset = p - search_text->folded;
+          g_array_append_val (word_starts, offset);
+        }
+
+      in_word = is_word_char;
+    }
+
+  search_text->n_words = word_starts->len;
+  search_text->word_starts = (guint *) g_array_free (g_steal_pointer (&word_starts), FALSE);
+
+  return search_text;
+}
+
+static void
+search_text_free (SearchText *search_text)
+{
+  g_free (search_text->folded);
+  g_free (search_text->word_starts);
+  g_slice_free (SearchText, search_text);
+}
+
+static SearchText*
+lookup_search_text (GcalSearchRanker *self,
+                    const gchar      *text)
+{
+  SearchText *search_text;
+
+  if (!text || *text == '\0')
+    return NULL;
+
+  search_text = g_hash_table_lookup (self->texts, text);
+
+  if (!search_text)
+    {
+      search_text = search_text_new (text);
+      g_hash_table_insert (self->texts, g_strdup (text), search_text);
+    }
+
+  return search_text;
+}
+
+static void
+trim_cache (GcalSearchRanker *self,
+            guint             n_new_texts)
+{
+  /*
+   * Only called before looking up the texts of an event, never in between,
+   * so that no SearchText in use is freed.
+   */
+  if (g_hash_table_size (self->texts) + n_new_texts > GCAL_SEARCH_RANKER_MAX_CACHED_TEXTS)
+    g_hash_table_remove_all (self->texts);
+}
+
+static guint
+get_word_at_offset (SearchText *search_text,
+                    guint       offset)
+{
+  guint low, high;
+
+  /* Number of words starting at or before offset */
+  low = 0;
+  high = search_text->n_words;
+
+  while (low < high)
+    {
+      guint middle = low + (high - low) / 2;
+
+      if (search_text->word_starts[middle] <= offset)
+        low = middle + 1;
+      else
+        high = middle;
+    }
+
+  return low > 0 ? low - 1 : 0;
+}
+
+static gboolean
+match_term (SearchText  *search_text,
+            const gchar *term,
+            guint       *out_position,
+            gboolean    *out_word_start)
+{
+  const gchar *match;
+  gboolean found;
+
+  found = FALSE;
+
+  /* Prefer the first match at the start of a word over earlier partial matches */
+  for (match = strstr (search_text->folded, term); match; match = strstr (match + 1, term))
+    {
+      guint offset = match - search_text->folded;
+      guint position = get_word_at_offset (search_text, offset);
+      gboolean word_start = search_text->n_words > 0 && search_text->word_starts[position] == offset;
+
+      if (!found || word_start)
+        {
+          *out_position = position;
+          *out_word_start = word_start;
+          found = TRUE;
+        }
+
+      if (word_start)
+        break;
+    }
+
+  return found;
+}
+
+static gdouble
+calculate_proximity (GcalSearchRanker *self,
+                     GcalEvent        *event)
+{
+  gint64 start;
+  gint64 end;
+  gdouble days;
+
+  start = g_date_time_to_unix (gcal_event_get_date_start (event));
+  end = g_date_time_to_unix (gcal_event_get_date_end (event));
+
+  if (start <= self->now && end > self->now)
+    return 1.0;
+
+  days = (start - self->now) / SECONDS_PER_DAY;
+
+  /* Upcoming events are more interesting than past ones */
+  if (days >= 0)
+    return 1.0 / (1.0 + days / 14.0);
+  else
+    return 1.0 / (1.0 - days / 7.0);
+}
+
+
+/*
+ * Public API
+ */
+
+/**
+ * gcal_search_ranker_new:
+ * @query: the search query, as typed by the user
+ * @now: the current time
+ * @previous: (nullable): a previous #GcalSearchRanker
+ *
+ * Creates a new #GcalSearchRanker to score events against @query. If
+ * @previous is passed, the tokenized texts of events scored by it are
+ * reused.
+ *
+ * Returns: (transfer full): a #GcalSearchRanker
+ */
+GcalSearchRanker*
+gcal_search_ranker_new (const gchar      *query,
+                        GDateTime        *now,
+                        GcalSearchRanker *previous)
+{
+  g_autoptr (GPtrArray) terms = NULL;
+  g_autofree gchar *folded_query = NULL;
+  g_auto (GStrv) split_query = NULL;
+  GcalSearchRanker *self;
+  guint i;
+
+  g_return_val_if_fail (query != NULL, NULL);
+  g_return_val_if_fail (now != NULL, NULL);
+
+  folded_query = fold_text (query);
+  split_query = g_strsplit_set (folded_query, " \t\n\r", -1);
+
+  terms = g_ptr_array_new ();
+  for (i = 0; split_query[i]; i++)
+    {
+      if (*split_query[i] != '\0')
+        g_ptr_array_add (terms, g_strdup (split_query[i]));
+    }
+  g_ptr_array_add (terms, NULL);
+
+  self = g_slice_new0 (GcalSearchRanker);
+  self->ref_count = 1;
+  self->terms = (GStrv) g_ptr_array_free (g_steal_pointer (&terms), FALSE);
+  self->now = g_date_time_to_unix (now);
+
+  if (previous)
+    self->texts = g_hash_table_ref (previous->texts);
+  else
+    self->texts = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) search_text_free);
+
+  return self;
+}
+
+/**
+ * gcal_search_ranker_ref:
+ * @self: a #GcalSearchRanker
+ *
+ * Increases the reference count of @self.
+ *
+ * Returns: (transfer full): pointer to the just-referenced ranker.
+ */
+GcalSearchRanker*
+gcal_search_ranker_ref (GcalSearchRanker *self)
+{
+  g_return_val_if_fail (self, NULL);
+  g_return_val_if_fail (self->ref_count, NULL);
+
+  g_atomic_int_inc (&self->ref_count);
+
+  return self;
+}
+
+/**
+ * gcal_search_ranker_unref:
+ * @self: a #GcalSearchRanker
+ *
+ * Decreases the reference count of @self, and frees it when
+ * if the reference count reaches zero.
+ */
+void
+gcal_search_ranker_unref (GcalSearchRanker *self)
+{
+  g_return_if_fail (self);
+  g_return_if_fail (self->ref_count);
+
+  if (g_atomic_int_dec_and_test (&self->ref_count))
+    {
+      g_clear_pointer (&self->terms, g_strfreev);
+      g_clear_pointer (&self->texts, g_hash_table_unref);
+      g_slice_free (GcalSearchRanker, self);
+    }
+}
+
+/**
+ * gcal_search_ranker_score_event:
+ * @self: a #GcalSearchRanker
+ * @event: a #GcalEvent
+ * @out_features: (out caller-allocates) (nullable): return location for the features
+ *
+ * Scores @event against the query of @self. Higher scores mean more
+ * relevant events.
+ *
+ * Returns: the relevance score of @event, from 0 to 1
+ */
+gdouble
+gcal_search_ranker_score_event (GcalSearchRanker   *self,
+                                GcalEvent          *event,
+                                GcalSearchFeatures *out_features)
+{
+  GcalSearchFeatures features = { 0, };
+  SearchText *texts[G_N_ELEMENTS (field_weights)];
+  GcalCalendar *calendar;
+  gdouble relevance_sum;
+  guint n_terms;
+  guint i;
+
+  g_return_val_if_fail (self, 0.0);
+  g_return_val_if_fail (GCAL_IS_EVENT (event), 0.0);
+
+  trim_cache (self, G_N_ELEMENTS (texts) - 1);
+
+  texts[GCAL_SEARCH_FIELD_NONE] = NULL;
+  texts[GCAL_SEARCH_FIELD_SUMMARY] = lookup_search_text (self, gcal_event_get_summary (event));
+  texts[GCAL_SEARCH_FIELD_LOCATION] = lookup_search_text (self, gcal_event_get_location (event));
+  texts[GCAL_SEARCH_FIELD_DESCRIPTION] = lookup_search_text (self, gcal_event_get_description (event));
+
+  /* Text relevance */
+  n_terms = g_strv_length (self->terms);
+  relevance_sum = 0.0;
+
+  for (i = 0; i < n_terms; i++)
+    {
+      GcalSearchField field;
+      gdouble best_relevance;
+
+      best_relevance = 0.0;
+
+      for (field = GCAL_SEARCH_FIELD_SUMMARY; field <= GCAL_SEARCH_FIELD_DESCRIPTION; field++)
+        {
+          gboolean word_start;
+          gdouble relevance;
+          guint position;
+
+          if (!texts[field] || !match_term (texts[field], self->terms[i], &position, &word_start))
+            continue;
+
+          relevance = field_weights[field] * (word_start ? 1.0 : 0.5) / (1.0 + 0.25 * position);
+
+          if (relevance <= best_relevance)
+            continue;
+
+          best_relevance = relevance;
+
+          if (i == 0)
+            {
+              features.field = field;
+              features.token_position = position;
+              features.word_start = word_start;
+            }
+        }
+
+      relevance_sum += best_relevance;
+    }
+
+  features.text_relevance = n_terms > 0 ? relevance_sum / n_terms : 1.0;
+
+  /* Proximity to now */
+  features.proximity = calculate_proximity (self, event);
+
+  /* Calendar weight */
+  calendar = gcal_event_get_calendar (event);
+  features.calendar_weight = !calendar || gcal_calendar_get_visible (calendar) ? 1.0 : 0.5;
+
+  features.score = features.text_relevance * (0.5 + 0.5 * features.proximity) * features.calendar_weight;
+
+  if (out_features)
+    *out_features = features;
+
+  return features.score;
+}
+
+/**
+ * gcal_search_ranker_get_n_cached_texts:
+ * @self: a #GcalSearchRanker
+ *
+ * Retrieves the number of tokenized texts cached by @self, which
+ * are shared with the rankers created from it.
+ *
+ * Returns: the number of cached texts
+ */
+guint
+gcal_search_ranker_get_n_cached_texts (GcalSearchRanker *self)
+{
+  g_return_val_if_fail (self, 0);
+
+  return g_hash_table_size (self->texts);
+}
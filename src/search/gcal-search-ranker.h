@@ -0,0 +1,90 @@
+/* gcal-search-ranker.h
+ *
+ * Copyright 2024 Georges Basile Stavracas Neto <georges.stavracas@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include "gcal-event.h"
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define GCAL_TYPE_SEARCH_RANKER (gcal_search_ranker_get_type())
+
+typedef struct _GcalSearchRanker GcalSearchRanker;
+
+/**
+ * GcalSearchField:
+ * @GCAL_SEARCH_FIELD_NONE: no field matched the query
+ * @GCAL_SEARCH_FIELD_SUMMARY: the summary matched the query
+ * @GCAL_SEARCH_FIELD_LOCATION: the location matched the query
+ * @GCAL_SEARCH_FIELD_DESCRIPTION: the description matched the query
+ *
+ * The fields of an event that are matched against search queries, from
+ * the most to the least relevant.
+ */
+typedef enum
+{
+  GCAL_SEARCH_FIELD_NONE,
+  GCAL_SEARCH_FIELD_SUMMARY,
+  GCAL_SEARCH_FIELD_LOCATION,
+  GCAL_SEARCH_FIELD_DESCRIPTION,
+} GcalSearchField;
+
+/**
+ * GcalSearchFeatures:
+ * @field: the most relevant field that matched the first query term
+ * @token_position: the index of the word where the first query term matched
+ * @word_start: whether the first query term matched at the start of a word
+ * @text_relevance: how well the text of the event matches the query, from 0 to 1
+ * @proximity: how close the event is to the current time, from 0 to 1
+ * @calendar_weight: the weight of the calendar of the event, from 0 to 1
+ * @score: the final relevance score, combining all of the above
+ *
+ * The features used by #GcalSearchRanker to rank an event.
+ */
+typedef struct
+{
+  GcalSearchField     field;
+  guint               token_position;
+  gboolean            word_start;
+  gdouble             text_relevance;
+  gdouble             proximity;
+  gdouble             calendar_weight;
+  gdouble             score;
+} GcalSearchFeatures;
+
+GType                gcal_search_ranker_get_type                 (void) G_GNUC_CONST;
+
+GcalSearchRanker*    gcal_search_ranker_new                      (const gchar        *query,
+                                                                  GDateTime          *now,
+                                                                  GcalSearchRanker   *previous);
+
+GcalSearchRanker*    gcal_search_ranker_ref                      (GcalSearchRanker   *self);
+
+void                 gcal_search_ranker_unref                    (GcalSearchRanker   *self);
+
+gdouble              gcal_search_ranker_score_event              (GcalSearchRanker   *self,
+                                                                  GcalEvent          *event,
+                                                                  GcalSearchFeatures *out_features);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (GcalSearchRanker, gcal_search_ranker_unref)
+
+G_END_DECLS
@@ -19,6 +19,7 @@
 #define G_LOG_DOMAIN "Weather"
 
 #include <string.h>
+#include "gcal-memory-stats.h"
 #include "gcal-weather-info.h"
 
 
@@ -76,6 +77,8 @@ gcal_weather_info_finalize (GObject *object)
   g_free (self->icon_name);
   g_free (self->temperature);
 
+  gcal_memory_stats_remove (GCAL_MEMORY_WEATHER, 1, sizeof (GcalWeatherInfo));
+
   G_OBJECT_CLASS (gcal_weather_info_parent_class)->finalize (object);
 }
 
@@ -185,6 +188,8 @@ gcal_weather_info_init (GcalWeatherInfo *self)
   g_date_clear (&self->date, 1);
   self->icon_name = NULL;
   self->temperature = NULL;
+
+  gcal_memory_stats_add (GCAL_MEMORY_WEATHER, 1, sizeof (GcalWeatherInfo));
 }
 
 
@@ -69,6 +69,7 @@ typedef struct
  * @weather_service_active:  True if weather service is requested to be active, regardless of being in use.
  * @weather_service_running: True if weather service is active.
  * @weather_is_stale:        True if update was request without the service running.
+ * @timers_suspended:        True if timers must not run, e.g. while no window is visible.
  *
  * This service listens to location and weather changes and reports them.
  *
@@ -111,6 +112,7 @@ struct _GcalWeatherService
   gboolean            weather_service_active;
   gboolean            weather_service_running;
   gboolean            weather_is_stale;
+  gboolean            timers_suspended;
 };
 
 static void          on_gweather_update_cb                       (GWeatherInfo       *info,
@@ -269,6 +271,9 @@ start_timer (GcalWeatherService  *self)
 {
   GNetworkMonitor *monitor;
 
+  if (self->timers_suspended)
+    return;
+
   monitor = g_network_monitor_get_default ();
 
   if (g_network_monitor_get_network_available (monitor))
@@ -1369,3 +1374,35 @@ gcal_weather_service_release (GcalWeatherService *self)
 
   start_or_stop_weather_service (self);
 }
+
+/**
+ * gcal_weather_service_set_timers_suspended:
+ * @self: The #GcalWeatherService instance.
+ * @suspended: whether to suspend the update timers
+ *
+ * Suspends or resumes the periodic weather updates, without stopping
+ * the service. When resuming, weather reports are updated once to
+ * catch up with the time the timers were suspended.
+ **/
+void
+gcal_weather_service_set_timers_suspended (GcalWeatherService *self,
+                                           gboolean            suspended)
+{
+  g_return_if_fail (GCAL_IS_WEATHER_SERVICE (self));
+
+  if (self->timers_suspended == suspended)
+    return;
+
+  self->timers_suspended = suspended;
+
+  if (suspended)
+    {
+      if (gcal_timer_is_running (self->duration_timer))
+        stop_timer (self);
+    }
+  else if (self->weather_service_running && self->gweather_info)
+    {
+      gweather_info_update (self->gweather_info);
+      start_timer (self);
+    }
+}
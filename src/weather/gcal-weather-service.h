@@ -62,6 +62,9 @@ void                 gcal_weather_service_hold                      (GcalWeather
 
 void                 gcal_weather_service_release                   (GcalWeatherService *self);
 
+void                 gcal_weather_service_set_timers_suspended      (GcalWeatherService *self,
+                                                                     gboolean            suspended);
+
 G_END_DECLS
 
 #endif /* GCAL_WEATHER_SERVICE_H */
@@ -0,0 +1,343 @@
+/* test-calendar-monitor.c
+ *
+ * Copyright 2024 Georges Basile Stavracas Neto <georges.stavracas@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <glib.h>
+#include <libecal/libecal.h>
+
+#include "gcal-calendar-monitor-private.h"
+#include "gcal-event.h"
+#include "gcal-stub-calendar.h"
+
+#define RECURRING_EVENT(rrule) "BEGIN:VEVENT\n"                             \
+                               "UID:recurring@uid\n"                        \
+                               "SUMMARY:Recurring event\n"                  \
+                               "DTSTART:20240101T100000Z\n"                 \
+                               "DTEND:20240101T110000Z\n"                   \
+                               "RRULE:" rrule "\n"                          \
+                               "END:VEVENT\n"
+
+#define SINGLE_EVENT "BEGIN:VEVENT\n"                                       \
+                     "UID:single@uid\n"                                     \
+                     "SUMMARY:Single event\n"                               \
+                     "DTSTART:20240110T100000Z\n"                           \
+                     "DTEND:20240110T110000Z\n"                             \
+                     "END:VEVENT\n"
+
+#define JANUARY_START 1704067200 /* 2024-01-01T00:00:00Z */
+#define JANUARY_END   1706745600 /* 2024-02-01T00:00:00Z */
+
+static guint
+estimate (const gchar *string)
+{
+  g_autoptr (ICalComponent) component = NULL;
+
+  component = i_cal_component_new_from_string (string);
+  g_assert_nonnull (component);
+
+  return gcal_calendar_monitor_estimate_n_instances (component, JANUARY_START, JANUARY_END);
+}
+
+/*********************************************************************************************************************/
+
+static void
+calendar_monitor_estimate (void)
+{
+  g_assert_cmpuint (estimate (RECURRING_EVENT ("FREQ=DAILY")), ==, 32);
+  g_assert_cmpuint (estimate (RECURRING_EVENT ("FREQ=DAILY;INTERVAL=2")), ==, 16);
+  g_assert_cmpuint (estimate (RECURRING_EVENT ("FREQ=DAILY;COUNT=5")), ==, 5);
+  g_assert_cmpuint (estimate (RECURRING_EVENT ("FREQ=WEEKLY")), ==, 5);
+  g_assert_cmpuint (estimate (RECURRING_EVENT ("FREQ=YEARLY")), ==, 1);
+
+  /* Estimates are capped to the per-series budget */
+  g_assert_cmpuint (estimate (RECURRING_EVENT ("FREQ=MINUTELY")), ==, 1000);
+}
+
+/*********************************************************************************************************************/
+
+/*
+ * Mimics e_cal_client_generate_instances_for_object_sync(), which needs a
+ * running E-D-S: recurring events get a new component for each instance,
+ * and non-recurring events are passed as they are.
+ */
+
+typedef struct
+{
+  ECalRecurInstanceCb callback;
+  gpointer            callback_data;
+  ICalComponent      *last_instance;
+} GenerateData;
+
+static gboolean
+recur_instance_cb (ICalComponent  *icomponent,
+                   ICalTime       *instance_start,
+                   ICalTime       *instance_end,
+                   gpointer        user_data,
+                   GCancellable   *cancellable,
+                   GError        **error)
+{
+  g_autoptr (ICalComponent) instance = NULL;
+  GenerateData *data = user_data;
+
+  instance = i_cal_component_clone (icomponent);
+  i_cal_component_set_dtstart (instance, instance_start);
+  i_cal_component_set_dtend (instance, instance_end);
+  i_cal_component_set_recurrenceid (instance, instance_start);
+
+  data->last_instance = instance;
+
+  return data->callback (instance, instance_start, instance_end, data->callback_data, cancellable, error);
+}
+
+static void
+stub_generate_instances (ICalComponent       *icomponent,
+                         time_t               range_start,
+                         time_t               range_end,
+                         GCancellable        *cancellable,
+                         ECalRecurInstanceCb  callback,
+                         gpointer             callback_data,
+                         gpointer             user_data)
+{
+  g_autoptr (ICalTime) start = NULL;
+  g_autoptr (ICalTime) end = NULL;
+  GenerateData *data = user_data;
+
+  if (!e_cal_util_component_has_recurrences (icomponent))
+    {
+      start = i_cal_component_get_dtstart (icomponent);
+      end = i_cal_component_get_dtend (icomponent);
+
+      callback (icomponent, start, end, callback_data, cancellable, NULL);
+      return;
+    }
+
+  data->callback = callback;
+  data->callback_data = callback_data;
+
+  start = i_cal_time_new_from_timet_with_zone (range_start, FALSE, i_cal_timezone_get_utc_timezone ());
+  end = i_cal_time_new_from_timet_with_zone (range_end, FALSE, i_cal_timezone_get_utc_timezone ());
+
+  e_cal_recur_generate_instances_sync (icomponent,
+                                       start,
+                                       end,
+                                       recur_instance_cb,
+                                       data,
+                                       NULL,
+                                       NULL,
+                                       i_cal_timezone_get_utc_timezone (),
+                                       cancellable,
+                                       NULL);
+}
+
+static GcalEvent*
+get_last_event (GPtrArray *events)
+{
+  return g_ptr_array_index (events, events->len - 1);
+}
+
+/*********************************************************************************************************************/
+
+static void
+calendar_monitor_instance_ownership (void)
+{
+  g_autoptr (ICalComponent) recurring = NULL;
+  g_autoptr (ICalComponent) single = NULL;
+  g_autoptr (GcalCalendar) calendar = NULL;
+  g_autoptr (GPtrArray) events = NULL;
+  g_autoptr (GError) error = NULL;
+  ECalComponent *ecomponent;
+  GenerateData data = { NULL, };
+  guint n_hidden;
+
+  calendar = gcal_stub_calendar_new (NULL, &error);
+  g_assert_no_error (error);
+
+  /* Non-recurring events are passed as the caller's component, which must not be shared */
+  single = i_cal_component_new_from_string (SINGLE_EVENT);
+  events = gcal_calendar_monitor_expand_series (calendar,
+                                                single,
+                                                JANUARY_START,
+                                                JANUARY_END,
+                                                stub_generate_instances,
+                                                &data,
+                                                NULL,
+                                                &n_hidden);
+
+  g_assert_cmpuint (events->len, ==, 1);
+  g_assert_cmpuint (n_hidden, ==, 0);
+
+  ecomponent = gcal_event_get_component (get_last_event (events));
+  g_assert_true (e_cal_component_get_icalcomponent (ecomponent) != single);
+
+  gcal_event_set_summary (get_last_event (events), "Changed");
+  g_assert_cmpstr (i_cal_component_get_summary (single), ==, "Single event");
+
+  g_clear_pointer (&events, g_ptr_array_unref);
+
+  /* Instances of recurring events are built for the event, and adopted */
+  recurring = i_cal_component_new_from_string (RECURRING_EVENT ("FREQ=DAILY;COUNT=3"));
+  events = gcal_calendar_monitor_expand_series (calendar,
+                                                recurring,
+                                                JANUARY_START,
+                                                JANUARY_END,
+                                                stub_generate_instances,
+                                                &data,
+                                                NULL,
+                                                &n_hidden);
+
+  g_assert_cmpuint (events->len, ==, 3);
+  g_assert_cmpuint (n_hidden, ==, 0);
+
+  ecomponent = gcal_event_get_component (get_last_event (events));
+  g_assert_true (e_cal_component_get_icalcomponent (ecomponent) == data.last_instance);
+}
+
+/*********************************************************************************************************************/
+
+static void
+calendar_monitor_truncated_series (void)
+{
+  g_autoptr (ICalComponent) component = NULL;
+  g_autoptr (GcalCalendar) calendar = NULL;
+  g_autoptr (GPtrArray) events = NULL;
+  g_autoptr (GDateTime) series_start = NULL;
+  g_autoptr (GDateTime) last_start = NULL;
+  g_autoptr (GError) error = NULL;
+  GenerateData data = { NULL, };
+  guint n_hidden;
+  guint i;
+
+  calendar = gcal_stub_calendar_new (NULL, &error);
+  g_assert_no_error (error);
+
+  /* Instances past the budget are counted, and not turned into events */
+  component = i_cal_component_new_from_string (RECURRING_EVENT ("FREQ=MINUTELY;COUNT=1500"));
+  events = gcal_calendar_monitor_expand_series (calendar,
+                                                component,
+                                                JANUARY_START,
+                                                JANUARY_END,
+                                                stub_generate_instances,
+                                                &data,
+                                                NULL,
+                                                &n_hidden);
+
+  g_assert_cmpuint (events->len, ==, MAX_INSTANCES_PER_SERIES);
+  g_assert_cmpuint (n_hidden, ==, 1500 - MAX_INSTANCES_PER_SERIES);
+
+  /* The first instances are the ones kept */
+  series_start = g_date_time_new_utc (2024, 1, 1, 10, 0, 0);
+  last_start = g_date_time_add_minutes (series_start, MAX_INSTANCES_PER_SERIES - 1);
+  g_assert_true (g_date_time_equal (gcal_event_get_date_start (get_last_event (events)), last_start));
+
+  /* Only the last kept instance carries the hidden count */
+  for (i = 0; i < events->len; i++)
+    {
+      GcalEvent *event = g_ptr_array_index (events, i);
+
+      if (event == get_last_event (events))
+        g_assert_cmpuint (gcal_event_get_n_hidden_occurrences (event), ==, n_hidden);
+      else
+        g_assert_cmpuint (gcal_event_get_n_hidden_occurrences (event), ==, 0);
+    }
+
+  g_clear_pointer (&events, g_ptr_array_unref);
+  g_clear_pointer (&component, g_object_unref);
+
+  /* Unbounded series stop generating once enough instances are hidden */
+  component = i_cal_component_new_from_string (RECURRING_EVENT ("FREQ=MINUTELY"));
+  events = gcal_calendar_monitor_expand_series (calendar,
+                                                component,
+                                                JANUARY_START,
+                                                JANUARY_END,
+                                                stub_generate_instances,
+                                                &data,
+                                                NULL,
+                                                &n_hidden);
+
+  g_assert_cmpuint (events->len, ==, MAX_INSTANCES_PER_SERIES);
+  g_assert_cmpuint (n_hidden, ==, MAX_HIDDEN_INSTANCES_PER_SERIES);
+  g_assert_cmpuint (gcal_event_get_n_hidden_occurrences (get_last_event (events)), ==, MAX_HIDDEN_INSTANCES_PER_SERIES);
+}
+
+/*********************************************************************************************************************/
+
+#define N_BENCHMARK_YEARS 2
+
+static void
+calendar_monitor_expansion_benchmark (void)
+{
+  g_autoptr (ICalComponent) component = NULL;
+  g_autoptr (GcalCalendar) calendar = NULL;
+  g_autoptr (GPtrArray) events = NULL;
+  g_autoptr (GError) error = NULL;
+  GenerateData data = { NULL, };
+  gdouble elapsed;
+  time_t range_end;
+
+  if (!g_test_perf ())
+    {
+      g_test_skip ("Only runs in perf mode");
+      return;
+    }
+
+  calendar = gcal_stub_calendar_new (NULL, &error);
+  g_assert_no_error (error);
+
+  /* Stays within the per-series budget, so that every instance is built */
+  component = i_cal_component_new_from_string (RECURRING_EVENT ("FREQ=DAILY"));
+  range_end = JANUARY_START + N_BENCHMARK_YEARS * 365 * 24 * 60 * 60;
+
+  g_test_timer_start ();
+  events = gcal_calendar_monitor_expand_series (calendar,
+                                                component,
+                                                JANUARY_START,
+                                                range_end,
+                                                stub_generate_instances,
+                                                &data,
+                                                NULL,
+                                                NULL);
+  elapsed = g_test_timer_elapsed ();
+
+  g_assert_cmpuint (events->len, >, 0);
+
+  g_test_message ("Expanded %u instances (estimated %u) in %.3f ms",
+                  events->len,
+                  gcal_calendar_monitor_estimate_n_instances (component, JANUARY_START, range_end),
+                  elapsed * 1000);
+
+  g_test_maximized_result (events->len / elapsed, "%.0f instances per second", events->len / elapsed);
+}
+
+/*********************************************************************************************************************/
+
+gint
+main (gint   argc,
+      gchar *argv[])
+{
+  g_setenv ("TZ", "UTC", TRUE);
+
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/calendar-monitor/estimate", calendar_monitor_estimate);
+  g_test_add_func ("/calendar-monitor/instance-ownership", calendar_monitor_instance_ownership);
+  g_test_add_func ("/calendar-monitor/truncated-series", calendar_monitor_truncated_series);
+  g_test_add_func ("/calendar-monitor/expansion-benchmark", calendar_monitor_expansion_benchmark);
+
+  return g_test_run ();
+}
@@ -0,0 +1,473 @@
+/* test-event-archive.c
+ *
+ * Copyright 2024 Georges Basile Stavracas Neto <georges.stavracas@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <unistd.h>
+
+#include "gcal-event-archive.h"
+
+#define TIMED_EVENT "BEGIN:VEVENT\n"                                        \
+                    "UID:timed@uid\n"                                       \
+                    "SUMMARY:Weekly meeting\n"                              \
+                    "LOCATION:Room 1\n"                                     \
+                    "DESCRIPTION:Discuss things\n"                          \
+                    "DTSTART;TZID=Europe/Berlin:20240311T100000\n"          \
+                    "DTEND;TZID=Europe/Berlin:20240311T110000\n"            \
+                    "RRULE:FREQ=WEEKLY;BYDAY=MO\n"                          \
+                    "ORGANIZER:mailto:alice@example.com\n"                  \
+                    "ATTENDEE:mailto:bob@example.com\n"                     \
+                    "ATTENDEE:mailto:carol@example.com\n"                   \
+                    "EXDATE;TZID=Europe/Berlin:20240325T100000\n"           \
+                    "RDATE;TZID=Europe/Berlin:20240402T100000\n"            \
+                    "BEGIN:VALARM\n"                                        \
+                    "ACTION:DISPLAY\n"                                      \
+                    "DESCRIPTION:Weekly meeting\n"                          \
+                    "TRIGGER:-PT15M\n"                                      \
+                    "END:VALARM\n"                                          \
+                    "END:VEVENT\n"
+
+#define ALL_DAY_EVENT "BEGIN:VEVENT\n"                                      \
+                      "UID:all-day@uid\n"                                   \
+                      "SUMMARY:Holiday\n"                                   \
+                      "DTSTART;VALUE=DATE:20240101\n"                       \
+                      "DTEND;VALUE=DATE:20240102\n"                         \
+                      "END:VEVENT\n"
+
+#define UTC_EVENT "BEGIN:VEVENT\n"                                          \
+                  "UID:timed@uid\n"                                         \
+                  "RECURRENCE-ID;TZID=Europe/Berlin:20240318T100000\n"      \
+                  "SUMMARY:Weekly meeting (moved)\n"                        \
+                  "DTSTART:20240318T150000Z\n"                              \
+                  "ORGANIZER:mailto:alice@example.com\n"                    \
+                  "ATTENDEE:mailto:bob@example.com\n"                       \
+                  "END:VEVENT\n"
+
+#define NO_UID_EVENT "BEGIN:VEVENT\n"                                       \
+                     "SUMMARY:Lost event\n"                                 \
+                     "DTSTART:20240318T150000Z\n"                           \
+                     "END:VEVENT\n"
+
+static GBytes*
+write_archive (const gchar * const *components)
+{
+  g_autoptr (GcalEventArchiveWriter) writer = NULL;
+  guint i;
+
+  writer = gcal_event_archive_writer_new ();
+
+  for (i = 0; components[i]; i++)
+    {
+      g_autoptr (ICalComponent) component = i_cal_component_new_from_string (components[i]);
+      g_autoptr (GError) error = NULL;
+
+      g_assert_nonnull (component);
+      g_assert_true (gcal_event_archive_writer_add_component (writer, component, &error));
+      g_assert_no_error (error);
+    }
+
+  return gcal_event_archive_writer_to_bytes (writer);
+}
+
+static gchar*
+dup_recurrence_id_tzid (ICalComponent *component)
+{
+  g_autoptr (ICalParameter) parameter = NULL;
+  g_autoptr (ICalProperty) property = NULL;
+
+  property = i_cal_component_get_first_property (component, I_CAL_RECURRENCEID_PROPERTY);
+  if (!property)
+    return NULL;
+
+  parameter = i_cal_property_get_first_parameter (property, I_CAL_TZID_PARAMETER);
+  if (!parameter)
+    return NULL;
+
+  return g_strdup (i_cal_parameter_get_tzid (parameter));
+}
+
+static GPtrArray*
+collect_property_strings (ICalComponent    *component,
+                          ICalPropertyKind  kind)
+{
+  g_autoptr (GPtrArray) strings = NULL;
+  ICalProperty *property;
+
+  strings = g_ptr_array_new_with_free_func (g_free);
+
+  for (property = i_cal_component_get_first_property (component, kind);
+       property;
+       property = i_cal_component_get_next_property (component, kind))
+    {
+      g_ptr_array_add (strings, i_cal_property_as_ical_string (property));
+      g_object_unref (property);
+    }
+
+  return g_steal_pointer (&strings);
+}
+
+static void
+assert_alarms_equal (ICalComponent *a,
+                     ICalComponent *b)
+{
+  g_autoptr (ICalComponent) a_alarm = NULL;
+  g_autoptr (ICalComponent) b_alarm = NULL;
+  g_autoptr (GPtrArray) a_triggers = NULL;
+  g_autoptr (GPtrArray) b_triggers = NULL;
+  guint i;
+
+  g_assert_cmpint (i_cal_component_count_components (a, I_CAL_VALARM_COMPONENT), ==,
+                   i_cal_component_count_components (b, I_CAL_VALARM_COMPONENT));
+
+  a_alarm = i_cal_component_get_first_component (a, I_CAL_VALARM_COMPONENT);
+  b_alarm = i_cal_component_get_first_component (b, I_CAL_VALARM_COMPONENT);
+
+  if (!a_alarm)
+    return;
+
+  a_triggers = collect_property_strings (a_alarm, I_CAL_TRIGGER_PROPERTY);
+  b_triggers = collect_property_strings (b_alarm, I_CAL_TRIGGER_PROPERTY);
+
+  g_assert_cmpuint (a_triggers->len, ==, b_triggers->len);
+  for (i = 0; i < a_triggers->len; i++)
+    g_assert_cmpstr (g_ptr_array_index (a_triggers, i), ==, g_ptr_array_index (b_triggers, i));
+}
+
+static void
+assert_properties_equal (ICalComponent    *a,
+                         ICalComponent    *b,
+                         ICalPropertyKind  kind)
+{
+  g_autoptr (GPtrArray) a_strings = collect_property_strings (a, kind);
+  g_autoptr (GPtrArray) b_strings = collect_property_strings (b, kind);
+  guint i;
+
+  g_assert_cmpuint (a_strings->len, ==, b_strings->len);
+  for (i = 0; i < a_strings->len; i++)
+    g_assert_cmpstr (g_ptr_array_index (a_strings, i), ==, g_ptr_array_index (b_strings, i));
+}
+
+static void
+assert_components_equal (ICalComponent *a,
+                         ICalComponent *b)
+{
+  g_autoptr (ICalTime) a_start = i_cal_component_get_dtstart (a);
+  g_autoptr (ICalTime) b_start = i_cal_component_get_dtstart (b);
+  g_autoptr (ICalTime) a_end = i_cal_component_get_dtend (a);
+  g_autoptr (ICalTime) b_end = i_cal_component_get_dtend (b);
+  g_autoptr (ICalTime) a_rid = i_cal_component_get_recurrenceid (a);
+  g_autoptr (ICalTime) b_rid = i_cal_component_get_recurrenceid (b);
+  g_autofree gchar *a_rid_tzid = dup_recurrence_id_tzid (a);
+  g_autofree gchar *b_rid_tzid = dup_recurrence_id_tzid (b);
+
+  g_assert_cmpstr (i_cal_component_get_uid (a), ==, i_cal_component_get_uid (b));
+  g_assert_cmpstr (i_cal_component_get_summary (a), ==, i_cal_component_get_summary (b));
+  g_assert_cmpstr (i_cal_component_get_location (a), ==, i_cal_component_get_location (b));
+  g_assert_cmpstr (i_cal_component_get_description (a), ==, i_cal_component_get_description (b));
+  g_assert_cmpint (i_cal_time_compare (a_start, b_start), ==, 0);
+  g_assert_cmpint (i_cal_time_is_date (a_start), ==, i_cal_time_is_date (b_start));
+  g_assert_cmpint (i_cal_time_compare (a_end, b_end), ==, 0);
+  g_assert_cmpint (i_cal_time_is_null_time (a_rid), ==, i_cal_time_is_null_time (b_rid));
+  g_assert_cmpint (i_cal_time_compare (a_rid, b_rid), ==, 0);
+  g_assert_cmpstr (a_rid_tzid, ==, b_rid_tzid);
+  g_assert_cmpint (i_cal_component_count_properties (a, I_CAL_ATTENDEE_PROPERTY), ==,
+                   i_cal_component_count_properties (b, I_CAL_ATTENDEE_PROPERTY));
+  g_assert_cmpint (i_cal_component_count_properties (a, I_CAL_RRULE_PROPERTY), ==,
+                   i_cal_component_count_properties (b, I_CAL_RRULE_PROPERTY));
+  assert_properties_equal (a, b, I_CAL_EXDATE_PROPERTY);
+  assert_properties_equal (a, b, I_CAL_RDATE_PROPERTY);
+  assert_alarms_equal (a, b);
+}
+
+/*********************************************************************************************************************/
+
+static void
+event_archive_round_trip (void)
+{
+  g_autoptr (GcalEventArchive) archive = NULL;
+  g_autoptr (GBytes) bytes = NULL;
+  g_autoptr (GError) error = NULL;
+  const gchar *components[] = { TIMED_EVENT, ALL_DAY_EVENT, UTC_EVENT, NULL };
+  GcalEventArchiveRecord record;
+  guint i;
+
+  bytes = write_archive (components);
+  archive = gcal_event_archive_new_from_bytes (bytes, &error);
+  g_assert_no_error (error);
+  g_assert_nonnull (archive);
+  g_assert_cmpuint (gcal_event_archive_get_n_records (archive), ==, 3);
+
+  gcal_event_archive_get_record (archive, 0, &record);
+  g_assert_cmpstr (record.uid, ==, "timed@uid");
+  g_assert_null (record.recurrence_id);
+  g_assert_cmpstr (record.summary, ==, "Weekly meeting");
+  g_assert_cmpstr (record.location, ==, "Room 1");
+  g_assert_cmpstr (record.start_tzid, ==, "Europe/Berlin");
+  g_assert_cmpstr (record.end_tzid, ==, "Europe/Berlin");
+  g_assert_cmpstr (record.organizer, ==, "mailto:alice@example.com");
+  g_assert_nonnull (record.rrule);
+  g_assert_true (record.has_end);
+  g_assert_false (record.all_day);
+  g_assert_cmpint (record.end - record.start, ==, 3600);
+  g_assert_cmpuint (record.n_attendees, ==, 2);
+  g_assert_cmpstr (gcal_event_archive_get_attendee (archive, &record, 0), ==, "mailto:bob@example.com");
+  g_assert_cmpstr (gcal_event_archive_get_attendee (archive, &record, 1), ==, "mailto:carol@example.com");
+  g_assert_cmpuint (record.n_recurrence_dates, ==, 2);
+  g_assert_cmpuint (record.n_alarms, ==, 1);
+  g_assert_nonnull (strstr (gcal_event_archive_get_alarm (archive, &record, 0), "TRIGGER:-PT15M"));
+
+  gcal_event_archive_get_record (archive, 1, &record);
+  g_assert_cmpstr (record.uid, ==, "all-day@uid");
+  g_assert_true (record.all_day);
+  g_assert_null (record.start_tzid);
+  g_assert_null (record.location);
+  g_assert_cmpuint (record.n_attendees, ==, 0);
+  g_assert_cmpuint (record.n_recurrence_dates, ==, 0);
+  g_assert_cmpuint (record.n_alarms, ==, 0);
+
+  gcal_event_archive_get_record (archive, 2, &record);
+  g_assert_cmpstr (record.start_tzid, ==, "UTC");
+  g_assert_cmpstr (record.recurrence_id, ==, "20240318T100000");
+  g_assert_cmpstr (record.recurrence_id_tzid, ==, "Europe/Berlin");
+  g_assert_false (record.has_end);
+
+  /* Repeated strings are stored once, and point to the same memory */
+  {
+    GcalEventArchiveRecord first;
+
+    gcal_event_archive_get_record (archive, 0, &first);
+    g_assert_true (first.uid == record.uid);
+    g_assert_true (first.organizer == record.organizer);
+  }
+
+  for (i = 0; components[i]; i++)
+    {
+      g_autoptr (ICalComponent) original = i_cal_component_new_from_string (components[i]);
+      g_autoptr (ICalComponent) rebuilt = gcal_event_archive_build_component (archive, i);
+
+      assert_components_equal (original, rebuilt);
+    }
+}
+
+/*********************************************************************************************************************/
+
+static void
+event_archive_file (void)
+{
+  g_autoptr (GcalEventArchive) archive = NULL;
+  g_autoptr (GBytes) bytes = NULL;
+  g_autoptr (GError) error = NULL;
+  g_autofree gchar *path = NULL;
+  const gchar *components[] = { TIMED_EVENT, ALL_DAY_EVENT, NULL };
+  GcalEventArchiveRecord record;
+  gint fd;
+
+  bytes = write_archive (components);
+
+  fd = g_file_open_tmp ("event-archive-XXXXXX", &path, &error);
+  g_assert_no_error (error);
+  close (fd);
+
+  g_file_set_contents (path, g_bytes_get_data (bytes, NULL), g_bytes_get_size (bytes), &error);
+  g_assert_no_error (error);
+
+  archive = gcal_event_archive_new_from_file (path, &error);
+  g_assert_no_error (error);
+  g_assert_cmpuint (gcal_event_archive_get_n_records (archive), ==, 2);
+
+  gcal_event_archive_get_record (archive, 1, &record);
+  g_assert_cmpstr (record.summary, ==, "Holiday");
+
+  g_unlink (path);
+}
+
+/*********************************************************************************************************************/
+
+static void
+event_archive_invalid (void)
+{
+  const gchar *components[] = { TIMED_EVENT, UTC_EVENT, NULL };
+  g_autoptr (GBytes) bytes = NULL;
+  const guint8 *data;
+  gsize size;
+  gsize i;
+
+  bytes = write_archive (components);
+  data = g_bytes_get_data (bytes, &size);
+
+  /* Every truncation must be rejected, not read out of bounds */
+  for (i = 0; i < size; i++)
+    {
+      g_autoptr (GcalEventArchive) archive = NULL;
+      g_autoptr (GBytes) truncated = NULL;
+      g_autoptr (GError) error = NULL;
+
+      truncated = g_bytes_new (data, i);
+      archive = gcal_event_archive_new_from_bytes (truncated, &error);
+
+      g_assert_null (archive);
+      g_assert_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+    }
+
+  {
+    g_autoptr (GcalEventArchive) archive = NULL;
+    g_autoptr (GBytes) garbage = NULL;
+    g_autoptr (GError) error = NULL;
+
+    garbage = g_bytes_new_static ("BEGIN:VCALENDAR\r\n", 17);
+    archive = gcal_event_archive_new_from_bytes (garbage, &error);
+
+    g_assert_null (archive);
+    g_assert_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+  }
+}
+
+/*********************************************************************************************************************/
+
+static void
+event_archive_missing_uid (void)
+{
+  g_autoptr (GcalEventArchiveWriter) writer = NULL;
+  g_autoptr (GcalEventArchive) archive = NULL;
+  g_autoptr (ICalComponent) no_uid = NULL;
+  g_autoptr (ICalComponent) timed = NULL;
+  g_autoptr (GBytes) bytes = NULL;
+  g_autoptr (GError) error = NULL;
+  GcalEventArchiveRecord record;
+
+  writer = gcal_event_archive_writer_new ();
+
+  no_uid = i_cal_component_new_from_string (NO_UID_EVENT);
+  g_assert_false (gcal_event_archive_writer_add_component (writer, no_uid, &error));
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+  g_clear_error (&error);
+
+  timed = i_cal_component_new_from_string (TIMED_EVENT);
+  g_assert_true (gcal_event_archive_writer_add_component (writer, timed, &error));
+  g_assert_no_error (error);
+
+  /* The refused component must not invalidate the rest of the archive */
+  bytes = gcal_event_archive_writer_to_bytes (writer);
+  archive = gcal_event_archive_new_from_bytes (bytes, &error);
+  g_assert_no_error (error);
+  g_assert_nonnull (archive);
+  g_assert_cmpuint (gcal_event_archive_get_n_records (archive), ==, 1);
+
+  gcal_event_archive_get_record (archive, 0, &record);
+  g_assert_cmpstr (record.uid, ==, "timed@uid");
+}
+
+/*********************************************************************************************************************/
+
+#define N_BENCHMARK_EVENTS 10000
+
+static void
+event_archive_benchmark (void)
+{
+  g_autoptr (GcalEventArchiveWriter) writer = NULL;
+  g_autoptr (GcalEventArchive) archive = NULL;
+  g_autoptr (ICalComponent) vcalendar = NULL;
+  g_autoptr (ICalComponent) parsed = NULL;
+  g_autoptr (GBytes) bytes = NULL;
+  g_autoptr (GError) error = NULL;
+  g_autofree gchar *text = NULL;
+  gdouble text_time;
+  gdouble binary_time;
+  guint n_records;
+  guint i;
+
+  if (!g_test_perf ())
+    {
+      g_test_skip ("Only runs in perf mode");
+      return;
+    }
+
+  writer = gcal_event_archive_writer_new ();
+  vcalendar = i_cal_component_new_vcalendar ();
+
+  for (i = 0; i < N_BENCHMARK_EVENTS; i++)
+    {
+      g_autoptr (ICalComponent) component = NULL;
+      g_autofree gchar *str = NULL;
+
+      str = g_strdup_printf ("BEGIN:VEVENT\n"
+                             "UID:event-%u@uid\n"
+                             "SUMMARY:Event %u\n"
+                             "LOCATION:Room %u\n"
+                             "DTSTART;TZID=Europe/Berlin:20240311T%02u0000\n"
+                             "DTEND;TZID=Europe/Berlin:20240311T%02u3000\n"
+                             "ORGANIZER:mailto:organizer%u@example.com\n"
+                             "ATTENDEE:mailto:attendee%u@example.com\n"
+                             "ATTENDEE:mailto:attendee%u@example.com\n"
+                             "END:VEVENT\n",
+                             i, i, i % 10, i % 24, i % 24, i % 5, i % 20, (i + 1) % 20);
+
+      component = i_cal_component_new_from_string (str);
+      gcal_event_archive_writer_add_component (writer, component, NULL);
+      i_cal_component_take_component (vcalendar, g_steal_pointer (&component));
+    }
+
+  text = i_cal_component_as_ical_string (vcalendar);
+  bytes = gcal_event_archive_writer_to_bytes (writer);
+
+  g_test_timer_start ();
+  parsed = i_cal_parser_parse_string (text);
+  text_time = g_test_timer_elapsed ();
+
+  g_assert_cmpint (i_cal_component_count_components (parsed, I_CAL_VEVENT_COMPONENT), ==, N_BENCHMARK_EVENTS);
+
+  g_test_timer_start ();
+  archive = gcal_event_archive_new_from_bytes (bytes, &error);
+  n_records = gcal_event_archive_get_n_records (archive);
+  for (i = 0; i < n_records; i++)
+    {
+      GcalEventArchiveRecord record;
+
+      gcal_event_archive_get_record (archive, i, &record);
+    }
+  binary_time = g_test_timer_elapsed ();
+
+  g_assert_no_error (error);
+  g_assert_cmpuint (n_records, ==, N_BENCHMARK_EVENTS);
+
+  g_test_message ("iCalendar: %zu bytes, parsed in %.3f ms", strlen (text), text_time * 1000);
+  g_test_message ("Archive: %zu bytes, read in %.3f ms", g_bytes_get_size (bytes), binary_time * 1000);
+
+  g_test_minimized_result (binary_time, "archive read time: %.3f ms", binary_time * 1000);
+}
+
+/*********************************************************************************************************************/
+
+gint
+main (gint   argc,
+      gchar *argv[])
+{
+  g_setenv ("TZ", "UTC", TRUE);
+
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/event-archive/round-trip", event_archive_round_trip);
+  g_test_add_func ("/event-archive/file", event_archive_file);
+  g_test_add_func ("/event-archive/invalid", event_archive_invalid);
+  g_test_add_func ("/event-archive/missing-uid", event_archive_missing_uid);
+  g_test_add_func ("/event-archive/benchmark", event_archive_benchmark);
+
+  return g_test_run ();
+}
@@ -143,6 +143,28 @@ event_summary (void)
 
 /*********************************************************************************************************************/
 
+static void
+event_shared_texts (void)
+{
+  g_autoptr (GcalEvent) event = NULL;
+  g_autoptr (GcalEvent) clone = NULL;
+  g_autoptr (GcalEvent) other = NULL;
+
+  event = create_event_for_string (STUB_EVENT, NULL);
+  clone = gcal_event_new_from_event (event);
+  other = create_event_for_string (STUB_EVENT_DTEND, NULL);
+
+  /* Equal texts are the same string, shared between events */
+  g_assert_true (gcal_event_get_summary (event) == gcal_event_get_summary (clone));
+  g_assert_true (gcal_event_get_location (event) == gcal_event_get_location (other));
+
+  gcal_event_set_summary (clone, "Stub all day");
+  g_assert_true (gcal_event_get_summary (clone) == gcal_event_get_summary (other));
+  g_assert_cmpstr (gcal_event_get_summary (event), ==, "Stub event");
+}
+
+/*********************************************************************************************************************/
+
 static void
 event_no_dtend (void)
 {
@@ -287,6 +309,32 @@ event_date_multiday (void)
 
 /*********************************************************************************************************************/
 
+static void
+event_compare (void)
+{
+  g_autoptr (GcalEvent) short_event = NULL;
+  g_autoptr (GcalEvent) long_event = NULL;
+  g_autoptr (GDateTime) new_end = NULL;
+
+  short_event = create_event_for_string (EVENT_STRING_FOR_DATE (":20160229T100000Z", ":20160229T110000Z"), NULL);
+  long_event = create_event_for_string (EVENT_STRING_FOR_DATE (":20160229T100000Z", ":20160229T120000Z"), NULL);
+
+  /* Same start, shorter events first */
+  g_assert_cmpint (gcal_event_compare (short_event, long_event), <, 0);
+  g_assert_cmpint (gcal_event_compare (long_event, short_event), >, 0);
+  g_assert_cmpint (gcal_event_compare (short_event, short_event), ==, 0);
+  g_assert_false (gcal_event_is_multiday (long_event));
+
+  /* Cached sort keys must follow date changes */
+  new_end = g_date_time_new_utc (2016, 3, 2, 12, 0, 0);
+  gcal_event_set_date_end (short_event, new_end);
+
+  g_assert_true (gcal_event_is_multiday (short_event));
+  g_assert_cmpint (gcal_event_compare (short_event, long_event), >, 0);
+}
+
+/*********************************************************************************************************************/
+
 static void
 event_date_create_tzid (void)
 {
@@ -451,11 +499,13 @@ main (gint   argc,
   g_test_add_func ("/event/clone", event_clone);
   g_test_add_func ("/event/uid", event_uid);
   g_test_add_func ("/event/summary", event_summary);
+  g_test_add_func ("/event/shared-texts", event_shared_texts);
   g_test_add_func ("/event/nodtend", event_no_dtend);
   g_test_add_func ("/event/date/start", event_date_start);
   g_test_add_func ("/event/date/end", event_date_end);
   g_test_add_func ("/event/date/singleday", event_date_singleday);
   g_test_add_func ("/event/date/multiday", event_date_multiday);
+  g_test_add_func ("/event/compare", event_compare);
   g_test_add_func ("/event/date/edit-tzid", event_date_edit_tzid);
   g_test_add_func ("/event/date/create-tzid", event_date_create_tzid);
   g_test_add_func ("/event/date/check-tz", event_date_check_tz);
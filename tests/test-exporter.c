@@ -0,0 +1,331 @@
+/* test-exporter.c
+ *
+ * Copyright 2024 Georges Basile Stavracas Neto <georges.stavracas@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <libecal/libecal.h>
+#include <string.h>
+
+#include "gcal-exporter.h"
+#include "gcal-exporter-private.h"
+#include "gcal-stub-calendar.h"
+
+#define N_BATCHES 4
+#define EVENTS_PER_BATCH 25
+
+#define ORIGINAL_CONTENTS "BEGIN:VCALENDAR\r\nEND:VCALENDAR\r\n"
+
+/*
+ * Stub backend
+ *
+ * Delivers N_BATCHES batches of EVENTS_PER_BATCH events, like a view
+ * would, and optionally fails after the first batch.
+ */
+
+static gboolean fail_after_first_batch = FALSE;
+
+static gboolean
+stub_query_components (GcalCalendar              *calendar,
+                       const gchar               *sexp,
+                       GcalExportComponentsFunc   func,
+                       gpointer                   user_data,
+                       GCancellable              *cancellable,
+                       GError                   **error)
+{
+  guint batch;
+  guint i;
+
+  for (batch = 0; batch < N_BATCHES; batch++)
+    {
+      g_autoslist (ICalComponent) components = NULL;
+
+      if (batch > 0 && fail_after_first_batch)
+        {
+          g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_FAILED, "Calendar went away");
+          return FALSE;
+        }
+
+      for (i = 0; i < EVENTS_PER_BATCH; i++)
+        {
+          g_autofree gchar *string = NULL;
+          guint n = batch * EVENTS_PER_BATCH + i;
+
+          string = g_strdup_printf ("BEGIN:VEVENT\n"
+                                    "UID:event-%u@uid\n"
+                                    "SUMMARY:Event %u\n"
+                                    "DTSTAMP:20240101T000000Z\n"
+                                    "DTSTART;TZID=Europe/Berlin:202401%02uT100000\n"
+                                    "DTEND;TZID=Europe/Berlin:202401%02uT110000\n"
+                                    "END:VEVENT\n",
+                                    n, n, n % 28 + 1, n % 28 + 1);
+
+          components = g_slist_prepend (components, i_cal_component_new_from_string (string));
+        }
+
+      if (!func (components, user_data, error))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static ICalTimezone*
+stub_get_timezone (GcalCalendar *calendar,
+                   const gchar  *tzid,
+                   GCancellable *cancellable)
+{
+  return i_cal_timezone_get_builtin_timezone (tzid);
+}
+
+static const GcalExportBackend stub_backend = {
+  .query_components = stub_query_components,
+  .get_timezone = stub_get_timezone,
+};
+
+
+/*
+ * Auxiliary methods
+ */
+
+static void
+on_export_finished_cb (GObject      *source_object,
+                       GAsyncResult *result,
+                       gpointer      user_data)
+{
+  GAsyncResult **out_result = user_data;
+
+  *out_result = g_object_ref (result);
+}
+
+static GAsyncResult*
+wait_for_result (GAsyncResult **result)
+{
+  while (!*result)
+    g_main_context_iteration (NULL, TRUE);
+
+  return *result;
+}
+
+static guint
+count_occurrences (const gchar *haystack,
+                   const gchar *needle)
+{
+  const gchar *p;
+  guint n = 0;
+
+  for (p = strstr (haystack, needle); p; p = strstr (p + 1, needle))
+    n++;
+
+  return n;
+}
+
+static GPtrArray*
+create_calendars (void)
+{
+  g_autoptr (GPtrArray) calendars = NULL;
+  g_autoptr (GError) error = NULL;
+
+  calendars = g_ptr_array_new_with_free_func (g_object_unref);
+  g_ptr_array_add (calendars, gcal_stub_calendar_new (NULL, &error));
+  g_assert_no_error (error);
+
+  return g_steal_pointer (&calendars);
+}
+
+
+/*********************************************************************************************************************/
+
+static void
+exporter_stream (void)
+{
+  g_autoptr (GOutputStream) stream = NULL;
+  g_autoptr (GAsyncResult) result = NULL;
+  g_autoptr (GPtrArray) calendars = NULL;
+  g_autoptr (GError) error = NULL;
+  g_autofree gchar *output = NULL;
+  guint n_exported;
+  guint i;
+
+  fail_after_first_batch = FALSE;
+  gcal_exporter_set_backend_for_testing (&stub_backend);
+
+  calendars = create_calendars ();
+  stream = g_memory_output_stream_new_resizable ();
+
+  gcal_exporter_export_to_stream (calendars, NULL, stream, NULL, NULL, NULL, on_export_finished_cb, &result);
+  gcal_exporter_export_to_stream_finish (wait_for_result (&result), &n_exported, &error);
+  g_assert_no_error (error);
+
+  g_assert_cmpuint (n_exported, ==, N_BATCHES * EVENTS_PER_BATCH);
+
+  g_output_stream_write_all (stream, "", 1, NULL, NULL, &error);
+  g_assert_no_error (error);
+  output = g_memory_output_stream_steal_data (G_MEMORY_OUTPUT_STREAM (stream));
+
+  g_assert_true (g_str_has_prefix (output, "BEGIN:VCALENDAR\r\n"));
+  g_assert_true (g_str_has_suffix (output, "END:VCALENDAR\r\n"));
+  g_assert_cmpuint (count_occurrences (output, "BEGIN:VEVENT"), ==, N_BATCHES * EVENTS_PER_BATCH);
+
+  /* Timezones are written once */
+  g_assert_cmpuint (count_occurrences (output, "BEGIN:VTIMEZONE"), ==, 1);
+  g_assert_cmpint (strstr (output, "BEGIN:VTIMEZONE") - output, <, strstr (output, "BEGIN:VEVENT") - output);
+
+  for (i = 0; i < N_BATCHES * EVENTS_PER_BATCH; i++)
+    {
+      g_autofree gchar *uid = g_strdup_printf ("UID:event-%u@uid\r\n", i);
+      g_assert_cmpuint (count_occurrences (output, uid), ==, 1);
+    }
+
+  gcal_exporter_set_backend_for_testing (NULL);
+}
+
+/*********************************************************************************************************************/
+
+static void
+exporter_stream_failure (void)
+{
+  g_autoptr (GOutputStream) stream = NULL;
+  g_autoptr (GAsyncResult) result = NULL;
+  g_autoptr (GPtrArray) calendars = NULL;
+  g_autoptr (GError) error = NULL;
+
+  fail_after_first_batch = TRUE;
+  gcal_exporter_set_backend_for_testing (&stub_backend);
+
+  calendars = create_calendars ();
+  stream = g_memory_output_stream_new_resizable ();
+
+  gcal_exporter_export_to_stream (calendars, NULL, stream, NULL, NULL, NULL, on_export_finished_cb, &result);
+  gcal_exporter_export_to_stream_finish (wait_for_result (&result), NULL, &error);
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_FAILED);
+
+  /* The first batch fits in the write buffer, and is dropped with it */
+  g_clear_object (&result);
+  g_assert_cmpuint (g_memory_output_stream_get_data_size (G_MEMORY_OUTPUT_STREAM (stream)), ==, 0);
+  g_assert_false (g_output_stream_is_closed (stream));
+
+  fail_after_first_batch = FALSE;
+  gcal_exporter_set_backend_for_testing (NULL);
+}
+
+/*********************************************************************************************************************/
+
+static void
+export_to_directory (GFile   *directory,
+                     guint   *out_n_exported,
+                     GError **error)
+{
+  g_autoptr (GAsyncResult) result = NULL;
+  g_autoptr (GPtrArray) calendars = NULL;
+
+  calendars = create_calendars ();
+
+  gcal_exporter_export_to_directory (calendars, NULL, directory, NULL, NULL, NULL, on_export_finished_cb, &result);
+  gcal_exporter_export_to_directory_finish (wait_for_result (&result), out_n_exported, error);
+}
+
+static guint
+count_files (const gchar *path)
+{
+  g_autoptr (GDir) dir = NULL;
+  guint n_files = 0;
+
+  dir = g_dir_open (path, 0, NULL);
+  g_assert_nonnull (dir);
+
+  while (g_dir_read_name (dir))
+    n_files++;
+
+  return n_files;
+}
+
+static void
+exporter_directory_failure (void)
+{
+  g_autoptr (GFile) directory = NULL;
+  g_autoptr (GError) error = NULL;
+  g_autofree gchar *contents = NULL;
+  g_autofree gchar *path = NULL;
+  g_autofree gchar *file_path = NULL;
+  guint n_exported;
+
+  gcal_exporter_set_backend_for_testing (&stub_backend);
+
+  path = g_dir_make_tmp ("gcal-exporter-XXXXXX", &error);
+  g_assert_no_error (error);
+
+  directory = g_file_new_for_path (path);
+  file_path = g_build_filename (path, "stub.ics", NULL);
+
+  /* A failed export doesn't create the file */
+  fail_after_first_batch = TRUE;
+  export_to_directory (directory, &n_exported, &error);
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_FAILED);
+  g_clear_error (&error);
+
+  g_assert_cmpuint (count_files (path), ==, 0);
+
+  /* A failed export keeps the existing file */
+  g_file_set_contents (file_path, ORIGINAL_CONTENTS, -1, &error);
+  g_assert_no_error (error);
+
+  export_to_directory (directory, &n_exported, &error);
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_FAILED);
+  g_clear_error (&error);
+
+  g_file_get_contents (file_path, &contents, NULL, &error);
+  g_assert_no_error (error);
+  g_assert_cmpstr (contents, ==, ORIGINAL_CONTENTS);
+  g_assert_cmpuint (count_files (path), ==, 1);
+  g_clear_pointer (&contents, g_free);
+
+  /* A successful export replaces it */
+  fail_after_first_batch = FALSE;
+  export_to_directory (directory, &n_exported, &error);
+  g_assert_no_error (error);
+  g_assert_cmpuint (n_exported, ==, N_BATCHES * EVENTS_PER_BATCH);
+
+  g_file_get_contents (file_path, &contents, NULL, &error);
+  g_assert_no_error (error);
+  g_assert_cmpuint (count_occurrences (contents, "BEGIN:VEVENT"), ==, N_BATCHES * EVENTS_PER_BATCH);
+  g_assert_cmpuint (count_files (path), ==, 1);
+
+  g_unlink (file_path);
+  g_rmdir (path);
+
+  gcal_exporter_set_backend_for_testing (NULL);
+}
+
+/*********************************************************************************************************************/
+
+gint
+main (gint   argc,
+      gchar *argv[])
+{
+  g_setenv ("TZ", "UTC", TRUE);
+
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/exporter/stream", exporter_stream);
+  g_test_add_func ("/exporter/stream-failure", exporter_stream_failure);
+  g_test_add_func ("/exporter/directory-failure", exporter_directory_failure);
+
+  return g_test_run ();
+}
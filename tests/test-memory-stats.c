@@ -0,0 +1,244 @@
+/* test-memory-stats.c
+ *
+ * Copyright 2024 Georges Basile Stavracas Neto <georges.stavracas@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <glib.h>
+
+#include "gcal-event.h"
+#include "gcal-memory-stats.h"
+#include "gcal-range-tree.h"
+#include "gcal-stub-calendar.h"
+
+/* Number of events in the synthetic calendar */
+#define N_SYNTHETIC_EVENTS 1000
+
+/* Maximum estimated size of a single event, in bytes */
+#define MAX_BYTES_PER_EVENT 2048
+
+/* Maximum estimated size of a range tree node, in bytes */
+#define MAX_BYTES_PER_NODE 128
+
+/* Threads accounting at the same time, and allocations per thread */
+#define N_ACCOUNTING_THREADS 4
+#define N_ACCOUNTING_ITERATIONS 100000
+
+/*
+ * Auxiliary methods
+ */
+
+static GPtrArray*
+create_synthetic_events (guint n_events)
+{
+  g_autoptr (GcalCalendar) calendar = NULL;
+  g_autoptr (GPtrArray) events = NULL;
+  g_autoptr (GError) error = NULL;
+
+  calendar = gcal_stub_calendar_new (NULL, &error);
+  g_assert_no_error (error);
+
+  events = g_ptr_array_new_full (n_events, g_object_unref);
+
+  for (guint i = 0; i < n_events; i++)
+    {
+      g_autoptr (ECalComponent) component = NULL;
+      g_autofree gchar *string = NULL;
+      GcalEvent *event;
+
+      string = g_strdup_printf ("BEGIN:VEVENT\n"
+                                "SUMMARY:Synthetic event %u\n"
+                                "LOCATION:Meeting room %u\n"
+                                "DESCRIPTION:A synthetic event with a description that is about as long "
+                                "as what is usually found in invitations sent by other clients.\n"
+                                "UID:synthetic-event-%u@gnome-calendar\n"
+                                "DTSTAMP:20240101T000000Z\n"
+                                "DTSTART:202401%02uT%02u0000Z\n"
+                                "DTEND:202401%02uT%02u3000Z\n"
+                                "END:VEVENT\n",
+                                i, i % 20, i,
+                                i % 28 + 1, i % 23,
+                                i % 28 + 1, i % 23);
+
+      component = e_cal_component_new_from_string (string);
+      g_assert_nonnull (component);
+
+      event = gcal_event_new (calendar, component, &error);
+      g_assert_no_error (error);
+      g_assert_nonnull (event);
+
+      g_ptr_array_add (events, event);
+    }
+
+  return g_steal_pointer (&events);
+}
+
+
+/*********************************************************************************************************************/
+
+static void
+memory_stats_accounting (void)
+{
+  GcalMemoryUsage before;
+  GcalMemoryUsage usage;
+
+  gcal_memory_stats_get_usage (GCAL_MEMORY_WEATHER, &before);
+
+  gcal_memory_stats_add (GCAL_MEMORY_WEATHER, 2, 100);
+  gcal_memory_stats_add (GCAL_MEMORY_WEATHER, 1, 50);
+  gcal_memory_stats_remove (GCAL_MEMORY_WEATHER, 2, 120);
+
+  gcal_memory_stats_get_usage (GCAL_MEMORY_WEATHER, &usage);
+  g_assert_cmpuint (usage.n_objects, ==, before.n_objects + 1);
+  g_assert_cmpuint (usage.n_bytes, ==, before.n_bytes + 30);
+  g_assert_cmpuint (usage.peak_objects, >=, before.n_objects + 3);
+  g_assert_cmpuint (usage.peak_bytes, >=, before.n_bytes + 150);
+
+  gcal_memory_stats_reset_peaks ();
+
+  gcal_memory_stats_get_usage (GCAL_MEMORY_WEATHER, &usage);
+  g_assert_cmpuint (usage.peak_objects, ==, usage.n_objects);
+  g_assert_cmpuint (usage.peak_bytes, ==, usage.n_bytes);
+
+  gcal_memory_stats_remove (GCAL_MEMORY_WEATHER, 1, 30);
+}
+
+/*********************************************************************************************************************/
+
+static gpointer
+account_in_thread (gpointer user_data)
+{
+  for (guint i = 0; i < N_ACCOUNTING_ITERATIONS; i++)
+    {
+      gcal_memory_stats_add (GCAL_MEMORY_WEATHER, 1, 10);
+      gcal_memory_stats_remove (GCAL_MEMORY_WEATHER, 1, 10);
+    }
+
+  return NULL;
+}
+
+static void
+memory_stats_threads (void)
+{
+  GThread *threads[N_ACCOUNTING_THREADS];
+  GcalMemoryUsage before;
+  GcalMemoryUsage usage;
+  guint i;
+
+  gcal_memory_stats_reset_peaks ();
+  gcal_memory_stats_get_usage (GCAL_MEMORY_WEATHER, &before);
+
+  for (i = 0; i < N_ACCOUNTING_THREADS; i++)
+    threads[i] = g_thread_new ("Accounting", account_in_thread, NULL);
+
+  for (i = 0; i < N_ACCOUNTING_THREADS; i++)
+    g_thread_join (threads[i]);
+
+  /* No update is lost, and the peak is one of the values actually reached */
+  gcal_memory_stats_get_usage (GCAL_MEMORY_WEATHER, &usage);
+  g_assert_cmpuint (usage.n_objects, ==, before.n_objects);
+  g_assert_cmpuint (usage.n_bytes, ==, before.n_bytes);
+  g_assert_cmpuint (usage.peak_objects, >=, before.n_objects + 1);
+  g_assert_cmpuint (usage.peak_objects, <=, before.n_objects + N_ACCOUNTING_THREADS);
+  g_assert_cmpuint (usage.peak_bytes, >=, before.n_bytes + 10);
+  g_assert_cmpuint (usage.peak_bytes, <=, before.n_bytes + 10 * N_ACCOUNTING_THREADS);
+}
+
+/*********************************************************************************************************************/
+
+static void
+memory_stats_event_budget (void)
+{
+  g_autoptr (GPtrArray) events = NULL;
+  GcalMemoryUsage before;
+  GcalMemoryUsage usage;
+  gsize bytes_per_event;
+
+  gcal_memory_stats_get_usage (GCAL_MEMORY_EVENTS, &before);
+
+  events = create_synthetic_events (N_SYNTHETIC_EVENTS);
+
+  gcal_memory_stats_get_usage (GCAL_MEMORY_EVENTS, &usage);
+  g_assert_cmpuint (usage.n_objects, ==, before.n_objects + N_SYNTHETIC_EVENTS);
+
+  bytes_per_event = (usage.n_bytes - before.n_bytes) / N_SYNTHETIC_EVENTS;
+  g_test_message ("Estimated size per event: %" G_GSIZE_FORMAT " bytes", bytes_per_event);
+  g_assert_cmpuint (bytes_per_event, <=, MAX_BYTES_PER_EVENT);
+
+  /* Everything must be released with the events */
+  g_clear_pointer (&events, g_ptr_array_unref);
+
+  gcal_memory_stats_get_usage (GCAL_MEMORY_EVENTS, &usage);
+  g_assert_cmpuint (usage.n_objects, ==, before.n_objects);
+  g_assert_cmpuint (usage.n_bytes, ==, before.n_bytes);
+}
+
+/*********************************************************************************************************************/
+
+static void
+memory_stats_range_tree_budget (void)
+{
+  g_autoptr (GcalRangeTree) range_tree = NULL;
+  g_autoptr (GPtrArray) events = NULL;
+  GcalMemoryUsage before;
+  GcalMemoryUsage usage;
+  gsize n_nodes;
+
+  events = create_synthetic_events (N_SYNTHETIC_EVENTS);
+
+  gcal_memory_stats_get_usage (GCAL_MEMORY_RANGE_TREE_NODES, &before);
+
+  range_tree = gcal_range_tree_new_with_free_func (g_object_unref);
+  for (guint i = 0; i < events->len; i++)
+    {
+      GcalEvent *event = g_ptr_array_index (events, i);
+
+      gcal_range_tree_add_range (range_tree, gcal_event_get_range (event), g_object_ref (event));
+    }
+
+  gcal_memory_stats_get_usage (GCAL_MEMORY_RANGE_TREE_NODES, &usage);
+
+  /* Events with the same range share the same node */
+  n_nodes = usage.n_objects - before.n_objects;
+  g_assert_cmpuint (n_nodes, >, 0);
+  g_assert_cmpuint (n_nodes, <=, N_SYNTHETIC_EVENTS);
+  g_assert_cmpuint ((usage.n_bytes - before.n_bytes) / n_nodes, <=, MAX_BYTES_PER_NODE);
+
+  g_clear_pointer (&range_tree, gcal_range_tree_unref);
+
+  gcal_memory_stats_get_usage (GCAL_MEMORY_RANGE_TREE_NODES, &usage);
+  g_assert_cmpuint (usage.n_objects, ==, before.n_objects);
+  g_assert_cmpuint (usage.n_bytes, ==, before.n_bytes);
+}
+
+/*********************************************************************************************************************/
+
+gint
+main (gint   argc,
+      gchar *argv[])
+{
+  g_setenv ("TZ", "UTC", TRUE);
+
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/memory-stats/accounting", memory_stats_accounting);
+  g_test_add_func ("/memory-stats/threads", memory_stats_threads);
+  g_test_add_func ("/memory-stats/event-budget", memory_stats_event_budget);
+  g_test_add_func ("/memory-stats/range-tree-budget", memory_stats_range_tree_budget);
+
+  return g_test_run ();
+}
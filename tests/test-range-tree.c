@@ -19,6 +19,7 @@
  */
 
 #include "gcal-range-tree.h"
+#include "gcal-range-tree-private.h"
 
 /*********************************************************************************************************************/
 
@@ -185,6 +186,338 @@ range_tree_remove_data (void)
 
 /*********************************************************************************************************************/
 
+static void
+range_tree_indexed_remove_data (void)
+{
+  g_autoptr (GcalRangeTree) range_tree = NULL;
+  g_autoptr (GcalRange) range = NULL;
+  g_autoptr (GcalRange) range2 = NULL;
+  g_autoptr (GDateTime) start = NULL;
+  g_autoptr (GDateTime) end = NULL;
+  g_autoptr (GDateTime) end2 = NULL;
+
+  range_tree = gcal_range_tree_new_full (NULL, GCAL_RANGE_TREE_INDEX_DATA);
+  g_assert_nonnull (range_tree);
+
+  start = g_date_time_new_local (2020, 3, 17, 9, 30, 0);
+  end = g_date_time_add_hours (start, 1);
+  range = gcal_range_new (start, end, GCAL_RANGE_DEFAULT);
+  end2 = g_date_time_add_hours (end, 1);
+  range2 = gcal_range_new (end, end2, GCAL_RANGE_DEFAULT);
+
+  g_assert_false (gcal_range_tree_contains_data (range_tree, (gpointer) 0xdeadbeef));
+
+  gcal_range_tree_add_range (range_tree, range, (gpointer) 0xdeadbeef);
+  gcal_range_tree_add_range (range_tree, range2, (gpointer) 0xdeadbeef);
+  gcal_range_tree_add_range (range_tree, range, (gpointer) 0xbadcafe);
+  g_assert_true (gcal_range_tree_contains_data (range_tree, (gpointer) 0xdeadbeef));
+  g_assert_true (gcal_range_tree_contains_data (range_tree, (gpointer) 0xbadcafe));
+  g_assert_cmpint (gcal_range_tree_count_entries_at_range (range_tree, range), ==, 2);
+
+  /* Remove the 2 deadbeefs, which live in different nodes */
+  gcal_range_tree_remove_data (range_tree, (gpointer) 0xdeadbeef);
+  g_assert_true (gcal_range_tree_contains_data (range_tree, (gpointer) 0xdeadbeef));
+  g_assert_cmpint (gcal_range_tree_count_entries_at_range (range_tree, range), ==, 1);
+
+  gcal_range_tree_remove_data (range_tree, (gpointer) 0xdeadbeef);
+  g_assert_false (gcal_range_tree_contains_data (range_tree, (gpointer) 0xdeadbeef));
+
+  /* Try again */
+  gcal_range_tree_remove_data (range_tree, (gpointer) 0xdeadbeef);
+  g_assert_true (gcal_range_tree_contains_data (range_tree, (gpointer) 0xbadcafe));
+  g_assert_cmpint (gcal_range_tree_count_entries_at_range (range_tree, range), ==, 1);
+
+  /* Remove bad cafe through its range */
+  gcal_range_tree_remove_range (range_tree, range, (gpointer) 0xbadcafe);
+  g_assert_false (gcal_range_tree_contains_data (range_tree, (gpointer) 0xbadcafe));
+  g_assert_cmpint (gcal_range_tree_count_entries_at_range (range_tree, range), ==, 0);
+}
+
+/*********************************************************************************************************************/
+
+static GcalRange*
+create_random_range (GDateTime *base)
+{
+  g_autoptr (GDateTime) start = NULL;
+  g_autoptr (GDateTime) end = NULL;
+
+  start = g_date_time_add_minutes (base, g_test_rand_int_range (0, 60 * 24 * 60));
+  end = g_date_time_add_minutes (start, g_test_rand_int_range (1, 60 * 24 * 3));
+
+  return gcal_range_new (start, end, GCAL_RANGE_DEFAULT);
+}
+
+static guint64
+count_overlaps_linearly (GPtrArray *inserted_ranges,
+                         GcalRange *range)
+{
+  guint64 counter = 0;
+  guint i;
+
+  for (i = 0; i < inserted_ranges->len; i++)
+    {
+      GcalRange *inserted_range = g_ptr_array_index (inserted_ranges, i);
+
+      if (gcal_range_calculate_overlap (inserted_range, range, NULL) != GCAL_RANGE_NO_OVERLAP)
+        counter++;
+    }
+
+  return counter;
+}
+
+static void
+range_tree_query_at_range (void)
+{
+  g_autoptr (GcalRangeTree) range_tree = NULL;
+  g_autoptr (GPtrArray) inserted_ranges = NULL;
+  g_autoptr (GDateTime) base = NULL;
+  gint i;
+
+  range_tree = gcal_range_tree_new ();
+  inserted_ranges = g_ptr_array_new_with_free_func ((GDestroyNotify) gcal_range_unref);
+  base = g_date_time_new_local (2020, 1, 1, 0, 0, 0);
+
+  for (i = 0; i < 500; i++)
+    {
+      g_autoptr (GcalRange) range = create_random_range (base);
+
+      gcal_range_tree_add_range (range_tree, range, range);
+      g_ptr_array_add (inserted_ranges, g_steal_pointer (&range));
+    }
+
+  /* Removing entries must keep the subtree maximums correct */
+  for (i = 0; i < 200; i++)
+    {
+      guint index = g_test_rand_int_range (0, inserted_ranges->len);
+      GcalRange *range = g_ptr_array_index (inserted_ranges, index);
+
+      gcal_range_tree_remove_range (range_tree, range, range);
+      g_ptr_array_remove_index_fast (inserted_ranges, index);
+    }
+
+  for (i = 0; i < 200; i++)
+    {
+      g_autoptr (GcalRange) range = create_random_range (base);
+      g_autoptr (GPtrArray) data = NULL;
+      guint64 expected;
+
+      expected = count_overlaps_linearly (inserted_ranges, range);
+      data = gcal_range_tree_get_data_at_range (range_tree, range);
+
+      g_assert_cmpuint (gcal_range_tree_count_entries_at_range (range_tree, range), ==, expected);
+      g_assert_cmpuint (data ? data->len : 0, ==, expected);
+    }
+}
+
+/*********************************************************************************************************************/
+
+static void
+range_tree_iter (void)
+{
+  g_autoptr (GcalRangeTree) range_tree = NULL;
+  g_autoptr (GDateTime) base = NULL;
+  gint i;
+
+  range_tree = gcal_range_tree_new_with_free_func ((GDestroyNotify) gcal_range_unref);
+  base = g_date_time_new_local (2020, 1, 1, 0, 0, 0);
+
+  for (i = 0; i < 500; i++)
+    {
+      GcalRange *range = create_random_range (base);
+
+      gcal_range_tree_add_range (range_tree, range, range);
+    }
+
+  for (i = 0; i < 200; i++)
+    {
+      g_autoptr (GcalRange) range = create_random_range (base);
+      g_autoptr (GPtrArray) data = NULL;
+      GcalRangeTreeIter iter;
+      GcalRange *entry_range;
+      gpointer entry_data;
+      guint n_entries;
+
+      data = gcal_range_tree_get_data_at_range (range_tree, range);
+      n_entries = 0;
+
+      /* Entries must come in the same order as the array */
+      gcal_range_tree_iter_init_at_range (&iter, range_tree, range);
+      while (gcal_range_tree_iter_next (&iter, &entry_range, &entry_data))
+        {
+          g_assert_nonnull (data);
+          g_assert_cmpuint (n_entries, <, data->len);
+          g_assert_true (g_ptr_array_index (data, n_entries) == entry_data);
+          g_assert_cmpint (gcal_range_compare (entry_range, entry_data), ==, 0);
+          n_entries++;
+        }
+
+      g_assert_cmpuint (n_entries, ==, data ? data->len : 0);
+    }
+}
+
+/*********************************************************************************************************************/
+
+static void
+range_tree_query_visits (void)
+{
+  g_autoptr (GcalRangeTree) range_tree = NULL;
+  g_autoptr (GDateTime) query_start = NULL;
+  g_autoptr (GDateTime) query_end = NULL;
+  g_autoptr (GcalRange) query = NULL;
+  g_autoptr (GPtrArray) data = NULL;
+  g_autoptr (GDateTime) base = NULL;
+  GcalRangeTreeIter iter;
+  guint64 max_visits;
+  guint n_entries;
+  guint i;
+
+  range_tree = gcal_range_tree_new_with_free_func ((GDestroyNotify) gcal_range_unref);
+  base = g_date_time_new_local (2020, 1, 1, 0, 0, 0);
+
+  /* One entry per hour, for 1000 hours */
+  for (i = 0; i < 1000; i++)
+    {
+      g_autoptr (GDateTime) start = g_date_time_add_hours (base, i);
+      g_autoptr (GDateTime) end = g_date_time_add_hours (base, i + 1);
+      GcalRange *range = gcal_range_new (start, end, GCAL_RANGE_DEFAULT);
+
+      gcal_range_tree_add_range (range_tree, range, range);
+    }
+
+  query_start = g_date_time_add_hours (base, 500);
+  query_end = g_date_time_add_hours (base, 503);
+  query = gcal_range_new (query_start, query_end, GCAL_RANGE_DEFAULT);
+
+  /*
+   * Besides the 3 matches, the ~50 entries ending within the two days before
+   * the query may be visited, as well as two paths from the root, which are
+   * shorter than 1.45 log2 (1000) ≈ 15 nodes. Each of those nodes may touch
+   * a pruned child too. A full scan visits all 1000 nodes.
+   */
+  max_visits = 2 * (3 + 50 + 2 * 15) + 1;
+
+  gcal_range_tree_count_visits_for_testing (range_tree);
+  data = gcal_range_tree_get_data_at_range (range_tree, query);
+
+  g_assert_nonnull (data);
+  g_assert_cmpuint (data->len, ==, 3);
+  g_assert_cmpuint (gcal_range_tree_get_n_visits_for_testing (range_tree), >=, 3);
+  g_assert_cmpuint (gcal_range_tree_get_n_visits_for_testing (range_tree), <=, max_visits);
+
+  gcal_range_tree_count_visits_for_testing (range_tree);
+  n_entries = 0;
+
+  gcal_range_tree_iter_init_at_range (&iter, range_tree, query);
+  while (gcal_range_tree_iter_next (&iter, NULL, NULL))
+    n_entries++;
+
+  g_assert_cmpuint (n_entries, ==, 3);
+  g_assert_cmpuint (gcal_range_tree_get_n_visits_for_testing (range_tree), >=, 3);
+  g_assert_cmpuint (gcal_range_tree_get_n_visits_for_testing (range_tree), <=, max_visits);
+}
+
+/*********************************************************************************************************************/
+
+static void
+assert_trees_equal (GcalRangeTree *range_tree,
+                    GcalRangeTree *other_range_tree,
+                    GDateTime     *base)
+{
+  g_autoptr (GPtrArray) other_data = NULL;
+  g_autoptr (GPtrArray) data = NULL;
+  guint i;
+
+  data = gcal_range_tree_get_all_data (range_tree);
+  other_data = gcal_range_tree_get_all_data (other_range_tree);
+
+  g_assert_cmpuint (data->len, ==, other_data->len);
+
+  for (i = 0; i < data->len; i++)
+    g_assert_true (g_ptr_array_index (data, i) == g_ptr_array_index (other_data, i));
+
+  for (i = 0; i < 200; i++)
+    {
+      g_autoptr (GcalRange) range = create_random_range (base);
+      g_autoptr (GPtrArray) other_data_at_range = NULL;
+      g_autoptr (GPtrArray) data_at_range = NULL;
+
+      data_at_range = gcal_range_tree_get_data_at_range (range_tree, range);
+      other_data_at_range = gcal_range_tree_get_data_at_range (other_range_tree, range);
+
+      g_assert_cmpuint (data_at_range ? data_at_range->len : 0, ==, other_data_at_range ? other_data_at_range->len : 0);
+    }
+}
+
+static void
+range_tree_bulk_load (void)
+{
+  g_autoptr (GcalRangeTree) incremental_range_tree = NULL;
+  g_autoptr (GcalRangeTree) merged_range_tree = NULL;
+  g_autoptr (GcalRangeTree) bulk_range_tree = NULL;
+  g_autoptr (GPtrArray) ranges = NULL;
+  g_autoptr (GPtrArray) data = NULL;
+  g_autoptr (GDateTime) base = NULL;
+  guint half;
+  guint i;
+
+  ranges = g_ptr_array_new_with_free_func ((GDestroyNotify) gcal_range_unref);
+  data = g_ptr_array_new ();
+  base = g_date_time_new_local (2020, 1, 1, 0, 0, 0);
+
+  for (i = 0; i < 2000; i++)
+    {
+      g_autoptr (GcalRange) range = NULL;
+
+      /* Store some entries at the same range, which share a node */
+      if (i > 0 && g_test_rand_int_range (0, 10) == 0)
+        range = gcal_range_ref (g_ptr_array_index (ranges, g_test_rand_int_range (0, ranges->len)));
+      else
+        range = create_random_range (base);
+
+      g_ptr_array_add (ranges, g_steal_pointer (&range));
+      g_ptr_array_add (data, GUINT_TO_POINTER (i + 1));
+    }
+
+  incremental_range_tree = gcal_range_tree_new ();
+  for (i = 0; i < ranges->len; i++)
+    gcal_range_tree_add_range (incremental_range_tree, g_ptr_array_index (ranges, i), g_ptr_array_index (data, i));
+
+  bulk_range_tree = gcal_range_tree_new_from_array (NULL,
+                                                    GCAL_RANGE_TREE_DEFAULT,
+                                                    (GcalRange **) ranges->pdata,
+                                                    data->pdata,
+                                                    ranges->len);
+
+  assert_trees_equal (incremental_range_tree, bulk_range_tree, base);
+
+  /* Bulk-add into a tree that already has entries */
+  half = ranges->len / 2;
+  merged_range_tree = gcal_range_tree_new ();
+
+  for (i = 0; i < half; i++)
+    gcal_range_tree_add_range (merged_range_tree, g_ptr_array_index (ranges, i), g_ptr_array_index (data, i));
+
+  gcal_range_tree_add_ranges (merged_range_tree,
+                              (GcalRange **) ranges->pdata + half,
+                              data->pdata + half,
+                              ranges->len - half);
+
+  assert_trees_equal (incremental_range_tree, merged_range_tree, base);
+
+  /* The bulk-loaded tree must keep working with regular operations */
+  for (i = 0; i < 500; i++)
+    {
+      GcalRange *range = g_ptr_array_index (ranges, i);
+
+      gcal_range_tree_remove_range (incremental_range_tree, range, g_ptr_array_index (data, i));
+      gcal_range_tree_remove_range (bulk_range_tree, range, g_ptr_array_index (data, i));
+    }
+
+  assert_trees_equal (incremental_range_tree, bulk_range_tree, base);
+}
+
+/*********************************************************************************************************************/
+
 gint
 main (gint   argc,
       gchar *argv[])
@@ -199,6 +532,11 @@ main (gint   argc,
   g_test_add_func ("/range-tree/traverse", range_tree_traverse);
   g_test_add_func ("/range-tree/smaller-range", range_tree_smaller_range);
   g_test_add_func ("/range-tree/remove-data", range_tree_remove_data);
+  g_test_add_func ("/range-tree/indexed-remove-data", range_tree_indexed_remove_data);
+  g_test_add_func ("/range-tree/query-at-range", range_tree_query_at_range);
+  g_test_add_func ("/range-tree/bulk-load", range_tree_bulk_load);
+  g_test_add_func ("/range-tree/iter", range_tree_iter);
+  g_test_add_func ("/range-tree/query-visits", range_tree_query_visits);
 
   return g_test_run ();
 }
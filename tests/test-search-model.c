@@ -0,0 +1,408 @@
+/* test-search-model.c
+ *
+ * Copyright 2024 Georges Basile Stavracas Neto <georges.stavracas@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <glib.h>
+
+#include "gcal-event.h"
+#include "gcal-search-hit-event.h"
+#include "gcal-search-model.h"
+#include "gcal-search-ranker.h"
+#include "gcal-search-ranker-private.h"
+#include "gcal-stub-calendar.h"
+#include "gcal-timeline-subscriber.h"
+
+#define N_EVENTS 25
+
+/*
+ * Auxiliary methods
+ */
+
+static GcalEvent*
+create_event (GcalCalendar *calendar,
+              const gchar  *summary,
+              const gchar  *location,
+              guint         day)
+{
+  g_autoptr (ECalComponent) component = NULL;
+  g_autoptr (GError) error = NULL;
+  g_autofree gchar *string = NULL;
+  GcalEvent *event;
+
+  string = g_strdup_printf ("BEGIN:VEVENT\n"
+                            "SUMMARY:%s\n"
+                            "%s%s%s"
+                            "UID:event-%s-%u@uid\n"
+                            "DTSTAMP:19970114T170000Z\n"
+                            "DTSTART:209901%02uT100000Z\n"
+                            "DTEND:209901%02uT110000Z\n"
+                            "END:VEVENT\n",
+                            summary,
+                            location ? "LOCATION:" : "",
+                            location ? location : "",
+                            location ? "\n" : "",
+                            summary,
+                            day,
+                            day,
+                            day);
+
+  component = e_cal_component_new_from_string (string);
+  g_assert_nonnull (component);
+
+  event = gcal_event_new (calendar, component, &error);
+  g_assert_no_error (error);
+
+  return event;
+}
+
+static GcalEvent*
+create_instance (GcalCalendar *calendar,
+                 guint         day)
+{
+  g_autoptr (ECalComponent) component = NULL;
+  g_autoptr (GError) error = NULL;
+  g_autofree gchar *string = NULL;
+  GcalEvent *event;
+
+  string = g_strdup_printf ("BEGIN:VEVENT\n"
+                            "SUMMARY:Standup\n"
+                            "UID:standup@uid\n"
+                            "RECURRENCE-ID:209901%02uT100000Z\n"
+                            "DTSTAMP:19970114T170000Z\n"
+                            "DTSTART:209901%02uT100000Z\n"
+                            "DTEND:209901%02uT103000Z\n"
+                            "RRULE:FREQ=DAILY\n"
+                            "END:VEVENT\n",
+                            day,
+                            day,
+                            day);
+
+  component = e_cal_component_new_from_string (string);
+  g_assert_nonnull (component);
+
+  event = gcal_event_new (calendar, component, &error);
+  g_assert_no_error (error);
+
+  return event;
+}
+
+static void
+on_items_changed_cb (GListModel *model,
+                     guint       position,
+                     guint       removed,
+                     guint       added,
+                     guint      *n_emissions)
+{
+  *n_emissions += 1;
+}
+
+static void
+assert_model_sorted (GListModel *model)
+{
+  g_autoptr (GDateTime) previous_start = NULL;
+  guint i;
+
+  for (i = 0; i < g_list_model_get_n_items (model); i++)
+    {
+      g_autoptr (GcalSearchHitEvent) hit = g_list_model_get_item (model, i);
+      GDateTime *start;
+
+      start = gcal_event_get_date_start (gcal_search_hit_event_get_event (hit));
+
+      if (previous_start)
+        g_assert_cmpint (g_date_time_compare (previous_start, start), <, 0);
+
+      g_clear_pointer (&previous_start, g_date_time_unref);
+      previous_start = g_date_time_ref (start);
+    }
+}
+
+
+/*********************************************************************************************************************/
+
+static void
+search_model_batched_insertion (void)
+{
+  g_autoptr (GcalSearchModel) model = NULL;
+  g_autoptr (GcalCalendar) calendar = NULL;
+  g_autoptr (GDateTime) range_start = NULL;
+  g_autoptr (GDateTime) range_end = NULL;
+  g_autoptr (GPtrArray) events = NULL;
+  g_autoptr (GError) error = NULL;
+  guint n_emissions;
+  guint i;
+
+  calendar = gcal_stub_calendar_new (NULL, &error);
+  g_assert_no_error (error);
+
+  range_start = g_date_time_new_utc (2099, 1, 1, 0, 0, 0);
+  range_end = g_date_time_new_utc (2099, 2, 1, 0, 0, 0);
+
+  model = gcal_search_model_new (NULL, NULL, range_start, range_end);
+  gcal_search_model_set_max_results (model, 10);
+
+  n_emissions = 0;
+  g_signal_connect (model, "items-changed", G_CALLBACK (on_items_changed_cb), &n_emissions);
+
+  /* Far in the future, so that hits are ranked by ascending start */
+  events = g_ptr_array_new_with_free_func (g_object_unref);
+  for (i = 0; i < N_EVENTS; i++)
+    {
+      g_autofree gchar *summary = g_strdup_printf ("Stub event %u", i + 1);
+      g_ptr_array_add (events, create_event (calendar, summary, NULL, i + 1));
+    }
+
+  /* Add out of order, and report one event twice */
+  for (i = 0; i < N_EVENTS; i++)
+    gcal_timeline_subscriber_add_event (GCAL_TIMELINE_SUBSCRIBER (model), g_ptr_array_index (events, (i * 7) % N_EVENTS));
+  gcal_timeline_subscriber_add_event (GCAL_TIMELINE_SUBSCRIBER (model), g_ptr_array_index (events, 3));
+
+  /* Nothing is exposed until the batch is flushed */
+  g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (model)), ==, 0);
+  g_assert_cmpuint (n_emissions, ==, 0);
+
+  while (g_main_context_iteration (NULL, FALSE))
+    ;
+
+  g_assert_cmpuint (n_emissions, ==, 1);
+  g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (model)), ==, 10);
+  g_assert_cmpuint (gcal_search_model_get_n_hidden_hits (model), ==, N_EVENTS - 10);
+  assert_model_sorted (G_LIST_MODEL (model));
+
+  /* Show more */
+  gcal_search_model_show_more (model);
+
+  g_assert_cmpuint (n_emissions, ==, 2);
+  g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (model)), ==, 20);
+  assert_model_sorted (G_LIST_MODEL (model));
+
+  gcal_search_model_show_more (model);
+
+  g_assert_cmpuint (n_emissions, ==, 3);
+  g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (model)), ==, N_EVENTS);
+  g_assert_cmpuint (gcal_search_model_get_n_hidden_hits (model), ==, 0);
+  assert_model_sorted (G_LIST_MODEL (model));
+
+  /* Nothing left to show */
+  gcal_search_model_show_more (model);
+  g_assert_cmpuint (n_emissions, ==, 3);
+}
+
+/*********************************************************************************************************************/
+
+static void
+search_model_ranking (void)
+{
+  g_autoptr (GcalSearchRanker) previous_ranker = NULL;
+  g_autoptr (GcalSearchRanker) ranker = NULL;
+  g_autoptr (GcalCalendar) calendar = NULL;
+  g_autoptr (GcalEvent) prefix_match = NULL;
+  g_autoptr (GcalEvent) second_word = NULL;
+  g_autoptr (GcalEvent) location = NULL;
+  g_autoptr (GcalEvent) infix = NULL;
+  g_autoptr (GcalEvent) far_away = NULL;
+  g_autoptr (GDateTime) now = NULL;
+  g_autoptr (GError) error = NULL;
+  GcalSearchFeatures features;
+  gdouble prefix_match_score;
+  gdouble second_word_score;
+  gdouble location_score;
+  gdouble infix_score;
+  gdouble far_away_score;
+
+  calendar = gcal_stub_calendar_new (NULL, &error);
+  g_assert_no_error (error);
+
+  now = g_date_time_new_utc (2099, 1, 10, 12, 0, 0);
+
+  prefix_match = create_event (calendar, "Standup", NULL, 11);
+  second_word = create_event (calendar, "Daily standup", NULL, 11);
+  location = create_event (calendar, "Team sync", "Standing room", 11);
+  infix = create_event (calendar, "Outstanding bills", NULL, 11);
+  far_away = create_event (calendar, "Standup", NULL, 28);
+
+  previous_ranker = gcal_search_ranker_new ("stan", now, NULL);
+  ranker = gcal_search_ranker_new ("STAND", now, previous_ranker);
+
+  prefix_match_score = gcal_search_ranker_score_event (ranker, prefix_match, &features);
+  g_assert_cmpint (features.field, ==, GCAL_SEARCH_FIELD_SUMMARY);
+  g_assert_cmpuint (features.token_position, ==, 0);
+  g_assert_true (features.word_start);
+
+  second_word_score = gcal_search_ranker_score_event (ranker, second_word, &features);
+  g_assert_cmpint (features.field, ==, GCAL_SEARCH_FIELD_SUMMARY);
+  g_assert_cmpuint (features.token_position, ==, 1);
+  g_assert_true (features.word_start);
+
+  location_score = gcal_search_ranker_score_event (ranker, location, &features);
+  g_assert_cmpint (features.field, ==, GCAL_SEARCH_FIELD_LOCATION);
+  g_assert_cmpuint (features.token_position, ==, 0);
+
+  infix_score = gcal_search_ranker_score_event (ranker, infix, &features);
+  g_assert_cmpint (features.field, ==, GCAL_SEARCH_FIELD_SUMMARY);
+  g_assert_false (features.word_start);
+
+  far_away_score = gcal_search_ranker_score_event (ranker, far_away, &features);
+  g_assert_cmpfloat (features.proximity, <, 1.0);
+
+  g_assert_cmpfloat (prefix_match_score, >, second_word_score);
+  g_assert_cmpfloat (second_word_score, >, location_score);
+  g_assert_cmpfloat (prefix_match_score, >, infix_score);
+  g_assert_cmpfloat (prefix_match_score, >, far_away_score);
+
+  /* The tokenized texts are shared, but the query is not */
+  g_assert_cmpfloat (gcal_search_ranker_score_event (previous_ranker, prefix_match, NULL), ==, prefix_match_score);
+  g_assert_cmpfloat (gcal_search_ranker_score_event (previous_ranker, infix, NULL), ==, infix_score);
+}
+
+/*********************************************************************************************************************/
+
+static void
+search_model_ranking_cache_limit (void)
+{
+  g_autoptr (GcalSearchRanker) ranker = NULL;
+  g_autoptr (GcalCalendar) calendar = NULL;
+  g_autoptr (GcalEvent) first_event = NULL;
+  g_autoptr (GDateTime) now = NULL;
+  g_autoptr (GError) error = NULL;
+  guint n_events;
+  guint i;
+
+  calendar = gcal_stub_calendar_new (NULL, &error);
+  g_assert_no_error (error);
+
+  now = g_date_time_new_utc (2099, 1, 10, 12, 0, 0);
+  ranker = gcal_search_ranker_new ("stand", now, NULL);
+
+  /* An odd number of cached texts makes the limit fall in the middle of an event */
+  first_event = create_event (calendar, "Standup", NULL, 11);
+  gcal_search_ranker_score_event (ranker, first_event, NULL);
+  g_assert_cmpuint (gcal_search_ranker_get_n_cached_texts (ranker), ==, 1);
+
+  n_events = GCAL_SEARCH_RANKER_MAX_CACHED_TEXTS;
+
+  for (i = 0; i < n_events; i++)
+    {
+      g_autoptr (GcalSearchRanker) uncached_ranker = NULL;
+      g_autoptr (GcalEvent) event = NULL;
+      g_autofree gchar *location = NULL;
+      g_autofree gchar *summary = NULL;
+      gdouble score;
+
+      summary = g_strdup_printf ("Standup %u", i);
+      location = g_strdup_printf ("Standing room %u", i);
+      event = create_event (calendar, summary, location, 11);
+
+      score = gcal_search_ranker_score_event (ranker, event, NULL);
+      g_assert_cmpuint (gcal_search_ranker_get_n_cached_texts (ranker), <=, GCAL_SEARCH_RANKER_MAX_CACHED_TEXTS);
+
+      uncached_ranker = gcal_search_ranker_new ("stand", now, NULL);
+      g_assert_cmpfloat (score, ==, gcal_search_ranker_score_event (uncached_ranker, event, NULL));
+    }
+}
+
+/*********************************************************************************************************************/
+
+static void
+search_model_collapse_series (void)
+{
+  g_autoptr (GcalSearchHitEvent) representative = NULL;
+  g_autoptr (GcalSearchModel) model = NULL;
+  g_autoptr (GcalCalendar) calendar = NULL;
+  g_autoptr (GDateTime) range_start = NULL;
+  g_autoptr (GDateTime) range_end = NULL;
+  g_autoptr (GcalEvent) single = NULL;
+  g_autoptr (GPtrArray) instances = NULL;
+  g_autoptr (GError) error = NULL;
+  guint n_emissions;
+  guint i;
+
+  calendar = gcal_stub_calendar_new (NULL, &error);
+  g_assert_no_error (error);
+
+  range_start = g_date_time_new_utc (2099, 1, 1, 0, 0, 0);
+  range_end = g_date_time_new_utc (2099, 2, 1, 0, 0, 0);
+
+  model = gcal_search_model_new (NULL, NULL, range_start, range_end);
+
+  n_emissions = 0;
+  g_signal_connect (model, "items-changed", G_CALLBACK (on_items_changed_cb), &n_emissions);
+
+  instances = g_ptr_array_new_with_free_func (g_object_unref);
+  for (i = 0; i < 5; i++)
+    g_ptr_array_add (instances, create_instance (calendar, 5 + i));
+
+  single = create_event (calendar, "Standup retrospective", NULL, 20);
+
+  /* The first batch does not have the nearest occurrence */
+  gcal_timeline_subscriber_add_event (GCAL_TIMELINE_SUBSCRIBER (model), g_ptr_array_index (instances, 3));
+  gcal_timeline_subscriber_add_event (GCAL_TIMELINE_SUBSCRIBER (model), g_ptr_array_index (instances, 4));
+  gcal_timeline_subscriber_add_event (GCAL_TIMELINE_SUBSCRIBER (model), single);
+
+  while (g_main_context_iteration (NULL, FALSE))
+    ;
+
+  g_assert_cmpuint (n_emissions, ==, 1);
+  g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (model)), ==, 2);
+
+  representative = g_list_model_get_item (G_LIST_MODEL (model), 0);
+  g_assert_true (gcal_search_hit_event_get_event (representative) == g_ptr_array_index (instances, 3));
+  g_assert_cmpuint (gcal_search_hit_event_get_n_instances (representative), ==, 2);
+  g_clear_object (&representative);
+
+  /* A better ranked occurrence replaces the representative */
+  for (i = 0; i < 3; i++)
+    gcal_timeline_subscriber_add_event (GCAL_TIMELINE_SUBSCRIBER (model), g_ptr_array_index (instances, i));
+
+  while (g_main_context_iteration (NULL, FALSE))
+    ;
+
+  g_assert_cmpuint (n_emissions, ==, 2);
+  g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (model)), ==, 2);
+
+  representative = g_list_model_get_item (G_LIST_MODEL (model), 0);
+  g_assert_true (gcal_search_hit_event_get_event (representative) == g_ptr_array_index (instances, 0));
+  g_assert_cmpuint (gcal_search_hit_event_get_n_instances (representative), ==, 5);
+
+  /* Expanding exposes every occurrence */
+  gcal_search_model_expand_series (model, gcal_search_hit_get_id (GCAL_SEARCH_HIT (representative)));
+
+  g_assert_cmpuint (n_emissions, ==, 3);
+  g_assert_cmpuint (g_list_model_get_n_items (G_LIST_MODEL (model)), ==, 6);
+  g_assert_cmpuint (gcal_search_hit_event_get_n_instances (representative), ==, 1);
+  assert_model_sorted (G_LIST_MODEL (model));
+}
+
+/*********************************************************************************************************************/
+
+gint
+main (gint   argc,
+      gchar *argv[])
+{
+  g_setenv ("TZ", "UTC", TRUE);
+
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/search-model/batched-insertion", search_model_batched_insertion);
+  g_test_add_func ("/search-model/ranking", search_model_ranking);
+  g_test_add_func ("/search-model/ranking-cache-limit", search_model_ranking_cache_limit);
+  g_test_add_func ("/search-model/collapse-series", search_model_collapse_series);
+
+  return g_test_run ();
+}
@@ -0,0 +1,259 @@
+/* test-timeline-snapshot.c
+ *
+ * Copyright 2024 Georges Basile Stavracas Neto <georges.stavracas@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <glib.h>
+
+#include "gcal-event.h"
+#include "gcal-stub-calendar.h"
+#include "gcal-timeline-snapshot.h"
+#include "gcal-timeline-snapshot-private.h"
+
+#define N_EVENTS 500
+#define N_QUERIES 200
+
+/*********************************************************************************************************************/
+
+static GcalEvent*
+create_event (GcalCalendar *calendar,
+              guint         i)
+{
+  g_autoptr (ECalComponent) component = NULL;
+  g_autoptr (GDateTime) start = NULL;
+  g_autoptr (GDateTime) end = NULL;
+  g_autoptr (GError) error = NULL;
+  g_autofree gchar *start_string = NULL;
+  g_autofree gchar *end_string = NULL;
+  g_autofree gchar *string = NULL;
+  GcalEvent *event;
+  guint duration;
+
+  /* Every 5th event has no duration, and many events end on the next days */
+  duration = i % 5 == 0 ? 0 : (i * 7) % 90 * 30;
+
+  /* Events never start at midnight, so none of them is an all day event */
+  start = g_date_time_new_utc (2024, 1, i % 28 + 1, i % 24, (i * 13) % 59 + 1, 0);
+  end = g_date_time_add_minutes (start, duration);
+  start_string = g_date_time_format (start, "%Y%m%dT%H%M%SZ");
+  end_string = g_date_time_format (end, "%Y%m%dT%H%M%SZ");
+
+  string = g_strdup_printf ("BEGIN:VEVENT\n"
+                            "SUMMARY:Event %u\n"
+                            "UID:snapshot-event-%u@gnome-calendar\n"
+                            "DTSTAMP:20240101T000000Z\n"
+                            "DTSTART:%s\n"
+                            "DTEND:%s\n"
+                            "END:VEVENT\n",
+                            i, i,
+                            start_string,
+                            end_string);
+
+  component = e_cal_component_new_from_string (string);
+  g_assert_nonnull (component);
+
+  event = gcal_event_new (calendar, component, &error);
+  g_assert_no_error (error);
+
+  return event;
+}
+
+static GPtrArray*
+create_events (void)
+{
+  g_autoptr (GcalCalendar) calendar = NULL;
+  g_autoptr (GError) error = NULL;
+  GPtrArray *events;
+  guint i;
+
+  calendar = gcal_stub_calendar_new (NULL, &error);
+  g_assert_no_error (error);
+
+  events = g_ptr_array_new_with_free_func (g_object_unref);
+  for (i = 0; i < N_EVENTS; i++)
+    g_ptr_array_add (events, create_event (calendar, i));
+
+  return events;
+}
+
+static GcalTimelineSnapshot*
+create_snapshot (GPtrArray *events)
+{
+  GcalTimelineSnapshot *snapshot;
+  guint i;
+
+  snapshot = gcal_timeline_snapshot_new ();
+
+  for (i = 0; i < events->len; i++)
+    {
+      GcalTimelineSnapshot *next;
+
+      next = gcal_timeline_snapshot_add_event (snapshot, g_ptr_array_index (events, i));
+      gcal_timeline_snapshot_unref (snapshot);
+      snapshot = next;
+    }
+
+  return snapshot;
+}
+
+static gboolean
+event_overlaps (GcalEvent *event,
+                GDateTime *range_start,
+                GDateTime *range_end)
+{
+  g_autoptr (GDateTime) start = NULL;
+  g_autoptr (GDateTime) end = NULL;
+
+  start = gcal_range_get_start (gcal_event_get_range (event));
+  end = gcal_range_get_end (gcal_event_get_range (event));
+
+  if (g_date_time_compare (start, range_end) >= 0)
+    return FALSE;
+
+  if (g_date_time_equal (start, end))
+    return g_date_time_compare (start, range_start) >= 0;
+
+  return g_date_time_compare (end, range_start) > 0;
+}
+
+/*********************************************************************************************************************/
+
+static void
+timeline_snapshot_versions (void)
+{
+  g_autoptr (GcalTimelineSnapshot) removed_snapshot = NULL;
+  g_autoptr (GcalTimelineSnapshot) added_snapshot = NULL;
+  g_autoptr (GcalTimelineSnapshot) snapshot = NULL;
+  g_autoptr (GPtrArray) events = NULL;
+
+  events = create_events ();
+
+  snapshot = gcal_timeline_snapshot_new ();
+  g_assert_cmpuint (gcal_timeline_snapshot_get_version (snapshot), ==, 0);
+  g_assert_cmpuint (gcal_timeline_snapshot_get_n_events (snapshot), ==, 0);
+
+  added_snapshot = gcal_timeline_snapshot_add_event (snapshot, g_ptr_array_index (events, 0));
+  g_assert_cmpuint (gcal_timeline_snapshot_get_version (added_snapshot), ==, 1);
+  g_assert_cmpuint (gcal_timeline_snapshot_get_n_events (added_snapshot), ==, 1);
+
+  removed_snapshot = gcal_timeline_snapshot_remove_event (added_snapshot, g_ptr_array_index (events, 0));
+  g_assert_cmpuint (gcal_timeline_snapshot_get_version (removed_snapshot), ==, 2);
+  g_assert_cmpuint (gcal_timeline_snapshot_get_n_events (removed_snapshot), ==, 0);
+
+  /* Previous versions are never modified */
+  g_assert_cmpuint (gcal_timeline_snapshot_get_n_events (snapshot), ==, 0);
+  g_assert_cmpuint (gcal_timeline_snapshot_get_n_events (added_snapshot), ==, 1);
+}
+
+/*********************************************************************************************************************/
+
+static void
+timeline_snapshot_path_copying (void)
+{
+  g_autoptr (GcalTimelineSnapshot) removed_snapshot = NULL;
+  g_autoptr (GcalTimelineSnapshot) snapshot = NULL;
+  g_autoptr (GPtrArray) all_events = NULL;
+  g_autoptr (GPtrArray) events = NULL;
+  guint n_shared;
+  gint max_height;
+  gint height;
+
+  events = create_events ();
+  snapshot = create_snapshot (events);
+
+  g_assert_cmpuint (gcal_timeline_snapshot_get_n_events (snapshot), ==, N_EVENTS);
+
+  /* AVL trees are at most ~1.44 log2(n) high */
+  height = gcal_timeline_snapshot_get_height_for_testing (snapshot);
+  max_height = 3 * g_bit_storage (N_EVENTS + 2) / 2 + 1;
+  g_assert_cmpint (height, <=, max_height);
+
+  /* Only the path to the removed event, and a few rotated nodes, are copied */
+  removed_snapshot = gcal_timeline_snapshot_remove_event (snapshot, g_ptr_array_index (events, N_EVENTS / 2));
+  n_shared = gcal_timeline_snapshot_count_shared_nodes_for_testing (snapshot, removed_snapshot);
+
+  g_assert_cmpuint (gcal_timeline_snapshot_get_n_events (removed_snapshot), ==, N_EVENTS - 1);
+  g_assert_cmpuint (n_shared, >=, N_EVENTS - 1 - 2 * max_height);
+
+  /* The original snapshot still has every event */
+  all_events = gcal_timeline_snapshot_get_events_at_range (snapshot, NULL);
+  g_assert_cmpuint (all_events->len, ==, N_EVENTS);
+}
+
+/*********************************************************************************************************************/
+
+static void
+timeline_snapshot_query (void)
+{
+  g_autoptr (GcalTimelineSnapshot) snapshot = NULL;
+  g_autoptr (GPtrArray) events = NULL;
+  g_autoptr (GRand) rand = NULL;
+  guint i;
+
+  events = create_events ();
+  snapshot = create_snapshot (events);
+  rand = g_rand_new_with_seed (0xcafe);
+
+  for (i = 0; i < N_QUERIES; i++)
+    {
+      g_autoptr (GPtrArray) expected_events = NULL;
+      g_autoptr (GPtrArray) found_events = NULL;
+      g_autoptr (GDateTime) range_start = NULL;
+      g_autoptr (GDateTime) range_end = NULL;
+      g_autoptr (GcalRange) range = NULL;
+      guint j;
+
+      range_start = g_date_time_new_utc (2024, 1,
+                                         g_rand_int_range (rand, 1, 29),
+                                         g_rand_int_range (rand, 0, 24),
+                                         g_rand_int_range (rand, 0, 60),
+                                         0);
+      range_end = g_date_time_add_minutes (range_start, g_rand_int_range (rand, 1, 48 * 60));
+      range = gcal_range_new (range_start, range_end, GCAL_RANGE_DEFAULT);
+
+      expected_events = g_ptr_array_new ();
+      for (j = 0; j < events->len; j++)
+        {
+          if (event_overlaps (g_ptr_array_index (events, j), range_start, range_end))
+            g_ptr_array_add (expected_events, g_ptr_array_index (events, j));
+        }
+
+      found_events = gcal_timeline_snapshot_get_events_at_range (snapshot, range);
+      g_assert_cmpuint (found_events->len, ==, expected_events->len);
+
+      for (j = 0; j < expected_events->len; j++)
+        g_assert_true (g_ptr_array_find (found_events, g_ptr_array_index (expected_events, j), NULL));
+    }
+}
+
+/*********************************************************************************************************************/
+
+gint
+main (gint   argc,
+      gchar *argv[])
+{
+  g_setenv ("TZ", "UTC", TRUE);
+
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/timeline-snapshot/versions", timeline_snapshot_versions);
+  g_test_add_func ("/timeline-snapshot/path-copying", timeline_snapshot_path_copying);
+  g_test_add_func ("/timeline-snapshot/query", timeline_snapshot_query);
+
+  return g_test_run ();
+}
@@ -0,0 +1,660 @@
+/* test-timeline.c
+ *
+ * Copyright 2024 Georges Basile Stavracas Neto <georges.stavracas@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <glib.h>
+
+#include "gcal-event.h"
+#include "gcal-stub-calendar.h"
+#include "gcal-timeline.h"
+#include "gcal-timeline-private.h"
+#include "gcal-timeline-subscriber.h"
+
+/*
+ * These tests assert on operation counts instead of wall clock time, so
+ * they are deterministic, and fail when the amount of work done by the
+ * timeline stops being proportional to what actually changed.
+ */
+
+#define N_EVENTS 1000
+#define N_RANGE_CHANGES 20
+#define N_UPDATED_EVENTS 200
+#define N_REMOVED_EVENTS 500
+
+
+/*
+ * Stub subscriber
+ */
+
+#define TEST_TYPE_SUBSCRIBER (test_subscriber_get_type ())
+G_DECLARE_FINAL_TYPE (TestSubscriber, test_subscriber, TEST, SUBSCRIBER, GObject)
+
+struct _TestSubscriber
+{
+  GObject             parent;
+
+  GcalRange          *range;
+  GHashTable         *events;
+};
+
+static void          test_subscriber_iface_init                  (GcalTimelineSubscriberInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (TestSubscriber, test_subscriber, G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (GCAL_TYPE_TIMELINE_SUBSCRIBER, test_subscriber_iface_init))
+
+static GcalRange*
+test_subscriber_get_range (GcalTimelineSubscriber *subscriber)
+{
+  return gcal_range_ref (TEST_SUBSCRIBER (subscriber)->range);
+}
+
+static void
+test_subscriber_add_event (GcalTimelineSubscriber *subscriber,
+                           GcalEvent              *event)
+{
+  g_hash_table_add (TEST_SUBSCRIBER (subscriber)->events, g_object_ref (event));
+}
+
+static void
+test_subscriber_update_event (GcalTimelineSubscriber *subscriber,
+                              GcalEvent              *old_event,
+                              GcalEvent              *event)
+{
+  TestSubscriber *self = TEST_SUBSCRIBER (subscriber);
+
+  g_hash_table_remove (self->events, old_event);
+  g_hash_table_add (self->events, g_object_ref (event));
+}
+
+static void
+test_subscriber_remove_event (GcalTimelineSubscriber *subscriber,
+                              GcalEvent              *event)
+{
+  g_hash_table_remove (TEST_SUBSCRIBER (subscriber)->events, event);
+}
+
+static void
+test_subscriber_iface_init (GcalTimelineSubscriberInterface *iface)
+{
+  iface->get_range = test_subscriber_get_range;
+  iface->add_event = test_subscriber_add_event;
+  iface->update_event = test_subscriber_update_event;
+  iface->remove_event = test_subscriber_remove_event;
+}
+
+static void
+test_subscriber_finalize (GObject *object)
+{
+  TestSubscriber *self = (TestSubscriber *) object;
+
+  g_clear_pointer (&self->range, gcal_range_unref);
+  g_clear_pointer (&self->events, g_hash_table_destroy);
+
+  G_OBJECT_CLASS (test_subscriber_parent_class)->finalize (object);
+}
+
+static void
+test_subscriber_class_init (TestSubscriberClass *klass)
+{
+  G_OBJECT_CLASS (klass)->finalize = test_subscriber_finalize;
+}
+
+static void
+test_subscriber_init (TestSubscriber *self)
+{
+  self->events = g_hash_table_new_full (NULL, NULL, g_object_unref, NULL);
+}
+
+static GcalRange*
+create_day_range (gint first_day,
+                  gint n_days)
+{
+  g_autoptr (GDateTime) start = NULL;
+  g_autoptr (GDateTime) end = NULL;
+
+  start = g_date_time_new_utc (2024, 1, first_day, 0, 0, 0);
+  end = g_date_time_add_days (start, n_days);
+
+  return gcal_range_new (start, end, GCAL_RANGE_DEFAULT);
+}
+
+static TestSubscriber*
+test_subscriber_new (gint first_day,
+                     gint n_days)
+{
+  TestSubscriber *self = g_object_new (TEST_TYPE_SUBSCRIBER, NULL);
+
+  self->range = create_day_range (first_day, n_days);
+
+  return self;
+}
+
+static void
+test_subscriber_set_range (TestSubscriber *self,
+                           GcalRange      *range)
+{
+  g_clear_pointer (&self->range, gcal_range_unref);
+  self->range = gcal_range_ref (range);
+
+  gcal_timeline_subscriber_range_changed (GCAL_TIMELINE_SUBSCRIBER (self));
+}
+
+
+/*
+ * Auxiliary methods
+ */
+
+static GcalEvent*
+create_event (GcalCalendar *calendar,
+              guint         i,
+              guint         generation)
+{
+  g_autoptr (ECalComponent) component = NULL;
+  g_autoptr (GError) error = NULL;
+  g_autofree gchar *string = NULL;
+  GcalEvent *event;
+
+  /* Events never start or end at midnight, so they never touch range boundaries */
+  string = g_strdup_printf ("BEGIN:VEVENT\n"
+                            "SUMMARY:Event %u (%u)\n"
+                            "UID:timeline-event-%u@gnome-calendar\n"
+                            "DTSTAMP:20240101T000000Z\n"
+                            "DTSTART:202401%02uT%02u0000Z\n"
+                            "DTEND:202401%02uT%02u3000Z\n"
+                            "END:VEVENT\n",
+                            i, generation, i,
+                            i % 28 + 1, i % 22 + 1,
+                            i % 28 + 1, i % 22 + 1);
+
+  component = e_cal_component_new_from_string (string);
+  g_assert_nonnull (component);
+
+  event = gcal_event_new (calendar, component, &error);
+  g_assert_no_error (error);
+  g_assert_nonnull (event);
+
+  return event;
+}
+
+static guint
+count_events_at_range (GPtrArray *events,
+                       GcalRange *range)
+{
+  guint n_events = 0;
+  guint i;
+
+  for (i = 0; i < events->len; i++)
+    {
+      GcalEvent *event = g_ptr_array_index (events, i);
+
+      if (gcal_range_calculate_overlap (gcal_event_get_range (event), range, NULL) != GCAL_RANGE_NO_OVERLAP)
+        n_events++;
+    }
+
+  return n_events;
+}
+
+/*
+ * Range queries may also visit the entries ending up to two days before
+ * the queried range, see PRUNE_SLACK in GcalRangeTree.
+ */
+static guint
+count_events_near_range (GPtrArray *events,
+                         GcalRange *range)
+{
+  g_autoptr (GDateTime) slack_start = NULL;
+  g_autoptr (GcalRange) slack_range = NULL;
+  g_autoptr (GDateTime) start = NULL;
+  g_autoptr (GDateTime) end = NULL;
+
+  start = gcal_range_get_start (range);
+  end = gcal_range_get_end (range);
+  slack_start = g_date_time_add_days (start, -2);
+  slack_range = gcal_range_new (slack_start, end, GCAL_RANGE_DEFAULT);
+
+  return count_events_at_range (events, slack_range);
+}
+
+/*
+ * Upper bound of the nodes touched by @n_queries range queries on a tree
+ * with @n_nodes nodes, which together match @n_matches entries. Besides
+ * the matches, each query walks down at most two paths from the root, and
+ * may touch one pruned child of each node it visits. A query that scans
+ * the whole tree exceeds this.
+ */
+static guint64
+max_range_tree_visits (guint n_matches,
+                       guint n_queries,
+                       guint n_nodes)
+{
+  guint max_height;
+
+  /* The height of an AVL tree is below 1.45 log2 (n + 2) */
+  max_height = 3 * g_bit_storage (n_nodes + 2) / 2 + 1;
+
+  return 2 * ((guint64) n_matches + 2 * n_queries * max_height);
+}
+
+static guint
+count_subscribers_at_event (GcalEvent       *event,
+                            TestSubscriber **subscribers,
+                            guint            n_subscribers)
+{
+  guint n_matches = 0;
+  guint i;
+
+  for (i = 0; i < n_subscribers; i++)
+    {
+      if (gcal_range_calculate_overlap (gcal_event_get_range (event), subscribers[i]->range, NULL) != GCAL_RANGE_NO_OVERLAP)
+        n_matches++;
+    }
+
+  return n_matches;
+}
+
+static void
+drain_main_context (void)
+{
+  while (g_main_context_iteration (NULL, FALSE))
+    ;
+}
+
+/*********************************************************************************************************************/
+
+static void
+timeline_operation_counts (void)
+{
+  g_autoptr (GcalTimeline) timeline = NULL;
+  g_autoptr (GcalCalendar) calendar = NULL;
+  g_autoptr (GPtrArray) removed_events = NULL;
+  g_autoptr (GPtrArray) updated_events = NULL;
+  g_autoptr (GPtrArray) old_events = NULL;
+  g_autoptr (GPtrArray) events = NULL;
+  g_autoptr (GError) error = NULL;
+  TestSubscriber *subscribers[3];
+  GcalTimelineStats stats;
+  guint expected_visits;
+  guint expected_adds;
+  guint expected_updates;
+  guint expected_removes;
+  guint i;
+
+  calendar = gcal_stub_calendar_new (NULL, &error);
+  g_assert_no_error (error);
+
+  timeline = gcal_timeline_new (NULL);
+
+  /* A month, a week and a day, like the views do */
+  subscribers[0] = test_subscriber_new (1, 28);
+  subscribers[1] = test_subscriber_new (8, 7);
+  subscribers[2] = test_subscriber_new (10, 1);
+
+  for (i = 0; i < G_N_ELEMENTS (subscribers); i++)
+    gcal_timeline_add_subscriber (timeline, GCAL_TIMELINE_SUBSCRIBER (subscribers[i]));
+
+  drain_main_context ();
+
+  /* Event storm: events are delivered only to the subscribers they overlap */
+  events = g_ptr_array_new_with_free_func (g_object_unref);
+  for (i = 0; i < N_EVENTS; i++)
+    g_ptr_array_add (events, create_event (calendar, i, 0));
+
+  expected_adds = 0;
+  for (i = 0; i < events->len; i++)
+    expected_adds += count_subscribers_at_event (g_ptr_array_index (events, i), subscribers, G_N_ELEMENTS (subscribers));
+
+  gcal_timeline_reset_stats (timeline);
+  gcal_timeline_add_events_for_testing (timeline, events);
+  drain_main_context ();
+  gcal_timeline_get_stats (timeline, &stats);
+
+  g_assert_cmpuint (stats.subscriber_adds, ==, expected_adds);
+  g_assert_cmpuint (stats.subscriber_updates, ==, 0);
+  g_assert_cmpuint (stats.subscriber_removes, ==, 0);
+  g_assert_cmpuint (stats.queued_items, ==, N_EVENTS + expected_adds);
+  g_assert_cmpuint (stats.dispatched_items, ==, stats.queued_items);
+  g_assert_cmpuint (stats.range_tree_visits, <=, max_range_tree_visits (expected_adds, N_EVENTS, G_N_ELEMENTS (subscribers)));
+
+  for (i = 0; i < G_N_ELEMENTS (subscribers); i++)
+    g_assert_cmpuint (g_hash_table_size (subscribers[i]->events), ==, count_events_at_range (events, subscribers[i]->range));
+
+  /* Range churn: moving the week by a day only touches two days of events */
+  for (i = 0; i < N_RANGE_CHANGES; i++)
+    {
+      g_autoptr (GcalRange) new_range = NULL;
+      g_autoptr (GcalRange) removed_day = NULL;
+      g_autoptr (GcalRange) added_day = NULL;
+      guint n_removed;
+      guint n_added;
+
+      new_range = create_day_range (2 + i, 7);
+      removed_day = create_day_range (1 + i, 1);
+      added_day = create_day_range (8 + i, 1);
+
+      n_removed = count_events_at_range (events, removed_day);
+      n_added = count_events_at_range (events, added_day);
+
+      /* Start from the first week of the month */
+      if (i == 0)
+        {
+          g_autoptr (GcalRange) first_week = create_day_range (1, 7);
+
+          test_subscriber_set_range (subscribers[1], first_week);
+          drain_main_context ();
+        }
+
+      gcal_timeline_reset_stats (timeline);
+      test_subscriber_set_range (subscribers[1], new_range);
+      drain_main_context ();
+      gcal_timeline_get_stats (timeline, &stats);
+
+      g_assert_cmpuint (stats.subscriber_removes, ==, n_removed);
+      g_assert_cmpuint (stats.subscriber_adds, ==, n_added);
+      g_assert_cmpuint (stats.queued_items, ==, n_removed + n_added);
+      g_assert_cmpuint (stats.range_tree_visits, <=, max_range_tree_visits (count_events_near_range (events, removed_day) +
+                                                                            count_events_near_range (events, added_day),
+                                                                            2,
+                                                                            N_EVENTS));
+      g_assert_cmpuint (g_hash_table_size (subscribers[1]->events), ==, count_events_at_range (events, new_range));
+    }
+
+  /* Updates: one range tree update per event, one callback per overlapping subscriber */
+  old_events = g_ptr_array_new_with_free_func (g_object_unref);
+  updated_events = g_ptr_array_new_with_free_func (g_object_unref);
+  expected_updates = 0;
+
+  for (i = 0; i < N_UPDATED_EVENTS; i++)
+    {
+      GcalEvent *old_event = g_ptr_array_index (events, i);
+      GcalEvent *event = create_event (calendar, i, 1);
+
+      g_ptr_array_add (old_events, g_object_ref (old_event));
+      g_ptr_array_add (updated_events, event);
+
+      expected_updates += count_subscribers_at_event (event, subscribers, G_N_ELEMENTS (subscribers));
+    }
+
+  gcal_timeline_reset_stats (timeline);
+  gcal_timeline_update_events_for_testing (timeline, old_events, updated_events);
+  drain_main_context ();
+  gcal_timeline_get_stats (timeline, &stats);
+
+  g_assert_cmpuint (stats.subscriber_updates, ==, expected_updates);
+  g_assert_cmpuint (stats.subscriber_adds, ==, 0);
+  g_assert_cmpuint (stats.subscriber_removes, ==, 0);
+  g_assert_cmpuint (stats.queued_items, ==, N_UPDATED_EVENTS + expected_updates);
+  g_assert_cmpuint (stats.range_tree_visits, <=, max_range_tree_visits (2 * expected_updates, 2 * N_UPDATED_EVENTS, G_N_ELEMENTS (subscribers)));
+
+  for (i = 0; i < N_UPDATED_EVENTS; i++)
+    {
+      g_object_unref (g_ptr_array_index (events, i));
+      g_ptr_array_index (events, i) = g_object_ref (g_ptr_array_index (updated_events, i));
+    }
+
+  /* Removals */
+  removed_events = g_ptr_array_new_with_free_func (g_object_unref);
+  expected_removes = 0;
+
+  for (i = 0; i < N_REMOVED_EVENTS; i++)
+    {
+      GcalEvent *event = g_ptr_array_index (events, events->len - 1);
+
+      expected_removes += count_subscribers_at_event (event, subscribers, G_N_ELEMENTS (subscribers));
+      g_ptr_array_add (removed_events, g_ptr_array_steal_index (events, events->len - 1));
+    }
+
+  gcal_timeline_reset_stats (timeline);
+  gcal_timeline_remove_events_for_testing (timeline, removed_events);
+  drain_main_context ();
+  gcal_timeline_get_stats (timeline, &stats);
+
+  g_assert_cmpuint (stats.subscriber_removes, ==, expected_removes);
+  g_assert_cmpuint (stats.queued_items, ==, N_REMOVED_EVENTS + expected_removes);
+  g_assert_cmpuint (stats.range_tree_visits, <=, max_range_tree_visits (expected_removes, N_REMOVED_EVENTS, G_N_ELEMENTS (subscribers)));
+
+  for (i = 0; i < G_N_ELEMENTS (subscribers); i++)
+    g_assert_cmpuint (g_hash_table_size (subscribers[i]->events), ==, count_events_at_range (events, subscribers[i]->range));
+
+  /* Subscriber churn: only the events within range are visited */
+  {
+    g_autoptr (TestSubscriber) subscriber = test_subscriber_new (15, 3);
+
+    expected_visits = count_events_at_range (events, subscriber->range);
+
+    gcal_timeline_reset_stats (timeline);
+    gcal_timeline_add_subscriber (timeline, GCAL_TIMELINE_SUBSCRIBER (subscriber));
+    drain_main_context ();
+    gcal_timeline_get_stats (timeline, &stats);
+
+    g_assert_cmpuint (stats.subscriber_adds, ==, expected_visits);
+    g_assert_cmpuint (stats.range_tree_visits, <=, max_range_tree_visits (count_events_near_range (events, subscriber->range),
+                                                                          1,
+                                                                          N_EVENTS));
+
+    gcal_timeline_remove_subscriber (timeline, GCAL_TIMELINE_SUBSCRIBER (subscriber));
+
+    /* Queued items of a removed subscriber are dropped without callbacks */
+    gcal_timeline_reset_stats (timeline);
+    gcal_timeline_add_subscriber (timeline, GCAL_TIMELINE_SUBSCRIBER (subscriber));
+    gcal_timeline_remove_subscriber (timeline, GCAL_TIMELINE_SUBSCRIBER (subscriber));
+    drain_main_context ();
+    gcal_timeline_get_stats (timeline, &stats);
+
+    g_assert_cmpuint (stats.subscriber_adds, ==, 0);
+    g_assert_cmpuint (stats.dispatched_items, ==, stats.queued_items);
+  }
+
+  for (i = 0; i < G_N_ELEMENTS (subscribers); i++)
+    {
+      gcal_timeline_remove_subscriber (timeline, GCAL_TIMELINE_SUBSCRIBER (subscribers[i]));
+      g_object_unref (subscribers[i]);
+    }
+}
+
+/*********************************************************************************************************************/
+
+static void
+timeline_dispatch_budget (void)
+{
+  g_autoptr (TestSubscriber) subscriber = NULL;
+  g_autoptr (GcalTimeline) timeline = NULL;
+  g_autoptr (GcalCalendar) calendar = NULL;
+  g_autoptr (GPtrArray) events = NULL;
+  g_autoptr (GError) error = NULL;
+  GcalTimelineStats stats;
+  guint64 dispatched_items;
+  guint n_dispatches;
+  guint i;
+
+  calendar = gcal_stub_calendar_new (NULL, &error);
+  g_assert_no_error (error);
+
+  timeline = gcal_timeline_new (NULL);
+  subscriber = test_subscriber_new (1, 28);
+  gcal_timeline_add_subscriber (timeline, GCAL_TIMELINE_SUBSCRIBER (subscriber));
+  drain_main_context ();
+
+  events = g_ptr_array_new_with_free_func (g_object_unref);
+  for (i = 0; i < N_EVENTS; i++)
+    g_ptr_array_add (events, create_event (calendar, i, 0));
+
+  gcal_timeline_reset_stats (timeline);
+  gcal_timeline_add_events_for_testing (timeline, events);
+
+  /* A large batch is spread over several dispatches */
+  dispatched_items = 0;
+  n_dispatches = 0;
+
+  while (g_main_context_iteration (NULL, FALSE))
+    {
+      gcal_timeline_get_stats (timeline, &stats);
+      g_assert_cmpuint (stats.dispatched_items - dispatched_items, <=, GCAL_TIMELINE_MAX_COALESCED_ADDS);
+
+      dispatched_items = stats.dispatched_items;
+      n_dispatches++;
+    }
+
+  gcal_timeline_get_stats (timeline, &stats);
+
+  g_assert_cmpuint (n_dispatches, >=, N_EVENTS / GCAL_TIMELINE_MAX_COALESCED_ADDS);
+  g_assert_cmpuint (stats.dispatched_items, ==, stats.queued_items);
+  g_assert_cmpuint (g_hash_table_size (subscriber->events), ==, count_events_at_range (events, subscriber->range));
+
+  gcal_timeline_remove_subscriber (timeline, GCAL_TIMELINE_SUBSCRIBER (subscriber));
+}
+
+/*********************************************************************************************************************/
+
+typedef struct
+{
+  GcalTimeline       *timeline;
+  GcalTimelineSnapshot *snapshot;
+  gint                done;
+} SnapshotReaderData;
+
+static gpointer
+snapshot_reader_thread_func (gpointer data)
+{
+  g_autoptr (GPtrArray) events = NULL;
+  SnapshotReaderData *reader_data;
+  guint64 last_version;
+  guint n_snapshots;
+  guint i;
+
+  reader_data = data;
+
+  /* The snapshot taken before the changes stays sorted and complete */
+  events = gcal_timeline_snapshot_get_events_at_range (reader_data->snapshot, NULL);
+  g_assert_cmpuint (events->len, ==, N_EVENTS);
+
+  for (i = 1; i < events->len; i++)
+    {
+      g_autoptr (GDateTime) previous_start = NULL;
+      g_autoptr (GDateTime) start = NULL;
+
+      previous_start = gcal_range_get_start (gcal_event_get_range (g_ptr_array_index (events, i - 1)));
+      start = gcal_range_get_start (gcal_event_get_range (g_ptr_array_index (events, i)));
+
+      g_assert_cmpint (g_date_time_compare (previous_start, start), <=, 0);
+      g_assert_false (gcal_event_is_multiday (g_ptr_array_index (events, i)));
+    }
+
+  /* Versions published while the main thread removes events only move forward */
+  last_version = gcal_timeline_snapshot_get_version (reader_data->snapshot);
+  n_snapshots = 0;
+
+  do
+    {
+      g_autoptr (GcalTimelineSnapshot) snapshot = NULL;
+
+      snapshot = gcal_timeline_ref_snapshot (reader_data->timeline);
+
+      g_assert_cmpuint (gcal_timeline_snapshot_get_version (snapshot), >=, last_version);
+      g_assert_cmpuint (gcal_timeline_snapshot_get_n_events (snapshot), >=, N_EVENTS - N_REMOVED_EVENTS);
+      g_assert_cmpuint (gcal_timeline_snapshot_get_n_events (snapshot), <=, N_EVENTS);
+
+      last_version = gcal_timeline_snapshot_get_version (snapshot);
+      n_snapshots++;
+    }
+  while (!g_atomic_int_get (&reader_data->done));
+
+  return GUINT_TO_POINTER (n_snapshots);
+}
+
+static void
+timeline_snapshot (void)
+{
+  g_autoptr (GcalTimelineSnapshot) other_snapshot = NULL;
+  g_autoptr (GcalTimelineSnapshot) new_snapshot = NULL;
+  g_autoptr (GcalTimelineSnapshot) snapshot = NULL;
+  g_autoptr (GcalTimeline) timeline = NULL;
+  g_autoptr (GcalCalendar) calendar = NULL;
+  g_autoptr (GPtrArray) removed_events = NULL;
+  g_autoptr (GPtrArray) events = NULL;
+  g_autoptr (GError) error = NULL;
+  SnapshotReaderData reader_data;
+  GThread *thread;
+  guint i;
+
+  calendar = gcal_stub_calendar_new (NULL, &error);
+  g_assert_no_error (error);
+
+  timeline = gcal_timeline_new (NULL);
+
+  snapshot = gcal_timeline_ref_snapshot (timeline);
+  g_assert_cmpuint (gcal_timeline_snapshot_get_n_events (snapshot), ==, 0);
+  g_clear_pointer (&snapshot, gcal_timeline_snapshot_unref);
+
+  events = g_ptr_array_new_with_free_func (g_object_unref);
+  for (i = 0; i < N_EVENTS; i++)
+    g_ptr_array_add (events, create_event (calendar, i, 0));
+
+  gcal_timeline_add_events_for_testing (timeline, events);
+  drain_main_context ();
+
+  /* The published snapshot is shared until the events change */
+  snapshot = gcal_timeline_ref_snapshot (timeline);
+  other_snapshot = gcal_timeline_ref_snapshot (timeline);
+  g_assert_true (snapshot == other_snapshot);
+  g_assert_cmpuint (gcal_timeline_snapshot_get_n_events (snapshot), ==, N_EVENTS);
+  g_assert_cmpuint (gcal_timeline_snapshot_get_version (snapshot), >, 0);
+
+  /* Readers in other threads take snapshots while the timeline changes */
+  reader_data = (SnapshotReaderData) {
+    .timeline = timeline,
+    .snapshot = snapshot,
+    .done = FALSE,
+  };
+  thread = g_thread_new ("Snapshot reader", snapshot_reader_thread_func, &reader_data);
+
+  removed_events = g_ptr_array_new_with_free_func (g_object_unref);
+  for (i = 0; i < N_REMOVED_EVENTS; i++)
+    g_ptr_array_add (removed_events, g_object_ref (g_ptr_array_index (events, i)));
+
+  gcal_timeline_remove_events_for_testing (timeline, removed_events);
+  drain_main_context ();
+
+  g_atomic_int_set (&reader_data.done, TRUE);
+  g_assert_cmpuint (GPOINTER_TO_UINT (g_thread_join (thread)), >, 0);
+
+  new_snapshot = gcal_timeline_ref_snapshot (timeline);
+  g_assert_true (new_snapshot != snapshot);
+  g_assert_cmpuint (gcal_timeline_snapshot_get_version (new_snapshot), >, gcal_timeline_snapshot_get_version (snapshot));
+  g_assert_cmpuint (gcal_timeline_snapshot_get_n_events (new_snapshot), ==, N_EVENTS - N_REMOVED_EVENTS);
+
+  /* The old snapshot is untouched */
+  g_assert_cmpuint (gcal_timeline_snapshot_get_n_events (snapshot), ==, N_EVENTS);
+}
+
+/*********************************************************************************************************************/
+
+gint
+main (gint   argc,
+      gchar *argv[])
+{
+  g_setenv ("TZ", "UTC", TRUE);
+
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/timeline/operation-counts", timeline_operation_counts);
+  g_test_add_func ("/timeline/dispatch-budget", timeline_dispatch_budget);
+  g_test_add_func ("/timeline/snapshot", timeline_snapshot);
+
+  return g_test_run ();
+}